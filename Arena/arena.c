@@ -0,0 +1,130 @@
+/*=============================================================================
+ * Arena allocator for the decoders' per file tables.
+ *
+ * Everything that the converter and the Lister keep about one SAV file, the
+ * name table, the bytes of the names, the line index and the symbol table,
+ * is the same size for as long as the file is open, and all of it is thrown
+ * away together. The header says how big most of it will be, so it is
+ * carved out of one block, reserved before the name table is read, and
+ * freed with one call.
+ *
+ * When a batch of files is decoded, the block is kept between files, and is
+ * only reallocated when a file needs more than any before it.
+ *===========================================================================*/
+
+/*===========================================================================
+ * HEADERS
+ *===========================================================================*/
+#include "arena.h"
+
+
+/*=============================================================================
+ * ARENAINIT() Sets up an empty arena.
+ *===========================================================================*/
+void arenaInit(arena *a) {
+    a->base = NULL;
+    a->size = 0;
+    a->used = 0;
+}
+
+
+/*=============================================================================
+ * ARENARESERVE() Empties the arena and makes sure it holds at least size
+ * bytes. The old block is kept if it's big enough. Returns 1 if there isn't
+ * enough memory.
+ *===========================================================================*/
+ushort arenaReserve(arena *a, ulong size) {
+    uchar *temp;
+
+    a->used = 0;
+    if (size <= a->size && a->base) {
+        return 0;
+    }
+
+    /* Nothing to keep, so don't let realloc() copy it. */
+    free(a->base);
+    temp = malloc(size ? size : ARENA_ALIGN);
+    if (!temp) {
+        fprintf(stderr, "\n\nERROR: arenaReserve(): Cannot allocate memory for arena. (%lu bytes).\n", size);
+        arenaInit(a);
+        return 1;
+    }
+
+    a->base = temp;
+    a->size = size;
+    return 0;
+}
+
+
+/*=============================================================================
+ * ARENAALLOC() Hands out the next size bytes, aligned. Returns NULL if they
+ * weren't reserved.
+ *===========================================================================*/
+void *arenaAlloc(arena *a, ulong size) {
+    void *block;
+
+    size = (size + ARENA_ALIGN - 1) & ~(ulong)(ARENA_ALIGN - 1);
+    if (!a->base || size > a->size - a->used) {
+        fprintf(stderr, "\n\nERROR: arenaAlloc(): Arena is full. (%lu bytes wanted, %lu left).\n", size, (a->base ? a->size - a->used : 0));
+        return NULL;
+    }
+
+    block = a->base + a->used;
+    a->used += size;
+    return block;
+}
+
+
+/*=============================================================================
+ * ARENACALLOC() As arenaAlloc(), but zeroed.
+ *===========================================================================*/
+void *arenaCalloc(arena *a, ulong size) {
+    void *block = arenaAlloc(a, size);
+
+    if (block) {
+        memset(block, 0, size);
+    }
+
+    return block;
+}
+
+
+/*=============================================================================
+ * ARENARESET() Takes back everything handed out, but keeps the block.
+ *===========================================================================*/
+void arenaReset(arena *a) {
+    a->used = 0;
+}
+
+
+/*=============================================================================
+ * NAMEBYTESSIZE() How many bytes the names in a name table need, each with a
+ * zero on the end, given the header's name table length. That's the length
+ * itself, as it counts one more than each name, unless the names were too
+ * long for the header's word, and it says 65535. Then the rest of the file,
+ * from fp, is as long as they can be.
+ *===========================================================================*/
+ulong nameBytesSize(FILE *fp, ushort entries, ushort length) {
+    long here;
+    long end;
+
+    if (length != 0xFFFF) {
+        return length;
+    }
+
+    here = ftell(fp);
+    fseek(fp, 0, SEEK_END);
+    end = ftell(fp);
+    fseek(fp, here, SEEK_SET);
+
+    return (end > here ? end - here : 0) + entries;
+}
+
+
+/*=============================================================================
+ * ARENAFREE() Frees the block, and everything handed out from it.
+ *===========================================================================*/
+void arenaFree(arena *a) {
+    free(a->base);
+    arenaInit(a);
+}
@@ -0,0 +1,48 @@
+#ifndef __ARENA_H__
+#define __ARENA_H__
+
+/*===========================================================================
+ * HEADERS
+ *===========================================================================*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* The Lister's header has the same guard, and the same types. */
+#include "../C68Port/c68port.h"
+
+/*===========================================================================
+ * DEFINES
+ *===========================================================================*/
+#define ARENA_ALIGN 8               /* Every block starts on a multiple. */
+
+/* How much to reserve for count things of a type, aligned. */
+#define ARENA_SIZE(type, count) ((((ulong)(count) * sizeof(type)) + ARENA_ALIGN - 1) & ~(ulong)(ARENA_ALIGN - 1))
+
+/*===========================================================================
+ * TYPEDEFS
+ *===========================================================================*/
+
+/* One block of memory, handed out a piece at a time, and given back all at
+ * once. Used is how much has been handed out so far. */
+typedef struct arena {
+    uchar *base;
+    ulong size;
+    ulong used;
+} arena;
+
+/*===========================================================================
+ * FUNCTION PROTOTYPES
+ *===========================================================================*/
+void   arenaInit(arena *a);
+ushort arenaReserve(arena *a, ulong size);
+void  *arenaAlloc(arena *a, ulong size);
+void  *arenaCalloc(arena *a, ulong size);
+void   arenaReset(arena *a);
+void   arenaFree(arena *a);
+
+ulong  nameBytesSize(FILE *fp, ushort entries, ushort length);
+
+/*===========================================================================*/
+
+#endif /* __ARENA_H__ */
@@ -0,0 +1,46 @@
+/*=============================================================================
+ * The Lister side of the benchmarks. This is kept apart from savBench.c as
+ * the Lister's header has its own idea of what the C68Port functions look
+ * like, which clashes with the converter's header that savFile.h uses.
+ *===========================================================================*/
+
+/*===========================================================================
+ * HEADERS
+ *===========================================================================*/
+#include "../Lister/savFileLister.h"
+
+/*=============================================================================
+ * LISTERDECODE() Does what the Lister's main() does, and returns the number
+ * of bytes of the file that were decoded. Returns 0 if all was well. The
+ * arena is kept from one file to the next, so it's only reallocated when a
+ * file has a bigger name table than any before.
+ *===========================================================================*/
+ushort listerDecode(char *fileName, ulong *bytes) {
+    static arena names = {NULL, 0, 0};
+    ushort nameTableEntries = 0;
+    ushort nameTableLength = 0;
+    ushort programLines = 0;
+    ushort result = 1;
+    FILE *fp;
+
+    *bytes = 0;
+
+    fp = fopen(fileName, "rb");
+    if (!fp) {
+        fprintf(stderr, "\n\nERROR: listerDecode(): Cannot open SAV file '%s'.\n", fileName);
+        return 1;
+    }
+
+    if (decodeHeader(fp, &nameTableEntries, &nameTableLength, &programLines) == 0) {
+        if (reserveNameTable(&names, fp, nameTableEntries, nameTableLength) == 0 &&
+            decodeNameTable(nameTableEntries, fp) == 0 &&
+            decodeProgram(programLines, fp, fileName) == 0) {
+            *bytes = ftell(fp);
+            result = 0;
+        }
+    }
+
+    nameTable = NULL;
+    fclose(fp);
+    return result;
+}
@@ -0,0 +1,488 @@
+/*=============================================================================
+ * Decoder and Lister throughput benchmarks.
+ *
+ * Times the header, name table, floating point and whole program decode
+ * paths of the SavFile decoder, and the Lister's decodeProgram(), over a set
+ * of SAV files. Each benchmark is run a number of times and the MB/s and
+ * tokens/s figures reported as percentiles over the runs.
+ *
+ * The median MB/s of each benchmark, for each file, is compared with the one
+ * in the baseline file. If any is slower than the baseline by more than the
+ * margin, we exit with an error. If there is no baseline file, one is made
+ * from this run. Baselines only make sense on the machine that made them, so
+ * use -u to make a new one after a deliberate change, or a new machine.
+ *
+ * Run by 'make bench' in the C68Port directory, which builds the inputs with
+ * savGen first.
+ *
+ * Usage: savBench [-r runs] [-m margin%] [-b baseline] [-u] file ...
+ *===========================================================================*/
+
+/*===========================================================================
+ * HEADERS
+ *===========================================================================*/
+#include <time.h>
+
+#ifndef QDOS
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "savBench.h"
+
+/*===========================================================================
+ * GLOBALS
+ *===========================================================================*/
+benchCase cases[] = {
+    {"header", benchHeader},
+    {"nametable", benchNameTable},
+    {"float", benchFloats},
+    {"program", benchProgram},
+    {"lister", benchLister}
+};
+#define CASES (sizeof(cases) / sizeof(cases[0]))
+
+benchBaseline baselines[MAXBASELINES];
+ushort baselineCount = 0;
+
+
+/*=============================================================================
+ * COMPAREDOUBLES() qsort() helper for the run results.
+ *===========================================================================*/
+static int compareDoubles(const void *a, const void *b) {
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+
+    return (x < y ? -1 : x > y ? 1 : 0);
+}
+
+
+/*=============================================================================
+ * PERCENTILE() Returns the given percentile of a sorted array of results.
+ *===========================================================================*/
+static double percentile(double *sorted, ushort count, ushort percent) {
+    return sorted[((count - 1) * percent + 50) / 100];
+}
+
+
+/*=============================================================================
+ * FINDBASELINE() Returns the baseline for a benchmark and input, or NULL.
+ *===========================================================================*/
+static benchBaseline *findBaseline(char *name, char *input) {
+    ushort x;
+
+    for (x = 0; x < baselineCount; x++) {
+        if (strcmp(baselines[x].name, name) == 0 && strcmp(baselines[x].input, input) == 0) {
+            return &baselines[x];
+        }
+    }
+
+    return NULL;
+}
+
+
+/*=============================================================================
+ * SETBASELINE() Records a result as the new baseline for its benchmark.
+ *===========================================================================*/
+static void setBaseline(char *name, char *input, double mbps) {
+    benchBaseline *baseline = findBaseline(name, input);
+
+    if (!baseline) {
+        if (baselineCount == MAXBASELINES) {
+            return;
+        }
+
+        baseline = &baselines[baselineCount++];
+        strncpy(baseline->name, name, sizeof(baseline->name) - 1);
+        baseline->name[sizeof(baseline->name) - 1] = '\0';
+        strncpy(baseline->input, input, MAXPATH);
+        baseline->input[MAXPATH] = '\0';
+    }
+
+    baseline->mbps = mbps;
+}
+
+
+/*=============================================================================
+ * MAIN() Start here. Reads the inputs and baseline, runs every benchmark
+ * against every input and reports.
+ *===========================================================================*/
+int main (int argc, char *argv[]) {
+    benchInput inputs[MAXINPUTS];
+    ushort inputCount = 0;
+    char *inputNames[MAXINPUTS];
+    char *baselineFile = "baseline.txt";
+    ushort runs = 11;
+    double margin = 20.0;
+    ushort update = 0;
+    ushort haveBaseline;
+    ushort failures = 0;
+    double mbps[MAXRUNS];
+    double tps[MAXRUNS];
+    double start;
+    double took;
+    ulong iterations;
+    ulong bytes;
+    ulong tokens;
+    ushort c, i, r;
+    benchBaseline *baseline;
+    char *verdict;
+    int arg;
+
+    for (arg = 1; arg < argc; arg++) {
+        if (strcmp(argv[arg], "-r") == 0 && arg + 1 < argc) {
+            runs = atoi(argv[++arg]);
+            if (runs < 1 || runs > MAXRUNS) {
+                fprintf(stderr, "%s: runs must be 1 to %d.\n", argv[0], MAXRUNS);
+                return -1;
+            }
+        } else if (strcmp(argv[arg], "-m") == 0 && arg + 1 < argc) {
+            margin = atof(argv[++arg]);
+        } else if (strcmp(argv[arg], "-b") == 0 && arg + 1 < argc) {
+            baselineFile = argv[++arg];
+        } else if (strcmp(argv[arg], "-u") == 0) {
+            update = 1;
+        } else if (argv[arg][0] == '-') {
+            fprintf(stderr, "%s: Unknown option '%s'.\n", argv[0], argv[arg]);
+            return -1;
+        } else if (inputCount == MAXINPUTS) {
+            fprintf(stderr, "%s: No more than %d input files.\n", argv[0], MAXINPUTS);
+            return -1;
+        } else {
+            inputNames[inputCount++] = argv[arg];
+        }
+    }
+
+    if (!inputCount) {
+        fprintf(stderr, "Usage: %s [-r runs] [-m margin%%] [-b baseline] [-u] file ...\n", argv[0]);
+        return -1;
+    }
+
+    for (i = 0; i < inputCount; i++) {
+        if (prepareInput(inputNames[i], &inputs[i]) != 0) {
+            fprintf(stderr, "FATAL ERROR: main(): Cannot use '%s'.\n", inputNames[i]);
+            return -1;
+        }
+    }
+
+    haveBaseline = (readBaseline(baselineFile) == 0);
+    if (!haveBaseline) {
+        update = 1;
+    }
+
+    printf("%-10s %-20s %5s %9s %9s %9s %12s %8s %s\n",
+           "Benchmark", "Input", "Runs", "MB/s p10", "MB/s p50", "MB/s p90", "Tokens/s p50", "Baseline", "");
+
+    for (c = 0; c < CASES; c++) {
+        for (i = 0; i < inputCount; i++) {
+            /* Find out how many iterations make a measurable run. */
+            iterations = 1;
+            while (1) {
+                bytes = tokens = 0;
+                start = elapsedTime();
+                if ((cases[c].function)(&inputs[i], iterations, &bytes, &tokens) != 0) {
+                    fprintf(stderr, "FATAL ERROR: main(): Benchmark '%s' failed on '%s'.\n", cases[c].name, inputNames[i]);
+                    return -1;
+                }
+
+                if (elapsedTime() - start >= MINRUNTIME) {
+                    break;
+                }
+
+                iterations *= 2;
+            }
+
+            /* The real runs. */
+            for (r = 0; r < runs; r++) {
+                bytes = tokens = 0;
+                start = elapsedTime();
+                (cases[c].function)(&inputs[i], iterations, &bytes, &tokens);
+                took = elapsedTime() - start;
+                if (took <= 0) {
+                    took = 1e-9;
+                }
+
+                mbps[r] = (double)bytes / took / 1e6;
+                tps[r] = (double)tokens / took;
+            }
+
+            qsort(mbps, runs, sizeof(double), compareDoubles);
+            qsort(tps, runs, sizeof(double), compareDoubles);
+
+            verdict = "";
+            baseline = findBaseline(cases[c].name, inputNames[i]);
+            if (baseline && !update) {
+                if (percentile(mbps, runs, 50) < baseline->mbps * (1.0 - margin / 100.0)) {
+                    verdict = "SLOWER";
+                    failures++;
+                }
+            }
+
+            printf("%-10s %-20s %5d %9.2f %9.2f %9.2f %12.0f %8.2f %s\n",
+                   cases[c].name, inputNames[i], runs,
+                   percentile(mbps, runs, 10), percentile(mbps, runs, 50), percentile(mbps, runs, 90),
+                   percentile(tps, runs, 50), (baseline ? baseline->mbps : 0.0), verdict);
+            fflush(stdout);
+
+            if (update) {
+                setBaseline(cases[c].name, inputNames[i], percentile(mbps, runs, 50));
+            }
+        }
+    }
+
+    if (update) {
+        if (writeBaseline(baselineFile) != 0) {
+            return -1;
+        }
+
+        printf("\nBaseline %s '%s'.\n", (haveBaseline ? "updated in" : "created as"), baselineFile);
+    }
+
+    if (failures) {
+        printf("\n%d benchmark(s) more than %.1f%% slower than the baseline.\n", failures, margin);
+        return 1;
+    }
+
+    return 0;
+}
+
+
+/*=============================================================================
+ * PREPAREINPUT() Reads an input file and does one full decode, to count the
+ * tokens and find the floats. Returns 0 if all was well.
+ *===========================================================================*/
+ushort prepareInput(char *fileName, benchInput *input) {
+    ulong pos;
+    ulong space = 0;
+    ulong *temp;
+    savLine line;
+    savToken token;
+    ushort result;
+    ulong lines = 0;
+
+    memset(input, 0, sizeof(benchInput));
+    savInitFile(&input->sav);
+
+    if (savReadFile(fileName, &input->sav) != SAV_OK) {
+        return 1;
+    }
+
+    pos = input->sav.programOffset;
+    while ((result = savNextLine(&input->sav, &pos, &line)) == SAV_OK) {
+        /* The Lister stops at the header's line count. */
+        if (lines++ == input->sav.programLines) {
+            input->listerTokens = input->tokens;
+        }
+
+        do {
+            if (savNextToken(&input->sav, &pos, &token) != SAV_OK) {
+                return 1;
+            }
+
+            input->tokens++;
+            if (token.type >= TYPE_FP_BIN_MIN) {
+                if (input->floatCount == space) {
+                    space = (space ? space * 2 : 1024);
+                    temp = realloc(input->floats, space * sizeof(ulong));
+                    if (!temp) {
+                        fprintf(stderr, "\n\nERROR: prepareInput(): Out of memory.\n");
+                        return 1;
+                    }
+
+                    input->floats = temp;
+                }
+
+                input->floats[input->floatCount++] = token.offset;
+            }
+        } while (token.type != TYPE_SYMBOL || token.code != SYMBOL_EOL);
+    }
+
+    if (lines <= input->sav.programLines) {
+        input->listerTokens = input->tokens;
+    }
+
+    return (result == SAV_END ? 0 : 1);
+}
+
+
+/*=============================================================================
+ * BENCHHEADER() Decodes the 10 byte header.
+ *===========================================================================*/
+ushort benchHeader(benchInput *input, ulong iterations, ulong *bytes, ulong *tokens) {
+    while (iterations--) {
+        if (savDecodeHeader(&input->sav) != SAV_OK) {
+            return 1;
+        }
+
+        *bytes += SAV_HEADER_SIZE;
+        *tokens += 1;
+    }
+
+    return 0;
+}
+
+
+/*=============================================================================
+ * BENCHNAMETABLE() Decodes the name table. Each name counts as a token.
+ *===========================================================================*/
+ushort benchNameTable(benchInput *input, ulong iterations, ulong *bytes, ulong *tokens) {
+    while (iterations--) {
+        if (savDecodeNameTable(&input->sav) != SAV_OK) {
+            return 1;
+        }
+
+        *bytes += input->sav.programOffset - SAV_HEADER_SIZE;
+        *tokens += input->sav.nameTableEntries;
+    }
+
+    return 0;
+}
+
+
+/*=============================================================================
+ * BENCHFLOATS() Converts every floating point value in the program to a
+ * double. The results are added up so the compiler can't skip the work.
+ *===========================================================================*/
+ushort benchFloats(benchInput *input, ulong iterations, ulong *bytes, ulong *tokens) {
+    static volatile double total = 0.0;
+    ulong x;
+
+    while (iterations--) {
+        for (x = 0; x < input->floatCount; x++) {
+            total += qlfpDecode(input->sav.buffer + input->floats[x]);
+        }
+
+        *bytes += input->floatCount * SAV_FLOAT_SIZE;
+        *tokens += input->floatCount;
+    }
+
+    return 0;
+}
+
+
+/*=============================================================================
+ * BENCHPROGRAM() Decodes every line and token of the program.
+ *===========================================================================*/
+ushort benchProgram(benchInput *input, ulong iterations, ulong *bytes, ulong *tokens) {
+    savFile *sav = &input->sav;
+    ulong pos;
+    savLine line;
+    savToken token;
+
+    while (iterations--) {
+        pos = sav->programOffset;
+        while (savNextLine(sav, &pos, &line) == SAV_OK) {
+            do {
+                if (savNextToken(sav, &pos, &token) != SAV_OK) {
+                    return 1;
+                }
+
+                (*tokens)++;
+            } while (token.type != TYPE_SYMBOL || token.code != SYMBOL_EOL);
+        }
+
+        *bytes += sav->size - sav->programOffset;
+    }
+
+    return 0;
+}
+
+
+/*=============================================================================
+ * BENCHLISTER() Runs the Lister's decodeHeader(), decodeNameTable() and
+ * decodeProgram() over the file, writing the listing as usual. The Lister
+ * talks a lot on stderr, so that is sent to /dev/null while it runs.
+ *===========================================================================*/
+ushort benchLister(benchInput *input, ulong iterations, ulong *bytes, ulong *tokens) {
+    ushort result = 0;
+    ulong fileBytes;
+
+#ifndef QDOS
+    int savedStderr;
+    int devNull;
+
+    fflush(stderr);
+    savedStderr = dup(2);
+    devNull = open("/dev/null", O_WRONLY);
+    dup2(devNull, 2);
+    close(devNull);
+#endif
+
+    while (iterations-- && !result) {
+        result = listerDecode(input->sav.fileName, &fileBytes);
+        *bytes += fileBytes;
+        *tokens += input->listerTokens;
+    }
+
+#ifndef QDOS
+    fflush(stderr);
+    dup2(savedStderr, 2);
+    close(savedStderr);
+#endif
+
+    return result;
+}
+
+
+/*=============================================================================
+ * ELAPSEDTIME() Returns a time, in seconds, for measuring intervals.
+ *===========================================================================*/
+double elapsedTime(void) {
+#ifndef QDOS
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+#else
+    return (double)clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+
+/*=============================================================================
+ * READBASELINE() Reads the baseline file. Each line is:
+ *
+ * benchmark input MB/s
+ *
+ * Returns 0 if the file was read, 1 if there isn't one.
+ *===========================================================================*/
+ushort readBaseline(char *fileName) {
+    FILE *fp;
+    char name[32];
+    char input[257];                /* Big enough for MAXPATH anywhere. */
+    double mbps;
+
+    fp = fopen(fileName, "r");
+    if (!fp) {
+        return 1;
+    }
+
+    while (fscanf(fp, "%31s %256s %lf", name, input, &mbps) == 3) {
+        setBaseline(name, input, mbps);
+    }
+
+    fclose(fp);
+    return 0;
+}
+
+
+/*=============================================================================
+ * WRITEBASELINE() Writes the baseline file. Returns 0 if all was well.
+ *===========================================================================*/
+ushort writeBaseline(char *fileName) {
+    FILE *fp;
+    ushort x;
+
+    fp = fopen(fileName, "w");
+    if (!fp) {
+        fprintf(stderr, "\n\nERROR: writeBaseline(): Cannot create '%s'.\n", fileName);
+        return 1;
+    }
+
+    for (x = 0; x < baselineCount; x++) {
+        fprintf(fp, "%s %s %.2f\n", baselines[x].name, baselines[x].input, baselines[x].mbps);
+    }
+
+    fclose(fp);
+    return 0;
+}
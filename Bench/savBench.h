@@ -0,0 +1,65 @@
+#ifndef __SAVBENCH_H__
+#define __SAVBENCH_H__
+
+/*===========================================================================
+ * HEADERS
+ *===========================================================================*/
+#include "../SavFile/savFile.h"
+
+/*===========================================================================
+ * DEFINES
+ *===========================================================================*/
+#define MAXRUNS 101                 /* Most timed runs of each benchmark. */
+#define MAXINPUTS 8                 /* Most input files. */
+#define MINRUNTIME 0.02             /* Seconds, each run repeats until this. */
+#define MAXBASELINES 64             /* Lines in the baseline file. */
+
+/*===========================================================================
+ * TYPEDEFS
+ *===========================================================================*/
+
+/* One input file, read once, before any timing. */
+typedef struct benchInput {
+    savFile sav;
+    ulong tokens;                   /* Tokens in the program. */
+    ulong listerTokens;             /* Tokens in the header's line count. */
+    ulong *floats;                  /* Offsets of the float tokens. */
+    ulong floatCount;
+} benchInput;
+
+/* One decode path to be timed. Each call does 'iterations' decodes and
+ * adds up the bytes and tokens it got through. Returns 0 if all was well. */
+typedef ushort (*BENCHFUNC)(benchInput *input, ulong iterations, ulong *bytes, ulong *tokens);
+
+typedef struct benchCase {
+    char *name;
+    BENCHFUNC function;
+} benchCase;
+
+/* A stored result, from the baseline file. */
+typedef struct benchBaseline {
+    char name[32];
+    char input[MAXPATH + 1];
+    double mbps;
+} benchBaseline;
+
+/*===========================================================================
+ * FUNCTION PROTOTYPES
+ *===========================================================================*/
+ushort benchHeader(benchInput *input, ulong iterations, ulong *bytes, ulong *tokens);
+ushort benchNameTable(benchInput *input, ulong iterations, ulong *bytes, ulong *tokens);
+ushort benchFloats(benchInput *input, ulong iterations, ulong *bytes, ulong *tokens);
+ushort benchProgram(benchInput *input, ulong iterations, ulong *bytes, ulong *tokens);
+ushort benchLister(benchInput *input, ulong iterations, ulong *bytes, ulong *tokens);
+
+/* In listerBench.c, which can't see savFile.h. */
+ushort listerDecode(char *fileName, ulong *bytes);
+
+ushort prepareInput(char *fileName, benchInput *input);
+double elapsedTime(void);
+ushort readBaseline(char *fileName);
+ushort writeBaseline(char *fileName);
+
+/*===========================================================================*/
+
+#endif /* __SAVBENCH_H__ */
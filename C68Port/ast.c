@@ -0,0 +1,784 @@
+/*=============================================================================
+ * AST. A tree of the program: the program, its DEFine blocks, their
+ * statements and the statements' expressions. It is built from a program
+ * decoded by savDecodeProgram() and every node comes from one arena, sized
+ * from the token count, so the whole tree goes in one arenaReset().
+ *
+ * Blocks other than DEFine are left flat, FOR ... END FOR is a FOR statement,
+ * some statements, and an END statement, in the order they were written,
+ * until blockNest() nests them. A
+ * statement the parser doesn't understand is kept, as AST_UNPARSED, so that
+ * its tokens can still be copied through.
+ *===========================================================================*/
+
+/*===========================================================================
+ * HEADERS
+ *===========================================================================*/
+#include "ast.h"
+
+/*===========================================================================
+ * TYPEDEFS
+ *===========================================================================*/
+
+/* Where the parser is. Tokens from t up to end are the rest of the current
+ * statement. */
+typedef struct astParser {
+    savToken *tokens;
+    arena  *a;
+    astTree *tree;
+    ulong  t;                       /* Next token. */
+    ulong  end;                     /* End of the statement. */
+    ushort lineNumber;
+    ushort depth;                   /* Of nested expressions. */
+    ushort failed;                  /* Something didn't parse. */
+    ushort noMemory;                /* The arena was too small. */
+} astParser;
+
+/* Where astDump() is writing, and what. */
+typedef struct astDumpData {
+    FILE *fp;
+    astTree *tree;
+} astDumpData;
+
+/*===========================================================================
+ * GLOBALS
+ *===========================================================================*/
+
+/* Precedence of the binary operators, by operator code. OR and XOR are the
+ * loosest, then AND, NOT, the comparisons, INSTR, &, the bitwise operators,
+ * then the arithmetic and, tightest of all, ^. Monadic minus is between *
+ * and ^, so -2^2 is -4. ^ is the only one that is right associative. */
+static uchar astPrecedence[SAV_OPERATORS + 1] = {
+    0,
+    9, 9, 10, 10,                   /* + - * / */
+    4, 4, 4, 4, 4, 4, 4,            /* >= > == = <> <= < */
+    7, 8, 7,                        /* || && ^^ */
+    12,                             /* ^ */
+    6,                              /* & */
+    1, 2, 1,                        /* OR AND XOR */
+    10, 10,                         /* MOD DIV */
+    5                               /* INSTR */
+};
+
+static astNode *astExpression(astParser *p, uchar minPrec);
+
+
+/*=============================================================================
+ * ASTSIZE() Returns how much arena the tree for a program can need. Every
+ * node but the root uses up at least one token, and so does every
+ * statement, so twice the tokens is enough to parse. Nesting the blocks
+ * makes, at most, one more for each token. Code generation needs a pointer
+ * for each line, to find the targets of GO TO, and lists of the names and
+ * calls in each DEFine, at most one of each for a token, with a mark and a
+ * place on a stack for each name, to find which LOCals are seen elsewhere.
+ *===========================================================================*/
+ulong astSize(savProgram *prog) {
+    return ARENA_SIZE(astNode, 3 * prog->tokenCount + 2) + ARENA_SIZE(astNode *, prog->lineCount) +
+           2 * ARENA_SIZE(ushort, prog->tokenCount) + ARENA_SIZE(uchar, prog->tokenCount) +
+           ARENA_SIZE(ulong, prog->nameCount) + ARENA_SIZE(ushort, prog->nameCount);
+}
+
+
+/*=============================================================================
+ * ASTNEW() Returns a new, empty node, from the tree's arena, or NULL if the
+ * arena is full.
+ *===========================================================================*/
+astNode *astNew(astTree *tree, uchar kind, ulong token) {
+    astNode *node;
+
+    node = arenaCalloc(tree->a, sizeof(astNode));
+    if (!node) {
+        return NULL;
+    }
+
+    node->kind = kind;
+    node->token = token;
+    tree->nodes++;
+    return node;
+}
+
+
+/*=============================================================================
+ * ASTMAKE() Returns a new node for the parser, on the current line.
+ *===========================================================================*/
+static astNode *astMake(astParser *p, uchar kind, ulong token) {
+    astNode *node;
+
+    node = astNew(p->tree, kind, token);
+    if (!node) {
+        p->noMemory = 1;
+        p->failed = 1;
+        return NULL;
+    }
+
+    node->lineNumber = p->lineNumber;
+    return node;
+}
+
+
+/*=============================================================================
+ * ASTADD() Adds child to the end of parent's children.
+ *===========================================================================*/
+void astAdd(astNode *parent, astNode *child) {
+    if (!parent->first) {
+        parent->first = child;
+    } else {
+        parent->last->next = child;
+    }
+    parent->last = child;
+}
+
+
+/*=============================================================================
+ * ASTPEEK() Skips spaces and returns the next token of the statement, or NULL
+ * if there are none left.
+ *===========================================================================*/
+static savToken *astPeek(astParser *p) {
+    p->t = savSkipSpaces(p->tokens, p->t, p->end);
+    return (p->t < p->end ? p->tokens + p->t : NULL);
+}
+
+
+/*=============================================================================
+ * ASTIS() Is the token of the given type and code?
+ *===========================================================================*/
+static ushort astIs(savToken *token, uchar type, uchar code) {
+    return (token && token->type == type && token->code == code);
+}
+
+
+/*=============================================================================
+ * ASTLIST() Parses a list of expressions into parent, up to the end of the
+ * statement or, if close is set, a closing parenthesis, which is used up.
+ * Separators are kept on the item before them, so are symbol commas, as
+ * SEPARATOR_COMMA. Nothing before a separator is an AST_EMPTY. Operands
+ * are allowed to be keywords, as in GO TO, and = symbols, as in FOR.
+ *===========================================================================*/
+static void astList(astParser *p, astNode *parent, ushort close, ushort operands) {
+    savToken *token;
+    astNode *item;
+
+    for (;;) {
+        token = astPeek(p);
+        if (!token) {
+            if (close) {
+                p->failed = 1;
+            }
+            return;
+        }
+
+        if (close && astIs(token, TYPE_SYMBOL, SYMBOL_RPAREN)) {
+            p->t++;
+            return;
+        }
+
+        if (token->type == TYPE_SEPARATOR || astIs(token, TYPE_SYMBOL, SYMBOL_COMMA)) {
+            item = astMake(p, AST_EMPTY, p->t);
+        } else if (operands && token->type == TYPE_KEYWORD) {
+            item = astMake(p, AST_WORD, p->t);
+            if (item) {
+                item->op = token->code;
+                p->t++;
+            }
+        } else if (operands && astIs(token, TYPE_SYMBOL, SYMBOL_EQUALS)) {
+            item = astMake(p, AST_SYMBOL, p->t);
+            if (item) {
+                item->op = token->code;
+                p->t++;
+            }
+        } else {
+            item = astExpression(p, 0);
+        }
+
+        if (p->failed) {
+            return;
+        }
+        astAdd(parent, item);
+
+        /* A separator after it? */
+        token = astPeek(p);
+        if (token && token->type == TYPE_SEPARATOR) {
+            item->sep = token->code;
+            p->t++;
+        } else if (astIs(token, TYPE_SYMBOL, SYMBOL_COMMA)) {
+            item->sep = SEPARATOR_COMMA;
+            p->t++;
+        }
+    }
+}
+
+
+/*=============================================================================
+ * ASTPRIMARY() Parses a number, string, name, array element, FN call,
+ * bracketed expression, or channel.
+ *===========================================================================*/
+static astNode *astPrimary(astParser *p) {
+    savToken *token;
+    astNode *node;
+
+    token = astPeek(p);
+    if (!token) {
+        p->failed = 1;
+        return NULL;
+    }
+
+    if (token->type >= TYPE_FP_BIN_MIN) {
+        node = astMake(p, AST_NUMBER, p->t);
+        if (node) {
+            node->value = qlfpDecode(token->data);
+            p->t++;
+        }
+        return node;
+    }
+
+    switch (token->type) {
+        case TYPE_STRING:
+            node = astMake(p, AST_STRING, p->t);
+            p->t++;
+            return node;
+
+        case TYPE_NAME:
+            node = astMake(p, AST_NAME, p->t);
+            if (!node) {
+                return NULL;
+            }
+            node->entry = token->value;
+            p->t++;
+
+            /* Subscripts, slices or arguments? */
+            if (astIs(astPeek(p), TYPE_SYMBOL, SYMBOL_LPAREN)) {
+                node->kind = AST_INDEX;
+                p->t++;
+                astList(p, node, 1, 0);
+            }
+            return node;
+
+        case TYPE_SYMBOL:
+            if (token->code == SYMBOL_LPAREN) {
+                node = astMake(p, AST_PAREN, p->t);
+                if (!node) {
+                    return NULL;
+                }
+                p->t++;
+                astAdd(node, astExpression(p, 0));
+                if (!astIs(astPeek(p), TYPE_SYMBOL, SYMBOL_RPAREN)) {
+                    p->failed = 1;
+                }
+                p->t++;
+                return node;
+            }
+
+            if (token->code == SYMBOL_HASH) {
+                node = astMake(p, AST_CHANNEL, p->t);
+                if (!node) {
+                    return NULL;
+                }
+                p->t++;
+                astAdd(node, astExpression(p, AST_PREC_UNARY));
+                return node;
+            }
+            break;
+    }
+
+    p->failed = 1;
+    return NULL;
+}
+
+
+/*=============================================================================
+ * ASTEXPRESSION() Parses an expression whose operators bind at least as
+ * tightly as minPrec, by precedence climbing. Gives up, rather than run out
+ * of stack, if they nest too deeply.
+ *===========================================================================*/
+static astNode *astExpression(astParser *p, uchar minPrec) {
+    savToken *token;
+    astNode *left;
+    astNode *node;
+    ushort depth;
+    uchar prec;
+
+    /* Each operator in a chain makes the tree one deeper, as well. */
+    depth = p->depth;
+    if (++p->depth > AST_MAX_DEPTH) {
+        p->failed = 1;
+        p->depth = depth;
+        return NULL;
+    }
+
+    token = astPeek(p);
+    if (token && token->type == TYPE_MONADIC) {
+        left = astMake(p, AST_UNARY, p->t);
+        if (left) {
+            left->op = token->code;
+            p->t++;
+            astAdd(left, astExpression(p, (token->code == MONADIC_NOT ? AST_PREC_NOT : AST_PREC_UNARY)));
+        }
+    } else {
+        left = astPrimary(p);
+    }
+
+    while (!p->failed) {
+        token = astPeek(p);
+        if (!token || token->type != TYPE_OPERATOR) {
+            break;
+        }
+
+        prec = astPrecedence[token->code];
+        if (prec < minPrec) {
+            break;
+        }
+
+        if (++p->depth > AST_MAX_DEPTH) {
+            p->failed = 1;
+            break;
+        }
+
+        node = astMake(p, AST_BINARY, p->t);
+        if (!node) {
+            break;
+        }
+        node->op = token->code;
+        p->t++;
+
+        astAdd(node, left);
+        astAdd(node, astExpression(p, (token->code == OPERATOR_POWER ? prec : prec + 1)));
+        left = node;
+    }
+
+    p->depth = depth;
+    return (p->failed ? NULL : left);
+}
+
+
+/*=============================================================================
+ * ASTDEFINE() Parses DEFine PROCedure/FuNction name[(parameters)] into
+ * node, an AST_DEFINE with an AST_PARAMS child.
+ *===========================================================================*/
+static void astDefine(astParser *p, astNode *node) {
+    savToken *token;
+    astNode *params;
+
+    node->kind = AST_DEFINE;
+    token = astPeek(p);
+    if (!token || token->type != TYPE_KEYWORD ||
+        (token->code != kwProcedure + 1 && token->code != kwFunction + 1)) {
+        p->failed = 1;
+        return;
+    }
+    node->op = token->code;
+    p->t++;
+
+    token = astPeek(p);
+    if (!token || token->type != TYPE_NAME) {
+        p->failed = 1;
+        return;
+    }
+    node->entry = token->value;
+    p->t++;
+
+    params = astMake(p, AST_PARAMS, p->t);
+    if (!params) {
+        return;
+    }
+    astAdd(node, params);
+
+    if (astIs(astPeek(p), TYPE_SYMBOL, SYMBOL_LPAREN)) {
+        p->t++;
+        astList(p, params, 1, 0);
+    }
+
+    /* Anything else on the line is a mistake. */
+    if (astPeek(p)) {
+        p->failed = 1;
+    }
+}
+
+
+/*=============================================================================
+ * ASTREWIND() Gives back every node made since the arena was at used, when
+ * nodes was the count.
+ *===========================================================================*/
+static void astRewind(astParser *p, ulong used, ulong nodes) {
+    p->a->used = used;
+    p->tree->nodes = nodes;
+}
+
+
+/*=============================================================================
+ * ASTSTATEMENT() Parses the tokens from p->t to p->end as one statement.
+ *===========================================================================*/
+static astNode *astStatement(astParser *p) {
+    savToken *token;
+    astNode *node;
+    astNode *target;
+    ulong start;
+    ulong used;
+    ulong nodes;
+
+    start = p->t;
+    token = p->tokens + start;
+    node = astMake(p, AST_KEYWORD, start);
+    if (!node) {
+        return NULL;
+    }
+    p->depth = 0;
+    p->failed = 0;
+    p->tree->statements++;
+    used = p->a->used;
+    nodes = p->tree->nodes;
+
+    if (token->type == TYPE_KEYWORD) {
+        node->op = token->code;
+        p->t++;
+
+        switch (token->code - 1) {
+            case kwRemark:
+            case kwMistake:
+                node->kind = (token->code == kwRemark + 1 ? AST_REMARK : AST_MISTAKE);
+                token = astPeek(p);
+                node->token = (token && token->type == TYPE_TEXT ? p->t : start);
+                p->t = p->end;
+                return node;
+
+            case kwDefine:
+                astDefine(p, node);
+                break;
+
+            case kwLet:
+                node->kind = AST_ASSIGN;
+                node->flags = AST_LET;
+                target = astPrimary(p);
+                if (!p->failed && (!target || (target->kind != AST_NAME && target->kind != AST_INDEX) ||
+                    !astIs(astPeek(p), TYPE_SYMBOL, SYMBOL_EQUALS))) {
+                    p->failed = 1;
+                }
+                if (!p->failed) {
+                    astAdd(node, target);
+                    p->t++;
+                    astAdd(node, astExpression(p, 0));
+                }
+                break;
+
+            default:
+                /* THEN, at the end, leaves the rest of the line to the IF. */
+                if (p->end > p->t && astIs(p->tokens + p->end - 1, TYPE_KEYWORD, kwThen + 1) &&
+                    token->code != kwThen + 1) {
+                    node->flags = AST_THEN;
+                    p->end--;
+                    astList(p, node, 0, 1);
+                    p->end++;
+                    p->t = p->end;
+                } else {
+                    astList(p, node, 0, 1);
+                }
+                break;
+        }
+    } else if (token->type == TYPE_NAME) {
+        /* Assignment, or procedure call? */
+        target = astPrimary(p);
+        if (!p->failed && astIs(astPeek(p), TYPE_SYMBOL, SYMBOL_EQUALS)) {
+            node->kind = AST_ASSIGN;
+            astAdd(node, target);
+            p->t++;
+            astAdd(node, astExpression(p, 0));
+        } else {
+            node->kind = AST_CALL;
+            node->entry = token->value;
+            astRewind(p, used, nodes);
+            p->failed = 0;
+            p->t = start + 1;
+            astList(p, node, 0, 1);
+        }
+    } else if (astIs(token, TYPE_SYMBOL, SYMBOL_EQUALS) || astIs(token, TYPE_OPERATOR, OPERATOR_EQUALS)) {
+        /* '= 3 TO 5' is a SELect clause, without the ON. The = is usually
+         * the operator, but is kept as the symbol, as it is after ON. */
+        node->op = kwOn + 1;
+        node->flags = AST_SHORT_ON;
+        target = astMake(p, AST_SYMBOL, start);
+        if (target) {
+            target->op = SYMBOL_EQUALS;
+            astAdd(node, target);
+            p->t++;
+            astList(p, node, 0, 1);
+        }
+    } else {
+        p->failed = 1;
+    }
+
+    /* Anything left over, or not understood, and the whole statement is
+     * kept as its tokens. */
+    if (!p->noMemory && (p->failed || astPeek(p))) {
+        node->kind = AST_UNPARSED;
+        node->token = start;
+        node->count = p->end - start;
+        node->first = node->last = NULL;
+        node->flags = 0;
+        astRewind(p, used, nodes);
+        p->tree->unparsed++;
+    }
+
+    p->t = p->end;
+    return node;
+}
+
+
+/*=============================================================================
+ * ASTSTATEMENTEND() Returns where the statement starting at t ends. A colon
+ * ends it, and so does THEN, which belongs to it, and ELSE, which doesn't,
+ * unless it's the first thing. REMark always runs to the end of the line.
+ *===========================================================================*/
+static ulong astStatementEnd(savToken *tokens, ulong t, ulong end) {
+    ulong start = t;
+
+    for (; t < end; t++) {
+        if (tokens[t].type == TYPE_SYMBOL && tokens[t].code == SYMBOL_COLON) {
+            return t;
+        }
+
+        if (tokens[t].type == TYPE_KEYWORD) {
+            if (tokens[t].code == kwRemark + 1 || tokens[t].code == kwMistake + 1) {
+                return (t == start ? end : t);
+            }
+            if (tokens[t].code == kwThen + 1) {
+                return t + 1;
+            }
+            if (tokens[t].code == kwElse + 1) {
+                return (t == start ? t + 1 : t);
+            }
+        }
+    }
+
+    return end;
+}
+
+
+/*=============================================================================
+ * ASTBUILD() Builds the tree of a program from its tokens, in the arena,
+ * which should have astSize() bytes free. DEFine starts a block, which END
+ * DEFine, or the next DEFine, ends. Returns 0 if all went well, even if some
+ * statements were unparsed, or 1 if the arena was too small.
+ *===========================================================================*/
+ushort astBuild(savProgram *prog, arena *a, astTree *tree) {
+    astParser parser;
+    astParser *p = &parser;
+    astNode *block;
+    astNode *node;
+    ulong x;
+    ulong end;
+    ushort first;
+
+    memset(tree, 0, sizeof(astTree));
+    memset(p, 0, sizeof(astParser));
+    tree->prog = prog;
+    tree->a = a;
+    p->tokens = prog->tokens;
+    p->a = a;
+    p->tree = tree;
+
+    tree->root = astMake(p, AST_PROGRAM, 0);
+    if (!tree->root) {
+        fprintf(stderr, "\n\nERROR: astBuild(): Out of memory for the program.\n");
+        return 1;
+    }
+    block = tree->root;
+
+    for (x = 0; x < prog->lineCount; x++) {
+        p->lineNumber = prog->lines[x].lineNumber;
+        p->t = prog->lines[x].first;
+        end = p->t + prog->lines[x].count;
+        first = 1;
+
+        while (p->t < end) {
+            /* Skip spaces and empty statements. */
+            p->t = savSkipSpaces(p->tokens, p->t, end);
+            if (p->t < end && astIs(p->tokens + p->t, TYPE_SYMBOL, SYMBOL_COLON)) {
+                p->t++;
+                continue;
+            }
+            if (p->t == end) {
+                break;
+            }
+
+            p->end = astStatementEnd(p->tokens, p->t, end);
+            node = astStatement(p);
+            if (p->noMemory) {
+                fprintf(stderr, "\n\nERROR: astBuild(): Out of memory at line %d.\n", p->lineNumber);
+                return 1;
+            }
+
+            if (first) {
+                node->flags |= AST_LINE;
+                first = 0;
+            }
+
+            /* A DEFine starts a new block, ending any one that is open. */
+            if (node->kind == AST_DEFINE) {
+                astAdd(tree->root, node);
+                block = node;
+                continue;
+            }
+
+            astAdd(block, node);
+
+            if (block != tree->root && node->kind == AST_KEYWORD && node->op == kwEnd + 1 &&
+                node->first && node->first->kind == AST_WORD && node->first->op == kwDefine + 1) {
+                block = tree->root;
+            }
+        }
+    }
+
+    return 0;
+}
+
+
+/*=============================================================================
+ * ASTWALK() Calls func for node and, unless it returns 0, all of its
+ * children, parents first.
+ *===========================================================================*/
+void astWalk(astNode *node, ushort depth, ASTFUNC func, void *data) {
+    astNode *child;
+
+    if (!func(node, depth, data)) {
+        return;
+    }
+
+    for (child = node->first; child; child = child->next) {
+        astWalk(child, depth + 1, func, data);
+    }
+}
+
+
+/*=============================================================================
+ * ASTKINDNAME() Returns the name of a node kind, for dumps and messages.
+ *===========================================================================*/
+char *astKindName(uchar kind) {
+    switch (kind) {
+        case AST_PROGRAM:  return "PROGRAM";
+        case AST_DEFINE:   return "DEFINE";
+        case AST_PARAMS:   return "PARAMS";
+        case AST_ASSIGN:   return "ASSIGN";
+        case AST_CALL:     return "CALL";
+        case AST_KEYWORD:  return "KEYWORD";
+        case AST_REMARK:   return "REMARK";
+        case AST_MISTAKE:  return "MISTAKE";
+        case AST_UNPARSED: return "UNPARSED";
+        case AST_FOR:      return "FOR";
+        case AST_REPEAT:   return "REPEAT";
+        case AST_IF:       return "IF";
+        case AST_SELECT:   return "SELECT";
+        case AST_CLAUSE:   return "CLAUSE";
+        case AST_BLOCK:    return "BLOCK";
+        case AST_RANGE:    return "RANGE";
+        case AST_NUMBER:   return "NUMBER";
+        case AST_STRING:   return "STRING";
+        case AST_NAME:     return "NAME";
+        case AST_INDEX:    return "INDEX";
+        case AST_UNARY:    return "UNARY";
+        case AST_BINARY:   return "BINARY";
+        case AST_PAREN:    return "PAREN";
+        case AST_CHANNEL:  return "CHANNEL";
+        case AST_WORD:     return "WORD";
+        case AST_SYMBOL:   return "SYMBOL";
+        case AST_EMPTY:    return "EMPTY";
+    }
+
+    return "UNKNOWN";
+}
+
+
+/*=============================================================================
+ * ASTDUMPNODE() Writes one node, indented by its depth, for astDump().
+ *===========================================================================*/
+static ushort astDumpNode(astNode *node, ushort depth, void *data) {
+    astDumpData *dump = (astDumpData *)data;
+    savProgram *prog = dump->tree->prog;
+    savToken *token = prog->tokens + node->token;
+    savName *name;
+    FILE *fp = dump->fp;
+
+    fprintf(fp, "%*s%s", depth * 2, "", astKindName(node->kind));
+
+    switch (node->kind) {
+        case AST_DEFINE:
+        case AST_KEYWORD:
+        case AST_WORD:
+        case AST_CLAUSE:
+            fprintf(fp, " %s", savKeywords[node->op]);
+            break;
+
+        case AST_UNARY:
+            fprintf(fp, " %s", savMonadics[node->op]);
+            break;
+
+        case AST_BINARY:
+            fprintf(fp, " %s", savOperators[node->op]);
+            break;
+
+        case AST_SYMBOL:
+            fprintf(fp, " %s", savSymbols[node->op]);
+            break;
+
+        case AST_NUMBER:
+            fprintf(fp, " %.15g", node->value);
+            break;
+
+        case AST_STRING:
+            fprintf(fp, " %c%.*s%c", token->code, token->value, token->data + 4, token->code);
+            break;
+
+        case AST_REMARK:
+        case AST_MISTAKE:
+            if (token->type == TYPE_TEXT) {
+                fprintf(fp, " %.*s", token->value, token->data + 4);
+            }
+            break;
+
+        case AST_UNPARSED:
+            fprintf(fp, " %lu tokens", node->count);
+            break;
+    }
+
+    if (node->kind == AST_DEFINE || node->kind == AST_CALL ||
+        node->kind == AST_FOR || node->kind == AST_REPEAT || node->kind == AST_SELECT ||
+        node->kind == AST_NAME || node->kind == AST_INDEX) {
+        if (node->entry < prog->nameCount) {
+            name = prog->names + node->entry;
+            fprintf(fp, " %.*s", name->nameLength, name->name);
+        }
+    }
+
+    if (node->flags & AST_LET) {
+        fprintf(fp, " LET");
+    }
+    if (node->flags & AST_THEN) {
+        fprintf(fp, " THEN");
+    }
+    if (node->flags & AST_SHORT_ON) {
+        fprintf(fp, " (no ON)");
+    }
+    if (node->sep) {
+        fprintf(fp, " [%s]", savSeparators[node->sep]);
+    }
+
+    /* Statements show their line. */
+    if (node->kind == AST_DEFINE || (node->kind >= AST_ASSIGN && node->kind <= AST_SELECT)) {
+        fprintf(fp, ", line %d", node->lineNumber);
+    }
+
+    fprintf(fp, "\n");
+    return 1;
+}
+
+
+/*=============================================================================
+ * ASTDUMP() Writes the whole tree to fp, one node to a line, indented.
+ *===========================================================================*/
+void astDump(FILE *fp, astTree *tree) {
+    astDumpData dump;
+
+    dump.fp = fp;
+    dump.tree = tree;
+    astWalk(tree->root, 0, astDumpNode, &dump);
+    fprintf(fp, "\n%lu nodes, %lu statements, %lu unparsed.\n",
+            tree->nodes, tree->statements, tree->unparsed);
+}
@@ -0,0 +1,127 @@
+#ifndef __AST_H__
+#define __AST_H__
+
+/*===========================================================================
+ * HEADERS
+ *===========================================================================*/
+#include "../SavFile/savFile.h"
+#include "../Arena/arena.h"
+
+/*===========================================================================
+ * DEFINES
+ *===========================================================================*/
+
+/* Node kinds. The program, and each DEFine, hold statements, in order. */
+#define AST_PROGRAM     1           /* Statements and DEFines. */
+#define AST_DEFINE      2           /* op = PROCedure or FuNction keyword,
+                                     * entry = its name. First child is the
+                                     * AST_PARAMS, then the body. */
+#define AST_PARAMS      3           /* Parameter AST_NAMEs. */
+
+/* Statements. */
+#define AST_ASSIGN      10          /* [LET] target = value. */
+#define AST_CALL        11          /* entry = PROC, children = arguments. */
+#define AST_KEYWORD     12          /* op = keyword, children = operands. */
+#define AST_REMARK      13          /* token = the text. */
+#define AST_MISTAKE     14          /* token = the text. */
+#define AST_UNPARSED    15          /* count tokens, from token. */
+#define AST_FOR         16          /* entry = loop variable, children =
+                                     * AST_RANGEs, then the AST_BLOCK. */
+#define AST_REPEAT      17          /* entry = name, or 0xFFFF, child =
+                                     * the AST_BLOCK. */
+#define AST_IF          18          /* children = condition, the THEN
+                                     * AST_BLOCK and maybe the ELSE one. */
+#define AST_SELECT      19          /* entry = variable, children = its
+                                     * AST_NAME, maybe an AST_BLOCK of
+                                     * REMarks, then the AST_CLAUSEs. */
+
+/* Expressions, and the other things that can be operands. */
+#define AST_NUMBER      20          /* value, token = the float. */
+#define AST_STRING      21          /* token = the string. */
+#define AST_NAME        22          /* entry. */
+#define AST_INDEX       23          /* entry, children = subscripts, slices
+                                     * or FN arguments. */
+#define AST_UNARY       24          /* op = monadic, child = operand. */
+#define AST_BINARY      25          /* op = operator, children = operands. */
+#define AST_PAREN       26          /* child = expression. */
+#define AST_CHANNEL     27          /* #expression. */
+#define AST_WORD        28          /* op = keyword, GO TO's TO etc. */
+#define AST_SYMBOL      29          /* op = symbol, the = in FOR etc. */
+#define AST_EMPTY       30          /* Nothing, before a separator. */
+
+/* Made when blocks are nested. */
+#define AST_BLOCK       40          /* Statements. */
+#define AST_RANGE       41          /* from [, to [, step]]. */
+#define AST_CLAUSE      42          /* op = ON or REMAINDER, children =
+                                     * AST_RANGEs, then the AST_BLOCK. */
+
+/* Flags. */
+#define AST_LET         0x01        /* AST_ASSIGN started with LET. */
+#define AST_THEN        0x02        /* Ended with THEN, the rest of the line
+                                     * belongs to it. */
+#define AST_SHORT_ON    0x04        /* SELect clause with no ON, '= 3'. */
+#define AST_FOLDED      0x08        /* AST_NUMBER made by exprFold(). */
+#define AST_NO_END      0x10        /* Block that blockNest() found has no
+                                     * end. */
+#define AST_LINE        0x20        /* First statement on its line. */
+#define AST_LABEL       0x40        /* A GO TO or GO SUB goes to its line. */
+#define AST_REF         0x80        /* Parameter the DEFine may change, passed
+                                     * by reference. */
+
+/* Operator precedence. Higher binds tighter. */
+#define AST_PREC_NOT    3
+#define AST_PREC_UNARY  11
+
+#define AST_MAX_DEPTH   200         /* Nesting, before a statement is left
+                                     * unparsed, so the stack is safe. */
+
+/*===========================================================================
+ * TYPEDEFS
+ *===========================================================================*/
+
+/* One node. Children are a list, first to last, through next. Nothing is
+ * copied from the program, names are name table entries and strings, text
+ * and floats are the index of their token. */
+typedef struct astNode {
+    uchar  kind;                    /* AST_... */
+    uchar  op;                      /* Keyword, operator, monadic or symbol. */
+    uchar  sep;                     /* Separator after it, in a list, or 0. */
+    uchar  flags;                   /* AST_LET etc. */
+    ushort entry;                   /* Name table entry. */
+    ushort lineNumber;              /* Line it's on. */
+    ulong  token;                   /* Index of its (first) token. */
+    ulong  count;                   /* How many tokens, if unparsed. */
+    double value;                   /* AST_NUMBER. */
+    struct astNode *first;          /* First child. */
+    struct astNode *last;           /* Last child. */
+    struct astNode *next;           /* Next sibling. */
+} astNode;
+
+/* A whole program's tree, and what it came from. The program's tokens must
+ * be kept for as long as the tree is. */
+typedef struct astTree {
+    astNode *root;
+    savProgram *prog;
+    arena *a;                       /* Where the nodes come from. */
+    ulong nodes;                    /* How many were made. */
+    ulong statements;
+    ulong unparsed;                 /* Statements that wouldn't parse. */
+    ulong blocks;                   /* Nested by blockNest(). */
+} astTree;
+
+/* Called by astWalk() for each node, parents first. Return 0 to skip the
+ * node's children. */
+typedef ushort (*ASTFUNC)(astNode *node, ushort depth, void *data);
+
+/*===========================================================================
+ * FUNCTION PROTOTYPES
+ *===========================================================================*/
+ulong  astSize(savProgram *prog);
+ushort astBuild(savProgram *prog, arena *a, astTree *tree);
+astNode *astNew(astTree *tree, uchar kind, ulong token);
+void   astAdd(astNode *parent, astNode *child);
+void   astWalk(astNode *node, ushort depth, ASTFUNC func, void *data);
+char  *astKindName(uchar kind);
+void   astDump(FILE *fp, astTree *tree);
+
+#endif /* __AST_H__ */
@@ -0,0 +1,739 @@
+/*=============================================================================
+ * BLOCKS. Nests the statements of each block inside the statement that opens
+ * it, once the AST has been built, so that code generation can walk the
+ * structure rather than search for the END. FOR ... END FOR becomes an
+ * AST_FOR, holding its ranges and an AST_BLOCK of the statements between,
+ * REPeat ... END REPeat an AST_REPEAT, holding the AST_BLOCK, IF ... ELSE
+ * ... END IF an AST_IF, holding its condition and one or two blocks, and
+ * SELect ON ... END SELect an AST_SELECT, holding an AST_CLAUSE for each ON.
+ *
+ * The nodes come from the tree's arena, which astSize() made big enough. A
+ * block that doesn't end, or is nested too deeply, is left flat, and its
+ * statements are written as not converted.
+ *===========================================================================*/
+
+/*===========================================================================
+ * HEADERS
+ *===========================================================================*/
+#include "blocks.h"
+
+/*===========================================================================
+ * TYPEDEFS
+ *===========================================================================*/
+
+/* What blockNest() is doing. */
+typedef struct blockNester {
+    astTree *tree;
+    ushort depth;                   /* Of nested blocks. */
+} blockNester;
+
+static ushort blockList(blockNester *b, astNode *parent);
+
+
+/*=============================================================================
+ * BLOCKISEXPRESSION() Can node be a value?
+ *===========================================================================*/
+static ushort blockIsExpression(astNode *node) {
+    return (node->kind >= AST_NUMBER && node->kind <= AST_PAREN);
+}
+
+
+/*=============================================================================
+ * BLOCKVARIABLE() Returns the name table entry of a FOR or NEXT's variable,
+ * or a REPeat's name, the first operand, or 0xFFFF if there isn't one.
+ *===========================================================================*/
+static ushort blockVariable(astNode *node) {
+    if (node->first && node->first->kind == AST_NAME) {
+        return node->first->entry;
+    }
+
+    return 0xFFFF;
+}
+
+
+/*=============================================================================
+ * BLOCKISKEYWORD() Is node the keyword statement kw, for the variable entry?
+ *===========================================================================*/
+static ushort blockIsKeyword(astNode *node, uchar kw, ushort entry) {
+    return (node->kind == AST_KEYWORD && node->op == kw + 1 && blockVariable(node) == entry);
+}
+
+
+/*=============================================================================
+ * BLOCKISEND() Is node END kw, for the variable entry? The name is optional.
+ *===========================================================================*/
+static ushort blockIsEnd(astNode *node, uchar kw, ushort entry) {
+    astNode *word = node->first;
+
+    if (node->kind != AST_KEYWORD || node->op != kwEnd + 1 ||
+        !word || word->kind != AST_WORD || word->op != kw + 1) {
+        return 0;
+    }
+
+    return (!word->next || (word->next->kind == AST_NAME && word->next->entry == entry));
+}
+
+
+/*=============================================================================
+ * BLOCKCHECKRANGES() Checks a FOR's ranges, the operands after the '=', and
+ * returns how many there are, or 0 if they aren't all 'from [TO to [STEP
+ * step]]', separated by commas.
+ *===========================================================================*/
+static ushort blockCheckRanges(astNode *child) {
+    ushort ranges = 0;
+
+    while (child) {
+        if (!blockIsExpression(child)) {
+            return 0;
+        }
+
+        if (child->sep == SEPARATOR_TO) {
+            child = child->next;
+            if (!child || !blockIsExpression(child)) {
+                return 0;
+            }
+
+            if (!child->sep && child->next &&
+                child->next->kind == AST_WORD && child->next->op == kwStep + 1) {
+                child = child->next->next;
+                if (!child || !blockIsExpression(child)) {
+                    return 0;
+                }
+            }
+        }
+
+        /* Each range but the last ends with a comma. */
+        if (child->sep == SEPARATOR_COMMA ? !child->next : (child->sep || child->next)) {
+            return 0;
+        }
+
+        ranges++;
+        child = child->next;
+    }
+
+    return ranges;
+}
+
+
+/*=============================================================================
+ * BLOCKTAKE() Unlinks child from its siblings and adds it to parent.
+ * Returns the sibling that followed it.
+ *===========================================================================*/
+static astNode *blockTake(astNode *parent, astNode *child) {
+    astNode *next = child->next;
+
+    child->next = NULL;
+    astAdd(parent, child);
+    return next;
+}
+
+
+/*=============================================================================
+ * BLOCKRANGES() Moves a checked FOR's ranges, from child on, into AST_RANGE
+ * nodes, which become the FOR's only children. Returns 1 if the arena is
+ * full.
+ *===========================================================================*/
+static ushort blockRanges(astTree *tree, astNode *node, astNode *child) {
+    astNode *range;
+    astNode *to;
+
+    node->first = node->last = NULL;
+
+    while (child) {
+        range = astNew(tree, AST_RANGE, child->token);
+        if (!range) {
+            return 1;
+        }
+        range->lineNumber = node->lineNumber;
+        astAdd(node, range);
+
+        to = child->next;
+        if (child->sep == SEPARATOR_TO) {
+            blockTake(range, child);
+            child = blockTake(range, to);
+            if (!to->sep && child && child->kind == AST_WORD) {
+                /* The STEP. */
+                child = blockTake(range, child->next);
+            }
+        } else {
+            child = blockTake(range, child);
+        }
+    }
+
+    return 0;
+}
+
+
+/*=============================================================================
+ * BLOCKFIND() Finds the end of a FOR or REPeat block, kw, for entry. In line,
+ * with more statements after it on its line, the block is the rest of the
+ * line, or up to an END on it. Otherwise it runs to the END or, for FOR in
+ * older programs, to the last NEXT, before another FOR of the same variable.
+ *
+ * Sets end to the END or closing NEXT, which is dropped, or NULL, and stop
+ * to the first statement after the block. Returns 0 if there is no end.
+ *===========================================================================*/
+static ushort blockFind(astNode *node, uchar kw, ushort entry, astNode **end, astNode **stop) {
+    astNode *child;
+
+    *end = NULL;
+    if (node->next && node->next->lineNumber == node->lineNumber) {
+        for (child = node->next; child && child->lineNumber == node->lineNumber; child = child->next) {
+            if (blockIsEnd(child, kw, entry) || (kw == kwFor && blockIsKeyword(child, kwNext, entry))) {
+                *end = child;
+                break;
+            }
+        }
+        *stop = (*end ? (*end)->next : child);
+        return 1;
+    }
+
+    for (child = node->next; child; child = child->next) {
+        if (child->kind == AST_DEFINE || blockIsKeyword(child, kw, entry)) {
+            break;
+        }
+        if (blockIsEnd(child, kw, entry)) {
+            *end = child;
+            break;
+        }
+        if (kw == kwFor && blockIsKeyword(child, kwNext, entry)) {
+            *end = child;
+        }
+    }
+
+    if (!*end) {
+        return 0;
+    }
+    *stop = (*end)->next;
+    return 1;
+}
+
+
+/*=============================================================================
+ * BLOCKMOVE() Moves the statements from first, up to but not including
+ * upto, into a new AST_BLOCK for owner. Returns the block, or NULL if the
+ * arena is full.
+ *===========================================================================*/
+static astNode *blockMove(blockNester *b, astNode *owner, astNode *first, astNode *upto) {
+    astNode *child;
+    astNode *block;
+
+    block = astNew(b->tree, AST_BLOCK, owner->token);
+    if (!block) {
+        return NULL;
+    }
+    block->lineNumber = owner->lineNumber;
+
+    for (child = first; child != upto; ) {
+        child = blockTake(block, child);
+    }
+
+    return block;
+}
+
+
+/*=============================================================================
+ * BLOCKMAKE() Moves the statements after node, up to end, or stop if there's
+ * no end, into a new AST_BLOCK, and drops the end. Returns the block, or
+ * NULL if the arena is full.
+ *===========================================================================*/
+static astNode *blockMake(blockNester *b, astNode *parent, astNode *node, astNode *end, astNode *stop) {
+    astNode *block;
+
+    block = blockMove(b, node, node->next, (end ? end : stop));
+    if (!block) {
+        return NULL;
+    }
+
+    node->next = stop;
+    if (!stop) {
+        parent->last = node;
+    }
+
+    b->tree->blocks++;
+    return block;
+}
+
+
+/*=============================================================================
+ * BLOCKFOR() Nests a FOR loop. Any NEXT, other than a closing one, stays in
+ * the loop. Returns 1 if the arena is full, and 0 otherwise, nested or not.
+ *===========================================================================*/
+static ushort blockFor(blockNester *b, astNode *parent, astNode *node) {
+    ushort entry = blockVariable(node);
+    astNode *end;
+    astNode *stop;
+    astNode *block;
+
+    if (entry == 0xFFFF || !node->first->next ||
+        node->first->next->kind != AST_SYMBOL || node->first->next->op != SYMBOL_EQUALS ||
+        !blockCheckRanges(node->first->next->next) ||
+        !blockFind(node, kwFor, entry, &end, &stop)) {
+        return 0;
+    }
+
+    block = blockMake(b, parent, node, end, stop);
+    if (!block) {
+        return 1;
+    }
+
+    node->kind = AST_FOR;
+    node->entry = entry;
+    if (blockRanges(b->tree, node, node->first->next->next)) {
+        return 1;
+    }
+    astAdd(node, block);
+
+    return blockList(b, block);
+}
+
+
+/*=============================================================================
+ * BLOCKREPEAT() Nests a REPeat loop, named or not. Returns 1 if the arena
+ * is full, and 0 otherwise, nested or not.
+ *===========================================================================*/
+static ushort blockRepeat(blockNester *b, astNode *parent, astNode *node) {
+    ushort entry = blockVariable(node);
+    astNode *end;
+    astNode *stop;
+    astNode *block;
+
+    if ((node->first && (entry == 0xFFFF || node->first->next)) ||
+        !blockFind(node, kwRepeat, entry, &end, &stop)) {
+        return 0;
+    }
+
+    block = blockMake(b, parent, node, end, stop);
+    if (!block) {
+        return 1;
+    }
+
+    node->kind = AST_REPEAT;
+    node->entry = entry;
+    node->first = node->last = NULL;
+    astAdd(node, block);
+
+    return blockList(b, block);
+}
+
+
+/*=============================================================================
+ * BLOCKISIF() Is node an IF, with just its condition?
+ *===========================================================================*/
+static ushort blockIsIf(astNode *node) {
+    return (node->kind == AST_KEYWORD && node->op == kwIf + 1 && node->first &&
+            !node->first->next && !node->first->sep && blockIsExpression(node->first));
+}
+
+
+/*=============================================================================
+ * BLOCKIFSCAN() Finds the ELSE and END IF of an IF. In line, with more
+ * statements after it on its line, the IF is the rest of the line, or up to
+ * an END IF on it. Otherwise it runs to the END IF. An IF inside it is
+ * skipped, with its ELSE and END IF, as an IF in line takes the rest of its
+ * line, an ELSE after it on the line belongs to it, not this one.
+ *
+ * Sets other to the ELSE, and end to the END IF, or NULL if they aren't
+ * there, and stop to the first statement after the IF. Returns 0 if it
+ * doesn't end. An IF that doesn't end is marked, so it is only scanned
+ * once, and so is any IF not in line around it, which can't end either.
+ *===========================================================================*/
+static ushort blockIfScan(astNode *node, ushort depth, astNode **other, astNode **end, astNode **stop) {
+    ushort inLine = (node->next && node->next->lineNumber == node->lineNumber);
+    astNode *child = node->next;
+    astNode *skip;
+    astNode *ignore;
+
+    *other = *end = NULL;
+    if (depth >= AST_MAX_DEPTH || (node->flags & AST_NO_END)) {
+        return 0;
+    }
+
+    while (child && (!inLine || child->lineNumber == node->lineNumber)) {
+        if (child->kind == AST_DEFINE) {
+            break;
+        }
+
+        if (blockIsIf(child)) {
+            if (blockIfScan(child, depth + 1, &ignore, &ignore, &skip)) {
+                child = skip;
+                continue;
+            }
+            if (!inLine) {
+                break;
+            }
+        }
+
+        if (child->kind == AST_KEYWORD && child->op == kwElse + 1 && !*other) {
+            *other = child;
+        } else if (blockIsEnd(child, kwIf, 0xFFFF)) {
+            *end = child;
+            break;
+        }
+        child = child->next;
+    }
+
+    if (!inLine && !*end) {
+        node->flags |= AST_NO_END;
+        return 0;
+    }
+
+    *stop = (*end ? (*end)->next : child);
+    return 1;
+}
+
+
+/*=============================================================================
+ * BLOCKIF() Nests an IF, as an AST_IF holding its condition, then a block
+ * for THEN and, if it has an ELSE, a block for that. Returns 1 if the arena
+ * is full, and 0 otherwise, nested or not.
+ *===========================================================================*/
+static ushort blockIf(blockNester *b, astNode *parent, astNode *node) {
+    astNode *other;
+    astNode *end;
+    astNode *stop;
+    astNode *then;
+    astNode *otherwise = NULL;
+    ushort result;
+
+    if (!blockIsIf(node) || !blockIfScan(node, 0, &other, &end, &stop)) {
+        return 0;
+    }
+
+    then = blockMove(b, node, node->next, (other ? other : (end ? end : stop)));
+    if (!then) {
+        return 1;
+    }
+
+    if (other) {
+        otherwise = blockMove(b, other, other->next, (end ? end : stop));
+        if (!otherwise) {
+            return 1;
+        }
+    }
+
+    node->next = stop;
+    if (!stop) {
+        parent->last = node;
+    }
+
+    node->kind = AST_IF;
+    astAdd(node, then);
+    if (otherwise) {
+        astAdd(node, otherwise);
+    }
+    b->tree->blocks++;
+
+    result = blockList(b, then);
+    if (!result && otherwise) {
+        result = blockList(b, otherwise);
+    }
+    return result;
+}
+
+
+/*=============================================================================
+ * BLOCKCLAUSEVALUES() Checks the values of a SELect clause, the operands
+ * after its '=', which are REMAINDER, or 'from [TO to]', separated by
+ * commas.
+ *===========================================================================*/
+static ushort blockClauseValues(astNode *child) {
+    astNode *item;
+
+    if (child && child->kind == AST_WORD && child->op == kwRemainder + 1) {
+        return !child->next;
+    }
+
+    for (item = child; item; item = item->next) {
+        if (item->kind == AST_WORD) {
+            return 0;
+        }
+    }
+
+    return (blockCheckRanges(child) != 0);
+}
+
+
+/*=============================================================================
+ * BLOCKCLAUSE() Is node a clause of a SELect ON entry, 'ON x = values' or
+ * just '= values'? If so, values is set to the first value.
+ *===========================================================================*/
+static ushort blockClause(astNode *node, ushort entry, astNode **values) {
+    astNode *child = node->first;
+
+    if (node->kind != AST_KEYWORD || node->op != kwOn + 1 || !child) {
+        return 0;
+    }
+
+    if (!(node->flags & AST_SHORT_ON)) {
+        if (child->kind != AST_NAME || child->entry != entry) {
+            return 0;
+        }
+        child = child->next;
+    }
+
+    if (!child || child->kind != AST_SYMBOL || child->op != SYMBOL_EQUALS ||
+        !blockClauseValues(child->next)) {
+        return 0;
+    }
+
+    *values = child->next;
+    return 1;
+}
+
+
+/*=============================================================================
+ * BLOCKISSELECT() Is node SELect ON x, maybe with a clause of its own, 'SELect
+ * ON x = values'? If it has, values is set to the first value, or else to
+ * NULL.
+ *===========================================================================*/
+static ushort blockIsSelect(astNode *node, astNode **values) {
+    astNode *child = node->first;
+
+    if (node->kind != AST_KEYWORD || node->op != kwSelect + 1 ||
+        !child || child->kind != AST_WORD || child->op != kwOn + 1 ||
+        !child->next || child->next->kind != AST_NAME) {
+        return 0;
+    }
+
+    child = child->next->next;
+    *values = NULL;
+    if (!child) {
+        return 1;
+    }
+
+    if (child->kind != AST_SYMBOL || child->op != SYMBOL_EQUALS || !blockClauseValues(child->next)) {
+        return 0;
+    }
+
+    *values = child->next;
+    return 1;
+}
+
+
+/*=============================================================================
+ * BLOCKSELECTSCAN() Finds the END SELect of a SELect. With a clause of its
+ * own, the SELect is the rest of its line, or up to an END SELect on it.
+ * Otherwise it runs to the END SELect. A SELect inside it is skipped, with
+ * its clauses. Sets end and stop, and marks a SELect that doesn't end, as
+ * blockIfScan() does for IF.
+ *===========================================================================*/
+static ushort blockSelectScan(astNode *node, ushort depth, astNode **end, astNode **stop) {
+    astNode *child = node->next;
+    astNode *values;
+    astNode *skip;
+    astNode *ignore;
+    ushort inLine;
+
+    *end = NULL;
+    if (depth >= AST_MAX_DEPTH || (node->flags & AST_NO_END) || !blockIsSelect(node, &values)) {
+        return 0;
+    }
+    inLine = (values != NULL);
+
+    while (child && (!inLine || child->lineNumber == node->lineNumber)) {
+        if (child->kind == AST_DEFINE) {
+            break;
+        }
+
+        if (blockIsSelect(child, &values)) {
+            if (blockSelectScan(child, depth + 1, &ignore, &skip)) {
+                child = skip;
+                continue;
+            }
+            if (!inLine) {
+                break;
+            }
+        }
+
+        if (blockIsEnd(child, kwSelect, 0xFFFF)) {
+            *end = child;
+            break;
+        }
+        child = child->next;
+    }
+
+    if (!inLine && !*end) {
+        node->flags |= AST_NO_END;
+        return 0;
+    }
+
+    *stop = (*end ? (*end)->next : child);
+    return 1;
+}
+
+
+/*=============================================================================
+ * BLOCKMAKECLAUSE() Makes clause, an ON statement or a new node, into an
+ * AST_CLAUSE of values, and adds it to the SELect. Returns 1 if the arena is
+ * full.
+ *===========================================================================*/
+static ushort blockMakeClause(blockNester *b, astNode *node, astNode *clause, astNode *values) {
+    clause->kind = AST_CLAUSE;
+    clause->next = NULL;
+    if (values->kind == AST_WORD) {
+        clause->op = kwRemainder + 1;
+        clause->first = clause->last = NULL;
+    } else {
+        clause->op = kwOn + 1;
+        if (blockRanges(b->tree, clause, values)) {
+            return 1;
+        }
+    }
+
+    astAdd(node, clause);
+    return 0;
+}
+
+
+/*=============================================================================
+ * BLOCKSELECT() Nests a SELect ON, as an AST_SELECT holding its variable,
+ * then its clauses, each with its values and a block of the statements
+ * after it, up to the next clause. Only REMarks can come before the first
+ * clause, they are kept in a block of their own. Returns 1 if the arena is
+ * full, and 0 otherwise, nested or not.
+ *===========================================================================*/
+static ushort blockSelect(blockNester *b, astNode *parent, astNode *node) {
+    ushort entry;
+    astNode *name;
+    astNode *values;
+    astNode *end;
+    astNode *stop;
+    astNode *upto;
+    astNode *child;
+    astNode *start;
+    astNode *owner;
+    astNode *skip;
+    astNode *ignore;
+    astNode *block;
+
+    if (!blockSelectScan(node, 0, &end, &stop)) {
+        return 0;
+    }
+
+    blockIsSelect(node, &values);
+    name = node->first->next;
+    entry = name->entry;
+    upto = (end ? end : stop);
+
+    if (!values) {
+        for (child = node->next; child != upto && !blockClause(child, entry, &ignore); child = child->next) {
+            if (child->kind != AST_REMARK) {
+                return 0;
+            }
+        }
+    }
+
+    start = node->next;
+    node->kind = AST_SELECT;
+    node->entry = entry;
+    node->first = node->last = NULL;
+    node->next = stop;
+    if (!stop) {
+        parent->last = node;
+    }
+    name->next = NULL;
+    name->sep = 0;
+    astAdd(node, name);
+
+    /* The statements after each clause, up to the next, are its block. */
+    owner = node;
+    if (values) {
+        owner = astNew(b->tree, AST_CLAUSE, values->token);
+        if (!owner || blockMakeClause(b, node, owner, values)) {
+            return 1;
+        }
+        owner->lineNumber = node->lineNumber;
+    }
+
+    child = start;
+    for (;;) {
+        if (child != upto && blockIsSelect(child, &ignore) && blockSelectScan(child, 1, &ignore, &skip)) {
+            child = skip;
+            continue;
+        }
+
+        if (child == upto || blockClause(child, entry, &values)) {
+            if (start != child || owner != node) {
+                block = blockMove(b, owner, start, child);
+                if (!block) {
+                    return 1;
+                }
+                astAdd(owner, block);
+            }
+
+            if (child == upto) {
+                break;
+            }
+
+            owner = child;
+            start = child = child->next;
+            if (blockMakeClause(b, node, owner, values)) {
+                return 1;
+            }
+            continue;
+        }
+
+        child = child->next;
+    }
+    b->tree->blocks++;
+
+    for (child = name->next; child; child = child->next) {
+        block = (child->kind == AST_BLOCK ? child : child->last);
+        if (blockList(b, block)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+
+/*=============================================================================
+ * BLOCKLIST() Nests the blocks in a list of statements, and in the DEFines
+ * and blocks in it. Returns 1 if the arena is full.
+ *===========================================================================*/
+static ushort blockList(blockNester *b, astNode *parent) {
+    astNode *node;
+    ushort result = 0;
+
+    /* Anything deeper is left flat. */
+    if (b->depth >= AST_MAX_DEPTH) {
+        return 0;
+    }
+
+    b->depth++;
+    for (node = parent->first; node && !result; node = node->next) {
+        if (node->kind == AST_DEFINE) {
+            result = blockList(b, node);
+        } else if (node->kind == AST_KEYWORD && node->op == kwFor + 1) {
+            result = blockFor(b, parent, node);
+        } else if (node->kind == AST_KEYWORD && node->op == kwRepeat + 1) {
+            result = blockRepeat(b, parent, node);
+        } else if (node->kind == AST_KEYWORD && node->op == kwIf + 1) {
+            result = blockIf(b, parent, node);
+        } else if (node->kind == AST_KEYWORD && node->op == kwSelect + 1) {
+            result = blockSelect(b, parent, node);
+        }
+    }
+    b->depth--;
+
+    return result;
+}
+
+
+/*=============================================================================
+ * BLOCKNEST() Nests every block in the program. Returns 0 if it worked, or
+ * 1 if the arena ran out.
+ *===========================================================================*/
+ushort blockNest(astTree *tree) {
+    blockNester b;
+
+    b.tree = tree;
+    b.depth = 0;
+    if (blockList(&b, tree->root)) {
+        fprintf(stderr, "\n\nERROR: blockNest(): Out of memory for the AST.\n");
+        return 1;
+    }
+
+    return 0;
+}
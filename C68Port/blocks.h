@@ -0,0 +1,14 @@
+#ifndef __BLOCKS_H__
+#define __BLOCKS_H__
+
+/*===========================================================================
+ * HEADERS
+ *===========================================================================*/
+#include "ast.h"
+
+/*===========================================================================
+ * FUNCTION PROTOTYPES
+ *===========================================================================*/
+ushort blockNest(astTree *tree);
+
+#endif /* __BLOCKS_H__ */
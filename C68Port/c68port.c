@@ -19,6 +19,14 @@
 
 #include "c68port.h"
 #include "keywords.h"
+#include "symbols.h"
+#include "ast.h"
+#include "blocks.h"
+#include "expr.h"
+#include "gen.h"
+#include "../Arena/arena.h"
+#include "../SavFile/savFile.h"
+#include "../Xref/xref.h"
 
 /*===========================================================================
  * GLOBALS
@@ -27,6 +35,17 @@
 ushort quit = 0;
 ushort lastLineSize = 0;
 nameTableEntry *nameTable = NULL;
+ushort nameTableSize = 0;
+uchar *nameBytes = NULL;            /* Where the names go, in the arena. */
+ulong nameBytesLeft = 0;
+
+arena decoderArena;                 /* All of the above, and the symbols. */
+
+savFile programFile;                /* The SAV file, in memory. */
+savProgram program;                 /* And the program decoded from it. */
+astTree ast;
+arena astArena;                     /* Every node of the AST. */
+ushort astMode = 0;                 /* -a writes it to astFile. */
 size_t ignore;
 
 /* File handles for, and the output files. */
@@ -39,6 +58,8 @@ char *globalFile = "globals_h";
 char headerFile[MAXPATH + 1];
 char sourceFile[MAXPATH + 1];
 char listingFile[MAXPATH + 1];
+char xrefFile[MAXPATH + 1];
+char astFile[MAXPATH + 1];
 
 ushort level = 0;           /* C68 source code indent level. */
 const uchar indent = 4;     /* Tab stop size. */
@@ -48,39 +69,59 @@ const uchar indent = 4;     /* Tab stop size. */
 
 /*=============================================================================
  * MAIN() Start here. Expects the input file on argv[1] and writes the output
- * to various files with messages and errors on stderr.
+ * to various files with messages and errors on stderr. With -x, or -j, a
+ * cross reference of the names is written too, as text to Filename_xrf or
+ * as JSON to Filename_json. With -a, the program's AST is written to
+ * Filename_ast.
  *===========================================================================*/
 int main (int argc, char *argv[]) {
 
     ushort nameTableEntries = 0;
+    ushort nameTableLength = 0;
     ushort programLines = 0;
     ulong  programOffset = 0;
+    char *fileName;
     FILE *fp;
+    int arg;
+
+    for (arg = 1; arg < argc - 1; arg++) {
+        if (strcmp(argv[arg], "-x") == 0) {
+            xrefMode = XREF_TEXT;
+        } else if (strcmp(argv[arg], "-j") == 0) {
+            xrefMode = XREF_JSON;
+        } else if (strcmp(argv[arg], "-a") == 0) {
+            astMode = 1;
+        } else {
+            break;
+        }
+    }
 
-    if (argc != 2) {
-        fprintf(stderr, "%s requires 1 argument, the SAV file name.\n", argv[0]);
+    if (argc < 2 || arg != argc - 1) {
+        fprintf(stderr, "%s requires 1 argument, the SAV file name, optionally after -x or -j, and -a.\n", argv[0]);
         return -1;
     }
 
+    fileName = argv[argc - 1];
+
     /* Can we open the SAV file? */
-    fp = fopen(argv[1], "rb");
+    fp = fopen(fileName, "rb");
     if (!fp) {
-        fprintf(stderr, "FATAL ERROR: main(): Cannot open SAV file '%s'.\n", argv[1]);
+        fprintf(stderr, "FATAL ERROR: main(): Cannot open SAV file '%s'.\n", fileName);
         return -1;
     }
 
-    fprintf(stderr, "SAV File..............: %s\n", argv[1]);
+    fprintf(stderr, "SAV File..............: %s\n", fileName);
 
     /* Can we read the header? */
-    if ((decodeHeader(fp, &nameTableEntries, &programLines)) != 0) {
+    if ((decodeHeader(fp, &nameTableEntries, &nameTableLength, &programLines)) != 0) {
         fprintf(stderr, "FATAL ERROR: decodeHeader() failed.\n");
         return -1;
     }
 
-    /* Allocate the name table. */
-    nameTable = malloc(nameTableEntries * sizeof(nameTableEntry));
-    if (!nameTable) {
-        fprintf(stderr, "FATAL ERROR: Cannot  allocate memory for name table. (%d entries).\n", nameTableEntries);
+    /* Allocate the name table, names and symbols in one go. */
+    arenaInit(&decoderArena);
+    if (reserveArena(fp, nameTableEntries, nameTableLength) != 0) {
+        fprintf(stderr, "FATAL ERROR: reserveArena() failed.\n");
         return -1;
     }
 
@@ -90,54 +131,317 @@ int main (int argc, char *argv[]) {
         return -1;
     }
 
+    /* Names are cross referenced as the program is decoded. */
+    if (xrefMode && xrefInit(nameTableEntries) != 0) {
+        fprintf(stderr, "FATAL ERROR: xrefInit() failed.\n");
+        return -1;
+    }
+
     /* Create the output file names. */
-    printf("\n\nInput SAV (source) file..: '%s'\n", argv[1]);
-    swapExtension(argv[1], headerFile, "h");
+    printf("\n\nInput SAV (source) file..: '%s'\n", fileName);
+    swapExtension(fileName, headerFile, "h");
     printf("Converted header file....: '%s'\n", headerFile);
 
-    swapExtension(argv[1], sourceFile, "c");
+    swapExtension(fileName, sourceFile, "c");
     printf("Converted source file....: '%s'\n", sourceFile);
 
-    swapExtension(argv[1], listingFile, "bas");
+    swapExtension(fileName, listingFile, "bas");
     printf("Conversion listing.......: '%s'\n", listingFile);
 
+    if (xrefMode) {
+        swapExtension(fileName, xrefFile, (xrefMode == XREF_JSON ? "json" : "xrf"));
+        printf("Cross reference..........: '%s'\n", xrefFile);
+    }
 
+    if (astMode) {
+        swapExtension(fileName, astFile, "ast");
+        printf("Syntax tree..............: '%s'\n", astFile);
+    }
 
-    /* Convert the program:
-     * This is effectively a SuperBASIC parser, in that it (should) know what to
-     * expect in each source line as we have already got SuperBASIC to tokenise
-     * it for us. Nice. Also, any errors in the source will have been ironed out
-     * that's syntax errors, not coding problems!
-     * So, it _should_ be relatively easy - famous last words - to convert to 
-     * C68 source. What could possibly go wrong?
-     */
-    if (parseProgram(fp, programOffset) != 0) {
-        fprintf(stderr, "FATAL ERROR: parseProgram() failed.\n");
+    /* Decode the whole program, in memory, noting where each name is used. */
+    if (decodeProgram(fileName) != 0) {
+        fprintf(stderr, "FATAL ERROR: decodeProgram() failed.\n");
         return -1;
     }
 
-    /* Decode the program. */
-    // if (decodeProgram(programLines, fp, argv[1]) != 0) {
-        // fprintf(stderr, "FATAL ERROR: decodeProgram() failed.\n");
-        // return -1;
-    // }
+    /* The cross reference only needs the decoded program. */
+    if (xrefMode && writeXref(fileName, nameTableEntries) != 0) {
+        fprintf(stderr, "FATAL ERROR: writeXref() failed.\n");
+        return -1;
+    }
+
+    /* Build the AST, from the same decoded program. */
+    if (buildAst() != 0) {
+        fprintf(stderr, "FATAL ERROR: buildAst() failed.\n");
+        return -1;
+    }
+
+    /* Write the C source, header and globals from it. */
+    if (genProgram(&ast, fileName) != 0) {
+        fprintf(stderr, "FATAL ERROR: genProgram() failed.\n");
+        return -1;
+    }
+
+    /* And the listing, from the program the AST was built from. */
+    if (writeListing() != 0) {
+        fprintf(stderr, "FATAL ERROR: writeListing() failed.\n");
+        return -1;
+    }
 
     /* All done, exit with no errors. */
-    if (nameTable) {
-        free(nameTable);
+    arenaFree(&astArena);
+    savFreeProgram(&program);
+    savFreeFile(&programFile);
+    symFree();
+    arenaFree(&decoderArena);
+    nameTable = NULL;
+
+    fclose(fp);
+
+    return 0;
+}
+
+/*=============================================================================
+ * DECODEPROGRAM() Reads the whole SAV file into memory and decodes its lines
+ * and tokens into program. With -x or -j, each name is noted against the line
+ * it's on as it is decoded, for the cross reference.
+ *===========================================================================*/
+ushort decodeProgram(char *fileName) {
+    savLine line;
+    savToken token;
+    ulong pos;
+    ushort result;
+    ushort x;
+
+    savInitFile(&programFile);
+    savInitProgram(&program);
+
+    if (savReadFile(fileName, &programFile) != SAV_OK) {
+        fprintf(stderr, "\n\nERROR: decodeProgram(): Cannot read '%s'.\n", fileName);
+        return 1;
+    }
+
+    program.flags[0] = programFile.flags[0];
+    program.flags[1] = programFile.flags[1];
+    program.nameTableLength = programFile.nameTableLength;
+    program.programLines = programFile.programLines;
+
+    for (x = 0; x < programFile.nameTableEntries; x++) {
+        if (savAddName(&program, programFile.names + x) != SAV_OK) {
+            return 1;
+        }
+    }
+
+    pos = programFile.programOffset;
+    while ((result = savNextLine(&programFile, &pos, &line)) == SAV_OK) {
+        if (savAddLine(&program, line.lineNumber) != SAV_OK) {
+            return 1;
+        }
+
+        program.lines[program.lineCount - 1].offset = line.offset;
+        for (;;) {
+            if (savNextToken(&programFile, &pos, &token) != SAV_OK) {
+                fprintf(stderr, "\n\nERROR: decodeProgram(): Cannot decode line %d.\n", line.lineNumber);
+                return 1;
+            }
+
+            if (token.type == TYPE_SYMBOL && token.code == SYMBOL_EOL) {
+                break;
+            }
+
+            if (token.type == TYPE_NAME && xrefMode &&
+                xrefUse(token.value, line.lineNumber) != 0) {
+                return 1;
+            }
+
+            if (savAddToken(&program, &token) != SAV_OK) {
+                return 1;
+            }
+        }
+    }
+
+    if (result != SAV_END) {
+        fprintf(stderr, "\n\nERROR: decodeProgram(): Cannot decode '%s'.\n", fileName);
+        return 1;
+    }
+
+    return 0;
+}
+
+
+/*=============================================================================
+ * BUILDAST() Builds the decoded program's AST, in astArena, which is reserved
+ * from the token count. Its blocks are nested and its constants folded. With
+ * -a, the tree is written to astFile as well.
+ *===========================================================================*/
+ushort buildAst(void) {
+    FILE *fp;
+
+    arenaInit(&astArena);
+    if (arenaReserve(&astArena, astSize(&program)) != 0 ||
+        astBuild(&program, &astArena, &ast) != 0 ||
+        blockNest(&ast) != 0) {
+        return 1;
+    }
+
+    fprintf(stderr, "\nAST Nodes.............: %lu\n", ast.nodes);
+    fprintf(stderr, "AST Statements........: %lu\n", ast.statements);
+    fprintf(stderr, "AST Unparsed..........: %lu\n", ast.unparsed);
+    fprintf(stderr, "AST Blocks............: %lu\n", ast.blocks);
+    fprintf(stderr, "AST Folded............: %lu\n", exprFold(&ast));
+
+    if (!astMode) {
+        return 0;
+    }
+
+    fp = fopen(astFile, "w");
+    if (!fp) {
+        fprintf(stderr, "\n\nERROR: buildAst(): Cannot open AST file '%s'.\n", astFile);
+        return 1;
     }
 
+    astDump(fp, &ast);
     fclose(fp);
+    return 0;
+}
+
+
+/*=============================================================================
+ * WRITELISTING() Writes the decoded program to listingFile.
+ * Each line has its number, then its tokens, as SuperBASIC. Keywords are
+ * followed by a space.
+ *===========================================================================*/
+ushort writeListing(void) {
+    savProgLine *line;
+    savToken *token;
+    ulong x;
+    ulong t;
+
+    listing = fopen(listingFile, "w");
+    if (!listing) {
+        fprintf(stderr, "\n\nERROR: writeListing(): Cannot open listing file '%s'.\n", listingFile);
+        return 1;
+    }
+
+    for (x = 0; x < program.lineCount; x++) {
+        line = program.lines + x;
+        fprintf(listing, "%5d ", line->lineNumber);
+
+        for (t = line->first; t < line->first + line->count; t++) {
+            token = program.tokens + t;
+            switch (token->type) {
+                case TYPE_MULTISPACE: fprintf(listing, "%*s", token->code, ""); break;
+                case TYPE_KEYWORD:    fprintf(listing, "%s ", savKeywords[token->code]); break;
+                case TYPE_SYMBOL:     fprintf(listing, "%s", savSymbols[token->code]); break;
+                case TYPE_OPERATOR:   fprintf(listing, "%s", savOperators[token->code]); break;
+                case TYPE_MONADIC:    fprintf(listing, "%s", savMonadics[token->code]); break;
+                case TYPE_SEPARATOR:  fprintf(listing, "%s", savSeparators[token->code]); break;
+
+                case TYPE_NAME:
+                    fprintf(listing, "%.*s", program.names[token->value].nameLength,
+                            program.names[token->value].name);
+                    break;
+
+                case TYPE_STRING:
+                    fprintf(listing, "%c%.*s%c", token->code, token->value, token->data + 4, token->code);
+                    break;
+
+                case TYPE_TEXT:
+                    fprintf(listing, "%.*s", token->value, token->data + 4);
+                    break;
+
+                default:
+                    listFloat(token->type, qlfpDecode(token->data));
+                    break;
+            }
+        }
+
+        fputc('\n', listing);
+    }
+
+    fclose(listing);
+    return 0;
+}
+
+
+/*=============================================================================
+ * LISTFLOAT() Writes a float to the listing as it was typed, %binary and
+ * $hexadecimal ones in their own base, which only ever hold whole numbers.
+ *===========================================================================*/
+void listFloat(uchar type, double value) {
+    ulong bits = (ulong)value;
+    ulong mask = 1;
+
+    if (type > TYPE_FP_HEX_MAX) {
+        fprintf(listing, "%.10g", value);
+    } else if (type > TYPE_FP_BIN_MAX) {
+        fprintf(listing, "$%lX", bits);
+    } else {
+        while (mask <= bits / 2) {
+            mask <<= 1;
+        }
+
+        fputc('%', listing);
+        for (; mask; mask >>= 1) {
+            fputc((bits & mask ? '1' : '0'), listing);
+        }
+    }
+}
+
+
+/*=============================================================================
+ * WRITEXREF() Writes the cross reference, collected while the program was
+ * decoded, to xrefFile.
+ *===========================================================================*/
+ushort writeXref(char *fileName, ushort entries) {
+    FILE *xref;
 
+    xref = fopen(xrefFile, "w");
+    if (!xref) {
+        fprintf(stderr, "\n\nERROR: writeXref(): Cannot open cross reference file '%s'.\n", xrefFile);
+        return 1;
+    }
+
+    xrefWrite(xref, fileName, nameTable, entries, xrefMode);
+    xrefFree();
+    fclose(xref);
     return 0;
 }
 
+/*=============================================================================
+ * RESERVEARENA() Sizes the arena from the header, then carves the name table
+ * and the bytes of the names out of it. The header's name table length is one
+ * byte more than each name, so that's enough for the names, unless it's 65535,
+ * when the names could be longer. Then they can't be more than the rest of the
+ * file. The symbol table takes the rest, later.
+ *===========================================================================*/
+ushort reserveArena(FILE *fp, ushort entries, ushort length) {
+    ulong names = nameBytesSize(fp, entries, length);
+    ulong size = ARENA_SIZE(nameTableEntry, entries) +
+                 ARENA_SIZE(uchar, names) +
+                 symSize(entries);
+
+    if (arenaReserve(&decoderArena, size) != 0) {
+        return 1;
+    }
+
+    nameTable = arenaAlloc(&decoderArena, ARENA_SIZE(nameTableEntry, entries));
+    nameBytes = arenaAlloc(&decoderArena, ARENA_SIZE(uchar, names));
+    if (!nameTable || !nameBytes) {
+        return 1;
+    }
+
+    nameBytesLeft = names;
+    return 0;
+}
+
+
 /*=============================================================================
  * DECODEHEADER() Decodes the header of the _save file and makes sure it's
  * valid, otherwise we abort. Returns the number of entries in the name table,
- * and the number of lines in the program.
+ * its length, and the number of lines in the program.
  *===========================================================================*/
-ushort decodeHeader(FILE *fp, ushort *entries, ushort *lines) {
+ushort decodeHeader(FILE *fp, ushort *entries, ushort *length, ushort *lines) {
     uchar  head[4];
     ushort valid;
     ushort nameTableLength = 0;
@@ -193,6 +497,7 @@ ushort decodeHeader(FILE *fp, ushort *entries, ushort *lines) {
     fflush(stderr);
     
     *entries = nameTableEntries;
+    *length = nameTableLength;
     *lines = programLines;
 
     return 0;
@@ -205,10 +510,9 @@ ushort decodeHeader(FILE *fp, ushort *entries, ushort *lines) {
  *===========================================================================*/
 ushort decodeNameTable(ushort entries, FILE *fp, ulong *offset) {
     ushort x;
-    uchar ch;
     ushort size = 0;
-    ushort procCount = 0;
-    ushort fnCount[3] = {0,0,0};        /* FN$, FN, FN% counters */
+    ushort kind;
+    ushort fnCount[4] = {0,0,0,0};      /* By return type, SYM_STRING etc. */
 
     fprintf(stderr, "decodeNameTable()\n");
 
@@ -217,37 +521,52 @@ ushort decodeNameTable(ushort entries, FILE *fp, ulong *offset) {
         nameTable[x].nameType = getWord(fp);
         nameTable[x].lineNumber = getWord(fp);        
         nameTable[x].nameLength = getWord(fp);
-        
-        /* Count up the details. */
-        switch (nameTable[x].nameType) {
-            case 0x1402: procCount++; break;
-            case 0x1501:
-            case 0x1502:
-            case 0x1503: fnCount[nameTable[x].nameType - 0x1501]++; break;
-        }
 
-        /* Do we need a recompile? */
-        if (nameTable[x].nameLength >= MAXNAMESIZE) {
-            size = MAXNAMESIZE - 1;
-            ignore = fread(nameTable[x].name, 1, size, fp);
-            fprintf(stderr, "\n\nWARNING: Cannot read a name with >= %d characters. Please amend the SAV file, or, recompile C68Port.\n", MAXNAMESIZE);
-            fprintf(stderr, "The offending name is '%*.*s'\n.", MAXNAMESIZE, MAXNAMESIZE, nameTable[x].name);
+        if (feof(fp)) {
+            fprintf(stderr, "\n\nERROR: decodeNameTable(): Unexpected end of file in name table entry %d.\n", x);
             return 1;
         }
-    
-        ignore = fread(nameTable[x].name, 1, nameTable[x].nameLength, fp);
+        
+        /* The header says how long the names are, all together. */
+        size = nameTable[x].nameLength;
+        if (size >= nameBytesLeft) {
+            fprintf(stderr, "\n\nERROR: decodeNameTable(): Name table entry %d is past the name table length in the header.\n", x);
+            return 1;
+        }
+
+        nameTable[x].name = nameBytes;
+        nameBytes += size + 1;
+        nameBytesLeft -= size + 1;
+
+        ignore = fread(nameTable[x].name, 1, size, fp);
+        nameTable[x].name[size] = '\0';
 
         /* Odd length names are padded. */
         if (nameTable[x].nameLength & 1)
-            ch = fgetc(fp);
+            fgetc(fp);
+    }
+
+    /* Names in the program are checked against this. */
+    nameTableSize = entries;
+
+    /* Everything else finds out what a name is from the symbol table. */
+    if (symBuild(nameTable, entries, &decoderArena) != 0) {
+        return 1;
+    }
+
+    for (x = 0; x < symbols.kindCount[SYM_FN]; x++) {
+        fnCount[symbols.symbols[symbols.byKind[SYM_FN][x]].type]++;
     }
 
     fprintf(stderr, "\nNAME TABLE\n==========\n");
 
-    fprintf(stderr, "\nNumber of Procedures..: %4d", procCount);
-    fprintf(stderr, "\nNumber of Function$...: %4d", fnCount[0]);
-    fprintf(stderr, "\nNumber of Function....: %4d", fnCount[1]);
-    fprintf(stderr, "\nNumber of Function%%...: %4d\n", fnCount[2]);
+    for (kind = 0; kind < SYM_KINDS; kind++) {
+        fprintf(stderr, "\nNumber of %-12.12s: %4d", symKindName(kind), symbols.kindCount[kind]);
+    }
+
+    fprintf(stderr, "\nNumber of Function$...: %4d", fnCount[SYM_STRING]);
+    fprintf(stderr, "\nNumber of Function....: %4d", fnCount[SYM_FLOAT]);
+    fprintf(stderr, "\nNumber of Function%%...: %4d\n", fnCount[SYM_INTEGER]);
 
     for (x = 0; x < entries; x++) {
         fprintf(stderr, "\n%4.4X: ", nameTable[x].offset);
@@ -256,6 +575,7 @@ ushort decodeNameTable(ushort entries, FILE *fp, ulong *offset) {
         fprintf(stderr, "Line Number: %5d, ", nameTable[x].lineNumber);
         fprintf(stderr, "Name: Size = %3d, ", nameTable[x].nameLength);
         fprintf(stderr, "%*.*s", nameTable[x].nameLength, nameTable[x].nameLength, nameTable[x].name);
+        fprintf(stderr, " (%s, %s)", symKindName(symbols.symbols[x].kind), symbols.symbols[x].cName);
     }
 
     fflush(stderr);
@@ -267,421 +587,6 @@ ushort decodeNameTable(ushort entries, FILE *fp, ulong *offset) {
 }
 
 
-/*=============================================================================
- * PARSEPROGRAM() is the top level program parser. It will open the files and
- * call out repeatedly to parseProgramLine() to do the needful.
- *===========================================================================*/
-ushort parseProgram(FILE *fp, ulong offset) {
-    fprintf(stderr, "parseProgram()\n");
-
-    /* Open output files */
-    header = fopen(headerFile, "w");
-    source = fopen(sourceFile, "w");
-    globals = fopen(globalFile, "w");
-    listing = fopen(listingFile, "w");
-
-    /* Position at correct location */
-    fseek(fp, offset, SEEK_SET);
-    if (ftell(fp) != offset) {
-        fprintf(stderr, "\n\nERROR: parseProgram() cannot seek to start of program lines at position %ld\n.", offset);
-        return 1;
-    }
-
-    /* Parse Program Lines */
-    while (1) {
-        if (feof(fp)) 
-            break;
-
-        if (parseProgramLine(fp) != 0) {
-            fprintf(stderr, "\n\nERROR: parseProgramLine() failed.\n");
-            return 1;
-        }
-    }
-
-
-    /* Close Output Files */
-    fclose(header);
-    fclose(source);
-    fclose(globals);
-    fclose(listing);
-}
-
-
-/*=============================================================================
- * PARSEPROGRAMLINE() is the low level program parser. It will parse and 
- * convert one line of the source program at a time. A line is made up of:
- * 
- * Word: Line length change from previous line.
- * Word: 0x8D00 (TYPE_LINENUMBER) Indicates a line number to follow.
- * Word: The line number.
- * Bytes: The content of the line. (LineSize in size, obviously!)
- * Byte: 0x84 (TYPE_SYMBOL) Indicates a linefeed to follow.
- * Byte: 0x0A The end of the line.
- * 
- * Lines may, of course, have multiple statements, but the last one is always
- * terminated by a 0x840a word. (Well, pair of bytes!)
- * 
- * BEWARE, lines can only start with:
- * 
- * Keywords - but not $8107 (PROCedure), $8108 (FuNction) or $810D (ERRor),
- * Names - but only type $0800 (Procedures) or $1402 (SuperBASIC procedure),
- * Separators - but only a colon (Symbol $8402),
- * Multispaces - $80nn.
- *===========================================================================*/
-ushort parseProgramLine(FILE *fp) {
-    static ushort lineSize = 0;         /* Current line size */
-    ushort flag;                        /* Line number coming indicator */
-    ushort lineNumber;                  /* Guess! */
-
-    /* 
-     * Read the change in lineSize. We might be at EOF though
-     * so check this and return if so. we are done.
-     */
-    lineSize += getWord(fp);
-    if (feof(fp))
-        return 0;
-
-    if ((flag = getWord(fp)) != TYPE_LINENUMBER) {
-        fprintf(stderr, "\n\nERROR: parseProgramLine(): Program out of step at offset %ld ($%08lx).\n", ftell(fp), ftell(fp));
-        fprintf(stderr, "Expected 0x8D00, found 0x%X.\n", flag);
-        return 1;
-    }
-
-    /* Now the line number */
-    lineNumber = getWord(fp);
-    fprintf(listing, "%5d ", lineNumber);
-    printf("parseProgramLine(%d)\n", lineNumber);
-
-    /* And the rest of the line - the statements */
-    while (1) {
-        /* Parse one statement and check for end of line */
-        if ((flag = parseStatement(fp)) == 10) {
-            return 0;
-        }
-
-        /* If an error was found, bale out. */
-        if (flag != 0) {
-            fprintf(stderr, "\n\nERROR: parseProgramLine(): parseStatement() Failed.\n");
-            return flag;
-        }
-    }
-}
-
-
-
-/*=============================================================================
- * PARSESTATEMENT() is the very low level program parser. It will parse and 
- * convert one statement of the source program at a time. This is made up of:
- * 
- * Byte: To determine the statements type.
- * Byte: Parameter for the type byte.
- * Bytes: The content of the statements.
- * EITHER:
- * Byte: 0x84 (TYPE_SYMBOL) Indicates a linefeed to follow.
- * Byte: 0x0A The end of the line.
- * OR:
- * Byte: 0x84 (TYPE_SYMBOL) Indicates a symbol to follow.
- * Byte: 0x02 End of statement, a colon.
- * 
- * Returns 10 if end of line found.
- *          2 if end of statement found.
- *          1 if error.
- *===========================================================================*/
-ushort parseStatement(FILE *fp) {
-    uchar  typeByte;                    /* What are we processing? */
-    ulong offset;                       /* Where are we in the file? */
-    uchar endOfLine;                    /* Colon? End of Line? */
-
-    fprintf(stderr, "parseStatement()\n");
-
-    /* Type Byte */
-    typeByte = fgetc(fp);
-    endOfLine = 0;
-
-    /*-------------------------------------------------------------------------
-     * OK, there's a problem here. When we exit from whatever code we call to
-     * parse something, we need to be holding the next type byte. We exit back
-     * to parseProgram() when we hit (0x84 0x0A) which is a doSymbol() call
-     * technically.
-     * ----------------------------------------------------------------------*/
-    switch(typeByte) {
-        case TYPE_MULTISPACE: doMultiSpaces(fp); break;
-        case TYPE_KEYWORD:    doKeywords(fp); break;
-        case TYPE_SYMBOL:     doSymbols(fp); break;
-        case TYPE_OPERATOR:   doOperators(fp); break;
-        case TYPE_MONADIC:    doMonadics(fp); break;
-        case TYPE_NAME:       doNames(fp); break;
-        case TYPE_STRING:     doStrings(fp); break;
-        case TYPE_TEXT:       doText(fp); break;
-        case TYPE_SEPARATOR:  doSeparators(fp); break;
-
-        /* Floats come in three formats, each with 16 leading bytes! */
-        case TYPE_FP_BIN_MIN ... TYPE_FP_BIN_MIN:   
-        case TYPE_FP_HEX_MIN ... TYPE_FP_HEX_MAX:
-        case TYPE_FP_DEC_MIN ... TYPE_FP_DEC_MAX:   
-                                doFloatingPoint(fp, typeByte); break;
-
-        default: 
-            offset = ftell(fp);
-            fprintf(stderr, "\n\nERROR: parseStatement(): At offset %ld ($%08lx), read byte %d (%c). Out of sync.", offset, offset, typeByte, (typeByte > 31 ? typeByte : '.'));
-            return 1;
-    }
-
-    /*
-     * At this point, we should be looking for either an end of statement 0x8402
-     * or and end of line 0x840a word. In either case we should check for it and
-     * call out to doSymbol() to print the details to the BAS listing and also
-     * to end the line in the C source file.
-     */
-
-    typeByte = fgetc(fp);
-    if (typeByte != 0x84) {
-        fprintf(stderr, "\n\nERROR: parseStatement(): At offset %ld ($%08lx), read byte %d (%c). Out of sync.", offset, offset, typeByte, (typeByte > 31 ? typeByte : '.'));
-        return 1;
-    }
-
-    /*
-     * Fetch the terminator byte then shove it back! 
-     */
-    endOfLine = fgetc(fp);
-    ungetc(endOfLine, fp);
-
-    doSymbols(fp);
-
-    switch (endOfLine) {
-        case 2: return 0; 
-                break;               /* Another statement to process */
-
-        case 10: return endOfLine;
-                 break;              /* End of the current line */
-
-        default: return 1; 
-                 break;             /* Oops! */
-    }
-}
-
-
-
-
-void doMultiSpaces(FILE *fp){
-    /* 0x80.nn = Print nn spaces */
-    uchar nn = fgetc(fp);
-    fprintf(listing, "%*.*s", nn, nn, " ");
-}
-
-/*=============================================================================
- * DOKEYWORDS() Call here when a keyword is read from the SAV file. This will
- * print the appropriate codes to the listing file, and then process the 
- * keyword into something resembling C68 source code. I hope! 
- *===========================================================================*/
-void doKeywords(FILE *fp){
-    /* 0x81.nn = Print keywords[nn] */
-
-    static char *keywords[] = {
-        "END", "FOR", "IF", "REPeat", "SELect", "WHEN", "DEFine",
-        "PROCedure", "FuNction", "GO", "TO", "SUB", "", "ERRor", "",
-        "", "RESTORE", "NEXT", "EXIT", "ELSE", "ON", "RETurn",
-        "REMAINDER", "DATA", "DIM", "LOCal", "LET", "THEN", "STEP",
-        "REMark", "MISTAKE"
-    };
-
-    static KWFUNC kwFunctions[] = {
-        keywordNull, //kwEnd, 
-        keywordNull, //kwFor, 
-        keywordNull, //kwIf, 
-        keywordNull, //kwRepeat, 
-        keywordNull, //kwSelect, 
-        keywordNull, //kwWhen, 
-        keywordNull, //kwDefine,
-        keywordNull, //kwProcedure,
-        keywordNull, //kwFunction, 
-        keywordNull, //kwGo, 
-        keywordNull, //kwTt, 
-        keywordNull, //kwSub, 
-        keywordNull, //kwNull_1, 
-        keywordNull, //kwError, 
-        keywordNull, //kwNull_2,
-        keywordNull, //kwNull_3, 
-        keywordNull, //kwRestore, 
-        keywordNull, //kwNext, 
-        keywordNull, //kwExit, 
-        keywordNull, //kwElse, 
-        keywordNull, //kwOn, 
-        keywordNull, //kwReturn,
-        keywordNull, //kwRemainder,
-        keywordNull, //kwData, 
-        keywordNull, //kwDim, 
-        keywordNull, //kwLocal, 
-        keywordNull, //kwLet, 
-        keywordNull, //kwThen, 
-        keywordNull, //kwStep,
-        keywordRemark, //kwRemark, 
-        keywordMistake, //kwMistake
-    };
-    
-    /* Read the keyword index, update the listing file, then
-     * call the appropriate helper routine in keywords.c to
-     * do the conversion to C68 source code.
-     */
-    fprintf(stderr, "doKeywords()\n");
-    uchar nn = fgetc(fp) -1;
-    fprintf(listing, "%s ", keywords[nn]);
-    (kwFunctions[nn])(fp);
-}
-
-
-void doSymbols(FILE *fp){
-    /* 0x84.nn = Print symbols[nn] */
-
-    static char *symbols = "=:#,(){} \n";
-
-    fprintf(stderr, "doSymbols()\n");
-    uchar nn = fgetc(fp) -1;
-
-    fprintf(listing, "%c", symbols[nn]);
-
-    /* For EOL, we need to terminate the C code line */
-    if (nn == 9)
-        fprintf(source, "\n");
-}
-
-
-void doOperators(FILE *fp){
-    /* 0x85.nn = Print operators[nn] */
-
-    static char *operators[] = {
-        "+", "-", "*", "/", ">=", ">", "==", "=", "<>", "<=", "<",
-        "||", "&&", "^^", "^", "&", "OR", "AND", "XOR", "MOD",
-        "DIV", "INSTR"
-    };
-
-    fprintf(stderr, "doOperators()\n");
-    uchar nn = fgetc(fp) -1;
-    fprintf(listing, "%s", operators[nn]);
-}
-
-
-void doMonadics(FILE *fp){
-    /* 0x86.nn = Print monadics[nn] */
-
-    static char *monadics[] = {
-        "+", "-", "~~", "NOT"
-    };
-
-    fprintf(stderr, "doMonadics()\n");
-    uchar nn = fgetc(fp) -1;
-    fprintf(listing, "%s", monadics[nn]);
-}
-
-
-void doNames(FILE *fp){
-    /* 0x8800.0xnnnn = Print name[0xnnnn] */
-    uchar nn = fgetc(fp);   /* ignore */
-    ushort entry = getWord(fp);
-    fprintf(stderr, "doNames()\n");
-    fprintf(listing, "%*.*s", nameTable[entry].nameLength, nameTable[entry].nameLength, nameTable[entry].name);
-}
-
-
-void doStrings(FILE *fp){
-    /* 0x8B.delim.size.bytes.[padding] = Print delimited string */
-    uchar delim = fgetc(fp);    /* Delimiter */
-    ushort size = getWord(fp);  /* String length */
-    ushort x;
-
-    fprintf(stderr, "doStrings()\n");
-    fputc(delim, listing);
-    for (x = 0; x < size; x++) {
-        fputc(fgetc(fp), listing);
-    }
-
-    fputc(delim, listing);
-
-    if (size & 1)
-        fgetc(fp);              /* Padding */
-}
-
-
-void doText(FILE *fp){
-    /* 0x8C00.size.bytes = Print undelimited text
-    */
-    uchar ignore = fgetc(fp);    /* 00 byte */
-    ushort size = getWord(fp);  /* String length */
-    ushort x;
-
-    fprintf(stderr, "doText()\n");
-    for (x = 0; x < size; x++) {
-        ignore = fgetc(fp);
-        fputc(ignore, listing);
-        fputc(ignore, source);
-    }
-
-    if (size & 1)
-        fgetc(fp);              /* Padding byte*/
-}
-
-
-void doSeparators(FILE *fp){
-    /* 0x8E.nn = Print separators[nn] */
-
-    static char *separators[] = {
-        ",", ";", "\\", "!", "TO"
-    };
-
-    uchar nn = fgetc(fp) -1;
-    fprintf(stderr, "doSeparators()\n");
-    fprintf(listing, "%s", separators[nn]);
-}
-
-
-void doFloatingPoint(FILE *fp, uchar leading){
-    /* Floating points come in three variations:
-     * 0xDn = % Binary
-     * 0xEn = $ Hexadecimal
-     * 0xFn = Normal.
-     *
-     * Each one is followed by 5 bytes.
-     */
-    ushort x;
-    uchar fpType = ((leading & 0xF0) >> 4) - 13;
-    char fpPrefix = (fpType == 0 ? '%' : fpType == 1 ? '$' : ' ');
-
-    /* 6 byte QL Float structure */
-    union {
-        QLFLOAT_t buffer;
-        ushort sh[3];
-    } fpVariable;
-
-    fprintf(stderr, "doFloatingPoints()\n");
-
-    /* Print the Float prefix character, if necessary. */
-    if (fpType == 0 || fpType == 1) {
-        fprintf(listing, "%c", fpPrefix);
-    }
-
-    /* Backup up one byte. We can read the whole FP then. */
-    fseek(fp, -1, SEEK_CUR);
-
-#ifndef QDOS
-
-    /* This reads a QL Float for wrong endian systems! */
-    fpVariable.sh[0] = getWord(fp);
-    fpVariable.sh[2] = getWord(fp);
-    fpVariable.sh[1] = getWord(fp);
-
-    fprintf(listing, "%f", qlfpToDouble(&fpVariable.buffer));
-
-#else
-
-    /* But the QL is correct endian! */
-    ignore = fread(&fpVariable.buffer, 1, sizeof(QLFLOAT_t), fp);    
-    fprintf(listing, "%f", qlfp_to_d(&fpVariable.buffer));
-
-#endif     
-
-}
-
-
 
 
 /*=============================================================================
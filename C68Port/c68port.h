@@ -6,7 +6,7 @@
 /*===========================================================================
  * DEFINES
  *===========================================================================*/
-#define MAXNAMESIZE 32              /* Max allowed name size in name table. */
+#define MAXNAMESIZE 32              /* Longest name used for C names. */
 #define QLFP_BINARY 0               /* Binary float, A = %01011. */
 #define QLFP_HEXADECIMAL 1          /* Hexadecimal float, A = $12AB. */
 #define QLFP_DECIMAL 2              /* Decimal float, A = 1234. */
@@ -56,29 +56,20 @@ typedef struct {
     ushort nameType;                /* Name type. */
     short  lineNumber;              /* Line number of definition. */
     ushort nameLength;              /* Length of actual name. */
-    uchar name[MAXNAMESIZE];        /* Bytes of name. */
+    uchar  *name;                   /* Bytes of name, in the arena. */
 } nameTableEntry;
 
 /*===========================================================================
  * FUNCTION PROTOTYPES
  *===========================================================================*/
-ushort decodeHeader(FILE *fp, ushort *entries, ushort *lines);
+ushort decodeHeader(FILE *fp, ushort *entries, ushort *length, ushort *lines);
+ushort reserveArena(FILE *fp, ushort entries, ushort length);
 ushort decodeNameTable(ushort entries, FILE *fp, ulong *offset);
-ushort parseProgram(FILE *fp, ulong offset);
-ushort parseProgramLine(FILE *fp);
-ushort parseStatement(FILE *fp);
-
-
-void doMultiSpaces(FILE *fp);
-void doKeywords(FILE *fp);
-void doSymbols(FILE *fp);
-void doOperators(FILE *fp);
-void doMonadics(FILE *fp);
-void doNames(FILE *fp);
-void doStrings(FILE *fp);
-void doText(FILE *fp);
-void doSeparators(FILE *fp);
-void doFloatingPoint(FILE *fp, uchar leading);
+ushort decodeProgram(char *fileName);
+ushort writeXref(char *fileName, ushort entries);
+ushort buildAst(void);
+ushort writeListing(void);
+void   listFloat(uchar type, double value);
 
 short  getWord(FILE *fp);
 
@@ -0,0 +1,1163 @@
+/*=============================================================================
+ * EXPRESSIONS. Translates AST expressions into C. The AST already has
+ * SuperBASIC's precedence, so all that is left is to spell each operator
+ * the C way, add the coercions SuperBASIC does without being asked, and
+ * work out, at conversion time, anything made only of constants.
+ *
+ * Types are the SYM_ ones. Strings are SB_CHAR *, and the SuperBASIC
+ * operators that C doesn't have call helpers from SBRuntime.
+ *===========================================================================*/
+
+/*===========================================================================
+ * HEADERS
+ *===========================================================================*/
+#include <math.h>
+#include <ctype.h>
+
+#include "expr.h"
+
+/*===========================================================================
+ * GLOBALS
+ *===========================================================================*/
+
+/* C spellings of the comparison operators, by operator code. */
+static char *exprCompare[SAV_OPERATORS + 1] = {
+    NULL,
+    NULL, NULL, NULL, NULL,
+    ">=", ">", "==", "==", "!=", "<=", "<"
+};
+
+/* Names written as something else, the counter of an integer FOR loop
+ * for its variable, or a LOCal that must be looked up. The innermost is
+ * last. */
+typedef struct exprAliasName {
+    ushort entry;
+    uchar type;
+    uchar how;                      /* EXPR_ALIAS_... */
+    char cName[EXPR_MAX_ALIAS];
+} exprAliasName;
+
+static exprAliasName exprAliases[EXPR_MAX_ALIASES];
+static ushort exprAliasCount = 0;
+
+static void exprRaw(FILE *fp, astTree *tree, astNode *node);
+static void exprTemps(astNode *node, uchar want, ushort *made, ushort *held, ushort *fits);
+
+
+/*=============================================================================
+ * EXPRALIAS() Writes the name table entry as cName, of type, until
+ * exprUnalias() is called, or, how it is EXPR_ALIAS_LOCAL, through the
+ * handle of the LOCal of that name. Returns 0 if there are too many
+ * already.
+ *===========================================================================*/
+ushort exprAlias(ushort entry, char *cName, uchar type, uchar how) {
+    exprAliasName *alias;
+
+    if (exprAliasCount >= EXPR_MAX_ALIASES) {
+        return 0;
+    }
+
+    alias = exprAliases + exprAliasCount++;
+    alias->entry = entry;
+    alias->type = type;
+    alias->how = how;
+    strncpy(alias->cName, cName, EXPR_MAX_ALIAS - 1);
+    alias->cName[EXPR_MAX_ALIAS - 1] = '\0';
+    return 1;
+}
+
+
+/*=============================================================================
+ * EXPRUNALIAS() Drops the last alias made.
+ *===========================================================================*/
+void exprUnalias(void) {
+    if (exprAliasCount) {
+        exprAliasCount--;
+    }
+}
+
+
+/*=============================================================================
+ * EXPRFINDALIAS() Returns the alias for a name table entry, or NULL.
+ *===========================================================================*/
+static exprAliasName *exprFindAlias(ushort entry) {
+    ushort x;
+
+    for (x = exprAliasCount; x > 0; x--) {
+        if (exprAliases[x - 1].entry == entry) {
+            return exprAliases + x - 1;
+        }
+    }
+
+    return NULL;
+}
+
+
+/*=============================================================================
+ * EXPRNAME() Puts the C for a variable in name, which has room for
+ * EXPR_NAME_SIZE characters, and returns it. A LOCal that a PROCedure or
+ * FuNction may see is used through its handle, cName_local, the address of
+ * the most recent one, or of the global if there isn't one, found as the
+ * function starts.
+ *===========================================================================*/
+char *exprName(ushort entry, char *name) {
+    exprAliasName *alias = exprFindAlias(entry);
+    symbol *sym = symLookup(entry);
+
+    if (!sym) {
+        strcpy(name, "0");
+    } else if (!alias) {
+        strcpy(name, sym->cName);
+    } else if (alias->how == EXPR_ALIAS_LOCAL) {
+        sprintf(name, "(*%s_local)", sym->cName);
+    } else {
+        strcpy(name, alias->cName);
+    }
+
+    return name;
+}
+
+
+/*=============================================================================
+ * EXPRROUND() Rounds a number to an integer, as SuperBASIC does. Returns 0
+ * if it won't fit in an SB_INTEGER.
+ *===========================================================================*/
+static ushort exprRound(double value, long *result) {
+    double rounded = floor(value + 0.5);
+
+    if (rounded < -32768 || rounded > 32767) {
+        return 0;
+    }
+
+    *result = (long)rounded;
+    return 1;
+}
+
+
+/*=============================================================================
+ * EXPRCONSTANT() Is node a number, after folding? If so, value is set.
+ *===========================================================================*/
+ushort exprConstant(astNode *node, double *value) {
+    if (node && node->kind == AST_NUMBER) {
+        *value = node->value;
+        return 1;
+    }
+
+    return 0;
+}
+
+
+/*=============================================================================
+ * EXPRBINARY() Works out a op b, for constants. Returns 0 if it can't be
+ * done, or is an error which must be left for the program to report.
+ *===========================================================================*/
+static ushort exprBinary(uchar op, double a, double b, double *result) {
+    long x;
+    long y;
+
+    switch (op) {
+        case OPERATOR_PLUS:   *result = a + b; break;
+        case OPERATOR_MINUS:  *result = a - b; break;
+        case OPERATOR_TIMES:  *result = a * b; break;
+
+        case OPERATOR_DIVIDE:
+            if (b == 0) {
+                return 0;
+            }
+            *result = a / b;
+            break;
+
+        case OPERATOR_POWER:  *result = pow(a, b); break;
+        case OPERATOR_GE:     *result = (a >= b); break;
+        case OPERATOR_GT:     *result = (a > b); break;
+        case OPERATOR_EQUALS: *result = (a == b); break;
+        case OPERATOR_NE:     *result = (a != b); break;
+        case OPERATOR_LE:     *result = (a <= b); break;
+        case OPERATOR_LT:     *result = (a < b); break;
+        case OPERATOR_OR:     *result = (a != 0 || b != 0); break;
+        case OPERATOR_AND:    *result = (a != 0 && b != 0); break;
+        case OPERATOR_XOR:    *result = ((a != 0) != (b != 0)); break;
+
+        case OPERATOR_APPROX:
+            *result = (fabs(a - b) <= (fabs(a) > fabs(b) ? fabs(a) : fabs(b)) * 1e-7);
+            break;
+
+        case OPERATOR_BITOR:
+        case OPERATOR_BITAND:
+        case OPERATOR_BITXOR:
+        case OPERATOR_MOD:
+        case OPERATOR_DIV:
+            if (!exprRound(a, &x) || !exprRound(b, &y)) {
+                return 0;
+            }
+
+            if (op == OPERATOR_BITOR) {
+                *result = (short)(x | y);
+            } else if (op == OPERATOR_BITAND) {
+                *result = (short)(x & y);
+            } else if (op == OPERATOR_BITXOR) {
+                *result = (short)(x ^ y);
+            } else if (y == 0) {
+                return 0;
+            } else if (op == OPERATOR_MOD) {
+                *result = x % y;
+                if (*result && ((*result < 0) != (y < 0))) {
+                    *result += y;
+                }
+            } else {
+                *result = floor((double)x / y);
+            }
+            break;
+
+        default:
+            /* & and INSTR are for strings. */
+            return 0;
+    }
+
+    return isfinite(*result);
+}
+
+
+/*=============================================================================
+ * EXPRRADIX() Works out HEX('...') or BIN('...') of a string constant.
+ * Returns 0 if it isn't one, or isn't valid.
+ *===========================================================================*/
+static ushort exprRadix(astTree *tree, astNode *node, double *result) {
+    savProgram *prog = tree->prog;
+    savToken *token;
+    savName *name;
+    symbol *sym;
+    ushort radix;
+    ushort x;
+    uchar digit;
+    double value = 0;
+
+    sym = symLookup(node->entry);
+    if (!sym || sym->kind != SYM_MC_FN || node->entry >= prog->nameCount) {
+        return 0;
+    }
+
+    name = prog->names + node->entry;
+    if (name->nameLength != 3) {
+        return 0;
+    }
+
+    if (toupper(name->name[0]) == 'H' && toupper(name->name[1]) == 'E' && toupper(name->name[2]) == 'X') {
+        radix = 16;
+    } else if (toupper(name->name[0]) == 'B' && toupper(name->name[1]) == 'I' && toupper(name->name[2]) == 'N') {
+        radix = 2;
+    } else {
+        return 0;
+    }
+
+    /* One string argument, that's all digits, and not too many of them. */
+    if (!node->first || node->first != node->last || node->first->kind != AST_STRING) {
+        return 0;
+    }
+
+    token = prog->tokens + node->first->token;
+    if (token->value == 0 || token->value > (radix == 16 ? 8 : 32)) {
+        return 0;
+    }
+
+    for (x = 0; x < token->value; x++) {
+        digit = toupper(token->data[4 + x]);
+        if (digit >= '0' && digit <= '9') {
+            digit -= '0';
+        } else if (digit >= 'A' && digit <= 'F') {
+            digit -= 'A' - 10;
+        } else {
+            return 0;
+        }
+
+        if (digit >= radix) {
+            return 0;
+        }
+        value = value * radix + digit;
+    }
+
+    *result = value;
+    return 1;
+}
+
+
+/*=============================================================================
+ * EXPRFOLDNODE() Folds node's children, then node itself if they are all
+ * constants. Returns how many nodes were folded.
+ *===========================================================================*/
+static ulong exprFoldNode(astTree *tree, astNode *node) {
+    astNode *child;
+    ulong folded = 0;
+    double a;
+    double b;
+    double result = 0;
+    long x;
+    ushort done = 0;
+
+    for (child = node->first; child; child = child->next) {
+        folded += exprFoldNode(tree, child);
+    }
+
+    switch (node->kind) {
+        case AST_PAREN:
+            done = exprConstant(node->first, &result);
+            break;
+
+        case AST_UNARY:
+            if (!exprConstant(node->first, &a)) {
+                break;
+            }
+
+            done = 1;
+            switch (node->op) {
+                case MONADIC_PLUS:  result = a; break;
+                case MONADIC_MINUS: result = -a; break;
+                case MONADIC_NOT:   result = (a == 0); break;
+                case MONADIC_BITNOT:
+                    done = exprRound(a, &x);
+                    result = (short)~x;
+                    break;
+            }
+            break;
+
+        case AST_BINARY:
+            if (exprConstant(node->first, &a) && exprConstant(node->first->next, &b)) {
+                done = exprBinary(node->op, a, b, &result);
+            }
+            break;
+
+        case AST_INDEX:
+            done = exprRadix(tree, node, &result);
+            break;
+    }
+
+    if (!done) {
+        return folded;
+    }
+
+    node->kind = AST_NUMBER;
+    node->value = result;
+    node->flags |= AST_FOLDED;
+    node->first = node->last = NULL;
+    return folded + 1;
+}
+
+
+/*=============================================================================
+ * EXPRFOLD() Folds every constant expression in the program, numbers, HEX()
+ * and BIN() of strings, and operators on them, into a single number. Errors,
+ * like dividing by zero, are left for the program to find. Returns how many
+ * nodes were folded.
+ *===========================================================================*/
+ulong exprFold(astTree *tree) {
+    return exprFoldNode(tree, tree->root);
+}
+
+
+/*=============================================================================
+ * EXPRTYPE() Returns the type of an expression, SYM_STRING, SYM_FLOAT or
+ * SYM_INTEGER, or SYM_NONE if it can't be known until the program runs.
+ * Whole numbers that fit in an SB_INTEGER are integers, and so are sums,
+ * differences and products that exprWhole() shows are whole numbers, as C
+ * can work those out exactly without floats.
+ *===========================================================================*/
+uchar exprType(astNode *node) {
+    symbol *sym;
+    double bound;
+    long x;
+
+    switch (node->kind) {
+        case AST_NUMBER:
+            return (node->value == floor(node->value) && exprRound(node->value, &x) ? SYM_INTEGER : SYM_FLOAT);
+
+        case AST_STRING:
+            return SYM_STRING;
+
+        case AST_NAME:
+        case AST_INDEX:
+            if (node->kind == AST_NAME && exprFindAlias(node->entry)) {
+                return exprFindAlias(node->entry)->type;
+            }
+
+            /* Machine code functions can return anything. */
+            sym = symLookup(node->entry);
+            if (sym && sym->type == SYM_NONE && sym->kind == SYM_MC_FN) {
+                return SYM_NONE;
+            }
+            return (sym && sym->type != SYM_NONE ? sym->type : SYM_FLOAT);
+
+        case AST_PAREN:
+            return (node->first ? exprType(node->first) : SYM_FLOAT);
+
+        case AST_UNARY:
+            if (node->op == MONADIC_NOT || node->op == MONADIC_BITNOT) {
+                return SYM_INTEGER;
+            }
+            return (node->first && exprType(node->first) == SYM_INTEGER ? SYM_INTEGER : SYM_FLOAT);
+
+        case AST_BINARY:
+            switch (node->op) {
+                case OPERATOR_CONCAT:
+                    return SYM_STRING;
+
+                case OPERATOR_PLUS:
+                case OPERATOR_MINUS:
+                case OPERATOR_TIMES:
+                    return (exprWhole(node, &bound) ? SYM_INTEGER : SYM_FLOAT);
+
+                case OPERATOR_DIVIDE:
+                case OPERATOR_POWER:
+                    return SYM_FLOAT;
+            }
+            return SYM_INTEGER;
+
+        case AST_CHANNEL:
+            return SYM_INTEGER;
+    }
+
+    return SYM_FLOAT;
+}
+
+
+/*=============================================================================
+ * EXPRWHOLE() Is an expression always a whole number, that C can work out
+ * exactly, in an int? If so, bound is the most it can be, either way. Those
+ * of type SYM_INTEGER are, as is a FOR loop's counter, and sums, differences
+ * and products of whole numbers that can't get too big. SuperBASIC works
+ * those out as floats, which comes to the same thing.
+ *===========================================================================*/
+ushort exprWhole(astNode *node, double *bound) {
+    exprAliasName *alias;
+    double left;
+    double right;
+
+    switch (node->kind) {
+        case AST_NUMBER:
+            *bound = fabs(node->value);
+            return (node->value == floor(node->value) && *bound <= EXPR_WHOLE_LIMIT);
+
+        case AST_NAME:
+            alias = exprFindAlias(node->entry);
+            if (alias && alias->how == EXPR_ALIAS_NAME && alias->type == SYM_INTEGER) {
+                *bound = EXPR_COUNT_LIMIT;
+                return 1;
+            }
+            break;
+
+        case AST_PAREN:
+            return (node->first && exprWhole(node->first, bound));
+
+        case AST_UNARY:
+            if (node->op == MONADIC_PLUS || node->op == MONADIC_MINUS) {
+                return exprWhole(node->first, bound);
+            }
+            break;
+
+        case AST_BINARY:
+            if (node->op != OPERATOR_PLUS && node->op != OPERATOR_MINUS && node->op != OPERATOR_TIMES) {
+                break;
+            }
+            if (!exprWhole(node->first, &left) || !exprWhole(node->last, &right)) {
+                return 0;
+            }
+            *bound = (node->op == OPERATOR_TIMES ? left * right : left + right);
+            return (*bound <= EXPR_WHOLE_LIMIT);
+    }
+
+    /* Anything else of type SYM_INTEGER is an SB_INTEGER, or a flag. */
+    *bound = 32768;
+    return (exprType(node) == SYM_INTEGER);
+}
+
+
+/*=============================================================================
+ * EXPRWRITENUMBER() Writes a number as a C constant. Whole numbers are
+ * written as such, anything else has enough digits to be exact.
+ *===========================================================================*/
+void exprWriteNumber(FILE *fp, double value) {
+    char text[32];
+
+    if (value == floor(value) && fabs(value) < 2147483648.0) {
+        fprintf(fp, "%ld", (long)value);
+        return;
+    }
+
+    sprintf(text, "%.17g", value);
+    if (!strchr(text, '.') && !strchr(text, 'e')) {
+        strcat(text, ".0");
+    }
+    fprintf(fp, "%s", text);
+}
+
+
+/*=============================================================================
+ * EXPRWRITESTRING() Writes a string constant as a C string.
+ *===========================================================================*/
+static void exprWriteString(FILE *fp, savToken *token) {
+    ushort x;
+    uchar ch;
+
+    fputc('"', fp);
+    for (x = 0; x < token->value; x++) {
+        ch = token->data[4 + x];
+        if (ch == '"' || ch == '\\') {
+            fprintf(fp, "\\%c", ch);
+        } else if (ch < ' ' || ch > '~') {
+            fprintf(fp, "\\%03o", ch);
+        } else {
+            fputc(ch, fp);
+        }
+    }
+    fputc('"', fp);
+}
+
+
+/*=============================================================================
+ * EXPRWRITEARGS() Writes a node's children, as C arguments.
+ *===========================================================================*/
+static void exprWriteArgs(FILE *fp, astTree *tree, astNode *node) {
+    astNode *child;
+
+    fprintf(fp, "(");
+    for (child = node->first; child; child = child->next) {
+        if (child->kind == AST_EMPTY) {
+            continue;
+        }
+        exprWrite(fp, tree, child, SYM_NONE);
+        if (child->next) {
+            fprintf(fp, ", ");
+        }
+    }
+    fprintf(fp, ")");
+}
+
+
+/*=============================================================================
+ * EXPRPARAMTYPE() The type of a DEFine's parameter, from its name, floating
+ * point if it has no $ or %.
+ *===========================================================================*/
+uchar exprParamType(astNode *param) {
+    symbol *sym = symLookup(param->entry);
+
+    return (sym && sym->type != SYM_NONE ? sym->type : SYM_FLOAT);
+}
+
+
+/*=============================================================================
+ * EXPRWRITEARGUMENTS() Writes the arguments of a call to sym, a DEFine with
+ * C parameters, from first, one for each parameter. Missing ones are zero or
+ * empty, as SuperBASIC leaves them unset. A parameter passed by reference
+ * gets the address of a variable of its type, or of a copy of anything
+ * else.
+ *===========================================================================*/
+void exprWriteArguments(FILE *fp, astTree *tree, symbol *sym, astNode *first) {
+    static char *refs[] = {"", "sbRefString(", "sbRefFloat(", "sbRefInteger("};
+    astNode *param;
+    astNode *arg = first;
+    symbol *argSym;
+    char name[EXPR_NAME_SIZE];
+    uchar type;
+
+    fprintf(fp, "(");
+    for (param = sym->define->first->first; param; param = param->next) {
+        type = exprParamType(param);
+        argSym = (arg && arg->kind == AST_NAME ? symLookup(arg->entry) : NULL);
+
+        if (param->flags & AST_REF && argSym &&
+            (!exprFindAlias(arg->entry) || exprFindAlias(arg->entry)->how == EXPR_ALIAS_LOCAL) &&
+            (argSym->kind == SYM_VARIABLE || argSym->kind == SYM_FOR) &&
+            exprType(arg) == type) {
+            fprintf(fp, "&%s", exprName(arg->entry, name));
+        } else {
+            fprintf(fp, "%s", (param->flags & AST_REF ? refs[type] : ""));
+            if (arg && arg->kind != AST_EMPTY) {
+                exprWrite(fp, tree, arg, type);
+            } else {
+                fprintf(fp, (type == SYM_STRING ? "\"\"" : "0"));
+            }
+            fprintf(fp, (param->flags & AST_REF ? ")" : ""));
+        }
+
+        if (param->next) {
+            fprintf(fp, ", ");
+        }
+        arg = (arg ? arg->next : NULL);
+    }
+    fprintf(fp, ")");
+}
+
+
+/*=============================================================================
+ * EXPRSLICE() The first of an INDEX node's children that picks characters
+ * from a string, rather than an element of an array, or NULL if none do. A
+ * string array's last dimension is its strings, so with DIM a$(3,10), a$(2)
+ * is a whole string, and a$(2,4) is a character of it.
+ *===========================================================================*/
+astNode *exprSlice(astNode *node) {
+    symbol *sym = symLookup(node->entry);
+    astNode *child = node->first;
+    ushort x;
+
+    if (node->kind != AST_INDEX || !sym || sym->type != SYM_STRING ||
+        sym->kind == SYM_FN || sym->kind == SYM_MC_FN || sym->kind == SYM_MC_PROC ||
+        sym->kind == SYM_PROC) {
+        return NULL;
+    }
+
+    if (sym->kind == SYM_ARRAY) {
+        for (x = 1; child && x < sym->dims; x++) {
+            child = child->next;
+        }
+    }
+
+    return child;
+}
+
+
+/*=============================================================================
+ * EXPRWRITEINDEX() Writes an array element, a string slice, or an FN call.
+ *===========================================================================*/
+static void exprWriteIndex(FILE *fp, astTree *tree, astNode *node) {
+    symbol *sym = symLookup(node->entry);
+    astNode *child;
+    astNode *slice;
+    astNode *to;
+    char name[EXPR_NAME_SIZE];
+
+    if (!sym) {
+        fprintf(fp, "0");
+        return;
+    }
+
+    if (sym->kind == SYM_FN || sym->kind == SYM_MC_FN || sym->kind == SYM_MC_PROC ||
+        sym->kind == SYM_PROC) {
+        fprintf(fp, "%s", sym->cName);
+        if (sym->define) {
+            exprWriteArguments(fp, tree, sym, node->first);
+        } else {
+            exprWriteArgs(fp, tree, node);
+        }
+        return;
+    }
+
+    /* a$(n), a$(n TO m), a$(n TO) or a$(TO m), or the same after the
+     * indexes of a string array. */
+    slice = exprSlice(node);
+    if (slice) {
+        fprintf(fp, "sbSlice(");
+    }
+
+    fprintf(fp, "%s", (slice == node->first ? exprName(node->entry, name) : sym->cName));
+    for (child = node->first; child && child != slice; child = child->next) {
+        fprintf(fp, "[");
+        exprWrite(fp, tree, child, SYM_INTEGER);
+        fprintf(fp, "]");
+    }
+
+    if (!slice) {
+        return;
+    }
+
+    to = slice->next;
+    fprintf(fp, ", ");
+    if (slice->kind == AST_EMPTY) {
+        fprintf(fp, "1");
+    } else {
+        exprWrite(fp, tree, slice, SYM_INTEGER);
+    }
+    fprintf(fp, ", ");
+    if (to && to->kind != AST_EMPTY) {
+        exprWrite(fp, tree, to, SYM_INTEGER);
+    } else {
+        fprintf(fp, (slice->sep == SEPARATOR_TO ? "SB_SLICE_END" : "SB_SLICE_ONE"));
+    }
+    fprintf(fp, ")");
+}
+
+
+/*=============================================================================
+ * EXPRWRITEBINARY() Writes a binary operator and its operands.
+ *===========================================================================*/
+static void exprWriteBinary(FILE *fp, astTree *tree, astNode *node) {
+    astNode *left = node->first;
+    astNode *right = left->next;
+    uchar leftType = exprType(left);
+    uchar rightType = exprType(right);
+    double bound;
+    char *call;
+
+    switch (node->op) {
+        case OPERATOR_CONCAT:
+        case OPERATOR_INSTR:
+            call = (node->op == OPERATOR_CONCAT ? "sbConcat" : "sbInstr");
+            fprintf(fp, "%s(", call);
+            exprWrite(fp, tree, left, SYM_STRING);
+            fprintf(fp, ", ");
+            exprWrite(fp, tree, right, SYM_STRING);
+            fprintf(fp, ")");
+            return;
+
+        case OPERATOR_MOD:
+        case OPERATOR_DIV:
+        case OPERATOR_POWER:
+            call = (node->op == OPERATOR_MOD ? "sbMod" : node->op == OPERATOR_DIV ? "sbDiv" : "pow");
+            fprintf(fp, "%s(", call);
+            exprWrite(fp, tree, left, SYM_FLOAT);
+            fprintf(fp, ", ");
+            exprWrite(fp, tree, right, SYM_FLOAT);
+            fprintf(fp, ")");
+            return;
+
+        case OPERATOR_APPROX:
+            if (leftType == SYM_STRING && rightType == SYM_STRING) {
+                break;
+            }
+            fprintf(fp, "sbApprox(");
+            exprWrite(fp, tree, left, SYM_FLOAT);
+            fprintf(fp, ", ");
+            exprWrite(fp, tree, right, SYM_FLOAT);
+            fprintf(fp, ")");
+            return;
+
+        case OPERATOR_BITOR:
+        case OPERATOR_BITAND:
+        case OPERATOR_BITXOR:
+            fprintf(fp, "(");
+            exprWrite(fp, tree, left, SYM_INTEGER);
+            fprintf(fp, (node->op == OPERATOR_BITOR ? " | " : node->op == OPERATOR_BITAND ? " & " : " ^ "));
+            exprWrite(fp, tree, right, SYM_INTEGER);
+            fprintf(fp, ")");
+            return;
+
+        case OPERATOR_XOR:
+            fprintf(fp, "(!");
+            exprWrite(fp, tree, left, SYM_FLOAT);
+            fprintf(fp, " != !");
+            exprWrite(fp, tree, right, SYM_FLOAT);
+            fprintf(fp, ")");
+            return;
+
+        case OPERATOR_DIVIDE:
+            /* Integers divide as floats. A float on either side already
+             * does. A string may be a constant, converted to a whole number. */
+            fprintf(fp, "(");
+            if (exprType(left) != SYM_FLOAT && exprType(right) != SYM_FLOAT) {
+                fprintf(fp, "(SB_FLOAT)");
+            }
+            exprWrite(fp, tree, left, SYM_FLOAT);
+            fprintf(fp, " / ");
+            exprWrite(fp, tree, right, SYM_FLOAT);
+            fprintf(fp, ")");
+            return;
+    }
+
+    /* Two strings compare as strings, anything else as numbers. */
+    if (exprCompare[node->op] && leftType == SYM_STRING && rightType == SYM_STRING) {
+        fprintf(fp, "(sbCompare(");
+        exprWrite(fp, tree, left, SYM_STRING);
+        fprintf(fp, ", ");
+        exprWrite(fp, tree, right, SYM_STRING);
+        fprintf(fp, ", %d) %s 0)", (node->op == OPERATOR_APPROX), exprCompare[node->op]);
+        return;
+    }
+
+    /* Whole numbers that may get too big for an int are added, or whatever,
+     * as floats, as SuperBASIC does. */
+    fprintf(fp, "(");
+    if ((node->op == OPERATOR_PLUS || node->op == OPERATOR_MINUS || node->op == OPERATOR_TIMES) &&
+        exprWhole(left, &bound) && exprWhole(right, &bound) && !exprWhole(node, &bound)) {
+        fprintf(fp, "(SB_FLOAT)");
+    }
+    exprWrite(fp, tree, left, SYM_FLOAT);
+    if (exprCompare[node->op]) {
+        fprintf(fp, " %s ", exprCompare[node->op]);
+    } else if (node->op == OPERATOR_OR || node->op == OPERATOR_AND) {
+        fprintf(fp, (node->op == OPERATOR_OR ? " || " : " && "));
+    } else {
+        fprintf(fp, " %s ", savOperators[node->op]);
+    }
+    exprWrite(fp, tree, right, SYM_FLOAT);
+    fprintf(fp, ")");
+}
+
+
+/*=============================================================================
+ * EXPRRAW() Writes an expression as its own type.
+ *===========================================================================*/
+static void exprRaw(FILE *fp, astTree *tree, astNode *node) {
+    char name[EXPR_NAME_SIZE];
+    symbol *sym;
+
+    switch (node->kind) {
+        case AST_NUMBER:
+            exprWriteNumber(fp, node->value);
+            break;
+
+        case AST_STRING:
+            exprWriteString(fp, tree->prog->tokens + node->token);
+            break;
+
+        case AST_NAME:
+            sym = symLookup(node->entry);
+            if (exprFindAlias(node->entry) || !sym) {
+                fprintf(fp, "%s", exprName(node->entry, name));
+            } else if (sym->define) {
+                fprintf(fp, "%s", sym->cName);
+                exprWriteArguments(fp, tree, sym, NULL);
+            } else if (sym->kind == SYM_FN || sym->kind == SYM_MC_FN) {
+                fprintf(fp, "%s()", sym->cName);
+            } else {
+                fprintf(fp, "%s", sym->cName);
+            }
+            break;
+
+        case AST_INDEX:
+            exprWriteIndex(fp, tree, node);
+            break;
+
+        case AST_PAREN:
+            /* Binary operators have their own. */
+            if (node->first && node->first->kind == AST_BINARY) {
+                exprRaw(fp, tree, node->first);
+                break;
+            }
+            fprintf(fp, "(");
+            exprWrite(fp, tree, node->first, SYM_NONE);
+            fprintf(fp, ")");
+            break;
+
+        case AST_UNARY:
+            switch (node->op) {
+                case MONADIC_PLUS:
+                    exprWrite(fp, tree, node->first, SYM_FLOAT);
+                    break;
+
+                case MONADIC_MINUS:
+                    fprintf(fp, "-(");
+                    exprWrite(fp, tree, node->first, SYM_FLOAT);
+                    fprintf(fp, ")");
+                    break;
+
+                case MONADIC_BITNOT:
+                    fprintf(fp, "~");
+                    exprWrite(fp, tree, node->first, SYM_INTEGER);
+                    break;
+
+                case MONADIC_NOT:
+                    fprintf(fp, "!");
+                    exprWrite(fp, tree, node->first, SYM_FLOAT);
+                    break;
+            }
+            break;
+
+        case AST_BINARY:
+            exprWriteBinary(fp, tree, node);
+            break;
+
+        case AST_CHANNEL:
+            exprWrite(fp, tree, node->first, SYM_INTEGER);
+            break;
+
+        default:
+            fprintf(fp, "/* %s */", astKindName(node->kind));
+            break;
+    }
+}
+
+
+/*=============================================================================
+ * EXPRCONVERT() Writes a constant converted to the type wanted, now, rather
+ * than when the program runs: a whole number as the string sbStr() would
+ * make of it, or a string of digits as the number sbVal() would. Returns 0,
+ * having written nothing, for anything else.
+ *===========================================================================*/
+static ushort exprConvert(FILE *fp, astTree *tree, astNode *node, uchar want) {
+    savToken *token;
+    char text[32];
+    ushort digits = 0;
+    ushort x;
+    double value;
+    long whole;
+
+    if (want == SYM_STRING) {
+        if (node->kind != AST_NUMBER || node->value != floor(node->value) || fabs(node->value) >= 1e7) {
+            return 0;
+        }
+        fprintf(fp, "\"%ld\"", (long)node->value);
+        return 1;
+    }
+
+    token = tree->prog->tokens + node->token;
+    if (node->kind != AST_STRING || !token->value || token->value >= sizeof(text)) {
+        return 0;
+    }
+
+    /* Digits, with a sign and a point, that any strtod() reads the same. */
+    for (x = 0; x < token->value; x++) {
+        text[x] = token->data[4 + x];
+        if (isdigit((uchar)text[x])) {
+            digits++;
+        } else if (!(text[x] == '-' && x == 0) && text[x] != '.') {
+            return 0;
+        }
+    }
+    text[x] = '\0';
+    if (!digits || strchr(text, '.') != strrchr(text, '.')) {
+        return 0;
+    }
+
+    value = strtod(text, NULL);
+    if (want != SYM_INTEGER) {
+        exprWriteNumber(fp, value);
+    } else if (exprRound(value, &whole)) {
+        fprintf(fp, "%ld", whole);
+    } else {
+        return 0;
+    }
+    return 1;
+}
+
+
+/*=============================================================================
+ * EXPRWIDE() Could a whole number expression of type SYM_INTEGER be too big
+ * for an SB_INTEGER? Sums, differences, products and negations are worked
+ * out in an int, and FOR counters are longs, so they can be, unless
+ * exprWhole() shows they are always small enough.
+ *===========================================================================*/
+static ushort exprWide(astNode *node) {
+    double bound;
+
+    while (node->kind == AST_PAREN && node->first) {
+        node = node->first;
+    }
+
+    switch (node->kind) {
+        case AST_NAME:
+            if (!exprFindAlias(node->entry)) {
+                return 0;
+            }
+            break;
+
+        case AST_UNARY:
+        case AST_BINARY:
+            break;
+
+        default:
+            return 0;
+    }
+
+    return (exprWhole(node, &bound) && bound > 32767);
+}
+
+
+/*=============================================================================
+ * EXPRTEMPLIST() Counts, in made, the temporary strings made by the
+ * expressions from first, and then own more by the node they belong to,
+ * each written as the type of its param, if there is one, or as want. All
+ * are worked out before any is used, so one that holds a temporary string
+ * has it reused, and fits is cleared, if EXPR_TEMP_STRINGS more are made
+ * by the others, and the node, before then.
+ *===========================================================================*/
+static void exprTempList(astNode *first, astNode *param, uchar want, ushort own, ushort *made,
+                         ushort *fits) {
+    astNode *child;
+    ushort childMade;
+    ushort held;
+    ushort least = 0xFFFF;
+    ushort total = 0;
+
+    for (child = first; child; child = child->next) {
+        exprTemps(child, (param ? exprParamType(param) : want), &childMade, &held, fits);
+        total += childMade;
+        if (held && childMade < least) {
+            least = childMade;
+        }
+        param = (param ? param->next : NULL);
+    }
+
+    if (least != 0xFFFF && total - least + own >= EXPR_TEMP_STRINGS) {
+        *fits = 0;
+    }
+    *made = total + own;
+}
+
+
+/*=============================================================================
+ * EXPRTEMPS() Counts, in made, the temporary strings exprWrite() has node
+ * make, written as want, and sets held if its value is one of them. A
+ * FuNction makes its own in a ring of its own, so its call only makes the
+ * copy of a string result.
+ *===========================================================================*/
+static void exprTemps(astNode *node, uchar want, ushort *made, ushort *held, ushort *fits) {
+    symbol *sym = (node->kind == AST_NAME || node->kind == AST_INDEX ? symLookup(node->entry) : NULL);
+    astNode *first = node->first;
+    astNode *param = NULL;
+    uchar childWant = SYM_FLOAT;
+    uchar have = exprType(node);
+    ushort own = 0;
+
+    *held = 0;
+    switch (node->kind) {
+        case AST_NAME:
+        case AST_INDEX:
+            if (!sym || (node->kind == AST_NAME && exprFindAlias(node->entry))) {
+                first = NULL;
+            } else if (sym->kind == SYM_FN || sym->kind == SYM_MC_FN || sym->kind == SYM_MC_PROC ||
+                       sym->kind == SYM_PROC) {
+                param = (sym->define ? sym->define->first->first : NULL);
+                childWant = SYM_NONE;
+                own = (sym->kind == SYM_FN && sym->type == SYM_STRING);
+            } else {
+                childWant = SYM_INTEGER;
+                own = (exprSlice(node) != NULL);
+            }
+            if (node->kind == AST_NAME) {
+                first = NULL;
+            }
+            break;
+
+        case AST_PAREN:
+            if (first) {
+                exprTemps(first, SYM_NONE, made, held, fits);
+            } else {
+                *made = 0;
+            }
+            first = NULL;
+            break;
+
+        case AST_BINARY:
+            if (node->op == OPERATOR_CONCAT || node->op == OPERATOR_INSTR ||
+                (exprCompare[node->op] && exprType(node->first) == SYM_STRING &&
+                 exprType(node->last) == SYM_STRING)) {
+                childWant = SYM_STRING;
+            }
+            own = (node->op == OPERATOR_CONCAT);
+            break;
+
+        case AST_UNARY:
+        case AST_CHANNEL:
+            break;
+
+        default:
+            first = NULL;
+            break;
+    }
+
+    if (node->kind != AST_PAREN) {
+        exprTempList(first, param, childWant, own, made, fits);
+        *held = (own != 0);
+    }
+
+    /* A number, where a string is wanted, is printed to one. */
+    if (want == SYM_STRING && have != SYM_STRING && have != SYM_NONE) {
+        (*made)++;
+        *held = 1;
+    }
+}
+
+
+/*=============================================================================
+ * EXPRTEMPSNEEDED() Returns 0 if the expressions of a statement can all be
+ * worked out without making so many temporary strings that SBRuntime reuses
+ * one still in use. Only a very long expression, a$ & b$ & ..., which holds
+ * on to EXPR_TEMP_STRINGS of them at once, or a PROCedure call with as many,
+ * can't. Then it returns how many the statement makes, which is as many as
+ * the ring needs for none to be reused. Its statements, and the parts of a
+ * FOR range, make none.
+ *===========================================================================*/
+ushort exprTempsNeeded(astNode *statement) {
+    symbol *sym = (statement->kind == AST_CALL ? symLookup(statement->entry) : NULL);
+    ushort made;
+    ushort fits = 1;
+
+    exprTempList(statement->first, (sym && sym->define ? sym->define->first->first : NULL), SYM_NONE, 0,
+                 &made, &fits);
+    return (fits ? 0 : made);
+}
+
+
+/*=============================================================================
+ * EXPRWRITE() Writes an expression as C, converted to the type wanted, as
+ * SuperBASIC would, or as it is for SYM_NONE. Floats are rounded to make
+ * integers, as are whole numbers that may not fit in one, strings are read
+ * as numbers, and numbers printed to make strings. Constants are converted
+ * now, rather than when the program runs.
+ *===========================================================================*/
+void exprWrite(FILE *fp, astTree *tree, astNode *node, uchar want) {
+    uchar have;
+    long x;
+
+    if (!node) {
+        fprintf(fp, "0");
+        return;
+    }
+
+    have = exprType(node);
+    if (want == SYM_INTEGER && have == SYM_INTEGER && exprWide(node)) {
+        fprintf(fp, "sbInt(");
+        exprRaw(fp, tree, node);
+        fprintf(fp, ")");
+        return;
+    }
+
+    if (want == SYM_NONE || have == SYM_NONE || want == have ||
+        (want == SYM_FLOAT && have == SYM_INTEGER)) {
+        exprRaw(fp, tree, node);
+        return;
+    }
+
+    if (exprConvert(fp, tree, node, want)) {
+        return;
+    }
+
+    if (want == SYM_STRING) {
+        fprintf(fp, "sbStr(");
+        exprRaw(fp, tree, node);
+        fprintf(fp, ")");
+        return;
+    }
+
+    if (have == SYM_STRING) {
+        fprintf(fp, (want == SYM_INTEGER ? "sbInt(sbVal(" : "sbVal("));
+        exprRaw(fp, tree, node);
+        fprintf(fp, (want == SYM_INTEGER ? "))" : ")"));
+        return;
+    }
+
+    /* A float, where an integer is wanted. */
+    if (node->kind == AST_NUMBER && exprRound(node->value, &x)) {
+        fprintf(fp, "%ld", x);
+        return;
+    }
+
+    fprintf(fp, "sbInt(");
+    exprRaw(fp, tree, node);
+    fprintf(fp, ")");
+}
+
+
+/*=============================================================================
+ * EXPRWRITECONDITION() Writes an expression as the condition of an if or a
+ * loop, in parentheses, once. It's true if it isn't zero, and a string is
+ * tested as the number it holds, as SuperBASIC does.
+ *===========================================================================*/
+void exprWriteCondition(FILE *fp, astTree *tree, astNode *node) {
+    while (node && node->kind == AST_PAREN && node->first) {
+        node = node->first;
+    }
+
+    /* Comparisons and the logical operators have their own. */
+    if (node && node->kind == AST_BINARY && exprType(node) == SYM_INTEGER &&
+        (exprCompare[node->op] || node->op == OPERATOR_AND || node->op == OPERATOR_OR ||
+         node->op == OPERATOR_XOR || node->op == OPERATOR_BITOR ||
+         node->op == OPERATOR_BITAND || node->op == OPERATOR_BITXOR) &&
+        (node->op != OPERATOR_APPROX ||
+         (exprType(node->first) == SYM_STRING && exprType(node->last) == SYM_STRING))) {
+        exprRaw(fp, tree, node);
+        return;
+    }
+
+    fprintf(fp, "(");
+    exprWrite(fp, tree, node, SYM_FLOAT);
+    fprintf(fp, ")");
+}
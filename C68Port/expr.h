@@ -0,0 +1,52 @@
+#ifndef __EXPR_H__
+#define __EXPR_H__
+
+/*===========================================================================
+ * HEADERS
+ *===========================================================================*/
+#include <stdio.h>
+#include "ast.h"
+#include "symbols.h"
+
+/*===========================================================================
+ * DEFINES
+ *===========================================================================*/
+#define EXPR_MAX_ALIAS  32          /* Longest alias, with its '\0'. */
+#define EXPR_MAX_ALIASES (AST_MAX_DEPTH + 1024)
+
+/* How a variable is written, with exprName(). */
+#define EXPR_NAME_SIZE  (SYM_CNAME_SIZE + 16)
+
+/* Most a whole number can be, either way, for exprWhole(), worked out in a
+ * 32 bit int, as C68's are, and a FOR loop's counter, as SB_FOR_LIMIT. */
+#define EXPR_WHOLE_LIMIT 2147483647.0
+#define EXPR_COUNT_LIMIT 1073741823.0
+
+/* Temporary strings an expression may have in use at once, as
+ * SB_TEMP_STRINGS in SBRuntime.h, unless the ring is made bigger. */
+#define EXPR_TEMP_STRINGS 8
+
+/* What an alias is. */
+#define EXPR_ALIAS_NAME  0          /* Written as its cName. */
+#define EXPR_ALIAS_LOCAL 1          /* A LOCal a PROC or FN may see, kept
+                                     * in SBLocal, through cName_local. */
+
+/*===========================================================================
+ * FUNCTION PROTOTYPES
+ *===========================================================================*/
+ulong  exprFold(astTree *tree);
+ushort exprConstant(astNode *node, double *value);
+uchar  exprType(astNode *node);
+ushort exprWhole(astNode *node, double *bound);
+void   exprWrite(FILE *fp, astTree *tree, astNode *node, uchar want);
+void   exprWriteNumber(FILE *fp, double value);
+void   exprWriteCondition(FILE *fp, astTree *tree, astNode *node);
+uchar  exprParamType(astNode *param);
+void   exprWriteArguments(FILE *fp, astTree *tree, symbol *sym, astNode *first);
+astNode *exprSlice(astNode *node);
+ushort exprTempsNeeded(astNode *statement);
+ushort exprAlias(ushort entry, char *cName, uchar type, uchar how);
+char  *exprName(ushort entry, char *name);
+void   exprUnalias(void);
+
+#endif /* __EXPR_H__ */
@@ -0,0 +1,2622 @@
+/*=============================================================================
+ * CODE GENERATION. Writes the C source of a program from its AST. The
+ * program's own statements go in main(), and each DEFine in a function of
+ * its own, after it. Anything that can't be converted yet is written as a
+ * comment, with its line number, so nothing is lost without a trace.
+ *===========================================================================*/
+
+/*===========================================================================
+ * HEADERS
+ *===========================================================================*/
+#include <math.h>
+#include <stdlib.h>
+
+#include "gen.h"
+
+/*===========================================================================
+ * DEFINES
+ *===========================================================================*/
+
+/* What the statements in a loop do, from genScan(). */
+#define GEN_NEXT        0x01        /* NEXT the loop. */
+#define GEN_EXIT        0x02        /* EXIT the loop. */
+#define GEN_EXIT_INNER  0x04        /* EXIT it, from inside another loop. */
+#define GEN_WRITTEN     0x08        /* May change the FOR variable. */
+#define GEN_CALLS       0x10        /* Calls a PROCedure or FuNction. */
+#define GEN_NEXT_INNER  0x20        /* NEXT it, from inside another loop. */
+#define GEN_JUMPS       0x40        /* GO TO, GO SUB or RETurn. */
+
+/* Furthest a FOR loop counts in a long, as SB_FOR_LIMIT. */
+#define GEN_FOR_LIMIT   EXPR_COUNT_LIMIT
+
+/* How a SELect is written, from genSelectForm(). */
+#define GEN_SELECT_IF       0       /* if ... else if. */
+#define GEN_SELECT_SWITCH   1       /* switch on the value. */
+#define GEN_SELECT_TABLE    2       /* switch on sbSelect()'s clause. */
+
+#define GEN_MAX_SELECT  1024        /* Most ranges in the open SELects. */
+#define GEN_MIN_TABLE   3           /* Fewest ranges worth a search. */
+
+/* What the jumps in a function need, from genGoFind(). */
+#define GEN_GO_RETURN   0x01        /* RETurn, to go_return. */
+#define GEN_GO_SUB      0x02        /* GO SUB, the go_sub stack. */
+#define GEN_GO_JUMP     0x04        /* GO TO an expression, to go_jump. */
+
+/* What a DEFine does with each name it uses, from genLocals(). */
+#define GEN_NAME_BOUND   0x01       /* A parameter or LOCal of its own. */
+#define GEN_NAME_SHARED  0x02       /* Bound, and a PROC or FN it calls may
+                                     * use it, so it's kept in SBLocal. */
+#define GEN_NAME_DYNAMIC 0x04       /* Not bound, and may be a caller's. */
+
+/* Longest name SBLocal keeps, its MAX_LOCAL_NAME_SIZE. Longer ones are
+ * found by this much of them. */
+#define GEN_LOCAL_NAME  31
+
+/*===========================================================================
+ * TYPEDEFS
+ *===========================================================================*/
+
+/* An open loop. Its labels are for_next_number and for_exit_number, or
+ * repeat_next_number and repeat_exit_number. A SELect written as a switch
+ * is one too, as a break would leave it, but it has no labels. */
+typedef struct genLoop {
+    uchar  kind;                    /* AST_FOR, AST_REPEAT or AST_SELECT. */
+    ushort entry;                   /* The variable, or name. */
+    ushort number;
+    ushort ranges;
+    ushort canBreak;                /* EXIT from it can be a break. */
+    char   *var;                    /* A FOR's variable, or counter, */
+    astNode *step;                  /* and STEP, for NEXT's test. */
+} genLoop;
+
+/* A range of a SELect's clause, with constant ends. */
+typedef struct genRange {
+    double from;
+    double to;
+    ushort clause;                  /* Counting from 1. */
+} genRange;
+
+/*===========================================================================
+ * GLOBALS
+ *===========================================================================*/
+extern FILE *globals;
+extern FILE *header;
+extern FILE *source;
+
+extern char *globalFile;
+extern char headerFile[];
+extern char sourceFile[];
+
+extern ushort level;
+extern const uchar indent;
+
+/* Open loops, innermost last, for EXIT and NEXT. */
+static genLoop genLoops[AST_MAX_DEPTH];
+static ushort genLoopCount = 0;
+static ushort genLoopNumber = 0;
+
+/* The ranges of the SELects being written, outermost first. Those of the
+ * last one looked at, by genSelectRanges(), start at genRangeUsed. */
+static genRange genRanges[GEN_MAX_SELECT];
+static ushort genRangeUsed = 0;
+static ushort genRangeCount = 0;
+
+/* The function being written. Its lines' first statements are in genLines,
+ * by line index, for GO TO, GO SUB and ON ... GO. */
+static astNode *genDefining = NULL;   /* Or NULL for main(). */
+static astNode **genLines = NULL;
+static ushort genGoFlags = 0;
+static ushort genGoLines = 0;       /* Lines in go_lines. */
+static ushort genGoIndex = 0;
+static ushort genGoSubs = 0;        /* GO SUBs, each with a go_back label. */
+
+/* A DEFine with C parameters has cleanup to do as it leaves, when it has
+ * strings or parameters passed by reference, at define_exit. */
+static ushort genCleanup = 0;
+static ushort genExitUsed = 0;
+static ushort genSharing = 0;       /* It has an SBLocal scope. */
+
+/* The names each DEFine uses, with their GEN_NAME flags, and the PROCs and
+ * FNs it calls, by name table entry. Each symbol with a scope has its own
+ * sorted run of each list. genMarks and genStack are for searching calls. */
+static ushort *genNames = NULL;
+static uchar *genNameFlagList = NULL;
+static ushort *genCalls = NULL;
+static ulong genNameCount = 0;
+static ulong genCallCount = 0;
+static ulong genNameLimit = 0;
+static ulong *genMarks = NULL;
+static ushort *genStack = NULL;
+static ulong genMark = 0;
+
+static void genStatement(astTree *tree, astNode *node);
+static uchar genSelectForm(astNode *node);
+
+
+/*=============================================================================
+ * GENINDENT() Starts a line of source, at the current level.
+ *===========================================================================*/
+static void genIndent(void) {
+    fprintf(source, "%*s", level * indent, "");
+}
+
+
+/*=============================================================================
+ * GENCOMMENT() Writes text inside a C comment, so that it can't end it.
+ *===========================================================================*/
+static void genComment(uchar *text, ushort size) {
+    ushort x;
+
+    for (x = 0; x < size; x++) {
+        fputc(text[x], source);
+        if (text[x] == '*' && x + 1 < size && text[x + 1] == '/') {
+            fputc(' ', source);
+        }
+    }
+}
+
+
+/*=============================================================================
+ * GENUNCONVERTED() Writes a comment for a statement that can't be converted.
+ *===========================================================================*/
+static void genUnconverted(astNode *node) {
+    genIndent();
+    if (node->kind == AST_KEYWORD) {
+        fprintf(source, "/* Line %d: %s not converted. */\n", node->lineNumber, savKeywords[node->op]);
+    } else {
+        fprintf(source, "/* Line %d: %s not converted. */\n", node->lineNumber, astKindName(node->kind));
+    }
+}
+
+
+/*=============================================================================
+ * GENASSIGN() Writes [LET] target = value. Numbers are converted to the
+ * target's type, strings are copied.
+ *===========================================================================*/
+static void genAssign(astTree *tree, astNode *node) {
+    astNode *target = node->first;
+    astNode *value = target->next;
+    symbol *sym = symLookup(target->entry);
+
+    if (!sym || exprSlice(target)) {
+        /* Assigning to a slice, a$(2 TO 3) = 'xx', isn't done yet. */
+        genUnconverted(node);
+        return;
+    }
+
+    genIndent();
+    if (sym->type == SYM_STRING) {
+        fprintf(source, "sbAssign(&");
+        exprWrite(source, tree, target, SYM_NONE);
+        fprintf(source, ", ");
+        exprWrite(source, tree, value, SYM_STRING);
+        fprintf(source, ");\n");
+        return;
+    }
+
+    exprWrite(source, tree, target, SYM_NONE);
+    fprintf(source, " = ");
+    exprWrite(source, tree, value, (sym->type == SYM_NONE ? SYM_FLOAT : sym->type));
+    fprintf(source, ";\n");
+}
+
+
+/*=============================================================================
+ * GENCALL() Writes a PROCedure call. Separators become commas, and empty
+ * arguments are dropped, unless the PROCedure has C parameters, when there
+ * is one argument for each.
+ *===========================================================================*/
+static void genCall(astTree *tree, astNode *node) {
+    symbol *sym = symLookup(node->entry);
+    astNode *child;
+    astNode *param = NULL;
+    ushort first = 1;
+
+    if (sym && sym->define) {
+        param = sym->define->first->first;
+    }
+
+    for (child = node->first; child; child = child->next) {
+        if (child->kind == AST_WORD || child->kind == AST_SYMBOL || (sym && sym->define && !param)) {
+            genUnconverted(node);
+            return;
+        }
+        param = (param ? param->next : NULL);
+    }
+
+    if (!sym) {
+        genUnconverted(node);
+        return;
+    }
+
+    genIndent();
+    if (sym->define) {
+        fprintf(source, "%s", sym->cName);
+        exprWriteArguments(source, tree, sym, node->first);
+        fprintf(source, ";\n");
+        return;
+    }
+
+    fprintf(source, "%s(", sym->cName);
+    for (child = node->first; child; child = child->next) {
+        if (child->kind == AST_EMPTY) {
+            continue;
+        }
+
+        if (!first) {
+            fprintf(source, ", ");
+        }
+        exprWrite(source, tree, child, SYM_NONE);
+        first = 0;
+    }
+    fprintf(source, ");\n");
+}
+
+
+/*=============================================================================
+ * GENBLOCK() Writes the statements of a nested block, one level in.
+ *===========================================================================*/
+static void genBlock(astTree *tree, astNode *block) {
+    astNode *child;
+
+    level++;
+    for (child = block->first; child; child = child->next) {
+        genStatement(tree, child);
+    }
+    level--;
+}
+
+
+/*=============================================================================
+ * GENVARIABLE() Returns the name table entry of a statement's variable, its
+ * first operand, as for NEXT i, or 0xFFFF if there isn't one.
+ *===========================================================================*/
+static ushort genVariable(astNode *node) {
+    if (node->first && node->first->kind == AST_NAME) {
+        return node->first->entry;
+    }
+
+    return 0xFFFF;
+}
+
+
+/*=============================================================================
+ * GENISVARIABLE() Is sym a simple variable, one that can be a parameter or a
+ * LOCal? A string array of one dimension, a$(10), is one string, so it is.
+ *===========================================================================*/
+static ushort genIsVariable(symbol *sym) {
+    return (sym && (sym->kind == SYM_VARIABLE || sym->kind == SYM_FOR || sym->kind == SYM_UNSET ||
+                    (sym->kind == SYM_ARRAY && sym->type == SYM_STRING && sym->dims <= 1)));
+}
+
+
+/*=============================================================================
+ * GENISLOCALARRAY() Is node, from a LOCal statement, an array?
+ *===========================================================================*/
+static ushort genIsLocalArray(astNode *node) {
+    symbol *sym = symLookup(node->entry);
+
+    return (node->kind == AST_INDEX && sym && sym->kind == SYM_ARRAY);
+}
+
+
+/*=============================================================================
+ * GENISLOCAL() Is node a LOCal statement that can be converted, a list of
+ * simple variables and arrays? Its variables, and a$(n), are made locals.
+ * Other arrays are left as the globals, for now, by genLocalArrays().
+ *===========================================================================*/
+static ushort genIsLocal(astNode *node) {
+    astNode *child;
+
+    if (node->kind != AST_KEYWORD || node->op != kwLocal + 1 || !node->first) {
+        return 0;
+    }
+
+    for (child = node->first; child; child = child->next) {
+        if ((child->kind != AST_NAME || !genIsVariable(symLookup(child->entry))) && !genIsLocalArray(child)) {
+            return 0;
+        }
+        if (child->next ? child->sep != SEPARATOR_COMMA : child->sep) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+
+/*=============================================================================
+ * GENLOCALARRAYS() Says, in the source and on stderr, which arrays of a
+ * LOCal statement are still the globals, and so aren't LOCal. a$(n) isn't
+ * one of them, as it's a string.
+ *===========================================================================*/
+static void genLocalArrays(astNode *node) {
+    astNode *child;
+    symbol *sym;
+
+    for (child = node->first; child; child = child->next) {
+        sym = symLookup(child->entry);
+        if (!genIsLocalArray(child) || genIsVariable(sym)) {
+            continue;
+        }
+
+        genIndent();
+        fprintf(source, "/* Line %d: LOCal array %s not converted, the global is used. */\n", node->lineNumber,
+                sym->cName);
+        fprintf(stderr, "\n\nWARNING: genLocalArrays(): Line %d: LOCal array %s is the global one.\n",
+                node->lineNumber, sym->cName);
+    }
+}
+
+
+/*=============================================================================
+ * GENNAMEFLAGS() Returns the GEN_NAME flags of a name used by sym's DEFine,
+ * or NULL if it doesn't use it.
+ *===========================================================================*/
+static uchar *genNameFlags(symbol *sym, ushort entry) {
+    ulong low = sym->names;
+    ulong high = sym->names + sym->nameCount;
+    ulong middle;
+
+    while (low < high) {
+        middle = (low + high) / 2;
+        if (genNames[middle] == entry) {
+            return genNameFlagList + middle;
+        }
+        if (genNames[middle] < entry) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+
+    return NULL;
+}
+
+
+/*=============================================================================
+ * GENPASSED() Is node, an argument of call, passed by reference? Those of a
+ * DEFine with C parameters are if their parameter is, array subscripts and
+ * slices are not, and anything else may be.
+ *===========================================================================*/
+static ushort genPassed(astNode *call, astNode *node) {
+    symbol *sym = symLookup(call->entry);
+    astNode *param;
+    astNode *arg;
+
+    if (sym && call->kind == AST_INDEX && sym->kind != SYM_FN &&
+        sym->kind != SYM_MC_FN && sym->kind != SYM_MC_PROC && sym->kind != SYM_PROC) {
+        return 0;
+    }
+
+    if (!sym || !sym->define) {
+        return 1;
+    }
+
+    param = sym->define->first->first;
+    for (arg = call->first; param && arg != node; arg = arg->next) {
+        param = param->next;
+    }
+    return (param && (param->flags & AST_REF));
+}
+
+
+/*=============================================================================
+ * GENSCAN() Finds out what the statements in a loop do with its variable,
+ * or name, entry. Returns GEN_... flags. A name passed to a PROCedure,
+ * FuNction or keyword, rather than used in an expression, may be changed.
+ *===========================================================================*/
+static ushort genScan(astNode *node, astNode *parent, ushort entry, ushort inner) {
+    ushort flags = 0;
+    symbol *sym;
+    astNode *child;
+
+    switch (node->kind) {
+        case AST_FOR:
+            if (node->entry == entry) {
+                flags |= GEN_WRITTEN;
+            }
+            inner = 1;
+            break;
+
+        case AST_REPEAT:
+            inner = 1;
+            break;
+
+        case AST_SELECT:
+            if (genSelectForm(node) != GEN_SELECT_IF) {
+                inner = 1;
+            }
+            break;
+
+        case AST_ASSIGN:
+            if (node->first->entry == entry) {
+                flags |= GEN_WRITTEN;
+            }
+            break;
+
+        case AST_KEYWORD:
+            if (node->op == kwGo + 1 || node->op == kwOn + 1 || node->op == kwReturn + 1) {
+                /* It could go anywhere, and come back. */
+                flags |= GEN_JUMPS;
+            }
+            if (genVariable(node) == entry) {
+                if (node->op == kwNext + 1) {
+                    flags |= (inner ? GEN_NEXT_INNER : GEN_NEXT);
+                } else if (node->op == kwExit + 1) {
+                    flags |= (inner ? GEN_EXIT_INNER : GEN_EXIT);
+                }
+            }
+            break;
+
+        case AST_CALL:
+            sym = symLookup(node->entry);
+            if (sym && sym->kind == SYM_PROC) {
+                flags |= GEN_CALLS;
+            }
+            break;
+
+        case AST_NAME:
+        case AST_INDEX:
+            sym = symLookup(node->entry);
+            if (sym && sym->kind == SYM_FN) {
+                flags |= GEN_CALLS;
+            }
+            if (node->entry == entry && parent &&
+                (((parent->kind == AST_CALL || parent->kind == AST_INDEX) && genPassed(parent, node)) ||
+                 (parent->kind == AST_KEYWORD && parent->op != kwNext + 1 &&
+                  parent->op != kwExit + 1 && parent->op != kwEnd + 1 &&
+                  parent->op != kwReturn + 1 && parent->op != kwGo + 1 && parent->op != kwOn + 1))) {
+                flags |= GEN_WRITTEN;
+            }
+            break;
+    }
+
+    for (child = node->first; child; child = child->next) {
+        flags |= genScan(child, node, entry, inner);
+    }
+
+    return flags;
+}
+
+
+/*=============================================================================
+ * GENWHOLE() Is an expression always a whole number, small enough to count
+ * with?
+ *===========================================================================*/
+static ushort genWhole(astNode *node) {
+    double bound;
+
+    return (exprWhole(node, &bound) && bound <= GEN_FOR_LIMIT);
+}
+
+
+/*=============================================================================
+ * GENFORSAVE() Declares a FOR loop's end, or step, and works it out, once,
+ * before the loop starts.
+ *===========================================================================*/
+static void genForSave(astTree *tree, astNode *node, char *name, ushort number) {
+    genIndent();
+    fprintf(source, "SB_FLOAT %s_%d = ", name, number);
+    exprWrite(source, tree, node, SYM_FLOAT);
+    fprintf(source, ";\n");
+}
+
+
+/*=============================================================================
+ * GENFORSTEP() Writes var, then + the STEP of a FOR loop, 1 if it has none,
+ * or with assign set, var += STEP. A constant STEP's sign is in the operator.
+ *===========================================================================*/
+static void genForStep(char *var, astNode *step, ushort number, ushort assign) {
+    double value = 1;
+
+    if (step && !exprConstant(step, &value)) {
+        fprintf(source, "%s %s for_step_%d", var, (assign ? "+=" : "+"), number);
+        return;
+    }
+
+    fprintf(source, "%s %s%s ", var, (value < 0 ? "-" : "+"), (assign ? "=" : ""));
+    exprWriteNumber(source, fabs(value));
+}
+
+
+/*=============================================================================
+ * GENFORTEST() Writes a test of a FOR loop's variable, var, against its end.
+ * Is it still in range or, with next set, would it be past the end after one
+ * more step? Counting down if down is set.
+ *===========================================================================*/
+static void genForTest(char *var, astNode *step, ushort number, ushort next, ushort down) {
+    if (next) {
+        genForStep(var, step, number, 0);
+    } else {
+        fprintf(source, "%s", var);
+    }
+
+    if (down) {
+        fprintf(source, (next ? " < " : " >= "));
+    } else {
+        fprintf(source, (next ? " > " : " <= "));
+    }
+    fprintf(source, "for_end_%d", number);
+}
+
+
+/*=============================================================================
+ * GENFORCONDITION() Writes genForTest(), for whichever way the loop counts.
+ * If the STEP isn't a constant, that's only known when the program runs.
+ *===========================================================================*/
+static void genForCondition(char *var, astNode *step, ushort number, ushort next) {
+    double value = 1;
+
+    if (!step || exprConstant(step, &value)) {
+        genForTest(var, step, number, next, (value < 0));
+        return;
+    }
+
+    fprintf(source, "(for_step_%d >= 0 ? ", number);
+    genForTest(var, step, number, next, 0);
+    fprintf(source, " : ");
+    genForTest(var, step, number, next, 1);
+    fprintf(source, ")");
+}
+
+
+/*=============================================================================
+ * GENFORBODY() Writes the statements of a FOR loop, and the end of it.
+ * SuperBASIC leaves the variable at the last value used, not one STEP past
+ * it as C would, so the loop stops before the STEP that would take it past
+ * the end. NEXT goes to that test, if there's another value to go on with.
+ *===========================================================================*/
+static void genForBody(astTree *tree, astNode *node, char *var, astNode *step, ushort flags) {
+    genLoop *loop = genLoops + genLoopCount - 1;
+    ushort number = loop->number;
+
+    loop->var = var;
+    loop->step = step;
+    genBlock(tree, node->last);
+
+    level++;
+    if (flags & (GEN_NEXT | GEN_NEXT_INNER)) {
+        fprintf(source, "%*sfor_next_%d:\n", (level - 1) * indent, "", number);
+    }
+    genIndent();
+    fprintf(source, "if (");
+    genForCondition(var, step, number, 1);
+    fprintf(source, ") {\n");
+    level++;
+    genIndent();
+    fprintf(source, "break;\n");
+    level--;
+    genIndent();
+    fprintf(source, "}\n");
+    level--;
+    genIndent();
+    fprintf(source, "}\n");
+}
+
+
+/*=============================================================================
+ * GENFORCOUNT() Writes a FOR loop that counts in a long. The start and STEP
+ * are whole numbers, so every value the variable takes is one, and the end
+ * can be rounded, the right way, to the last whole number in range. In the
+ * loop, the counter is used for the variable, which is only set when
+ * something else could look at it.
+ *===========================================================================*/
+static void genForCount(astTree *tree, astNode *node, char *var, ushort flags) {
+    astNode *from = node->first->first;
+    astNode *end = from->next;
+    astNode *step = end->next;
+    ushort number = genLoops[genLoopCount - 1].number;
+    char counter[EXPR_MAX_ALIAS];
+    double value = 1;
+    double limit;
+
+    sprintf(counter, "for_n_%d", number);
+    if (step) {
+        exprConstant(step, &value);
+    }
+
+    genIndent();
+    fprintf(source, "long %s;\n", counter);
+    genIndent();
+    fprintf(source, "long for_end_%d = ", number);
+    if (exprConstant(end, &limit)) {
+        limit = (value < 0 ? ceil(limit) : floor(limit));
+        if (limit > GEN_FOR_LIMIT) {
+            limit = GEN_FOR_LIMIT;
+        } else if (limit < -GEN_FOR_LIMIT) {
+            limit = -GEN_FOR_LIMIT;
+        }
+        exprWriteNumber(source, limit);
+    } else {
+        fprintf(source, "sbForLimit(");
+        exprWrite(source, tree, end, SYM_FLOAT);
+        fprintf(source, ", ");
+        exprWriteNumber(source, value);
+        fprintf(source, ")");
+    }
+    fprintf(source, ";\n\n");
+
+    genIndent();
+    fprintf(source, "for (%s = ", counter);
+    exprWrite(source, tree, from, SYM_NONE);
+    fprintf(source, "; ");
+    genForTest(counter, step, number, 0, (value < 0));
+    if (value == 1 || value == -1) {
+        fprintf(source, "; %s%s) {\n", counter, (value < 0 ? "--" : "++"));
+    } else {
+        fprintf(source, "; ");
+        genForStep(counter, step, number, 1);
+        fprintf(source, ") {\n");
+    }
+
+    if (flags & GEN_CALLS) {
+        level++;
+        genIndent();
+        fprintf(source, "%s = %s;\n", var, counter);
+        level--;
+    }
+
+    exprAlias(node->entry, counter, SYM_INTEGER, EXPR_ALIAS_NAME);
+    genForBody(tree, node, counter, step, flags);
+    exprUnalias();
+
+    if (flags & GEN_EXIT_INNER) {
+        fprintf(source, "%*sfor_exit_%d:\n", (level - 1) * indent, "", number);
+    }
+    genIndent();
+    fprintf(source, "%s = %s;\n", var, counter);
+}
+
+
+/*=============================================================================
+ * GENFORFLOAT() Writes a FOR loop, from TO end [STEP step], that counts in
+ * its own variable, as SuperBASIC does.
+ *===========================================================================*/
+static void genForFloat(astTree *tree, astNode *node, symbol *sym, char *var, ushort flags) {
+    astNode *from = node->first->first;
+    astNode *end = from->next;
+    astNode *step = end->next;
+    ushort number = genLoops[genLoopCount - 1].number;
+    double value;
+
+    genForSave(tree, end, "for_end", number);
+    if (step && !exprConstant(step, &value)) {
+        genForSave(tree, step, "for_step", number);
+    }
+    fprintf(source, "\n");
+
+    genIndent();
+    fprintf(source, "for (%s = ", var);
+    exprWrite(source, tree, from, (sym->type == SYM_INTEGER ? SYM_INTEGER : SYM_FLOAT));
+    fprintf(source, "; ");
+    genForCondition(var, step, number, 0);
+    fprintf(source, "; ");
+    genForStep(var, step, number, 1);
+    fprintf(source, ") {\n");
+
+    genForBody(tree, node, var, step, flags);
+
+    if (flags & GEN_EXIT_INNER) {
+        fprintf(source, "%*sfor_exit_%d: ;\n", (level - 1) * indent, "", number);
+    }
+}
+
+
+/*=============================================================================
+ * GENFORRANGES() Writes a FOR loop with a list of ranges, FOR i = 1, 4 TO 6.
+ * An outer loop picks each range in turn, and the inner one runs it. A value
+ * on its own is a range with just that value in it.
+ *===========================================================================*/
+static void genForRanges(astTree *tree, astNode *node, symbol *sym, char *var, ushort flags) {
+    genLoop *loop = genLoops + genLoopCount - 1;
+    astNode *range;
+    astNode *end;
+    ushort x = 0;
+
+    genIndent();
+    fprintf(source, "SB_FLOAT for_end_%d;\n", loop->number);
+    genIndent();
+    fprintf(source, "SB_FLOAT for_step_%d;\n", loop->number);
+    genIndent();
+    fprintf(source, "short for_range_%d;\n\n", loop->number);
+
+    genIndent();
+    fprintf(source, "for (for_range_%d = 0; for_range_%d < %d; for_range_%d++) {\n",
+            loop->number, loop->number, loop->ranges, loop->number);
+    level++;
+    genIndent();
+    fprintf(source, "switch (for_range_%d) {\n", loop->number);
+    for (range = node->first; range->kind == AST_RANGE; range = range->next) {
+        end = (range->first->next ? range->first->next : range->first);
+
+        level++;
+        genIndent();
+        fprintf(source, "case %d:\n", x++);
+        level++;
+        genIndent();
+        fprintf(source, "for_end_%d = ", loop->number);
+        exprWrite(source, tree, end, SYM_FLOAT);
+        fprintf(source, ";\n");
+        genIndent();
+        fprintf(source, "for_step_%d = ", loop->number);
+        if (end->next) {
+            exprWrite(source, tree, end->next, SYM_FLOAT);
+        } else {
+            fprintf(source, "1");
+        }
+        fprintf(source, ";\n");
+        genIndent();
+        fprintf(source, "%s = ", var);
+        exprWrite(source, tree, range->first, (sym->type == SYM_INTEGER ? SYM_INTEGER : SYM_FLOAT));
+        fprintf(source, ";\n");
+        genIndent();
+        fprintf(source, "break;\n");
+        level -= 2;
+    }
+    genIndent();
+    fprintf(source, "}\n\n");
+
+    /* The range isn't a constant step, so the tests use for_step. */
+    genIndent();
+    fprintf(source, "for (; ");
+    genForCondition(var, node->first, loop->number, 0);
+    fprintf(source, "; %s += for_step_%d) {\n", var, loop->number);
+    genForBody(tree, node, var, node->first, flags);
+    level--;
+    genIndent();
+    fprintf(source, "}\n");
+
+    if (flags & (GEN_EXIT | GEN_EXIT_INNER)) {
+        fprintf(source, "%*sfor_exit_%d: ;\n", (level - 1) * indent, "", loop->number);
+    }
+}
+
+
+/*=============================================================================
+ * GENFOR() Writes a FOR loop, in a block of its own for the end and step,
+ * which are worked out as it starts. The loop counts in a long when the
+ * variable can be shown to be a whole number, that nothing but the loop
+ * changes, and the STEP is a constant.
+ *===========================================================================*/
+static void genFor(astTree *tree, astNode *node) {
+    symbol *sym = symLookup(node->entry);
+    astNode *range = node->first;
+    astNode *step;
+    genLoop *loop;
+    ushort flags;
+    double value = 1;
+    char var[EXPR_NAME_SIZE];
+
+    if (!sym || sym->type == SYM_STRING || genLoopCount >= AST_MAX_DEPTH) {
+        genUnconverted(node);
+        genBlock(tree, node->last);
+        return;
+    }
+
+    loop = genLoops + genLoopCount++;
+    loop->kind = AST_FOR;
+    loop->entry = node->entry;
+    loop->number = ++genLoopNumber;
+    loop->ranges = 0;
+    while (range->kind == AST_RANGE) {
+        loop->ranges++;
+        range = range->next;
+    }
+
+    /* FOR i = 3 is a list of one range, 3 TO 3. */
+    range = node->first;
+    step = (range->first->next ? range->first->next->next : NULL);
+    loop->canBreak = (loop->ranges == 1 && range->first->next);
+
+    flags = genScan(node->last, NULL, node->entry, 0);
+    exprName(node->entry, var);
+
+    genIndent();
+    fprintf(source, "{\n");
+    level++;
+
+    if (!loop->canBreak) {
+        genForRanges(tree, node, sym, var, flags);
+    } else if (genWhole(range->first) && !(flags & (GEN_WRITTEN | GEN_JUMPS)) &&
+               (!step || (exprConstant(step, &value) && value && genWhole(step)))) {
+        genForCount(tree, node, var, flags);
+    } else {
+        genForFloat(tree, node, sym, var, flags);
+    }
+
+    level--;
+    genIndent();
+    fprintf(source, "}\n");
+    genLoopCount--;
+}
+
+
+/*=============================================================================
+ * GENREPEAT() Writes a REPeat loop, which only stops with an EXIT.
+ *===========================================================================*/
+static void genRepeat(astTree *tree, astNode *node) {
+    genLoop *loop;
+    ushort flags;
+
+    if (genLoopCount >= AST_MAX_DEPTH) {
+        genUnconverted(node);
+        genBlock(tree, node->first);
+        return;
+    }
+
+    loop = genLoops + genLoopCount++;
+    loop->kind = AST_REPEAT;
+    loop->entry = node->entry;
+    loop->number = ++genLoopNumber;
+    loop->ranges = 0;
+    loop->canBreak = 1;
+
+    flags = genScan(node->first, NULL, node->entry, 0);
+
+    genIndent();
+    fprintf(source, "for (;;) {\n");
+    genBlock(tree, node->first);
+    if (flags & GEN_NEXT_INNER) {
+        fprintf(source, "%*srepeat_next_%d: ;\n", level * indent, "", loop->number);
+    }
+    genIndent();
+    fprintf(source, "}\n");
+
+    if (flags & GEN_EXIT_INNER) {
+        fprintf(source, "%*srepeat_exit_%d: ;\n", (level ? level - 1 : 0) * indent, "", loop->number);
+    }
+    genLoopCount--;
+}
+
+
+/*=============================================================================
+ * GENIF() Writes an IF, in line or not, as if ... else. An ELSE that holds
+ * only another IF is written as else if.
+ *===========================================================================*/
+static void genIf(astTree *tree, astNode *node) {
+    astNode *then = node->first->next;
+
+    genIndent();
+    fprintf(source, "if ");
+    for (;;) {
+        exprWriteCondition(source, tree, node->first);
+        fprintf(source, " {\n");
+        genBlock(tree, then);
+
+        if (!then->next) {
+            break;
+        }
+
+        genIndent();
+        node = then->next->first;
+        if (node && !node->next && node->kind == AST_IF) {
+            fprintf(source, "} else if ");
+            then = node->first->next;
+            continue;
+        }
+
+        fprintf(source, "} else {\n");
+        genBlock(tree, then->next);
+        break;
+    }
+    genIndent();
+    fprintf(source, "}\n");
+}
+
+
+/*=============================================================================
+ * GENRANGEORDER() Sorts a SELect's ranges, for qsort(), on where they start,
+ * then on where they end, then on their clause.
+ *===========================================================================*/
+static int genRangeOrder(const void *left, const void *right) {
+    const genRange *a = left;
+    const genRange *b = right;
+
+    if (a->from != b->from) {
+        return (a->from < b->from ? -1 : 1);
+    }
+    if (a->to != b->to) {
+        return (a->to < b->to ? -1 : 1);
+    }
+    return a->clause - b->clause;
+}
+
+
+/*=============================================================================
+ * GENSELECTRANGES() Collects the ranges of a SELect's clauses, before any
+ * REMAINDER, sorted, after those in use. An empty range, 5 TO 1, is dropped, as
+ * is one that is just the same as a range before it, which would always be
+ * picked first. Returns 0 if they aren't all constants, or there are too
+ * many.
+ *===========================================================================*/
+static ushort genSelectRanges(astNode *node) {
+    genRange *ranges = genRanges + genRangeUsed;
+    astNode *clause;
+    astNode *range;
+    genRange *last;
+    ushort number = 0;
+    ushort x;
+    double from;
+    double to;
+
+    genRangeCount = 0;
+    for (clause = node->first; clause; clause = clause->next) {
+        if (clause->kind != AST_CLAUSE) {
+            continue;
+        }
+        if (clause->op != kwOn + 1) {
+            break;
+        }
+
+        number++;
+        for (range = clause->first; range->kind == AST_RANGE; range = range->next) {
+            if (!exprConstant(range->first, &from) ||
+                !exprConstant((range->first->next ? range->first->next : range->first), &to)) {
+                return 0;
+            }
+
+            if (from > to) {
+                continue;
+            }
+            if (genRangeUsed + genRangeCount >= GEN_MAX_SELECT) {
+                return 0;
+            }
+            ranges[genRangeCount].from = from;
+            ranges[genRangeCount].to = to;
+            ranges[genRangeCount].clause = number;
+            genRangeCount++;
+        }
+    }
+
+    qsort(ranges, genRangeCount, sizeof(genRange), genRangeOrder);
+
+    last = ranges;
+    for (x = 1; x < genRangeCount; x++) {
+        if (ranges[x].from != last->from || ranges[x].to != last->to) {
+            *++last = ranges[x];
+        }
+    }
+    if (genRangeCount) {
+        genRangeCount = last - ranges + 1;
+    }
+
+    return 1;
+}
+
+
+/*=============================================================================
+ * GENSELECTFORM() Works out how to write a SELect. Clauses of whole values,
+ * close together, are a switch. Ranges, or values far apart, that don't
+ * overlap are a table for sbSelect()'s binary search, and the switch is on
+ * the clause it finds. Anything else, or too few ranges for a search to pay,
+ * is tested a clause at a time, in an if ... else if chain. Leaves the
+ * ranges after those in use.
+ *===========================================================================*/
+static uchar genSelectForm(astNode *node) {
+    genRange *ranges = genRanges + genRangeUsed;
+    ushort x;
+    ushort whole = 1;
+
+    if (exprType(node->first) == SYM_STRING || !genSelectRanges(node) || !genRangeCount) {
+        return GEN_SELECT_IF;
+    }
+
+    for (x = 0; x < genRangeCount; x++) {
+        if (x && ranges[x].from <= ranges[x - 1].to) {
+            return GEN_SELECT_IF;
+        }
+        if (ranges[x].from != ranges[x].to || ranges[x].from != floor(ranges[x].from) ||
+            fabs(ranges[x].from) > GEN_FOR_LIMIT) {
+            whole = 0;
+        }
+    }
+
+    if (whole && ranges[genRangeCount - 1].from - ranges[0].from < 3.0 * genRangeCount) {
+        return GEN_SELECT_SWITCH;
+    }
+
+    return (genRangeCount >= GEN_MIN_TABLE ? GEN_SELECT_TABLE : GEN_SELECT_IF);
+}
+
+
+/*=============================================================================
+ * GENSELECTIF() Writes a SELect as if ... else if, testing each clause's
+ * ranges in turn, as SuperBASIC does. REMAINDER is the else.
+ *===========================================================================*/
+static void genSelectIf(astTree *tree, astNode *node, astNode *clause) {
+    astNode *range;
+    astNode *to;
+    char *separator;
+    ushort more;
+
+    genIndent();
+    for (; clause; clause = clause->next) {
+        if (clause->op != kwOn + 1) {
+            fprintf(source, "{\n");
+            genBlock(tree, clause->last);
+            genIndent();
+            fprintf(source, "}\n");
+            return;
+        }
+
+        fprintf(source, "if (");
+        separator = "";
+        for (range = clause->first; range->kind == AST_RANGE; range = range->next) {
+            fprintf(source, "%s", separator);
+            separator = " || ";
+
+            to = range->first->next;
+            if (!to) {
+                exprWrite(source, tree, node->first, SYM_FLOAT);
+                fprintf(source, " == ");
+                exprWrite(source, tree, range->first, SYM_FLOAT);
+                continue;
+            }
+
+            /* Bracketed, unless it's the only range. */
+            more = (range != clause->first || range->next->kind == AST_RANGE);
+            fprintf(source, "%s", (more ? "(" : ""));
+            exprWrite(source, tree, node->first, SYM_FLOAT);
+            fprintf(source, " >= ");
+            exprWrite(source, tree, range->first, SYM_FLOAT);
+            fprintf(source, " && ");
+            exprWrite(source, tree, node->first, SYM_FLOAT);
+            fprintf(source, " <= ");
+            exprWrite(source, tree, to, SYM_FLOAT);
+            fprintf(source, "%s", (more ? ")" : ""));
+        }
+        fprintf(source, ") {\n");
+        genBlock(tree, clause->last);
+
+        genIndent();
+        fprintf(source, "}");
+        if (!clause->next) {
+            fprintf(source, "\n");
+        } else {
+            fprintf(source, " else ");
+        }
+    }
+}
+
+
+/*=============================================================================
+ * GENSELECTSWITCH() Writes a SELect as a switch, on the value, or on the
+ * clause that sbSelect() finds for it in a table. Each clause is a case, or
+ * the default for REMAINDER, and ends with a break. Inside it, an EXIT from
+ * a loop around it can't be a break, so it is an open loop of its own, that
+ * can't be named, for genJump().
+ *===========================================================================*/
+static void genSelectSwitch(astTree *tree, astNode *node, astNode *clause, uchar form) {
+    genLoop *loop = genLoops + genLoopCount++;
+    genRange *ranges = genRanges + genRangeUsed;
+    ushort count = genRangeCount;
+    ushort number = 0;
+    ushort cases;
+    ushort x;
+
+    loop->kind = AST_SELECT;
+    loop->entry = 0xFFFE;
+    loop->number = ++genLoopNumber;
+    loop->ranges = 0;
+    loop->canBreak = 0;
+
+    /* A SELect in a clause mustn't overwrite these. */
+    genRangeUsed += count;
+
+    genIndent();
+    if (form == GEN_SELECT_TABLE) {
+        fprintf(source, "{\n");
+        level++;
+        genIndent();
+        fprintf(source, "static const SB_SELECT select_%d[] = {\n", loop->number);
+        for (x = 0; x < count; x++) {
+            genIndent();
+            fprintf(source, "%*s{", indent, "");
+            exprWriteNumber(source, ranges[x].from);
+            fprintf(source, ", ");
+            exprWriteNumber(source, ranges[x].to);
+            fprintf(source, ", %d}%s\n", ranges[x].clause, (x + 1 < count ? "," : ""));
+        }
+        genIndent();
+        fprintf(source, "};\n\n");
+
+        genIndent();
+        fprintf(source, "switch (sbSelect(select_%d, %d, ", loop->number, count);
+        exprWrite(source, tree, node->first, SYM_FLOAT);
+        fprintf(source, ")) {\n");
+    } else if (exprType(node->first) == SYM_INTEGER) {
+        fprintf(source, "switch (");
+        exprWrite(source, tree, node->first, SYM_NONE);
+        fprintf(source, ") {\n");
+    } else {
+        fprintf(source, "switch (sbWhole(");
+        exprWrite(source, tree, node->first, SYM_FLOAT);
+        fprintf(source, ")) {\n");
+    }
+
+    level++;
+    for (; clause; clause = clause->next) {
+        if (clause->op == kwOn + 1) {
+            number++;
+            cases = 0;
+            for (x = 0; x < count; x++) {
+                if (ranges[x].clause != number) {
+                    continue;
+                }
+
+                genIndent();
+                if (form == GEN_SELECT_TABLE) {
+                    fprintf(source, "case %d:\n", number);
+                    cases++;
+                    break;
+                }
+                fprintf(source, "case %ld:\n", (long)ranges[x].from);
+                cases++;
+            }
+
+            if (!cases) {
+                genIndent();
+                fprintf(source, "/* Line %d: ON never selected. */\n", clause->lineNumber);
+                continue;
+            }
+        } else {
+            genIndent();
+            fprintf(source, "default:\n");
+        }
+
+        genBlock(tree, clause->last);
+        level++;
+        genIndent();
+        fprintf(source, "break;\n");
+        level--;
+
+        if (clause->op != kwOn + 1) {
+            break;
+        }
+    }
+    level--;
+    genIndent();
+    fprintf(source, "}\n");
+
+    if (form == GEN_SELECT_TABLE) {
+        level--;
+        genIndent();
+        fprintf(source, "}\n");
+    }
+    genRangeUsed -= count;
+    genLoopCount--;
+}
+
+
+/*=============================================================================
+ * GENSELECT() Writes a SELect ON, after any REMarks before its first clause.
+ * A clause after REMAINDER can never be picked, so it is left out.
+ *===========================================================================*/
+static void genSelect(astTree *tree, astNode *node) {
+    astNode *clause = node->first->next;
+    astNode *after;
+    uchar form;
+
+    if (clause && clause->kind == AST_BLOCK) {
+        level--;
+        genBlock(tree, clause);
+        level++;
+        clause = clause->next;
+    }
+
+    if (exprType(node->first) == SYM_STRING || genLoopCount >= AST_MAX_DEPTH) {
+        genUnconverted(node);
+        for (; clause; clause = clause->next) {
+            genBlock(tree, clause->last);
+        }
+        return;
+    }
+
+    for (after = clause; after && after->op == kwOn + 1; after = after->next) {
+    }
+    if (after && after->next) {
+        genIndent();
+        fprintf(source, "/* Line %d: ON after REMAINDER never selected. */\n", after->next->lineNumber);
+    }
+
+    if (!clause) {
+        return;
+    }
+
+    form = genSelectForm(node);
+    if (form == GEN_SELECT_IF) {
+        genSelectIf(tree, node, clause);
+    } else {
+        genSelectSwitch(tree, node, clause, form);
+    }
+}
+
+
+/*=============================================================================
+ * GENJUMP() Writes EXIT or NEXT, for the innermost loop of that name. EXIT
+ * from the innermost loop is a break, and NEXT a continue, unless it's a
+ * FOR, which has a test to make first. Anything else goes to one of the
+ * loop's labels, so no loop stack is needed when the program runs. A FOR's
+ * NEXT only goes back round if there's another value, or range, to come,
+ * and otherwise carries on with the statements after it, as SuperBASIC's
+ * does.
+ *===========================================================================*/
+static void genJump(astNode *node) {
+    ushort entry = genVariable(node);
+    genLoop *loop;
+    char *name;
+    ushort x;
+
+    for (x = genLoopCount; x > 0; x--) {
+        if (genLoops[x - 1].entry == entry) {
+            break;
+        }
+    }
+
+    if (!x) {
+        genUnconverted(node);
+        return;
+    }
+
+    loop = genLoops + x - 1;
+    name = (loop->kind == AST_FOR ? "for" : "repeat");
+
+    genIndent();
+    if (node->op == kwNext + 1 && loop->kind == AST_FOR) {
+        fprintf(source, "if (");
+        if (!loop->canBreak) {
+            fprintf(source, "for_range_%d < %d || ", loop->number, loop->ranges - 1);
+        }
+        fprintf(source, "!(");
+        genForCondition(loop->var, loop->step, loop->number, 1);
+        fprintf(source, ")) {\n");
+        level++;
+        genIndent();
+        fprintf(source, "goto for_next_%d;\n", loop->number);
+        level--;
+        genIndent();
+        fprintf(source, "}\n");
+    } else if (node->op == kwNext + 1) {
+        if (x == genLoopCount && loop->kind == AST_REPEAT) {
+            fprintf(source, "continue;\n");
+        } else {
+            fprintf(source, "goto %s_next_%d;\n", name, loop->number);
+        }
+    } else if (x == genLoopCount && loop->canBreak) {
+        fprintf(source, "break;\n");
+    } else {
+        fprintf(source, "goto %s_exit_%d;\n", name, loop->number);
+    }
+}
+
+
+/*=============================================================================
+ * GENLINE() Returns the index of the first line numbered lineNumber or more,
+ * as SuperBASIC goes on from the next line after one that isn't there, or
+ * the number of lines if there isn't one.
+ *===========================================================================*/
+static ulong genLine(astTree *tree, double lineNumber) {
+    savProgLine *lines = tree->prog->lines;
+    ulong low = 0;
+    ulong high = tree->prog->lineCount;
+    ulong middle;
+
+    while (low < high) {
+        middle = (low + high) / 2;
+        if (lines[middle].lineNumber < lineNumber) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+
+    return low;
+}
+
+
+/*=============================================================================
+ * GENISLINE() Is node the first statement on its line, that a label can go
+ * before? Clauses, and the ENDs dropped when blocks were nested, can't.
+ *===========================================================================*/
+static ushort genIsLine(astNode *node) {
+    return ((node->flags & AST_LINE) && node->kind >= AST_ASSIGN && node->kind <= AST_SELECT);
+}
+
+
+/*=============================================================================
+ * GENWALK() Calls func, through astWalk(), for each statement of the
+ * function being written, but not its END DEFine, or any other DEFine.
+ *===========================================================================*/
+static void genWalk(astTree *tree, astNode *first, ASTFUNC func) {
+    astNode *child;
+
+    for (child = first; child; child = child->next) {
+        if (genDefining && !child->next && child->kind == AST_KEYWORD && child->op == kwEnd + 1) {
+            break;
+        }
+        if (child->kind != AST_DEFINE) {
+            astWalk(child, 0, func, tree);
+        }
+    }
+}
+
+
+/*=============================================================================
+ * GENLINESTART() Called by genWalk() to put each line of the function in
+ * genLines. One that isn't found, as the lines are out of order, is left
+ * out.
+ *===========================================================================*/
+static ushort genLineStart(astNode *node, ushort depth, void *data) {
+    ulong x;
+
+    (void)depth;
+
+    if (genIsLine(node) && (x = genLine(data, node->lineNumber)) < ((astTree *)data)->prog->lineCount) {
+        genLines[x] = node;
+    }
+
+    return (node->kind < AST_NUMBER || node->kind >= AST_BLOCK);
+}
+
+
+/*=============================================================================
+ * GENLINEEND() Called by genWalk() to take the function's lines back out of
+ * genLines, once it is written.
+ *===========================================================================*/
+static ushort genLineEnd(astNode *node, ushort depth, void *data) {
+    ulong x;
+
+    (void)depth;
+
+    if (genIsLine(node) && (x = genLine(data, node->lineNumber)) < ((astTree *)data)->prog->lineCount) {
+        genLines[x] = NULL;
+    }
+
+    return (node->kind < AST_NUMBER || node->kind >= AST_BLOCK);
+}
+
+
+/*=============================================================================
+ * GENGOTARGETS() Is node GO TO or GO SUB a line, or ON n GO TO or GO SUB a
+ * list of lines? If so, sets targets to the first, and sub if it's GO SUB.
+ *===========================================================================*/
+static ushort genGoTargets(astNode *node, astNode **targets, ushort *sub) {
+    astNode *child = node->first;
+    astNode *target;
+
+    if (node->kind != AST_KEYWORD || !child) {
+        return 0;
+    }
+
+    if (node->op == kwOn + 1 && !(node->flags & AST_SHORT_ON)) {
+        if (child->kind < AST_NUMBER || child->kind > AST_PAREN || child->sep ||
+            !child->next || child->next->kind != AST_WORD || child->next->op != kwGo + 1) {
+            return 0;
+        }
+        child = child->next->next;
+    } else if (node->op != kwGo + 1) {
+        return 0;
+    }
+
+    if (!child || child->kind != AST_WORD || (child->op != kwTt + 1 && child->op != kwSub + 1) ||
+        !child->next || (node->op == kwGo + 1 && child->next->next)) {
+        return 0;
+    }
+
+    /* The lines are separated by commas. */
+    for (target = child->next; target; target = target->next) {
+        if (target->kind < AST_NUMBER || target->kind > AST_PAREN ||
+            (target->next ? target->sep != SEPARATOR_COMMA : target->sep)) {
+            return 0;
+        }
+    }
+
+    *targets = child->next;
+    *sub = (child->op == kwSub + 1);
+    return 1;
+}
+
+
+/*=============================================================================
+ * GENGOCHECK() Can a jump to each of targets be converted? A line number
+ * must be in the function, or past the end of the program. An expression,
+ * a GO SUB or a RETurn needs the tables in main(), so can only be in the
+ * program, not a DEFine.
+ *===========================================================================*/
+static ushort genGoCheck(astTree *tree, astNode *targets, ushort sub) {
+    double value;
+    ulong x;
+
+    if (sub && genDefining) {
+        return 0;
+    }
+
+    for (; targets; targets = targets->next) {
+        if (!exprConstant(targets, &value)) {
+            if (genDefining) {
+                return 0;
+            }
+            continue;
+        }
+
+        x = genLine(tree, value);
+        if (x < tree->prog->lineCount ? !genLines[x] : (genDefining != NULL)) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+
+/*=============================================================================
+ * GENGOFIND() Called by genWalk() to find the jumps in the function, and
+ * label the lines they go to. Sets genGoFlags.
+ *===========================================================================*/
+static ushort genGoFind(astNode *node, ushort depth, void *data) {
+    astTree *tree = data;
+    astNode *targets;
+    ushort sub;
+    double value;
+    ulong x;
+
+    (void)depth;
+
+    if (node->kind == AST_KEYWORD && node->op == kwReturn + 1 && !node->first) {
+        genGoFlags |= GEN_GO_RETURN;
+    }
+
+    if (!genGoTargets(node, &targets, &sub) || !genGoCheck(tree, targets, sub)) {
+        return (node->kind < AST_NUMBER || node->kind >= AST_BLOCK);
+    }
+
+    if (sub) {
+        genGoFlags |= GEN_GO_SUB;
+    }
+
+    for (; targets; targets = targets->next) {
+        if (!exprConstant(targets, &value)) {
+            genGoFlags |= GEN_GO_JUMP;
+            continue;
+        }
+
+        x = genLine(tree, value);
+        if (x < tree->prog->lineCount) {
+            genLines[x]->flags |= AST_LABEL;
+        }
+    }
+
+    return 0;
+}
+
+
+/*=============================================================================
+ * GENGOLABEL() Called by genWalk(), for a GO TO an expression, to label every
+ * line of the function, and count them.
+ *===========================================================================*/
+static ushort genGoLabel(astNode *node, ushort depth, void *data) {
+    (void)depth;
+    (void)data;
+
+    if (genIsLine(node)) {
+        node->flags |= AST_LABEL;
+        genGoLines++;
+    }
+
+    return (node->kind < AST_NUMBER || node->kind >= AST_BLOCK);
+}
+
+
+/*=============================================================================
+ * GENGOLINE() Called by genWalk() to write each line's number, for the
+ * go_lines table that sbGoTo() searches.
+ *===========================================================================*/
+static ushort genGoLine(astNode *node, ushort depth, void *data) {
+    (void)depth;
+    (void)data;
+
+    if (genIsLine(node)) {
+        if (genGoIndex % 10 == 0) {
+            fprintf(source, "%s%*s", (genGoIndex ? "\n" : ""), (level + 1) * indent, "");
+        } else {
+            fprintf(source, " ");
+        }
+        fprintf(source, "%d%s", node->lineNumber, (++genGoIndex < genGoLines ? "," : ""));
+    }
+
+    return (node->kind < AST_NUMBER || node->kind >= AST_BLOCK);
+}
+
+
+/*=============================================================================
+ * GENGOCASE() Called by genWalk() to write the case that goes to each line,
+ * for go_jump.
+ *===========================================================================*/
+static ushort genGoCase(astNode *node, ushort depth, void *data) {
+    (void)depth;
+    (void)data;
+
+    if (genIsLine(node)) {
+        genIndent();
+        fprintf(source, "case %d:\n", genGoIndex++);
+        genIndent();
+        fprintf(source, "%*sgoto line_%d;\n", indent, "", node->lineNumber);
+    }
+
+    return (node->kind < AST_NUMBER || node->kind >= AST_BLOCK);
+}
+
+
+/*=============================================================================
+ * GENGOSTART() Finds the lines of the function about to be written, starting
+ * with the statement first, and the jumps to them, then declares what the
+ * jumps need, at the top of main().
+ *===========================================================================*/
+static void genGoStart(astTree *tree, astNode *first) {
+    genGoFlags = 0;
+    genGoLines = 0;
+    genGoSubs = 0;
+
+    genWalk(tree, first, genLineStart);
+    genWalk(tree, first, genGoFind);
+
+    /* With no GO SUB, a DEFine's RETurn just leaves it. */
+    if (genDefining && !(genGoFlags & GEN_GO_SUB)) {
+        genGoFlags &= ~GEN_GO_RETURN;
+    }
+
+    if (genGoFlags & GEN_GO_SUB) {
+        genIndent();
+        fprintf(source, "SB_GOSUB go_sub = {0};\n");
+    }
+
+    if (genGoFlags & GEN_GO_JUMP) {
+        genWalk(tree, first, genGoLabel);
+
+        genIndent();
+        fprintf(source, "int go_line;\n");
+        genIndent();
+        fprintf(source, "static const unsigned short go_lines[] = {\n");
+        genGoIndex = 0;
+        genWalk(tree, first, genGoLine);
+        fprintf(source, "\n");
+        genIndent();
+        fprintf(source, "};\n");
+    }
+
+    if (genGoFlags & (GEN_GO_SUB | GEN_GO_JUMP)) {
+        fprintf(source, "\n");
+    }
+}
+
+
+/*=============================================================================
+ * GENLEAVING() Returns the SBRuntime function that a FuNction of sym's type
+ * returns its result through, to go back to its caller's temporary strings.
+ *===========================================================================*/
+static char *genLeaving(symbol *sym) {
+    if (sym && sym->type == SYM_STRING) {
+        return "sbLeaveString";
+    }
+    return (sym && sym->type == SYM_INTEGER ? "sbLeaveInteger" : "sbLeaveFloat");
+}
+
+
+/*=============================================================================
+ * GENLEAVE() Writes a return from the function being written, through
+ * define_exit if it has cleanup to do. Has no indent, the caller does that.
+ *===========================================================================*/
+static void genLeave(void) {
+    symbol *sym;
+
+    if (!genDefining) {
+        fprintf(source, "return 0;\n");
+    } else if (genCleanup) {
+        fprintf(source, "goto define_exit;\n");
+        genExitUsed = 1;
+    } else if (genDefining->op != kwFunction + 1) {
+        fprintf(source, "return;\n");
+    } else {
+        sym = symLookup(genDefining->entry);
+        fprintf(source, "return %s(%s);\n", genLeaving(sym), (sym && sym->type == SYM_STRING ? "\"\"" : "0"));
+    }
+}
+
+
+/*=============================================================================
+ * GENGOEND() Writes the end of the function, after its return, where a
+ * RETurn goes back to the GO SUB on the top of the stack, and a GO TO an
+ * expression goes to the line sbGoTo() found. A switch, that the compiler
+ * can make a jump table of, picks the label. Then takes the function's lines
+ * out of genLines.
+ *===========================================================================*/
+static void genGoEnd(astTree *tree, astNode *first) {
+    ushort x;
+
+    if (genGoFlags & GEN_GO_RETURN) {
+        fprintf(source, "go_return:\n");
+        if (genGoSubs) {
+            genIndent();
+            fprintf(source, "switch (sbReturn(&go_sub)) {\n");
+            for (x = 1; x <= genGoSubs; x++) {
+                genIndent();
+                fprintf(source, "%*scase %d:\n", indent, "", x);
+                genIndent();
+                fprintf(source, "%*sgoto go_back_%d;\n", 2 * indent, "", x);
+            }
+            genIndent();
+            fprintf(source, "}\n");
+        }
+        genIndent();
+        genLeave();
+    }
+
+    if (genGoFlags & GEN_GO_JUMP) {
+        fprintf(source, "go_jump:\n");
+        genIndent();
+        fprintf(source, "switch (go_line) {\n");
+        level++;
+        genGoIndex = 0;
+        genWalk(tree, first, genGoCase);
+        level--;
+        genIndent();
+        fprintf(source, "}\n");
+        genIndent();
+        genLeave();
+    }
+
+    genWalk(tree, first, genLineEnd);
+}
+
+
+/*=============================================================================
+ * GENGOJUMP() Writes a jump to a line. A line number is a goto its label, or
+ * past the end of the program, the end of it. An expression is looked up by
+ * sbGoTo(), and go_jump goes to its label.
+ *===========================================================================*/
+static void genGoJump(astTree *tree, astNode *target) {
+    double value;
+    ulong x;
+
+    genIndent();
+    if (!exprConstant(target, &value)) {
+        fprintf(source, "go_line = sbGoTo(go_lines, %d, ", genGoLines);
+        exprWrite(source, tree, target, SYM_FLOAT);
+        fprintf(source, ");\n");
+        genIndent();
+        fprintf(source, "goto go_jump;\n");
+        return;
+    }
+
+    x = genLine(tree, value);
+    if (x < tree->prog->lineCount) {
+        fprintf(source, "goto line_%d;\n", genLines[x]->lineNumber);
+    } else {
+        genLeave();
+    }
+}
+
+
+/*=============================================================================
+ * GENGO() Writes GO TO or GO SUB, or ON n GO TO or GO SUB, as a switch on n.
+ * GO SUB pushes the number of its go_back label, for RETurn.
+ *===========================================================================*/
+static void genGo(astTree *tree, astNode *node) {
+    astNode *targets;
+    astNode *target;
+    ushort sub;
+    ushort number = 0;
+    ushort x = 0;
+
+    if (!genGoTargets(node, &targets, &sub) || !genGoCheck(tree, targets, sub)) {
+        genUnconverted(node);
+        return;
+    }
+
+    if (sub) {
+        number = ++genGoSubs;
+    }
+
+    if (node->op == kwGo + 1) {
+        if (sub) {
+            genIndent();
+            fprintf(source, "sbGoSub(&go_sub, %d, %d);\n", number, node->lineNumber);
+        }
+        genGoJump(tree, targets);
+    } else {
+        genIndent();
+        if (exprType(node->first) == SYM_INTEGER) {
+            fprintf(source, "switch (");
+            exprWrite(source, tree, node->first, SYM_NONE);
+            fprintf(source, ") {\n");
+        } else {
+            fprintf(source, "switch (sbInt(");
+            exprWrite(source, tree, node->first, SYM_FLOAT);
+            fprintf(source, ")) {\n");
+        }
+
+        level++;
+        for (target = targets; target; target = target->next) {
+            genIndent();
+            fprintf(source, "case %d:\n", ++x);
+            level++;
+            if (sub) {
+                genIndent();
+                fprintf(source, "sbGoSub(&go_sub, %d, %d);\n", number, node->lineNumber);
+            }
+            genGoJump(tree, target);
+            level--;
+        }
+        level--;
+        genIndent();
+        fprintf(source, "}\n");
+    }
+
+    if (sub && (genGoFlags & GEN_GO_RETURN)) {
+        fprintf(source, "%*sgo_back_%d: ;\n", (level - 1) * indent, "", number);
+    }
+}
+
+
+/*=============================================================================
+ * GENRETURN() Writes a RETurn from a GO SUB, which goes to go_return, at the
+ * end of the function, or from a DEFine. A FuNction's result is kept in
+ * define_result, copied if it's a string, while it cleans up.
+ *===========================================================================*/
+static void genReturn(astTree *tree, astNode *node) {
+    symbol *sym = (genDefining ? symLookup(genDefining->entry) : NULL);
+    uchar type = (sym && sym->type != SYM_NONE ? sym->type : SYM_FLOAT);
+
+    if (!node->first) {
+        genIndent();
+        if (genGoFlags & GEN_GO_RETURN) {
+            fprintf(source, "goto go_return;\n");
+        } else {
+            genLeave();
+        }
+        return;
+    }
+
+    if (!sym || genDefining->op != kwFunction + 1 || node->first->next) {
+        genUnconverted(node);
+        return;
+    }
+
+    genIndent();
+    if (!genCleanup) {
+        fprintf(source, "return %s(", genLeaving(sym));
+        exprWrite(source, tree, node->first, type);
+        fprintf(source, ");\n");
+        return;
+    }
+
+    fprintf(source, (type == SYM_STRING ? "define_result = sbTemp(" : "define_result = "));
+    exprWrite(source, tree, node->first, type);
+    fprintf(source, (type == SYM_STRING ? ");\n" : ";\n"));
+    genIndent();
+    genLeave();
+}
+
+
+/*=============================================================================
+ * GENSTATEMENT() Writes one statement.
+ *===========================================================================*/
+static void genStatement(astTree *tree, astNode *node) {
+    savToken *token = tree->prog->tokens + node->token;
+    ushort temps;
+
+    if (node->flags & AST_LABEL) {
+        fprintf(source, "%*sline_%d: ;\n", (level - 1) * indent, "", node->lineNumber);
+    }
+
+    /* SBRuntime would reuse a temporary string the statement still needs,
+     * unless its ring is made big enough first. */
+    temps = exprTempsNeeded(node);
+    if (temps) {
+        genIndent();
+        fprintf(source, "sbTempRing(%d);\n", temps);
+    }
+
+    switch (node->kind) {
+        case AST_REMARK:
+            genIndent();
+            fprintf(source, "/* ");
+            if (token->type == TYPE_TEXT) {
+                genComment(token->data + 4, token->value);
+            }
+            fprintf(source, " */\n");
+            break;
+
+        case AST_MISTAKE:
+            fprintf(source, "#error Line %d: MISTake ", node->lineNumber);
+            if (token->type == TYPE_TEXT) {
+                fprintf(source, "%.*s", token->value, token->data + 4);
+            }
+            fprintf(source, "\n");
+            break;
+
+        case AST_ASSIGN:
+            genAssign(tree, node);
+            break;
+
+        case AST_CALL:
+            genCall(tree, node);
+            break;
+
+        case AST_FOR:
+            genFor(tree, node);
+            break;
+
+        case AST_REPEAT:
+            genRepeat(tree, node);
+            break;
+
+        case AST_IF:
+            genIf(tree, node);
+            break;
+
+        case AST_SELECT:
+            genSelect(tree, node);
+            break;
+
+        case AST_KEYWORD:
+            if (node->op == kwExit + 1 || node->op == kwNext + 1) {
+                genJump(node);
+            } else if (node->op == kwGo + 1 || node->op == kwOn + 1) {
+                genGo(tree, node);
+            } else if (node->op == kwReturn + 1) {
+                genReturn(tree, node);
+            } else if (node->op == kwLocal + 1 && genDefining && level == 1 &&
+                       symLookup(genDefining->entry)->scope == genDefining && genIsLocal(node)) {
+                /* Its variables are declared as the DEFine starts. */
+                genLocalArrays(node);
+            } else {
+                genUnconverted(node);
+            }
+            break;
+
+        default:
+            genUnconverted(node);
+            break;
+    }
+}
+
+
+/*=============================================================================
+ * GENPARAMETERS() Gives each DEFine whose parameters are all simple names C
+ * parameters, before anything is written, as its calls need them. One that
+ * the body may change is passed by reference, AST_REF, and that depends on
+ * what the calls in the body pass by reference, so it's repeated until
+ * nothing more is found. Any other DEFine is left with no parameters. Only
+ * the first DEFine of a name is converted, as its scope, so a second can't
+ * make a second C function of the same name.
+ *===========================================================================*/
+static void genParameters(astTree *tree) {
+    symbol *sym;
+    astNode *node;
+    astNode *param;
+    astNode *child;
+    ushort flags;
+    ushort changed = 1;
+
+    for (node = tree->root->first; node; node = node->next) {
+        sym = (node->kind == AST_DEFINE ? symLookup(node->entry) : NULL);
+        if (!sym || sym->scope || (sym->kind != SYM_PROC && sym->kind != SYM_FN)) {
+            continue;
+        }
+
+        sym->scope = node;
+        for (param = node->first->first; param; param = param->next) {
+            sym = symLookup(param->entry);
+            if (param->kind != AST_NAME || !sym ||
+                (sym->kind != SYM_VARIABLE && sym->kind != SYM_FOR && sym->kind != SYM_UNSET)) {
+                break;
+            }
+
+            /* DEFine PROC p(a, a) can't be. */
+            for (child = node->first->first; child != param && child->entry != param->entry;
+                 child = child->next) {
+            }
+            if (child != param) {
+                break;
+            }
+        }
+
+        if (!param) {
+            symLookup(node->entry)->define = node;
+        }
+    }
+
+    while (changed) {
+        changed = 0;
+        for (node = tree->root->first; node; node = node->next) {
+            sym = (node->kind == AST_DEFINE ? symLookup(node->entry) : NULL);
+            if (!sym || sym->define != node) {
+                continue;
+            }
+
+            for (param = node->first->first; param; param = param->next) {
+                if (param->flags & AST_REF) {
+                    continue;
+                }
+
+                flags = 0;
+                for (child = node->first->next; child; child = child->next) {
+                    flags |= genScan(child, NULL, param->entry, 0);
+                }
+                if (flags & GEN_WRITTEN) {
+                    param->flags |= AST_REF;
+                    changed = 1;
+                }
+            }
+        }
+    }
+}
+
+
+/*=============================================================================
+ * GENCOLLECT() Adds a node's name to the names, or calls, of the DEFine being
+ * looked at, for astWalk().
+ *===========================================================================*/
+static ushort genCollect(astNode *node, ushort depth, void *data) {
+    symbol *sym;
+
+    (void)depth;
+    (void)data;
+
+    switch (node->kind) {
+        case AST_NAME:
+        case AST_INDEX:
+        case AST_FOR:
+        case AST_SELECT:
+        case AST_CALL:
+            sym = symLookup(node->entry);
+            break;
+
+        default:
+            return 1;
+    }
+
+    if (genIsVariable(sym) && node->kind != AST_CALL) {
+        if (genNameCount < genNameLimit) {
+            genNames[genNameCount++] = node->entry;
+        }
+    } else if (sym && (sym->kind == SYM_FN ? node->kind == AST_NAME || node->kind == AST_INDEX :
+                       sym->kind == SYM_PROC && node->kind == AST_CALL)) {
+        if (genCallCount < genNameLimit) {
+            genCalls[genCallCount++] = node->entry;
+        }
+    }
+
+    return 1;
+}
+
+
+/*=============================================================================
+ * GENCOMPARE() Orders name table entries, for qsort().
+ *===========================================================================*/
+static int genCompare(const void *a, const void *b) {
+    return (int)*(const ushort *)a - (int)*(const ushort *)b;
+}
+
+
+/*=============================================================================
+ * GENUNIQUE() Sorts count entries, from list, and drops repeats. Returns how
+ * many are left.
+ *===========================================================================*/
+static ushort genUnique(ushort *list, ulong count) {
+    ulong x;
+    ulong kept = 0;
+
+    qsort(list, count, sizeof(ushort), genCompare);
+    for (x = 0; x < count; x++) {
+        if (!kept || list[kept - 1] != list[x]) {
+            list[kept++] = list[x];
+        }
+    }
+
+    return (ushort)kept;
+}
+
+
+/*=============================================================================
+ * GENCOLLECTDEFINE() Lists the names a DEFine uses and the calls it makes,
+ * and marks those it binds, its parameters and the names in its LOCal
+ * statements. Those in a nested block are left to the interpreter's rules,
+ * as statements that aren't converted.
+ *===========================================================================*/
+static void genCollectDefine(symbol *sym, astNode *node) {
+    astNode *child;
+    astNode *name;
+    uchar *flags;
+
+    sym->scope = node;
+    sym->names = genNameCount;
+    sym->calls = genCallCount;
+    astWalk(node, 0, genCollect, NULL);
+    sym->nameCount = genUnique(genNames + sym->names, genNameCount - sym->names);
+    sym->callCount = genUnique(genCalls + sym->calls, genCallCount - sym->calls);
+    genNameCount = sym->names + sym->nameCount;
+    genCallCount = sym->calls + sym->callCount;
+
+    if (sym->define == node) {
+        for (name = node->first->first; name; name = name->next) {
+            if ((flags = genNameFlags(sym, name->entry)) != NULL) {
+                *flags |= GEN_NAME_BOUND;
+            }
+        }
+    }
+
+    for (child = node->first->next; child; child = child->next) {
+        if (!genIsLocal(child)) {
+            continue;
+        }
+        for (name = child->first; name; name = name->next) {
+            if (genIsVariable(symLookup(name->entry)) && (flags = genNameFlags(sym, name->entry)) != NULL) {
+                *flags |= GEN_NAME_BOUND;
+            }
+        }
+    }
+}
+
+
+/*=============================================================================
+ * GENPUSHCALLS() Stacks the DEFines that sym calls, that this search hasn't
+ * been to yet.
+ *===========================================================================*/
+static void genPushCalls(symbol *sym, ushort *top) {
+    symbol *callee;
+    ulong x;
+
+    for (x = sym->calls; x < sym->calls + sym->callCount; x++) {
+        callee = symLookup(genCalls[x]);
+        if (callee && callee->scope && genMarks[callee->entry] != genMark) {
+            genMarks[callee->entry] = genMark;
+            genStack[(*top)++] = callee->entry;
+        }
+    }
+}
+
+
+/*=============================================================================
+ * GENSHARE() Follows the calls from the DEFine of sym, as far as one that
+ * binds the same name, to see if any uses its bound name, x. If so, each
+ * that does finds it in SBLocal, GEN_NAME_DYNAMIC, and so does sym's DEFine,
+ * GEN_NAME_SHARED.
+ *===========================================================================*/
+static void genShare(symbol *sym, ulong x) {
+    ushort entry = genNames[x];
+    ushort top = 0;
+    symbol *callee;
+    uchar *flags;
+
+    genMark++;
+    genMarks[sym->entry] = genMark;
+    genPushCalls(sym, &top);
+    while (top) {
+        callee = symLookup(genStack[--top]);
+        flags = genNameFlags(callee, entry);
+        if (flags && (*flags & GEN_NAME_BOUND)) {
+            continue;
+        }
+
+        if (flags) {
+            *flags |= GEN_NAME_DYNAMIC;
+            genNameFlagList[x] |= GEN_NAME_SHARED;
+        }
+        genPushCalls(callee, &top);
+    }
+}
+
+
+/*=============================================================================
+ * GENLOCALS() Works out which parameters and LOCals of each DEFine can be C
+ * locals. SuperBASIC's are seen by any PROC or FN it calls, while it runs,
+ * so one that may be is kept in SBLocal instead, and found there by name.
+ * Only the first DEFine of a name is looked at, as that's the one called.
+ *===========================================================================*/
+static ushort genLocals(astTree *tree) {
+    symbol *sym;
+    astNode *node;
+    ulong x;
+
+    genNameLimit = tree->prog->tokenCount;
+    genNames = arenaAlloc(tree->a, ARENA_SIZE(ushort, genNameLimit));
+    genNameFlagList = arenaCalloc(tree->a, ARENA_SIZE(uchar, genNameLimit));
+    genCalls = arenaAlloc(tree->a, ARENA_SIZE(ushort, genNameLimit));
+    genMarks = arenaCalloc(tree->a, ARENA_SIZE(ulong, symbols.count));
+    genStack = arenaAlloc(tree->a, ARENA_SIZE(ushort, symbols.count));
+    if (!genNames || !genNameFlagList || !genCalls || !genMarks || !genStack) {
+        fprintf(stderr, "\n\nERROR: genLocals(): Out of memory for the LOCal names.\n");
+        return 1;
+    }
+
+    genNameCount = 0;
+    genCallCount = 0;
+    genMark = 0;
+    for (node = tree->root->first; node; node = node->next) {
+        sym = (node->kind == AST_DEFINE ? symLookup(node->entry) : NULL);
+        if (sym && sym->scope == node) {
+            genCollectDefine(sym, node);
+        }
+    }
+
+    for (node = tree->root->first; node; node = node->next) {
+        sym = (node->kind == AST_DEFINE ? symLookup(node->entry) : NULL);
+        if (!sym || sym->scope != node) {
+            continue;
+        }
+        for (x = sym->names; x < sym->names + sym->nameCount; x++) {
+            if (genNameFlagList[x] & GEN_NAME_BOUND) {
+                genShare(sym, x);
+            }
+        }
+    }
+
+    return 0;
+}
+
+
+/*=============================================================================
+ * GENPROTOTYPE() Writes the start of a DEFine's function, its type, name and
+ * parameters. Those passed by reference are pointers, name_ref, and strings
+ * passed by value are copied from name_arg, as the caller's may be a
+ * temporary one. So are those kept in SBLocal.
+ *===========================================================================*/
+static void genPrototype(FILE *fp, symbol *sym) {
+    astNode *param;
+    symbol *paramSym;
+    uchar *flags;
+    uchar type = (sym->type != SYM_NONE ? sym->type : SYM_FLOAT);
+
+    fprintf(fp, "%s%s(", (sym->kind == SYM_FN ? symCType(type) : "void "), sym->cName);
+    if (!sym->define) {
+        fprintf(fp, ")");
+        return;
+    }
+
+    if (!sym->define->first->first) {
+        fprintf(fp, "void");
+    }
+
+    for (param = sym->define->first->first; param; param = param->next) {
+        paramSym = symLookup(param->entry);
+        type = exprParamType(param);
+        flags = genNameFlags(sym, param->entry);
+        if (param->flags & AST_REF) {
+            fprintf(fp, "%s*%s_ref", symCType(type), paramSym->cName);
+        } else {
+            fprintf(fp, "%s%s%s", symCType(type), paramSym->cName,
+                    (type == SYM_STRING || (flags && (*flags & GEN_NAME_SHARED)) ? "_arg" : ""));
+        }
+        fprintf(fp, (param->next ? ", " : ""));
+    }
+    fprintf(fp, ")");
+}
+
+
+/*=============================================================================
+ * GENPROTOTYPES() Writes a prototype for each PROCedure and FuNction to the
+ * header.
+ *===========================================================================*/
+static void genPrototypes(void) {
+    static uchar kinds[] = {SYM_PROC, SYM_FN};
+    symbol *sym;
+    long size;
+    ushort kind;
+    ushort x;
+
+    fprintf(header, "/* PROCedures and FuNctions. */\n");
+    for (kind = 0; kind < sizeof(kinds); kind++) {
+        for (x = 0; x < symbols.kindCount[kinds[kind]]; x++) {
+            sym = symbols.symbols + symbols.byKind[kinds[kind]][x];
+            size = ftell(header);
+            genPrototype(header, sym);
+            fprintf(header, ";");
+            size = ftell(header) - size;
+            fprintf(header, "%*s/* Line %d. */\n", (size < 40 ? (int)(40 - size) : 1), "", sym->lineNumber);
+        }
+    }
+}
+
+
+/*=============================================================================
+ * GENISPARAMETER() Is entry one of the C parameters of sym's DEFine?
+ *===========================================================================*/
+static ushort genIsParameter(symbol *sym, ushort entry) {
+    astNode *param;
+
+    if (sym->define != sym->scope) {
+        return 0;
+    }
+
+    for (param = sym->define->first->first; param; param = param->next) {
+        if (param->entry == entry) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+
+/*=============================================================================
+ * GENDEFINESTART() Declares the locals of the DEFine being written, named as
+ * the body uses them: copies of its parameters, where strings are copied and
+ * numbers passed by value are used as they are, and its LOCals. Those that
+ * are shared start a new SBLocal scope, and get their values there. Each
+ * name kept in SBLocal is looked up once, here, into its handle, as nothing
+ * can change which one it is until the function returns.
+ *===========================================================================*/
+static void genDefineStart(symbol *sym, astNode *node) {
+    astNode *param;
+    symbol *nameSym;
+    uchar type;
+    ulong x;
+    char name[EXPR_NAME_SIZE];
+    char *ref;
+
+    for (param = (sym->define == node ? node->first->first : NULL); param; param = param->next) {
+        nameSym = symLookup(param->entry);
+        type = exprParamType(param);
+        if (*genNameFlags(sym, param->entry) & GEN_NAME_SHARED) {
+            continue;
+        }
+        if (type == SYM_STRING) {
+            genIndent();
+            fprintf(source, "SB_CHAR *%s = NULL;\n", nameSym->cName);
+        } else if (param->flags & AST_REF) {
+            genIndent();
+            fprintf(source, "%s%s = *%s_ref;\n", symCType(type), nameSym->cName, nameSym->cName);
+        }
+    }
+
+    for (x = sym->names; sym->scope == node && x < sym->names + sym->nameCount; x++) {
+        nameSym = symLookup(genNames[x]);
+        type = (nameSym->type != SYM_NONE ? nameSym->type : SYM_FLOAT);
+        if ((genNameFlagList[x] & (GEN_NAME_BOUND | GEN_NAME_SHARED)) == GEN_NAME_BOUND &&
+            !genIsParameter(sym, genNames[x])) {
+            genIndent();
+            fprintf(source, "%s%s = %s;\n", symCType(type), nameSym->cName, (type == SYM_STRING ? "NULL" : "0"));
+        } else if (genNameFlagList[x] & (GEN_NAME_SHARED | GEN_NAME_DYNAMIC)) {
+            genIndent();
+            fprintf(source, "%s*%s_local;\n", symCType(type), nameSym->cName);
+        }
+    }
+
+    type = (sym->type != SYM_NONE ? sym->type : SYM_FLOAT);
+    if (genCleanup && sym->kind == SYM_FN) {
+        genIndent();
+        fprintf(source, "%sdefine_result = %s;\n", symCType(type), (type == SYM_STRING ? "\"\"" : "0"));
+    }
+
+    if (genSharing) {
+        genIndent();
+        fprintf(source, "beginScope();\n");
+        for (x = sym->names; x < sym->names + sym->nameCount; x++) {
+            if (genNameFlagList[x] & GEN_NAME_SHARED) {
+                nameSym = symLookup(genNames[x]);
+                genIndent();
+                fprintf(source, "newLocal(%s, \"%.*s\");\n",
+                        (nameSym->type == SYM_STRING ? "SBLOCAL_STRING" :
+                         nameSym->type == SYM_INTEGER ? "SBLOCAL_INTEGER" : "SBLOCAL_FLOAT"),
+                        GEN_LOCAL_NAME, nameSym->cName);
+            }
+        }
+    }
+
+    for (x = sym->names; sym->scope == node && x < sym->names + sym->nameCount; x++) {
+        if (genNameFlagList[x] & (GEN_NAME_SHARED | GEN_NAME_DYNAMIC)) {
+            nameSym = symLookup(genNames[x]);
+            genIndent();
+            fprintf(source, "%s_local = addressSBLocalVariable%s(\"%.*s\", &%s);\n", nameSym->cName,
+                    (nameSym->type == SYM_STRING ? "_s" : nameSym->type == SYM_INTEGER ? "_i" : ""),
+                    GEN_LOCAL_NAME, nameSym->cName, nameSym->cName);
+        }
+    }
+
+    for (param = (sym->define == node ? node->first->first : NULL); param; param = param->next) {
+        nameSym = symLookup(param->entry);
+        type = exprParamType(param);
+        ref = (param->flags & AST_REF ? "_ref" : "_arg");
+        if (!(*genNameFlags(sym, param->entry) & GEN_NAME_SHARED)) {
+            if (type == SYM_STRING) {
+                genIndent();
+                fprintf(source, "sbAssign(&%s, %s%s%s);\n", nameSym->cName,
+                        (param->flags & AST_REF ? "*" : ""), nameSym->cName, ref);
+            }
+            continue;
+        }
+
+        exprName(param->entry, name);
+        genIndent();
+        fprintf(source, (type == SYM_STRING ? "sbAssign(&%s, %s%s%s);\n" : "%s = %s%s%s;\n"), name,
+                (param->flags & AST_REF ? "*" : ""), nameSym->cName, ref);
+    }
+}
+
+
+/*=============================================================================
+ * GENRETURNS() Does the last statement of a DEFine return from it, so that
+ * the body can't get to its END DEFine? A RETurn that genReturn() converts
+ * does, unless it goes back to a GO SUB.
+ *===========================================================================*/
+static ushort genReturns(astNode *last) {
+    if (!last || last->kind != AST_KEYWORD || last->op != kwReturn + 1) {
+        return 0;
+    }
+
+    if (!last->first) {
+        return !(genGoFlags & GEN_GO_RETURN);
+    }
+    return (genDefining->op == kwFunction + 1 && !last->first->next);
+}
+
+
+/*=============================================================================
+ * GENDEFINEEND() Writes the end of the DEFine being written. If it has
+ * cleanup, define_exit copies the parameters passed by reference back, ends
+ * its SBLocal scope and frees the strings. A FuNction that gets to its END
+ * DEFine returns zero, or an empty string, unless its body has returned
+ * already. The GO TO and GO SUB code, if any, follows.
+ *===========================================================================*/
+static void genDefineEnd(symbol *sym, astNode *node, ushort returned) {
+    astNode *param;
+    symbol *nameSym;
+    ushort more = (genGoFlags & (GEN_GO_RETURN | GEN_GO_JUMP));
+    ulong x;
+    char name[EXPR_NAME_SIZE];
+
+    if (!genCleanup) {
+        if ((sym->kind == SYM_FN || more) && !returned) {
+            genIndent();
+            genLeave();
+        }
+        return;
+    }
+
+    if (genExitUsed || more) {
+        fprintf(source, "define_exit:\n");
+    }
+
+    for (param = (sym->define == node ? node->first->first : NULL); param; param = param->next) {
+        nameSym = symLookup(param->entry);
+        if (param->flags & AST_REF) {
+            exprName(param->entry, name);
+            genIndent();
+            if (exprParamType(param) == SYM_STRING) {
+                fprintf(source, "sbAssign(%s_ref, %s);\n", nameSym->cName, name);
+            } else {
+                fprintf(source, "*%s_ref = %s;\n", nameSym->cName, name);
+            }
+        }
+    }
+
+    if (genSharing) {
+        genIndent();
+        fprintf(source, "endCurrentScope();\n");
+    }
+
+    for (x = sym->names; sym->scope == node && x < sym->names + sym->nameCount; x++) {
+        nameSym = symLookup(genNames[x]);
+        if ((genNameFlagList[x] & (GEN_NAME_BOUND | GEN_NAME_SHARED)) == GEN_NAME_BOUND &&
+            nameSym->type == SYM_STRING) {
+            genIndent();
+            fprintf(source, "free(%s);\n", nameSym->cName);
+        }
+    }
+
+    if (sym->kind == SYM_FN) {
+        genIndent();
+        fprintf(source, "return %s(define_result);\n", genLeaving(sym));
+    } else if (more) {
+        genIndent();
+        fprintf(source, "return;\n");
+    }
+}
+
+
+/*=============================================================================
+ * GENDEFINE() Writes a DEFine block as a function, returning the FN's type.
+ * The END DEFine is the closing brace. Its parameters are C parameters, if
+ * genParameters() gave it them, and its LOCals are C locals, or SBLocal ones
+ * if genLocals() found they are shared. Names it may share with a caller are
+ * found in SBLocal, or as globals if no caller has them. A FuNction has its
+ * own temporary strings, from sbEnter() until it returns.
+ *===========================================================================*/
+static void genDefine(astTree *tree, astNode *node) {
+    symbol *sym = symLookup(node->entry);
+    astNode *param;
+    astNode *child;
+    astNode *last = NULL;
+    ushort aliases = 0;
+    ulong x;
+
+    if (!sym) {
+        genUnconverted(node);
+        return;
+    }
+
+    if (sym->scope != node) {
+        fprintf(source, "\n\n/* Line %d: A second DEFine of %s, not converted. */\n", node->lineNumber,
+                sym->cName);
+        return;
+    }
+
+    genCleanup = 0;
+    genExitUsed = 0;
+    genSharing = 0;
+    if (sym->define == node) {
+        for (param = node->first->first; param; param = param->next) {
+            if ((param->flags & AST_REF) || exprParamType(param) == SYM_STRING) {
+                genCleanup = 1;
+            }
+        }
+    }
+
+    for (x = sym->names; x < sym->names + sym->nameCount; x++) {
+        if (genNameFlagList[x] & GEN_NAME_SHARED) {
+            genSharing = 1;
+            genCleanup = 1;
+        } else if ((genNameFlagList[x] & GEN_NAME_BOUND) && symLookup(genNames[x])->type == SYM_STRING) {
+            genCleanup = 1;
+        }
+    }
+
+    fprintf(source, "\n\n/* Line %d. */\n", node->lineNumber);
+    if (sym->define == node) {
+        genPrototype(source, sym);
+    } else {
+        fprintf(source, "%s%s()", (node->op == kwFunction + 1 ? symCType(sym->type) : "void "), sym->cName);
+    }
+    fprintf(source, " {\n");
+
+    for (x = sym->names; x < sym->names + sym->nameCount; x++) {
+        if (genNameFlagList[x] & (GEN_NAME_SHARED | GEN_NAME_DYNAMIC)) {
+            if (!exprAlias(genNames[x], "", symLookup(genNames[x])->type, EXPR_ALIAS_LOCAL)) {
+                fprintf(source, "#error Line %d: Too many shared LOCals to convert.\n", node->lineNumber);
+                break;
+            }
+            aliases++;
+        }
+    }
+
+    level = 1;
+    genDefining = node;
+    genGoStart(tree, node->first->next);
+    genDefineStart(sym, node);
+    if (node->op == kwFunction + 1) {
+        genIndent();
+        fprintf(source, "sbEnter();\n");
+    }
+    if (sym->define != node && node->first->first) {
+        genIndent();
+        fprintf(source, "/* Line %d: Parameters not converted. */\n", node->lineNumber);
+    }
+
+    for (child = node->first->next; child; child = child->next) {
+        if (!child->next && child->kind == AST_KEYWORD && child->op == kwEnd + 1) {
+            break;
+        }
+        genStatement(tree, child);
+        last = child;
+    }
+
+    genDefineEnd(sym, node, genReturns(last));
+    genGoEnd(tree, node->first->next);
+
+    while (aliases--) {
+        exprUnalias();
+    }
+
+    level = 0;
+    fprintf(source, "}\n");
+}
+
+
+/*=============================================================================
+ * GENDIMENSION() Called by astWalk() for each node, to note how many
+ * dimensions each DIMensioned, or LOCal, array has, which its declaration
+ * needs.
+ *===========================================================================*/
+static ushort genDimension(astNode *node, ushort depth, void *data) {
+    symbol *sym;
+    astNode *child;
+    astNode *index;
+    ushort dims;
+
+    (void)depth;
+    (void)data;
+
+    if (node->kind != AST_KEYWORD || (node->op != kwDim + 1 && node->op != kwLocal + 1)) {
+        return 1;
+    }
+
+    for (child = node->first; child; child = child->next) {
+        sym = symLookup(child->entry);
+        if (child->kind != AST_INDEX || !sym || sym->kind != SYM_ARRAY) {
+            continue;
+        }
+
+        dims = 0;
+        for (index = child->first; index; index = index->next) {
+            dims++;
+        }
+        if (dims > sym->dims) {
+            sym->dims = (dims > 255 ? 255 : dims);
+        }
+    }
+
+    return 0;
+}
+
+
+/*=============================================================================
+ * GENPROGRAM() Writes the converted program: the globals and prototypes,
+ * then main(), then a function for each DEFine.
+ *===========================================================================*/
+ushort genProgram(astTree *tree, char *savName) {
+    astNode *node;
+
+    genLines = arenaCalloc(tree->a, ARENA_SIZE(astNode *, tree->prog->lineCount));
+    if (!genLines) {
+        fprintf(stderr, "\n\nERROR: genProgram(): Out of memory for the line index.\n");
+        return 1;
+    }
+
+    header = fopen(headerFile, "w");
+    source = fopen(sourceFile, "w");
+    globals = fopen(globalFile, "w");
+    if (!header || !source || !globals) {
+        fprintf(stderr, "\n\nERROR: genProgram(): Cannot open the output files.\n");
+        return 1;
+    }
+
+    genLoopNumber = 0;
+    genRangeUsed = 0;
+    genDefining = NULL;
+    genCleanup = 0;
+
+    /* Everything is declared before any code is written. */
+    genParameters(tree);
+    astWalk(tree->root, 0, genDimension, NULL);
+    if (genLocals(tree)) {
+        return 1;
+    }
+    genPrototypes();
+    symDeclare(globals, header);
+
+    fprintf(source, "/* %s, converted by C68Port. */\n\n", savName);
+    fprintf(source, "#include <stdio.h>\n");
+    fprintf(source, "#include <stdlib.h>\n");
+    fprintf(source, "#include <math.h>\n");
+    fprintf(source, "#include \"SBRuntime.h\"\n");
+    fprintf(source, "#include \"%s\"\n", globalFile);
+    fprintf(source, "#include \"%s\"\n\n\n", headerFile);
+
+    fprintf(source, "int main(int argc, char *argv[]) {\n");
+    level = 1;
+    genGoStart(tree, tree->root->first);
+    for (node = tree->root->first; node; node = node->next) {
+        if (node->kind != AST_DEFINE) {
+            genStatement(tree, node);
+        }
+    }
+    genIndent();
+    fprintf(source, "return 0;\n");
+    genGoEnd(tree, tree->root->first);
+    level = 0;
+    fprintf(source, "}\n");
+
+    for (node = tree->root->first; node; node = node->next) {
+        if (node->kind == AST_DEFINE) {
+            genDefine(tree, node);
+        }
+    }
+
+    fclose(header);
+    fclose(source);
+    fclose(globals);
+    return 0;
+}
@@ -0,0 +1,17 @@
+#ifndef __GEN_H__
+#define __GEN_H__
+
+/*===========================================================================
+ * HEADERS
+ *===========================================================================*/
+#include <stdio.h>
+#include "ast.h"
+#include "expr.h"
+#include "symbols.h"
+
+/*===========================================================================
+ * FUNCTION PROTOTYPES
+ *===========================================================================*/
+ushort genProgram(astTree *tree, char *savName);
+
+#endif /* __GEN_H__ */
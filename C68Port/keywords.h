@@ -39,13 +39,4 @@ enum  kw {
     kwMistake
 };
 
-/* Functions */
-typedef ushort (*KWFUNC)(FILE *fp);
-
-ushort keywordNull(FILE *fp);
-ushort keywordRemark(FILE *fp);
-ushort keywordMistake(FILE *fp);
-
-
-
 #endif /* __KEYWORDS_H__ */
\ No newline at end of file
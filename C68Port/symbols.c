@@ -0,0 +1,481 @@
+/*=============================================================================
+ * Symbol table for the converter. Built once, from the name table, and then
+ * used for every name token, every declaration and anything else that needs
+ * to know what a name is.
+ *
+ * Each name table entry becomes a symbol, which says what kind of thing it
+ * is, what type it holds or returns, and what it will be called in the C
+ * source. The symbols are kept in name table order, so the entry in a name
+ * token is all that's needed to find one. Each kind also has its own list,
+ * so the declarations for, say, all the FuNctions don't need to look at
+ * anything else, and there's a hash of the names, ignoring case, as the
+ * SuperBASIC does, for when only the name is known.
+ *
+ * All of it comes out of the decoder's arena, which symSize() says how much
+ * to reserve for, so it's freed along with the name table.
+ *===========================================================================*/
+
+/*===========================================================================
+ * HEADERS
+ *===========================================================================*/
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "symbols.h"
+
+/*===========================================================================
+ * GLOBALS
+ *===========================================================================*/
+symbolTable symbols;
+
+/* Names that are fine in SuperBASIC, but not in C. Its own words, what the
+ * converted program's headers declare, and the names the code generator
+ * uses for itself. Anything else starting sb or SB is SBRuntime's, and
+ * anything with SBLocal in it is SBLocal's. */
+static char *cReserved[] = {
+    "auto", "break", "case", "char", "const", "continue", "default", "do",
+    "double", "else", "enum", "extern", "float", "for", "goto", "if",
+    "int", "long", "main", "register", "return", "short", "signed",
+    "sizeof", "static", "struct", "switch", "typedef", "union",
+    "unsigned", "void", "volatile", "while",
+
+    /* stdio.h */
+    "BUFSIZ", "EOF", "FILE", "FILENAME_MAX", "NULL", "SEEK_CUR", "SEEK_END",
+    "SEEK_SET", "clearerr", "fclose", "feof", "ferror", "fflush", "fgetc",
+    "fgetpos", "fgets", "fopen", "fprintf", "fputc", "fputs", "fread",
+    "freopen", "fscanf", "fseek", "fsetpos", "ftell", "fwrite", "getc",
+    "getchar", "gets", "perror", "printf", "putc", "putchar", "puts",
+    "remove", "rename", "rewind", "scanf", "setbuf", "setvbuf", "snprintf",
+    "sprintf", "sscanf", "stderr", "stdin", "stdout", "tmpfile", "tmpnam",
+    "ungetc", "vfprintf", "vprintf", "vsprintf",
+
+    /* stdlib.h */
+    "EXIT_FAILURE", "EXIT_SUCCESS", "RAND_MAX", "abort", "abs", "atexit",
+    "atof", "atoi", "atol", "bsearch", "calloc", "div", "exit", "free",
+    "getenv", "labs", "ldiv", "malloc", "qsort", "rand", "realloc",
+    "srand", "strtod", "strtol", "strtoul", "system",
+
+    /* math.h */
+    "HUGE_VAL", "INFINITY", "NAN", "acos", "asin", "atan", "atan2", "ceil",
+    "cos", "cosh", "exp", "fabs", "floor", "fmod", "frexp", "isinf",
+    "isnan", "ldexp", "log", "log10", "modf", "pow", "round", "sin", "sinh",
+    "sqrt", "tan", "tanh", "trunc",
+
+    /* SBLocal.h */
+    "beginScope", "endCurrentScope", "newLocal", "newLocalString",
+    "newLocalArray", "peekSBLocalScopeLevel", "findSBLocalVariableByName",
+    "sblocal_types",
+
+    /* The code generator's. */
+    "argc", "argv", "define_exit", "define_result", "go_back", "go_jump",
+    "go_line", "go_lines", "go_return", "go_sub", NULL
+};
+
+/* The code generator's numbered names, line_10, for_end_3 and so on, and
+ * what it adds to a name, for a LOCal's handle or a parameter. */
+static char *cNumbered[] = {
+    "for_end_", "for_exit_", "for_n_", "for_next_", "for_range_",
+    "for_step_", "go_back_", "line_", "repeat_exit_", "repeat_next_",
+    "select_", NULL
+};
+
+static char *cSuffixes[] = {
+    "_arg", "_local", "_ref", NULL
+};
+
+
+/*=============================================================================
+ * SYMHASH() FNV-1a hash of a name, optionally ignoring case.
+ *===========================================================================*/
+static ulong symHash(uchar *name, ushort size, ushort fold) {
+    ulong hash = 2166136261UL;
+    ushort x;
+
+    for (x = 0; x < size; x++) {
+        hash ^= (fold ? toupper(name[x]) : name[x]);
+        hash = (hash * 16777619UL) & 0xFFFFFFFFUL;
+    }
+
+    return hash;
+}
+
+
+/*=============================================================================
+ * SYMHASHSIZE() How big the hashes are for a number of entries. Under half
+ * full, so searches are short.
+ *===========================================================================*/
+static ulong symHashSize(ushort entries) {
+    ulong size = 16;
+
+    while (size < (ulong)entries * 2) {
+        size <<= 1;
+    }
+
+    return size;
+}
+
+
+/*=============================================================================
+ * SYMKIND() What kind of thing a name table entry is, from the high byte of
+ * its type.
+ *===========================================================================*/
+static uchar symKind(ushort nameType) {
+    switch (nameType >> 8) {
+        case 0x00: return SYM_UNSET;
+        case 0x02: return SYM_VARIABLE;
+        case 0x03: return SYM_ARRAY;
+        case 0x06: return SYM_REPEAT;
+        case 0x07: return SYM_FOR;
+        case 0x08: return SYM_MC_PROC;
+        case 0x09: return SYM_MC_FN;
+        case 0x14: return SYM_PROC;
+        case 0x15: return SYM_FN;
+    }
+
+    return SYM_OTHER;
+}
+
+
+/*=============================================================================
+ * SYMSUFFIXTYPE() The type a name's $ or % suffix gives it, SYM_STRING or
+ * SYM_INTEGER, otherwise SYM_NONE.
+ *===========================================================================*/
+static uchar symSuffixType(nameTableEntry *name) {
+    if (!name->nameLength) {
+        return SYM_NONE;
+    }
+
+    switch (name->name[name->nameLength - 1]) {
+        case '$': return SYM_STRING;
+        case '%': return SYM_INTEGER;
+    }
+
+    return SYM_NONE;
+}
+
+
+/*=============================================================================
+ * SYMRESERVED() Returns 1 if a C name can't be used for a symbol, as C, its
+ * libraries, SBRuntime or the code generator have it already.
+ *===========================================================================*/
+static ushort symReserved(char *cName, ushort size) {
+    ushort length;
+    ushort x;
+
+    if ((cName[0] == 's' && cName[1] == 'b' && isupper((uchar)cName[2])) ||
+        (cName[0] == 'S' && cName[1] == 'B') || strstr(cName, "SBLocal")) {
+        return 1;
+    }
+
+    for (x = 0; cReserved[x]; x++) {
+        if (strcmp(cName, cReserved[x]) == 0) {
+            return 1;
+        }
+    }
+
+    for (x = 0; cNumbered[x]; x++) {
+        length = strlen(cNumbered[x]);
+        if (strncmp(cName, cNumbered[x], length) == 0 && size > length &&
+            strspn(cName + length, "0123456789") == (size_t)(size - length)) {
+            return 1;
+        }
+    }
+
+    for (x = 0; cSuffixes[x]; x++) {
+        length = strlen(cSuffixes[x]);
+        if (size > length && strcmp(cName + size - length, cSuffixes[x]) == 0) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+
+/*=============================================================================
+ * SYMCNAME() Makes a C identifier from a SuperBASIC name. A trailing $ or %
+ * becomes _s or _i, as in SBLocal, and reserved names get _sb added. If that
+ * gives a name that's already taken, the entry number is added as well, so
+ * every symbol's C name is different.
+ *===========================================================================*/
+static void symCName(symbol *sym, nameTableEntry *name, ushort *cHash) {
+    char *cName = sym->cName;
+    ushort size = 0;
+    ushort x;
+    ulong slot;
+    ulong mask = symbols.hashSize - 1;
+
+    for (x = 0; x < name->nameLength && size < MAXNAMESIZE; x++) {
+        if (name->name[x] == '$') {
+            cName[size++] = '_';
+            cName[size++] = 's';
+        } else if (name->name[x] == '%') {
+            cName[size++] = '_';
+            cName[size++] = 'i';
+        } else if (isalnum(name->name[x]) || name->name[x] == '_') {
+            cName[size++] = name->name[x];
+        } else {
+            cName[size++] = '_';
+        }
+    }
+
+    cName[size] = '\0';
+    if (!size || isdigit((uchar)cName[0])) {
+        memmove(cName + 3, cName, size + 1);
+        memcpy(cName, "sb_", 3);
+        size += 3;
+    }
+
+    if (symReserved(cName, size)) {
+        strcpy(cName + size, "_sb");
+        size += 3;
+    }
+
+    /* Taken? Add the entry number. */
+    slot = symHash((uchar *)cName, size, 0) & mask;
+    while (cHash[slot]) {
+        if (strcmp(symbols.symbols[cHash[slot] - 1].cName, cName) == 0) {
+            sprintf(cName + size, "_%u", sym->entry);
+            size = strlen(cName);
+            slot = symHash((uchar *)cName, size, 0) & mask;
+            continue;
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    cHash[slot] = sym->entry + 1;
+}
+
+
+/*=============================================================================
+ * SYMSIZE() How much of the arena a symbol table for this many entries
+ * needs. The kinds' lists hold each entry once, between them, plus up to an
+ * alignment's worth each. The C names have a hash of their own, while they
+ * are being made.
+ *===========================================================================*/
+ulong symSize(ushort entries) {
+    return ARENA_SIZE(symbol, entries) +
+           ARENA_SIZE(ushort, entries) + ARENA_ALIGN * SYM_KINDS +
+           ARENA_SIZE(ushort, symHashSize(entries)) * 2;
+}
+
+
+/*=============================================================================
+ * SYMBUILD() Builds the symbol table from the name table, in the arena.
+ * Returns 1 if it won't fit.
+ *===========================================================================*/
+ushort symBuild(nameTableEntry *names, ushort entries, arena *a) {
+    symbol *sym;
+    ushort *cHash;
+    ushort x;
+    ushort kind;
+    ulong slot;
+    ulong mask;
+
+    symFree();
+
+    symbols.hashSize = symHashSize(entries);
+    mask = symbols.hashSize - 1;
+
+    symbols.symbols = arenaCalloc(a, ARENA_SIZE(symbol, entries));
+    symbols.hash = arenaCalloc(a, ARENA_SIZE(ushort, symbols.hashSize));
+    cHash = arenaCalloc(a, ARENA_SIZE(ushort, symbols.hashSize));
+    if (!symbols.symbols || !symbols.hash || !cHash) {
+        fprintf(stderr, "\n\nERROR: symBuild(): No room for symbol table. (%d entries).\n", entries);
+        symFree();
+        return 1;
+    }
+
+    symbols.count = entries;
+
+    /* Count the kinds, so each list can be carved out in one go. */
+    for (x = 0; x < entries; x++) {
+        symbols.kindCount[symKind(names[x].nameType)]++;
+    }
+
+    for (kind = 0; kind < SYM_KINDS; kind++) {
+        symbols.byKind[kind] = arenaAlloc(a, ARENA_SIZE(ushort, symbols.kindCount[kind]));
+        if (!symbols.byKind[kind]) {
+            fprintf(stderr, "\n\nERROR: symBuild(): No room for %s list. (%d entries).\n",
+                    symKindName(kind), symbols.kindCount[kind]);
+            symFree();
+            return 1;
+        }
+        symbols.kindCount[kind] = 0;
+    }
+
+    for (x = 0; x < entries; x++) {
+        sym = symbols.symbols + x;
+        sym->entry = x;
+        sym->kind = symKind(names[x].nameType);
+        sym->lineNumber = names[x].lineNumber;
+
+        /* PROCs, machine code or not, return nothing. Loop names hold
+         * nothing either, but FOR variables are always floats. Anything
+         * the name table doesn't type, like a machine code FN, or a name
+         * that's never set, is typed by its $ or %, if it has one. */
+        switch (sym->kind) {
+            case SYM_PROC:
+            case SYM_MC_PROC:
+            case SYM_REPEAT:
+            case SYM_OTHER:
+                sym->type = SYM_NONE;
+                break;
+
+            case SYM_FOR:
+                sym->type = SYM_FLOAT;
+                break;
+
+            default:
+                sym->type = names[x].nameType & 0xFF;
+                if (sym->type == SYM_NONE || sym->type > SYM_INTEGER) {
+                    sym->type = symSuffixType(names + x);
+                }
+        }
+
+        sym->kindIndex = symbols.kindCount[sym->kind];
+        symbols.byKind[sym->kind][symbols.kindCount[sym->kind]++] = x;
+
+        symCName(sym, names + x, cHash);
+
+        slot = symHash(names[x].name, names[x].nameLength, 1) & mask;
+        while (symbols.hash[slot]) {
+            slot = (slot + 1) & mask;
+        }
+        symbols.hash[slot] = x + 1;
+    }
+
+    return 0;
+}
+
+
+/*=============================================================================
+ * SYMFREE() Forgets the symbol table. The memory goes with the arena.
+ *===========================================================================*/
+void symFree(void) {
+    memset(&symbols, 0, sizeof(symbols));
+}
+
+
+/*=============================================================================
+ * SYMLOOKUP() Returns the symbol for a name table entry, or NULL if there
+ * isn't one.
+ *===========================================================================*/
+symbol *symLookup(ushort entry) {
+    if (entry >= symbols.count) {
+        return NULL;
+    }
+
+    return symbols.symbols + entry;
+}
+
+
+/*=============================================================================
+ * SYMFIND() Returns the symbol with the given name, ignoring case, or NULL.
+ * QDOS doesn't put a name in the table twice, so the first one is it.
+ *===========================================================================*/
+symbol *symFind(uchar *name, ushort size) {
+    extern nameTableEntry *nameTable;
+    ulong mask = symbols.hashSize - 1;
+    ulong slot;
+    ushort entry;
+    ushort x;
+
+    if (!symbols.hashSize) {
+        return NULL;
+    }
+
+    slot = symHash(name, size, 1) & mask;
+    while (symbols.hash[slot]) {
+        entry = symbols.hash[slot] - 1;
+        if (nameTable[entry].nameLength == size) {
+            for (x = 0; x < size; x++) {
+                if (toupper(nameTable[entry].name[x]) != toupper(name[x])) {
+                    break;
+                }
+            }
+
+            if (x == size) {
+                return symbols.symbols + entry;
+            }
+        }
+
+        slot = (slot + 1) & mask;
+    }
+
+    return NULL;
+}
+
+
+/*=============================================================================
+ * SYMKINDNAME() What a kind of symbol is called, for messages.
+ *===========================================================================*/
+char *symKindName(uchar kind) {
+    static char *kindNames[] = {
+        "Unset", "Variable", "Array", "REPeat", "FOR", "MC Procedure",
+        "MC Function", "Procedure", "Function", "Other"
+    };
+
+    return (kind < SYM_KINDS ? kindNames[kind] : "Unknown");
+}
+
+
+/*=============================================================================
+ * SYMCTYPE() The C type for a variable, or FuNction result.
+ *===========================================================================*/
+char *symCType(uchar type) {
+    switch (type) {
+        case SYM_STRING:  return "SB_CHAR *";
+        case SYM_FLOAT:   return "SB_FLOAT ";
+        case SYM_INTEGER: return "SB_INTEGER ";
+    }
+
+    return "void ";
+}
+
+
+/*=============================================================================
+ * SYMDECLARE() Writes the declarations. Variables, FOR variables and arrays
+ * are globals, as anything that isn't LOCal is, in SuperBASIC. Arrays are
+ * pointers, one for each dimension, as their size isn't known until they
+ * are DIMensioned. A string array's last dimension is the length of its
+ * strings, so DIM a$(10) is one string, and only DIM a$(3,10) is an array.
+ * Machine code PROCs and FNs come from elsewhere, so are just listed in the
+ * header, after the prototypes that the code generator writes.
+ *===========================================================================*/
+void symDeclare(FILE *globals, FILE *header) {
+    static uchar globalKinds[] = {SYM_VARIABLE, SYM_FOR, SYM_ARRAY};
+    static uchar mcKinds[] = {SYM_MC_PROC, SYM_MC_FN};
+    symbol *sym;
+    ushort kind;
+    ushort x;
+    ushort dims;
+
+    fprintf(globals, "/* Global variables. */\n");
+    for (kind = 0; kind < sizeof(globalKinds); kind++) {
+        for (x = 0; x < symbols.kindCount[globalKinds[kind]]; x++) {
+            sym = symbols.symbols + symbols.byKind[globalKinds[kind]][x];
+            dims = 0;
+            if (sym->kind == SYM_ARRAY) {
+                dims = (sym->dims ? sym->dims : 1) - (sym->type == SYM_STRING);
+            }
+            fprintf(globals, "%s", symCType(sym->type));
+            for (; dims; dims--) {
+                fputc('*', globals);
+            }
+            fprintf(globals, "%s;\n", sym->cName);
+        }
+    }
+
+    for (kind = 0; kind < sizeof(mcKinds); kind++) {
+        if (!symbols.kindCount[mcKinds[kind]]) {
+            continue;
+        }
+
+        fprintf(header, "\n/* %ss used: */\n", symKindName(mcKinds[kind]));
+        for (x = 0; x < symbols.kindCount[mcKinds[kind]]; x++) {
+            fprintf(header, "/*   %s */\n", symbols.symbols[symbols.byKind[mcKinds[kind]][x]].cName);
+        }
+    }
+}
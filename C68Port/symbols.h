@@ -0,0 +1,84 @@
+#ifndef __SYMBOLS_H__
+#define __SYMBOLS_H__
+
+#include <stdio.h>
+#include "c68port.h"
+#include "../Arena/arena.h"
+
+/*===========================================================================
+ * DEFINES
+ *===========================================================================*/
+
+/* What a name table entry is, from the high byte of its type. */
+#define SYM_UNSET 0                 /* Typed, never used. $00xx */
+#define SYM_VARIABLE 1              /* Simple variable, $02xx. */
+#define SYM_ARRAY 2                 /* DIMensioned array, $03xx. */
+#define SYM_REPEAT 3                /* REPeat loop name, $06xx. */
+#define SYM_FOR 4                   /* FOR loop variable, $07xx. */
+#define SYM_MC_PROC 5               /* Machine code procedure, $08xx. */
+#define SYM_MC_FN 6                 /* Machine code function, $09xx. */
+#define SYM_PROC 7                  /* SuperBASIC PROCedure, $14xx. */
+#define SYM_FN 8                    /* SuperBASIC FuNction, $15xx. */
+#define SYM_OTHER 9                 /* Anything else. */
+#define SYM_KINDS 10
+
+/* What it holds, or returns, from the low byte of its type. */
+#define SYM_NONE 0
+#define SYM_STRING 1                /* name$ */
+#define SYM_FLOAT 2                 /* name */
+#define SYM_INTEGER 3               /* name% */
+
+/* C identifiers get the name, a suffix for $ or %, and maybe _nnnnn. */
+#define SYM_CNAME_SIZE (MAXNAMESIZE + 16)
+
+/*===========================================================================
+ * TYPEDEFS
+ *===========================================================================*/
+
+/* One name table entry, ready for code generation. */
+typedef struct symbol {
+    ushort entry;                   /* Name table entry. */
+    uchar  kind;                    /* SYM_VARIABLE etc. */
+    uchar  type;                    /* SYM_FLOAT etc. */
+    ushort kindIndex;               /* Where it is in its kind's list. */
+    short  lineNumber;              /* DEFine line of a PROC or FN. */
+    struct astNode *define;         /* Its DEFine, if it has C parameters. */
+    struct astNode *scope;          /* Its DEFine, whose LOCals are found, */
+    ulong  names;                   /* and where its names, and the PROCs */
+    ulong  calls;                   /* and FNs it calls, start in the code */
+    ushort nameCount;               /* generator's lists. */
+    ushort callCount;
+    uchar  dims;                    /* An array's dimensions, from its DIM. */
+    char   cName[SYM_CNAME_SIZE];   /* Name to use in the C source. */
+} symbol;
+
+/* Every symbol, in name table order, so a name token's entry finds its
+ * symbol directly. Each kind also has a list of its symbols' entries, in
+ * name table order, and names can be looked up, ignoring case, by hash. */
+typedef struct symbolTable {
+    symbol *symbols;
+    ushort count;
+    ushort *byKind[SYM_KINDS];
+    ushort kindCount[SYM_KINDS];
+    ushort *hash;                   /* Entry + 1, 0 is empty. */
+    ulong  hashSize;                /* Always a power of 2. */
+} symbolTable;
+
+/*===========================================================================
+ * GLOBALS
+ *===========================================================================*/
+extern symbolTable symbols;
+
+/*===========================================================================
+ * FUNCTION PROTOTYPES
+ *===========================================================================*/
+ulong   symSize(ushort entries);
+ushort  symBuild(nameTableEntry *names, ushort entries, arena *a);
+void    symFree(void);
+symbol *symLookup(ushort entry);
+symbol *symFind(uchar *name, ushort size);
+char   *symKindName(uchar kind);
+char   *symCType(uchar type);
+void    symDeclare(FILE *globals, FILE *header);
+
+#endif /* __SYMBOLS_H__ */
@@ -0,0 +1,557 @@
+/*=============================================================================
+ * SAV file decoder fuzzer.
+ *
+ * Takes the seed corpus, a few valid SAV files, and feeds mangled copies of
+ * them to each of the decoders - the in memory one in SavFile, the Lister and,
+ * if we are told where it is, the converter. A decoder may reject a file, but
+ * it must not crash, and it must finish within a time that depends only on
+ * the size of the file. Anything that crashes, or runs out of time, is saved
+ * in the failures directory so that it can be run again by hand. Files that
+ * the in memory decoder accepts are also written back out with the SAV file
+ * writer, which must give back the file it was given.
+ *
+ * Each decoder runs in a child process, in the work directory, with stdout
+ * and stderr thrown away. The random numbers come from savRandom(), so the
+ * same seed and corpus always make the same files.
+ *
+ * Usage: savFuzz [-n runs] [-s seed] [-t ms] [-c converter] seed ...
+ *
+ * -n runs       How many mangled files to try. Default 1000.
+ * -s seed       Random number seed. Default 1.
+ * -t ms         Time every run is allowed, before the per byte allowance
+ *               is added on. Default FUZZ_BASETIME.
+ * -c converter  The C68Port program to fuzz as well.
+ *
+ * Seeds can be files or directories. In a directory, every file is a seed.
+ *
+ * This needs fork(), so it doesn't build on QDOS.
+ *===========================================================================*/
+
+#ifdef QDOS
+#error "SavFuzz needs fork(), it won't run on QDOS."
+#endif
+
+/*===========================================================================
+ * HEADERS
+ *===========================================================================*/
+#include <time.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include "savFuzz.h"
+
+/*===========================================================================
+ * GLOBALS
+ *===========================================================================*/
+fuzzSeed seeds[MAXSEEDS];
+ushort seedCount = 0;
+ulong baseTime = FUZZ_BASETIME;
+
+fuzzTarget targets[] = {
+    {"savfile", fuzzSavFile, NULL, 0, 0, 0, 0.0},
+    {"lister",  fuzzLister,  NULL, 0, 0, 0, 0.0},
+    {"c68port", NULL,        NULL, 0, 0, 0, 0.0}
+};
+
+#define FUZZ_TARGETS (sizeof(targets) / sizeof(targets[0]))
+
+/* Bytes that mean something in a SAV file, more likely to upset a decoder
+ * than any old random byte. */
+static uchar interesting[] = {
+    0x00, 0x01, 0x02, 0x0A, 0x1F, 0x20, 0x7F, 0x80, 0x81, 0x84, 0x85,
+    0x86, 0x88, 0x8B, 0x8C, 0x8D, 0x8E, 0xD0, 0xE0, 0xF0, 0xFF
+};
+
+static ushort interestingWords[] = {
+    0x0000, 0x0001, 0x7FFF, 0x8000, 0xFFFF, 0x8D00, 0x840A, 0x8402
+};
+
+
+/*=============================================================================
+ * MAIN() Start here. Reads the corpus, then tries each mangled file on each
+ * decoder. Returns 1 if any decoder crashed or took too long.
+ *===========================================================================*/
+int main (int argc, char *argv[]) {
+    ulong runs = 1000;
+    ulong n;
+    ulong size;
+    ushort t;
+    ushort failures = 0;
+    fuzzSeed *seed;
+    uchar *bytes;
+    char program[MAXPATH + 1];
+    int arg;
+
+    for (arg = 1; arg < argc; arg++) {
+        if (strcmp(argv[arg], "-n") == 0 && arg + 1 < argc) {
+            runs = strtoul(argv[++arg], NULL, 10);
+        } else if (strcmp(argv[arg], "-s") == 0 && arg + 1 < argc) {
+            savSeedRandom(strtoul(argv[++arg], NULL, 10));
+        } else if (strcmp(argv[arg], "-t") == 0 && arg + 1 < argc) {
+            baseTime = strtoul(argv[++arg], NULL, 10);
+        } else if (strcmp(argv[arg], "-c") == 0 && arg + 1 < argc) {
+            /* The child runs in the work directory, so we need it all. */
+            if (!realpath(argv[++arg], program)) {
+                fprintf(stderr, "FATAL ERROR: main(): Cannot find converter '%s'.\n", argv[arg]);
+                return -1;
+            }
+            targets[FUZZ_TARGETS - 1].program = program;
+        } else if (argv[arg][0] == '-') {
+            fprintf(stderr, "%s: Unknown option '%s'.\n", argv[0], argv[arg]);
+            return -1;
+        } else if (addSeeds(argv[arg]) != 0) {
+            fprintf(stderr, "FATAL ERROR: main(): Cannot read seeds from '%s'.\n", argv[arg]);
+            return -1;
+        }
+    }
+
+    if (!seedCount) {
+        fprintf(stderr, "Usage: %s [-n runs] [-s seed] [-t ms] [-c converter] seed ...\n", argv[0]);
+        return -1;
+    }
+
+    if ((mkdir(FUZZ_WORKDIR, 0755) != 0 && errno != EEXIST) ||
+        (mkdir(FUZZ_FAILDIR, 0755) != 0 && errno != EEXIST)) {
+        fprintf(stderr, "FATAL ERROR: main(): Cannot create the '%s' and '%s' directories.\n", FUZZ_WORKDIR, FUZZ_FAILDIR);
+        return -1;
+    }
+
+    bytes = malloc(MAXFUZZSIZE);
+    if (!bytes) {
+        fprintf(stderr, "FATAL ERROR: main(): Cannot allocate %d bytes.\n", MAXFUZZSIZE);
+        return -1;
+    }
+
+    /* The seeds themselves go first, as they are, then the mangled ones. */
+    for (n = 0; n < seedCount + runs; n++) {
+        if (n < seedCount) {
+            seed = &seeds[n];
+            memcpy(bytes, seed->bytes, seed->size);
+            size = seed->size;
+        } else {
+            seed = &seeds[savRandomBelow(seedCount)];
+            memcpy(bytes, seed->bytes, seed->size);
+            size = mutate(bytes, seed->size);
+        }
+
+        if (writeInput(FUZZ_WORKDIR "/" FUZZ_INPUT, bytes, size) != 0) {
+            fprintf(stderr, "FATAL ERROR: main(): Cannot write '%s/%s'.\n", FUZZ_WORKDIR, FUZZ_INPUT);
+            free(bytes);
+            return -1;
+        }
+
+        for (t = 0; t < FUZZ_TARGETS; t++) {
+            if (!targets[t].function && !targets[t].program) {
+                continue;
+            }
+
+            if (runTarget(&targets[t], size, n) != 0) {
+                failures++;
+
+                /* Keep the evidence. */
+                sprintf(program, "%s/%s_%lu_sav", FUZZ_FAILDIR, targets[t].name, n);
+                writeInput(program, bytes, size);
+                fprintf(stderr, "Failing input saved as '%s'.\n", program);
+            }
+        }
+    }
+
+    printf("%-10s %10s %10s %10s %14s\n", "Decoder", "Runs", "Rejected", "Failures", "Worst us/byte");
+    for (t = 0; t < FUZZ_TARGETS; t++) {
+        if (targets[t].runs) {
+            printf("%-10s %10lu %10lu %10lu %14.3f\n", targets[t].name, targets[t].runs,
+                   targets[t].rejected, targets[t].failures, targets[t].slowest);
+        }
+    }
+
+    free(bytes);
+    for (t = 0; t < seedCount; t++) {
+        free(seeds[t].bytes);
+    }
+
+    return (failures ? 1 : 0);
+}
+
+
+/*=============================================================================
+ * ADDSEED() Reads one seed file into memory.
+ *===========================================================================*/
+ushort addSeed(char *fileName) {
+    FILE *fp;
+    fuzzSeed *seed;
+
+    if (seedCount == MAXSEEDS) {
+        fprintf(stderr, "\n\nERROR: addSeed(): No more than %d seeds.\n", MAXSEEDS);
+        return 1;
+    }
+
+    fp = fopen(fileName, "rb");
+    if (!fp) {
+        fprintf(stderr, "\n\nERROR: addSeed(): Cannot open '%s'.\n", fileName);
+        return 1;
+    }
+
+    seed = &seeds[seedCount];
+    seed->bytes = malloc(MAXFUZZSIZE);
+    if (!seed->bytes) {
+        fclose(fp);
+        fprintf(stderr, "\n\nERROR: addSeed(): Cannot allocate %d bytes.\n", MAXFUZZSIZE);
+        return 1;
+    }
+
+    /* Anything too big is just cut short, which is still a good seed. */
+    seed->size = fread(seed->bytes, 1, MAXFUZZSIZE, fp);
+    fclose(fp);
+
+    seedCount++;
+    return 0;
+}
+
+
+/*=============================================================================
+ * ADDSEEDS() Adds a seed file, or every file in a seed directory.
+ *===========================================================================*/
+ushort addSeeds(char *name) {
+    DIR *dir;
+    struct dirent *entry;
+    struct stat info;
+    char fileName[MAXPATH + 1];
+
+    if (stat(name, &info) != 0) {
+        return 1;
+    }
+
+    if (!S_ISDIR(info.st_mode)) {
+        return addSeed(name);
+    }
+
+    dir = opendir(name);
+    if (!dir) {
+        return 1;
+    }
+
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] == '.') {
+            continue;
+        }
+
+        snprintf(fileName, sizeof(fileName), "%s/%s", name, entry->d_name);
+        if (addSeed(fileName) != 0) {
+            closedir(dir);
+            return 1;
+        }
+    }
+
+    closedir(dir);
+    return 0;
+}
+
+
+/*=============================================================================
+ * MUTATE() Makes from 1 to MAXMUTATIONS random changes to the bytes, and
+ * returns the new size. Some changes are random, others use bytes and words
+ * that mean something in a SAV file - token types, 0x8D00, 0x840A and sizes
+ * that are far too big - as those find bugs much faster.
+ *===========================================================================*/
+ulong mutate(uchar *bytes, ulong size) {
+    ushort changes = 1 + savRandomBelow(MAXMUTATIONS);
+    ushort word;
+    ulong at;
+    ulong length;
+
+    while (changes--) {
+        at = savRandomBelow(size);
+
+        switch (savRandomBelow(8)) {
+            case 0:
+                /* Flip a bit. */
+                if (size) {
+                    bytes[at] ^= (1 << savRandomBelow(8));
+                }
+                break;
+
+            case 1:
+                /* Any old byte. */
+                if (size) {
+                    bytes[at] = (uchar)savRandom();
+                }
+                break;
+
+            case 2:
+                /* A byte that means something. */
+                if (size) {
+                    bytes[at] = interesting[savRandomBelow(sizeof(interesting))];
+                }
+                break;
+
+            case 3:
+                /* A word that means something, or a silly size. */
+                if (size > 1) {
+                    at = savRandomBelow(size - 1);
+                    word = interestingWords[savRandomBelow(sizeof(interestingWords) / sizeof(ushort))];
+                    bytes[at] = word >> 8;
+                    bytes[at + 1] = word & 0xFF;
+                }
+                break;
+
+            case 4:
+                /* Cut it short. */
+                size = at;
+                break;
+
+            case 5:
+                /* Lose a few bytes from the middle. */
+                length = savRandomBelow(16) + 1;
+                if (at + length <= size) {
+                    memmove(bytes + at, bytes + at + length, size - at - length);
+                    size -= length;
+                }
+                break;
+
+            case 6:
+                /* Repeat a few bytes. */
+                length = savRandomBelow(16) + 1;
+                if (at + length <= size && size + length <= MAXFUZZSIZE) {
+                    memmove(bytes + at + length, bytes + at, size - at);
+                    size += length;
+                }
+                break;
+
+            case 7:
+                /* Swap a whole line, or whatever is there, with another. */
+                length = savRandomBelow(64) + 1;
+                word = savRandomBelow(size);
+                if (at + length <= size && word + length <= size &&
+                    size + length <= MAXFUZZSIZE) {
+                    memcpy(bytes + size, bytes + at, length);
+                    memmove(bytes + at, bytes + word, length);
+                    memcpy(bytes + word, bytes + size, length);
+                }
+                break;
+        }
+    }
+
+    return size;
+}
+
+
+/*=============================================================================
+ * RUNTARGET() Runs one decoder over the work file, in a child process, and
+ * waits for it. Returns 1 if it crashed, or didn't finish in time.
+ *===========================================================================*/
+ushort runTarget(fuzzTarget *target, ulong size, ulong iteration) {
+    pid_t child;
+    int status;
+    int null;
+    double start;
+    double took;
+    double allowed = (baseTime + size * FUZZ_BYTETIME) / 1000.0;
+
+    target->runs++;
+    fflush(stdout);
+    fflush(stderr);
+
+    start = elapsedTime();
+    child = fork();
+    if (child < 0) {
+        fprintf(stderr, "\n\nERROR: runTarget(): Cannot fork.\n");
+        return 1;
+    }
+
+    if (child == 0) {
+        /* We don't want to see all the error messages. */
+        null = open("/dev/null", O_WRONLY);
+        if (null >= 0) {
+            dup2(null, 1);
+            dup2(null, 2);
+            close(null);
+        }
+
+        if (chdir(FUZZ_WORKDIR) != 0) {
+            _exit(127);
+        }
+
+        if (target->function) {
+            _exit(target->function(FUZZ_INPUT));
+        }
+
+        execl(target->program, target->program, FUZZ_INPUT, (char *)NULL);
+        _exit(127);
+    }
+
+    /* Wait, but not for ever. */
+    while (waitpid(child, &status, WNOHANG) == 0) {
+        if (elapsedTime() - start > allowed) {
+            kill(child, SIGKILL);
+            waitpid(child, &status, 0);
+            target->failures++;
+            fprintf(stderr, "%s: Run %lu, %lu bytes, took more than %.3f seconds.\n", target->name, iteration, size, allowed);
+            return 1;
+        }
+
+        usleep(200);
+    }
+
+    took = elapsedTime() - start;
+    if (size && took * 1e6 / size > target->slowest) {
+        target->slowest = took * 1e6 / size;
+    }
+
+    if (WIFSIGNALED(status)) {
+        target->failures++;
+        fprintf(stderr, "%s: Run %lu, %lu bytes, killed by signal %d.\n", target->name, iteration, size, WTERMSIG(status));
+        return 1;
+    }
+
+    if (WEXITSTATUS(status) != 0) {
+        target->rejected++;
+    }
+
+    return 0;
+}
+
+
+/*=============================================================================
+ * WRITEINPUT() Writes the bytes to a file.
+ *===========================================================================*/
+ushort writeInput(char *fileName, uchar *bytes, ulong size) {
+    FILE *fp;
+    ushort result = 0;
+
+    fp = fopen(fileName, "wb");
+    if (!fp) {
+        return 1;
+    }
+
+    if (size && fwrite(bytes, 1, size, fp) != size) {
+        result = 1;
+    }
+
+    fclose(fp);
+    return result;
+}
+
+
+/*=============================================================================
+ * ELAPSEDTIME() Returns a time in seconds, from a clock that doesn't go
+ * backwards.
+ *===========================================================================*/
+double elapsedTime(void) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+
+/*=============================================================================
+ * FUZZSAVFILE() Decodes the whole file with the in memory decoder, every
+ * line and every token.
+ *===========================================================================*/
+ushort fuzzSavFile(char *fileName) {
+    savFile sav;
+    savLine line;
+    savToken token;
+    ushort result;
+    ulong pos;
+
+    savInitFile(&sav);
+    if (savReadFile(fileName, &sav) != SAV_OK) {
+        savFreeFile(&sav);
+        return 1;
+    }
+
+    pos = sav.programOffset;
+    while ((result = savNextLine(&sav, &pos, &line)) == SAV_OK) {
+        do {
+            if (savNextToken(&sav, &pos, &token) != SAV_OK) {
+                savFreeFile(&sav);
+                return 1;
+            }
+        } while (token.type != TYPE_SYMBOL || token.code != SYMBOL_EOL);
+    }
+
+    if (result == SAV_END) {
+        roundTrip(&sav);
+    }
+
+    savFreeFile(&sav);
+    return (result == SAV_END ? 0 : 1);
+}
+
+
+/*=============================================================================
+ * ROUNDTRIP() Decodes a file that read cleanly into a program, and encodes it
+ * again. The result must be the same file, except for line size changes,
+ * which are worked out afresh and may not have been right to begin with.
+ * Encoding that must give the same bytes again. Anything else aborts, so the
+ * input is kept as a failure.
+ *===========================================================================*/
+void roundTrip(savFile *sav) {
+    savProgram prog;
+    savFile again;
+    savBuffer first;
+    savBuffer second;
+    ulong x;
+    ulong y;
+
+    savInitProgram(&prog);
+    savInitBuffer(&first);
+    savInitBuffer(&second);
+    savInitFile(&again);
+
+    if (savDecodeProgram(sav, &prog) != SAV_OK ||
+        savEncodeProgram(&prog, &first) != SAV_OK ||
+        first.size != sav->size) {
+        abort();
+    }
+
+    /* Only the size change words may differ. */
+    for (x = 0, y = 0; x < first.size; x++) {
+        if (first.buffer[x] == sav->buffer[x]) {
+            continue;
+        }
+
+        while (y < prog.lineCount && prog.lines[y].offset + 1 < x) {
+            y++;
+        }
+
+        if (y == prog.lineCount || x < prog.lines[y].offset) {
+            abort();
+        }
+    }
+
+    /* Decode what we wrote, and write it again. */
+    again.buffer = first.buffer;
+    again.size = first.size;
+    if (savDecodeHeader(&again) != SAV_OK ||
+        savDecodeNameTable(&again) != SAV_OK ||
+        savDecodeProgram(&again, &prog) != SAV_OK ||
+        savEncodeProgram(&prog, &second) != SAV_OK ||
+        second.size != first.size ||
+        memcmp(first.buffer, second.buffer, first.size) != 0) {
+        abort();
+    }
+
+    /* The buffer is first's, don't free it twice. */
+    again.buffer = NULL;
+    savFreeFile(&again);
+    savFreeBuffer(&first);
+    savFreeBuffer(&second);
+    savFreeProgram(&prog);
+}
+
+
+/*=============================================================================
+ * FUZZLISTER() Lists the file with the Lister.
+ *===========================================================================*/
+ushort fuzzLister(char *fileName) {
+    ulong bytes;
+
+    return listerDecode(fileName, &bytes);
+}
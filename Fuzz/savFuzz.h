@@ -0,0 +1,66 @@
+#ifndef __SAVFUZZ_H__
+#define __SAVFUZZ_H__
+
+/*===========================================================================
+ * HEADERS
+ *===========================================================================*/
+#include "../SavFile/savFile.h"
+
+/*===========================================================================
+ * DEFINES
+ *===========================================================================*/
+#define MAXSEEDS 256                /* Most files in the seed corpus. */
+#define MAXFUZZSIZE 65536           /* Biggest seed, or mutated file. */
+#define MAXMUTATIONS 4              /* Most changes made to one seed. */
+#define FUZZ_BASETIME 1000          /* Milliseconds every run is allowed. */
+#define FUZZ_BYTETIME 0.01          /* Plus this many per byte of input. */
+#define FUZZ_WORKDIR "work"         /* Where the decoders are run. */
+#define FUZZ_FAILDIR "failures"     /* Where failing inputs are kept. */
+#define FUZZ_INPUT "fuzz_sav"       /* Name of the input, in FUZZ_WORKDIR. */
+
+/*===========================================================================
+ * TYPEDEFS
+ *===========================================================================*/
+
+/* A decoder that runs in the child process. Returns 0 if the file decoded,
+ * anything else if it was rejected. Either is fine, as long as it's quick. */
+typedef ushort (*FUZZFUNC)(char *fileName);
+
+/* One decoder to be fuzzed. In process ones have a function, the converter
+ * is run as a program, if we were told where it is. */
+typedef struct fuzzTarget {
+    char *name;
+    FUZZFUNC function;
+    char *program;
+    ulong runs;
+    ulong rejected;                 /* Exited non zero, an error message. */
+    ulong failures;                 /* Crashed, or took too long. */
+    double slowest;                 /* Worst microseconds per byte. */
+} fuzzTarget;
+
+/* One seed file, read once. */
+typedef struct fuzzSeed {
+    uchar *bytes;
+    ulong size;
+} fuzzSeed;
+
+/*===========================================================================
+ * FUNCTION PROTOTYPES
+ *===========================================================================*/
+ushort addSeed(char *fileName);
+ushort addSeeds(char *name);
+ulong  mutate(uchar *bytes, ulong size);
+ushort runTarget(fuzzTarget *target, ulong size, ulong iteration);
+ushort writeInput(char *fileName, uchar *bytes, ulong size);
+double elapsedTime(void);
+
+ushort fuzzSavFile(char *fileName);
+void   roundTrip(savFile *sav);
+ushort fuzzLister(char *fileName);
+
+/* In ../Bench/listerBench.c, which can't see savFile.h. */
+ushort listerDecode(char *fileName, ulong *bytes);
+
+/*===========================================================================*/
+
+#endif /* __SAVFUZZ_H__ */
@@ -11,43 +11,89 @@
  * August 24 2019. (Started!)
  *===========================================================================*/
 
-#include "c68port.h"
+#include <math.h>
+
+#include "savFileLister.h"
+#include "../Xref/xref.h"
+
+/*===========================================================================
+ * GLOBALS
+ *===========================================================================*/
+ushort quit = 0;
+ushort lastLineSize = 0;
+nameTableEntry *nameTable = NULL;
+ushort nameTableSize = 0;
+uchar *nameBytes = NULL;            /* Where the names go, in the arena. */
+ulong nameBytesLeft = 0;
+ushort currentLine = 0;
+ushort exportMode = 0;              /* -t, JSON lines instead of a listing. */
+ushort exportCount = 0;             /* Tokens so far on this line. */
+
 
 
 /*=============================================================================
  * MAIN() Start here. Expects the input file on argv[1] and writes the output
  * to stdout with messages and errors on stderr - might as well use them!
+ * With -x, or -j, a cross reference of the names is written to stdout, as
+ * text or JSON, after the listing.
+ * With -t, there's no listing file. Instead, each line is written to stdout
+ * as one JSON object, on a line of its own, with the line number and every
+ * token, typed, as it was in the file. Text is escaped as it's read, so
+ * this is no slower than listing. For example:
+ *
+ * {"line":10,"tokens":[{"t":"name","entry":3,"text":"x"},
+ *  {"t":"symbol","id":1,"text":"="},{"t":"float","kind":"decimal",
+ *  "value":1,"bytes":"f80140000000"}]}
+ *
+ * Keywords, symbols, operators, monadics and separators have the id that's
+ * in the file, names have their name table entry and strings their
+ * delimiter. The end of line symbol isn't a token, it ends the object.
+ * Compile with LISTER_NO_MAIN defined to link the Lister into something else,
+ * the benchmarks for example.
  *===========================================================================*/
+#ifndef LISTER_NO_MAIN
+
 int main (int argc, char *argv[]) {
 
     ushort nameTableEntries = 0;
+    ushort nameTableLength = 0;
     ushort programLines = 0;
+    char *fileName;
+    arena names;
     FILE *fp;
 
-    if (argc != 2) {
-        fprintf(stderr, "%s requires 1 argument, the SAV file name.\n", argv[0]);
+    if (argc == 3 && strcmp(argv[1], "-x") == 0) {
+        xrefMode = XREF_TEXT;
+    } else if (argc == 3 && strcmp(argv[1], "-j") == 0) {
+        xrefMode = XREF_JSON;
+    } else if (argc == 3 && strcmp(argv[1], "-t") == 0) {
+        exportMode = 1;
+    } else if (argc != 2) {
+        fprintf(stderr, "%s requires 1 argument, the SAV file name, optionally after -x, -j or -t.\n", argv[0]);
         return -1;
     }
 
+    fileName = argv[argc - 1];
+
     /* Can we open the SAV file? */
-    fp = fopen(argv[1], "rb");
+    fp = fopen(fileName, "rb");
     if (!fp) {
-        fprintf(stderr, "FATAL ERROR: main(): Cannot open SAV file '%s'.\n", argv[1]);
+        fprintf(stderr, "FATAL ERROR: main(): Cannot open SAV file '%s'.\n", fileName);
         return -1;
     }
 
-    fprintf(stderr, "SAV File..............: %s\n", argv[1]);
+    fprintf(stderr, "SAV File..............: %s\n", fileName);
 
     /* Can we read the header? */
-    if ((decodeHeader(fp, &nameTableEntries, &programLines)) != 0) {
+    if ((decodeHeader(fp, &nameTableEntries, &nameTableLength, &programLines)) != 0) {
         fprintf(stderr, "FATAL ERROR: decodeHeader() failed.\n");
         return -1;
     }
 
-    /* Allocate the name table. */
-    nameTable = malloc(nameTableEntries * sizeof(nameTableEntry));
-    if (!nameTable) {
-        fprintf(stderr, "FATAL ERROR: Cannot  allocate memory for name table. (%d entries).\n", nameTableEntries);
+    /* Allocate the name table, and its names, in one go. */
+    arenaInit(&names);
+    if (reserveNameTable(&names, fp, nameTableEntries, nameTableLength) != 0) {
+        fprintf(stderr, "FATAL ERROR: reserveNameTable() failed.\n");
         return -1;
     }
 
@@ -57,27 +103,40 @@ int main (int argc, char *argv[]) {
         return -1;
     }
 
+    /* Names are cross referenced as the program is decoded. */
+    if (xrefMode && xrefInit(nameTableEntries) != 0) {
+        fprintf(stderr, "FATAL ERROR: xrefInit() failed.\n");
+        return -1;
+    }
+
     /* Decode the program. */
-    if (decodeProgram(programLines, fp, argv[1]) != 0) {
+    if (decodeProgram(programLines, fp, fileName) != 0) {
         fprintf(stderr, "FATAL ERROR: decodeProgram() failed.\n");
         return -1;
     }
 
-    /* All done, exit with no errors. */
-    if (nameTable) {
-        free(nameTable);
+    if (xrefMode) {
+        xrefWrite(stdout, fileName, nameTable, nameTableEntries, xrefMode);
+        xrefFree();
     }
 
+    /* All done, exit with no errors. */
+    arenaFree(&names);
+    nameTable = NULL;
+
     fclose(fp);
 
     return 0;
 }
 
+#endif /* LISTER_NO_MAIN */
+
 /*=============================================================================
  * DECODEHEADER() Decodes the header of the _save file and makes sure it's
- * valid, otherwise we abort.
+ * valid, otherwise we abort. Returns the number of entries in the name table,
+ * its length, and the number of lines in the program.
  *===========================================================================*/
-ushort decodeHeader(FILE *fp, ushort *entries, ushort *lines) {
+ushort decodeHeader(FILE *fp, ushort *entries, ushort *length, ushort *lines) {
     uchar  head[4];
     ushort valid;
     ushort nameTableLength = 0;
@@ -132,19 +191,41 @@ ushort decodeHeader(FILE *fp, ushort *entries, ushort *lines) {
     fflush(stderr);
     
     *entries = nameTableEntries;
+    *length = nameTableLength;
     *lines = programLines;
 
     return 0;
 }
 
 
+/*=============================================================================
+ * RESERVENAMETABLE() Sizes the arena from the header, and carves the name
+ * table, and the bytes of the names, out of it. The header's name table
+ * length is one byte more than each name, so that's enough for the names,
+ * unless it's 65535, when the names could be longer. Then they can't be more
+ * than the rest of the file. An arena that's big enough already is used
+ * again, as is.
+ *===========================================================================*/
+ushort reserveNameTable(arena *a, FILE *fp, ushort entries, ushort length) {
+    ulong names = nameBytesSize(fp, entries, length);
+
+    if (arenaReserve(a, ARENA_SIZE(nameTableEntry, entries) + ARENA_SIZE(uchar, names)) != 0) {
+        return 1;
+    }
+
+    nameTable = arenaAlloc(a, ARENA_SIZE(nameTableEntry, entries));
+    nameBytes = arenaAlloc(a, ARENA_SIZE(uchar, names));
+    nameBytesLeft = names;
+    return (!nameTable || !nameBytes);
+}
+
+
 /*=============================================================================
  * DECODENAMETABLE() Builds the internal name table by reading the SAV file's
  * name table. 
  *===========================================================================*/
 ushort decodeNameTable(ushort entries, FILE *fp) {
     ushort x;
-    uchar ch;
     ushort size = 0;
     ushort procCount = 0;
     ushort fnCount[3] = {0,0,0};        /* FN$, FN, FN% counters */
@@ -154,6 +235,11 @@ ushort decodeNameTable(ushort entries, FILE *fp) {
         nameTable[x].nameType = getWord(fp);
         nameTable[x].lineNumber = getWord(fp);        
         nameTable[x].nameLength = getWord(fp);
+
+        if (feof(fp)) {
+            fprintf(stderr, "\n\nERROR: decodeNameTable(): Unexpected end of file in name table entry %d.\n", x);
+            return 1;
+        }
         
         /* Count up the details. */
         switch (nameTable[x].nameType) {
@@ -163,22 +249,28 @@ ushort decodeNameTable(ushort entries, FILE *fp) {
             case 0x1503: fnCount[nameTable[x].nameType - 0x1501]++; break;
         }
 
-        /* Do we need a recompile? */
-        if (nameTable[x].nameLength >= MAXNAMESIZE) {
-            size = MAXNAMESIZE - 1;
-            fread(nameTable[x].name, 1, size, fp);
-            fprintf(stderr, "\n\nWARNING: Cannot read a name with >= %d characters. Please amend the SAV file, or, recompile C68Port.\n", MAXNAMESIZE);
-            fprintf(stderr, "The offending name is '%*.*s'\n.", MAXNAMESIZE, MAXNAMESIZE, nameTable[x].name);
+        /* The header says how long the names are, all together. */
+        size = nameTable[x].nameLength;
+        if (size >= nameBytesLeft) {
+            fprintf(stderr, "\n\nERROR: decodeNameTable(): Name table entry %d is past the name table length in the header.\n", x);
             return 1;
         }
-    
-        fread(nameTable[x].name, 1, nameTable[x].nameLength, fp);
+
+        nameTable[x].name = nameBytes;
+        nameBytes += size + 1;
+        nameBytesLeft -= size + 1;
+
+        fread(nameTable[x].name, 1, size, fp);
+        nameTable[x].name[size] = '\0';
 
         /* Odd length names are padded. */
         if (nameTable[x].nameLength & 1)
-            ch = fgetc(fp);
+            fgetc(fp);
     }
 
+    /* Names in the program are checked against this. */
+    nameTableSize = entries;
+
     fprintf(stderr, "\nNAME TABLE\n==========\n");
 
     fprintf(stderr, "\nNumber of Procedures..: %4d", procCount);
@@ -208,8 +300,9 @@ ushort decodeNameTable(ushort entries, FILE *fp) {
  *===========================================================================*/
 ushort decodeProgram(ushort lines, FILE *fp, char *fileName) {
     ushort x;
+    int    ch;
+    ushort error;
     uchar  typeByte;
-    ushort programLine;
     ushort lineSize = 0;
     ushort flag;
     ulong offset;
@@ -224,69 +317,105 @@ ushort decodeProgram(ushort lines, FILE *fp, char *fileName) {
      * ushort - line number;
      * bytes - rest of the line.
 
+    /* Exporting? That goes to stdout, there's no listing file. */
+    if (exportMode) {
+        listingFile = stdout;
+    } else {
+        listingFile = NULL;
+    }
+
     /* Open a listing file, replace SAV with LST. */
-    if (strlen(fileName) > 39) {
+    if (!listingFile && strlen(fileName) > 39) {
         fprintf(stderr, "\n\nERROR: decodeProgram(): Cannot create listing file, filename too long.\n");
         return 1;
     }
-    strncpy(logFile, fileName, 39);
-    logFile[strlen(fileName) > 39 ? 39 : strlen(fileName)] = '\0';
+    if (!listingFile) {
+        strncpy(logFile, fileName, 39);
+        logFile[strlen(fileName) > 39 ? 39 : strlen(fileName)] = '\0';
 
-    // Change the extension, from SAV to LST */
-    if (logFile[strlen(logFile) - 4] == '_' || logFile[strlen(logFile) - 4] == '.') {
-        strcpy(&logFile[strlen(logFile) - 3], "LST");
-    } else {
+        // Change the extension, from SAV to LST */
+        if (logFile[strlen(logFile) - 4] == '_' || logFile[strlen(logFile) - 4] == '.') {
+            strcpy(&logFile[strlen(logFile) - 3], "LST");
+        } else {
         
+        }
+
+        listingFile = fopen(logFile, "w");
     }
 
-    listingFile = fopen(logFile, "w");
     if (!listingFile) {
         fprintf(stderr, "\n\nERROR: decodeProgram(): Cannot open listing file, 'c68port.lst'.\n");
         return 1;
     }
 
+    /*
+     * Every pass through the loops below reads at least one byte, or stops
+     * at the end of the file, so even a corrupt file is decoded in time
+     * proportional to its size.
+     */
     for (x = 0; x < lines; x++) {
         lineSize += getWord(fp);
 
-        if ((flag = getWord(fp)) != TYPE_LINENUMBER) {
+        if ((flag = getWord(fp)) != TYPE_LINENUMBER || feof(fp)) {
             fprintf(stderr, "\n\nERROR: decodeProgram(): Program out of step at offset %ld ($%08lx).\n", ftell(fp), ftell(fp));
             fprintf(stderr, "Expected 0x8D00, found %xd.\n", flag);
-            fclose(listingFile);
+            closeListing(listingFile);
             return 1;
         }
 
-        /* Line number */
-        fprintf(listingFile, "%d ", getWord(fp));
+        /* Line number, which the cross reference needs too. */
+        currentLine = getWord(fp);
+        if (exportMode) {
+            fprintf(listingFile, "{\"line\":%d,\"tokens\":[", currentLine);
+            exportCount = 0;
+        } else {
+            fprintf(listingFile, "%d ", currentLine);
+        }
 
         /* Line contents */
         while (1) {
-            /* Type Byte */
-            typeByte = fgetc(fp);
+            /* Type Byte. The end of the file is not a float! */
+            if ((ch = fgetc(fp)) == EOF) {
+                offset = ftell(fp);
+                fprintf(stderr, "\n\nERROR: decodeProgram(): At offset %ld ($%08lx), unexpected end of file.", offset, offset);
+                closeListing(listingFile);
+                return 1;
+            }
+
+            typeByte = ch;
             endOfLine = 0;
             switch(typeByte) {
-                case TYPE_MULTISPACE: doMultiSpaces(fp, listingFile); break;
-                case TYPE_KEYWORD:    doKeywords(fp, listingFile); break;
-                case TYPE_SYMBOL:     endOfLine = doSymbols(fp, listingFile); break;
-                case TYPE_OPERATOR:   doOperators(fp, listingFile); break;
-                case TYPE_MONADIC:    doMonadics(fp, listingFile); break;
-                case TYPE_NAME:       doNames(fp, listingFile); break;
-                case TYPE_STRING:     doStrings(fp, listingFile); break;
-                case TYPE_TEXT:       doText(fp, listingFile); break;
-                case TYPE_SEPARATOR:  doSeparators(fp, listingFile); break;
+                case TYPE_MULTISPACE: error = doMultiSpaces(fp, listingFile); break;
+                case TYPE_KEYWORD:    error = doKeywords(fp, listingFile); break;
+                case TYPE_SYMBOL:     error = doSymbols(fp, listingFile, &endOfLine); break;
+                case TYPE_OPERATOR:   error = doOperators(fp, listingFile); break;
+                case TYPE_MONADIC:    error = doMonadics(fp, listingFile); break;
+                case TYPE_NAME:       error = doNames(fp, listingFile); break;
+                case TYPE_STRING:     error = doStrings(fp, listingFile); break;
+                case TYPE_TEXT:       error = doText(fp, listingFile); break;
+                case TYPE_SEPARATOR:  error = doSeparators(fp, listingFile); break;
 
                 /* Floats come in three formats, each with 16 leading bytes! */
-                case TYPE_FP_BIN_MIN ... TYPE_FP_BIN_MIN:   
+                case TYPE_FP_BIN_MIN ... TYPE_FP_BIN_MAX:   
                 case TYPE_FP_HEX_MIN ... TYPE_FP_HEX_MAX:
                 case TYPE_FP_DEC_MIN ... TYPE_FP_DEC_MAX:   
-                                      doFloatingPoint(fp, listingFile, typeByte); break;
+                                      error = doFloatingPoint(fp, listingFile, typeByte); break;
 
                 default: 
                     offset = ftell(fp);
                     fprintf(stderr, "\n\nERROR: decodeProgram(): At offset %ld ($%08lx), read byte %d (%c). Out of sync.", offset, offset, typeByte, (typeByte > 31 ? typeByte : '.'));
-                    fclose(listingFile);
+                    closeListing(listingFile);
                     return 1;
             }
 
+            /* Bad table index, or the token ran off the end of the file. */
+            if (error) {
+                offset = ftell(fp);
+                fprintf(stderr, "\n\nERROR: decodeProgram(): At offset %ld ($%08lx), invalid token $%02X.", offset, offset, typeByte);
+                closeListing(listingFile);
+                return 1;
+            }
+
             /* Exit the while loop when we print an end of line character. */
             if (endOfLine) {
                 fflush(listingFile);
@@ -295,16 +424,23 @@ ushort decodeProgram(ushort lines, FILE *fp, char *fileName) {
         }
     }
 
+    closeListing(listingFile);
     return 0;
 }
 
-void doMultiSpaces(FILE *fp, FILE *listing){
+ushort doMultiSpaces(FILE *fp, FILE *listing){
     /* 0x80.nn = Print nn spaces */
     uchar nn = fgetc(fp);
-    fprintf(listing, "%*.*s", nn, nn, " ");
+    if (exportMode) {
+        exportStart(listing, "space");
+        fprintf(listing, ",\"n\":%d}", nn);
+    } else {
+        fprintf(listing, "%*.*s", nn, nn, " ");
+    }
+    return feof(fp) != 0;
 }
 
-void doKeywords(FILE *fp, FILE *listing){
+ushort doKeywords(FILE *fp, FILE *listing){
     /* 0x81.nn = Print keywords[nn] */
 
     static char *keywords[] = {
@@ -316,25 +452,52 @@ void doKeywords(FILE *fp, FILE *listing){
     };
     
     uchar nn = fgetc(fp) -1;
+    if (nn >= sizeof(keywords) / sizeof(keywords[0]))
+        return 1;
+
+    if (exportMode) {
+        exportStart(listing, "keyword");
+        fprintf(listing, ",\"id\":%d,\"text\":", nn + 1);
+        exportText(listing, keywords[nn]);
+        fputc('}', listing);
+        return 0;
+    }
+
     fprintf(listing, "%s ", keywords[nn]);
+    return 0;
 }
 
 
-uchar doSymbols(FILE *fp, FILE *listing){
+ushort doSymbols(FILE *fp, FILE *listing, uchar *endOfLine){
     /* 0x84.nn = Print symbols[nn] */
 
     static char *symbols = "=:#,(){} \n";
 
     uchar nn = fgetc(fp) -1;
+    char text[2] = {0, 0};
+
+    if (nn >= strlen(symbols))
+        return 1;
 
-    fprintf(listing, "%c", symbols[nn]);
+    /* Set endOfLine to 1 for end of line. 0 otherwise. */
+    *endOfLine = (nn == 0x09); 
 
-    /* Return 1 for end of line. 0 otherwise. */
-    return (nn == 0x09); 
+    if (!exportMode) {
+        fprintf(listing, "%c", symbols[nn]);
+    } else if (*endOfLine) {
+        fprintf(listing, "]}\n");
+    } else {
+        text[0] = symbols[nn];
+        exportStart(listing, "symbol");
+        fprintf(listing, ",\"id\":%d,\"text\":", nn + 1);
+        exportText(listing, text);
+        fputc('}', listing);
+    }
+    return 0;
 }
 
 
-void doOperators(FILE *fp, FILE *listing){
+ushort doOperators(FILE *fp, FILE *listing){
     /* 0x85.nn = Print operators[nn] */
 
     static char *operators[] = {
@@ -344,11 +507,23 @@ void doOperators(FILE *fp, FILE *listing){
     };
 
     uchar nn = fgetc(fp) -1;
+    if (nn >= sizeof(operators) / sizeof(operators[0]))
+        return 1;
+
+    if (exportMode) {
+        exportStart(listing, "operator");
+        fprintf(listing, ",\"id\":%d,\"text\":", nn + 1);
+        exportText(listing, operators[nn]);
+        fputc('}', listing);
+        return 0;
+    }
+
     fprintf(listing, "%s", operators[nn]);
+    return 0;
 }
 
 
-void doMonadics(FILE *fp, FILE *listing){
+ushort doMonadics(FILE *fp, FILE *listing){
     /* 0x86.nn = Print monadics[nn] */
 
     static char *monadics[] = {
@@ -356,23 +531,66 @@ void doMonadics(FILE *fp, FILE *listing){
     };
 
     uchar nn = fgetc(fp) -1;
+    if (nn >= sizeof(monadics) / sizeof(monadics[0]))
+        return 1;
+
+    if (exportMode) {
+        exportStart(listing, "monadic");
+        fprintf(listing, ",\"id\":%d,\"text\":", nn + 1);
+        exportText(listing, monadics[nn]);
+        fputc('}', listing);
+        return 0;
+    }
+
     fprintf(listing, "%s", monadics[nn]);
+    return 0;
 }
 
 
-void doNames(FILE *fp, FILE *listing){
+ushort doNames(FILE *fp, FILE *listing){
     /* 0x8800 = Print name[nn] */
-    uchar nn = fgetc(fp);   /* ignore */
+    fgetc(fp);              /* ignore */
     ushort entry = getWord(fp);
+    if (entry >= nameTableSize)
+        return 1;
+
+    if (xrefMode && xrefUse(entry, currentLine) != 0)
+        return 1;
+
+    if (exportMode) {
+        exportStart(listing, "name");
+        fprintf(listing, ",\"entry\":%d,\"text\":", entry);
+        xrefJsonString(listing, nameTable[entry].name, nameTable[entry].nameLength);
+        fputc('}', listing);
+        return 0;
+    }
+
     fprintf(listing, "%*.*s", nameTable[entry].nameLength, nameTable[entry].nameLength, nameTable[entry].name);
+    return 0;
 }
 
 
-void doStrings(FILE *fp, FILE *listing){
+ushort doStrings(FILE *fp, FILE *listing){
     /* 0x8B.delim.size.bytes.[padding] = Print delimited string */
     uchar delim = fgetc(fp);    /* Delimiter */
     ushort size = getWord(fp);  /* String length */
     ushort x;
+    char text[2] = {0, 0};
+
+    if (exportMode) {
+        text[0] = delim;
+        exportStart(listing, "string");
+        fprintf(listing, ",\"delim\":");
+        exportText(listing, text);
+        fprintf(listing, ",\"text\":");
+        exportBytes(listing, fp, size);
+        fputc('}', listing);
+
+        if (size & 1)
+            fgetc(fp);          /* Padding */
+
+        return feof(fp) != 0;
+    }
 
     fputc(delim, listing);
     for (x = 0; x < size; x++) {
@@ -383,26 +601,37 @@ void doStrings(FILE *fp, FILE *listing){
 
     if (size & 1)
         fgetc(fp);              /* Padding */
+
+    return feof(fp) != 0;
 }
 
 
-void doText(FILE *fp, FILE *listing){
+ushort doText(FILE *fp, FILE *listing){
     /* 0x8C00.size.bytes = Print undelimited text
     */
-    uchar ignore = fgetc(fp);    /* 00 byte */
+    fgetc(fp);                  /* 00 byte */
     ushort size = getWord(fp);  /* String length */
     ushort x;
 
-    for (x = 0; x < size; x++) {
-        fputc(fgetc(fp), listing);
+    if (exportMode) {
+        exportStart(listing, "text");
+        fprintf(listing, ",\"text\":");
+        exportBytes(listing, fp, size);
+        fputc('}', listing);
+    } else {
+        for (x = 0; x < size; x++) {
+            fputc(fgetc(fp), listing);
+        }
     }
 
     if (size & 1)
         fgetc(fp);              /* Padding */
+
+    return feof(fp) != 0;
 }
 
 
-void doSeparators(FILE *fp, FILE *listing){
+ushort doSeparators(FILE *fp, FILE *listing){
     /* 0x8E.nn = Print separators[nn] */
 
     static char *separators[] = {
@@ -410,11 +639,23 @@ void doSeparators(FILE *fp, FILE *listing){
     };
 
     uchar nn = fgetc(fp) -1;
+    if (nn >= sizeof(separators) / sizeof(separators[0]))
+        return 1;
+
+    if (exportMode) {
+        exportStart(listing, "separator");
+        fprintf(listing, ",\"id\":%d,\"text\":", nn + 1);
+        exportText(listing, separators[nn]);
+        fputc('}', listing);
+        return 0;
+    }
+
     fprintf(listing, "%s", separators[nn]);
+    return 0;
 }
 
 
-void doFloatingPoint(FILE *fp, FILE *listing, uchar leading){
+ushort doFloatingPoint(FILE *fp, FILE *listing, uchar leading){
     /* Floating points come in three variations:
      * 0xDn = % Binary
      * 0xEn = $ Hexadecimal
@@ -422,7 +663,6 @@ void doFloatingPoint(FILE *fp, FILE *listing, uchar leading){
      *
      * Each one is followed by 5 bytes.
      */
-    ushort x;
     uchar fpType = ((leading & 0xF0) >> 4) - 13;
     char fpPrefix = (fpType == 0 ? '%' : fpType == 1 ? '$' : ' ');
 
@@ -432,6 +672,11 @@ void doFloatingPoint(FILE *fp, FILE *listing, uchar leading){
         ushort sh[3];
     } fpVariable;
 
+    /* The bytes, as they are, and their value. */
+    if (exportMode) {
+        return exportFloat(fp, listing, leading);
+    }
+
     /* Print the Float prefix character, if necessary. */
     if (fpType == 0 || fpType == 1) {
         fprintf(listing, "%c", fpPrefix);
@@ -457,9 +702,114 @@ void doFloatingPoint(FILE *fp, FILE *listing, uchar leading){
 
 #endif     
 
+    return feof(fp) != 0;
+}
+
+
+
+
+/*=============================================================================
+ * EXPORTSTART() Starts a token's JSON object, after a comma if it's not the
+ * first on the line.
+ *===========================================================================*/
+void exportStart(FILE *out, char *type) {
+    fprintf(out, "%s{\"t\":\"%s\"", (exportCount++ ? "," : ""), type);
+}
+
+
+/*=============================================================================
+ * EXPORTTEXT() Writes a C string, from one of the tables, as a JSON string.
+ *===========================================================================*/
+void exportText(FILE *out, char *text) {
+    xrefJsonString(out, (uchar *)text, strlen(text));
 }
 
 
+/*=============================================================================
+ * EXPORTBYTES() Writes the next size bytes of the file as a JSON string,
+ * escaping each one as it's read, so there's nothing to copy.
+ *===========================================================================*/
+void exportBytes(FILE *out, FILE *fp, ushort size) {
+    ushort x;
+    int ch;
+
+    fputc('"', out);
+    for (x = 0; x < size; x++) {
+        if ((ch = fgetc(fp)) == EOF) {
+            break;
+        }
+
+        if (ch == '"' || ch == '\\') {
+            fputc('\\', out);
+            fputc(ch, out);
+        } else if (ch < 32 || ch > 126) {
+            fprintf(out, "\\u%04x", ch);
+        } else {
+            fputc(ch, out);
+        }
+    }
+
+    fputc('"', out);
+}
+
+
+/*=============================================================================
+ * EXPORTFLOAT() Writes a float's kind, its value and its 6 bytes, as they
+ * are in the file, so nothing is lost. The value is null if it's too big for
+ * a double.
+ *===========================================================================*/
+ushort exportFloat(FILE *fp, FILE *out, uchar leading) {
+    static char *kinds[] = {"binary", "hex", "decimal"};
+    uchar bytes[6];
+    int exponent;
+    ulong mantissa;
+    double value;
+    ushort x;
+
+    bytes[0] = leading;
+    if (fread(bytes + 1, 1, 5, fp) != 5) {
+        return 1;
+    }
+
+    exponent = ((bytes[0] & 0x0F) << 8) | bytes[1];
+    mantissa = ((ulong)bytes[2] << 24) | ((ulong)bytes[3] << 16) |
+               ((ulong)bytes[4] << 8) | (ulong)bytes[5];
+
+    if (mantissa & 0x80000000UL) {
+        value = -(double)((~mantissa + 1) & 0xFFFFFFFFUL);
+    } else {
+        value = (double)mantissa;
+    }
+    value = ldexp(value, exponent - 0x800 - 31);
+
+    exportStart(out, "float");
+    fprintf(out, ",\"kind\":\"%s\",\"value\":", kinds[((leading & 0xF0) >> 4) - 13]);
+    if (isfinite(value)) {
+        fprintf(out, "%.15g", value);
+    } else {
+        fprintf(out, "null");
+    }
+
+    fprintf(out, ",\"bytes\":\"");
+    for (x = 0; x < 6; x++) {
+        fprintf(out, "%02x", bytes[x]);
+    }
+    fprintf(out, "\"}");
+
+    return 0;
+}
+
+
+/*=============================================================================
+ * CLOSELISTING() Closes the listing file, unless it's stdout.
+ *===========================================================================*/
+void closeListing(FILE *listing) {
+    if (listing == stdout) {
+        fflush(stdout);
+    } else {
+        fclose(listing);
+    }
+}
 
 
 /*=============================================================================
@@ -11,7 +11,7 @@
 /*===========================================================================*/
 /* DEFINES */
 /*===========================================================================*/
-#define MAXNAMESIZE 32              /* Max allowed name size in name table. */
+#define MAXNAMESIZE 32              /* Longest name used for C names. */
 #define QLFP_BINARY 0               /* Binary float, A = %01011. */
 #define QLFP_HEXADECIMAL 1          /* Hexadecimal float, A = $12AB. */
 #define QLFP_DECIMAL 2              /* Decimal float, A = 1234. */
@@ -48,29 +48,42 @@ typedef struct {
     ushort nameType;                /* Name type. */
     short  lineNumber;              /* Line number of definition. */
     ushort nameLength;              /* Length of actual name. */
-    uchar name[MAXNAMESIZE];        /* Bytes of name. */
+    uchar  *name;                   /* Bytes of name, in the arena. */
 } nameTableEntry;
 
+/* Needs the types above. */
+#include "../Arena/arena.h"
+
 /*===========================================================================*/
  /* FUNCTION PROTOTYPES */
 /*===========================================================================*/
- ushort decodeHeader(FILE *fp, ushort *entries, ushort *lines);
+ ushort decodeHeader(FILE *fp, ushort *entries, ushort *length, ushort *lines);
+ ushort reserveNameTable(arena *a, FILE *fp, ushort entries, ushort length);
  ushort decodeNameTable(ushort entries, FILE *fp);
  ushort decodeProgram(ushort lines, FILE *fp, char *fileName);
 
-void doMultiSpaces(FILE *fp, FILE *listing);
-void doKeywords(FILE *fp, FILE *listing);
-uchar doSymbols(FILE *fp, FILE *listing);
-void doOperators(FILE *fp, FILE *listing);
-void doMonadics(FILE *fp, FILE *listing);
-void doNames(FILE *fp, FILE *listing);
-void doStrings(FILE *fp, FILE *listing);
-void doText(FILE *fp, FILE *listing);
-void doSeparators(FILE *fp, FILE *listing);
-void doFloatingPoint(FILE *fp, FILE *listing, uchar leading);
+/* The do*() functions return 1 for a bad table index or a token that runs
+ * off the end of the file, 0 otherwise. */
+ushort doMultiSpaces(FILE *fp, FILE *listing);
+ushort doKeywords(FILE *fp, FILE *listing);
+ushort doSymbols(FILE *fp, FILE *listing, uchar *endOfLine);
+ushort doOperators(FILE *fp, FILE *listing);
+ushort doMonadics(FILE *fp, FILE *listing);
+ushort doNames(FILE *fp, FILE *listing);
+ushort doStrings(FILE *fp, FILE *listing);
+ushort doText(FILE *fp, FILE *listing);
+ushort doSeparators(FILE *fp, FILE *listing);
+ushort doFloatingPoint(FILE *fp, FILE *listing, uchar leading);
 
 short getWord(FILE *fp);
 
+/* JSON lines export, -t. */
+void exportStart(FILE *out, char *type);
+void exportText(FILE *out, char *text);
+void exportBytes(FILE *out, FILE *fp, ushort size);
+ushort exportFloat(FILE *fp, FILE *out, uchar leading);
+void closeListing(FILE *listing);
+
 #ifndef QDOS
 
 #pragma pack(push, 1)
@@ -90,9 +103,12 @@ ulong swapLong(ulong value);
 /*===========================================================================*/
 /* GLOBALS */
 /*===========================================================================*/
-ushort quit = 0;
-ushort lastLineSize = 0;
-nameTableEntry *nameTable = NULL;
+extern ushort quit;
+extern ushort lastLineSize;
+extern nameTableEntry *nameTable;
+extern ushort nameTableSize;
+extern ushort currentLine;
+extern ushort exportMode;
 
 /*===========================================================================*/
 
@@ -52,6 +52,12 @@ static short max_sblocal_type = sizeof(sblocal_types)/sizeof(sblocal_types[0]) -
 /* Calculate the offset into an array of 'n' dimensions. */
 static int getArrayOffset(SBLOCAL variable, va_list args);
 
+/* Search the scopes, most recent first, for a LOCal. */
+static SBLOCAL searchSBLocalVariable(char *variableName);
+
+/* Find a LOCal that must be of a given type, or NULL if no scope has it. */
+static SBLOCAL searchSBLocalVariableType(char *variableName, short variableType, char *caller);
+
 /*===================================================================PRIVATE */
 
 /* The stack used for LOCal scopes. As a new PROCedure or FuNction is
@@ -114,23 +120,18 @@ SBLOCAL peekSBLocalScopeLevel(unsigned short level) {
 }
 
 
-/* Return a pointer to the most recent scope for a particular
- * local variable. Scans backwards through the nested scopes
- * until we find it, or not. */
-SBLOCAL findSBLocalVariableByName(char *variableName) {
+/* Search the scopes, most recent first, for a particular local
+ * variable. Returns NULL if none of them have it. */
+static SBLOCAL searchSBLocalVariable(char *variableName) {
     SBLOCAL thisScope;
     SBLOCAL thisRoot;
     short tempSP = stackPointer -1;    /* Current Scope pointer; */
 
-    /* Loop through all the scopes in reverse order. */
-    while (tempSP >= 0) {
+    /* Loop through all the scopes in reverse order. A scope with no
+     * LOCals yet has nothing after its root. */
+    for (; tempSP >= 0; tempSP--) {
         thisRoot = SBLocalStack[tempSP];
-        /* Does this scope have any LOCals defined yet> */
-        if (!thisRoot->next) {
-            continue;
-        }
 
-        /* We must have some LOCals then. */
         thisScope = thisRoot->next;
         while (thisScope) {
             /* Walk the variable list. */
@@ -142,18 +143,69 @@ SBLOCAL findSBLocalVariableByName(char *variableName) {
             /* Point at the next variable. */
             thisScope = thisScope->next;
         }
-
-        /* Not found in this scope? Try the previous one. */
-        tempSP--;
     }
 
-    /* We did not find it. */
-    fprintf(stderr, "findSBLocalVariable(): Variable '%s' not found.\n", variableName);
-    exit (ERR_NF);
     return NULL;
 }
 
 
+/* Find a LOCal of a given type. It's an error if it has another type, but
+ * not if no scope has it, that's NULL. */
+static SBLOCAL searchSBLocalVariableType(char *variableName, short variableType, char *caller) {
+    SBLOCAL variable = searchSBLocalVariable(variableName);
+
+    if (variable && variable->variable.variableType != variableType) {
+        fprintf(stderr, "%s(): Incompatible variable types.\n", caller);
+        fprintf(stderr, "\tExpected: %s. Found: %s.\n", sblocal_types[variableType],
+                        sblocal_types[variable->variable.variableType]);
+        exit (ERR_BP);
+    }
+
+    return variable;
+}
+
+
+/* Return a pointer to the most recent scope for a particular
+ * local variable. Scans backwards through the nested scopes
+ * until we find it, or not. */
+SBLOCAL findSBLocalVariableByName(char *variableName) {
+    SBLOCAL variable = searchSBLocalVariable(variableName);
+
+    if (!variable) {
+        fprintf(stderr, "findSBLocalVariable(): Variable '%s' not found.\n", variableName);
+        exit (ERR_NF);
+    }
+
+    return variable;
+}
+
+
+/* The address of a LOCal's value, in the most recent scope that has it,
+ * or global, the variable that a LOCal of that name would hide, if none of
+ * them do. The address stays good until the scope ends. */
+SB_FLOAT *addressSBLocalVariable(char *variableName, SB_FLOAT *global) {
+    SBLOCAL variable = searchSBLocalVariableType(variableName, SBLOCAL_FLOAT, "addressSBLocalVariable");
+
+    return (variable ? &variable->variable.variableValue.floatValue : global);
+}
+
+
+SB_INTEGER *addressSBLocalVariable_i(char *variableName, SB_INTEGER *global) {
+    SBLOCAL variable = searchSBLocalVariableType(variableName, SBLOCAL_INTEGER, "addressSBLocalVariable_i");
+
+    return (variable ? &variable->variable.variableValue.integerValue : global);
+}
+
+
+/* A string's address is that of its pointer, which must be NULL, or from
+ * malloc(), so that deleteNode() can free it. */
+SB_CHAR **addressSBLocalVariable_s(char *variableName, SB_CHAR **global) {
+    SBLOCAL variable = searchSBLocalVariableType(variableName, SBLOCAL_STRING, "addressSBLocalVariable_s");
+
+    return (variable ? (SB_CHAR **)&variable->variable.variableValue.arrayValue : global);
+}
+
+
 /* Internal helper routines to create nodes. Returns the node's address
  * or NULL if we are out of memory. */
 static SBLOCAL createNode() {
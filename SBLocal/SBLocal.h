@@ -131,6 +131,12 @@ SBLOCAL peekSBLocalScopeLevel(unsigned short level);
  * local variable. */
 SBLOCAL findSBLocalVariableByName(char *variableName);
 
+/* Return the address of a LOCal's value, from the most recent scope
+ * that has it, or global, the variable it hides, if none do. */
+SB_FLOAT *addressSBLocalVariable(char *variableName, SB_FLOAT *global);
+SB_INTEGER *addressSBLocalVariable_i(char *variableName, SB_INTEGER *global);
+SB_CHAR **addressSBLocalVariable_s(char *variableName, SB_CHAR **global);
+
 /* Return an integer description of a LOCal variable type */
 short getSBLocalVariableType(SBLOCAL variable);
 
@@ -0,0 +1,536 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "SBRuntime.h"
+
+/* This file has the helpers that converted programs need, to do the things
+ * that SuperBASIC does in its expressions, and C doesn't.
+ *
+ * Temporary strings come from a ring of buffers, each grown as needed and
+ * never freed, so an expression like a$ & b$ & c$ doesn't leak. The
+ * converter only ever nests temporaries as deeply as the expression does,
+ * and the result of the whole expression is copied by sbAssign(). There's
+ * a ring for each FuNction that's been called and not returned, so a
+ * recursive FuNction can't wrap its caller's ring. The rings are kept in
+ * one array, which grows with the deepest call. A ring has SB_TEMP_STRINGS
+ * buffers, or more if a statement has asked for them with sbTempRing(), and
+ * keeps them for the next call at that depth. Each ring has its own slots
+ * for arguments passed by reference too, so a FuNction can't reuse the ones
+ * its caller passed it. The slots are allocated apart from the rings, as
+ * the callee may grow the array of rings while it has pointers to them.
+ */
+
+
+/*=================================================================== PRIVATE */
+
+/* A string variable that was never set is NULL, and empty. */
+#define SB_UNSET(text) ((text) ? (text) : "")
+
+typedef struct TEMP_REFS {
+    SB_FLOAT floats[SB_TEMP_REFS];
+    SB_INTEGER integers[SB_TEMP_REFS];
+    SB_CHAR *strings[SB_TEMP_REFS];
+} TEMP_REFS;
+
+typedef struct TEMP_RING {
+    SB_CHAR **strings;
+    unsigned short *sizes;
+    unsigned short count;           /* Buffers in the ring, 0 until used. */
+    unsigned short next;            /* The one to use next. */
+    TEMP_REFS *refs;                /* Reference slots, NULL until used. */
+    unsigned short nextRef;         /* The slot to use next. */
+} TEMP_RING;
+
+static TEMP_RING *tempRings = NULL;
+static unsigned long tempRingCount = 0;
+static unsigned long tempRing = 0;
+
+/* Make room for the ring of the FuNction that's being called. */
+static void tempGrow(void) {
+    unsigned long rings = (tempRingCount ? tempRingCount * 2 : 4);
+    TEMP_RING *temp = realloc(tempRings, rings * sizeof(TEMP_RING));
+
+    if (!temp) {
+        fprintf(stderr, "sbRuntime: Out of memory for %lu FuNction calls.\n", rings);
+        exit(1);
+    }
+
+    memset(temp + tempRingCount, 0, (rings - tempRingCount) * sizeof(TEMP_RING));
+    tempRings = temp;
+    tempRingCount = rings;
+}
+
+
+/* Give the current ring at least count buffers. New ones are empty, and
+ * grown as they are used. */
+static void tempRingSize(unsigned short count) {
+    TEMP_RING *ring;
+    SB_CHAR **strings;
+    unsigned short *sizes;
+
+    if (tempRing >= tempRingCount) {
+        tempGrow();
+    }
+
+    ring = tempRings + tempRing;
+    if (ring->count >= count) {
+        return;
+    }
+
+    strings = realloc(ring->strings, count * sizeof(SB_CHAR *));
+    if (strings) {
+        ring->strings = strings;
+    }
+    sizes = realloc(ring->sizes, count * sizeof(unsigned short));
+    if (sizes) {
+        ring->sizes = sizes;
+    }
+    if (!strings || !sizes) {
+        fprintf(stderr, "sbRuntime: Out of memory for %d temporary strings.\n", count);
+        exit(1);
+    }
+
+    memset(ring->strings + ring->count, 0, (count - ring->count) * sizeof(SB_CHAR *));
+    memset(ring->sizes + ring->count, 0, (count - ring->count) * sizeof(unsigned short));
+    ring->count = count;
+}
+
+
+/* Return the next temporary string, from the current ring, with room for
+ * size characters. */
+static SB_CHAR *tempString(unsigned short size) {
+    TEMP_RING *ring;
+    SB_CHAR *temp;
+    unsigned short x;
+
+    tempRingSize(SB_TEMP_STRINGS);
+    ring = tempRings + tempRing;
+
+    x = ring->next;
+    ring->next = (ring->next + 1) % ring->count;
+
+    if (ring->sizes[x] < size + 1) {
+        temp = realloc(ring->strings[x], size + 1);
+        if (!temp) {
+            fprintf(stderr, "sbRuntime: Out of memory for a %d character string.\n", size);
+            exit(1);
+        }
+        ring->strings[x] = temp;
+        ring->sizes[x] = size + 1;
+    }
+
+    ring->strings[x][0] = '\0';
+    return ring->strings[x];
+}
+
+
+/* Return the current ring's reference slots, and in x the next one to
+ * use for an argument passed by reference. */
+static TEMP_REFS *tempRef(unsigned short *x) {
+    TEMP_RING *ring;
+
+    if (tempRing >= tempRingCount) {
+        tempGrow();
+    }
+
+    ring = tempRings + tempRing;
+    if (!ring->refs) {
+        ring->refs = calloc(1, sizeof(TEMP_REFS));
+        if (!ring->refs) {
+            fprintf(stderr, "sbRuntime: Out of memory for %d reference arguments.\n", SB_TEMP_REFS);
+            exit(1);
+        }
+    }
+
+    *x = ring->nextRef;
+    ring->nextRef = (ring->nextRef + 1) % SB_TEMP_REFS;
+    return ring->refs;
+}
+
+
+/*=================================================================== PUBLIC */
+
+void sbAssign(SB_CHAR **variable, SB_CHAR *value) {
+    SB_CHAR *copy;
+    size_t size;
+
+    /* A string variable that was never set is empty. */
+    if (!value) {
+        value = "";
+    }
+
+    size = strlen(value);
+
+    if (size > SB_MAX_STRING) {
+        size = SB_MAX_STRING;
+    }
+
+    /* The value may be part of the variable, a$ = a$(2 TO). */
+    copy = malloc(size + 1);
+    if (!copy) {
+        fprintf(stderr, "sbRuntime: Out of memory for a %d character string.\n", (int)size);
+        exit(1);
+    }
+
+    memcpy(copy, value, size);
+    copy[size] = '\0';
+    free(*variable);
+    *variable = copy;
+}
+
+
+SB_CHAR *sbTemp(SB_CHAR *text) {
+    size_t size = (text ? strlen(text) : 0);
+    SB_CHAR *result;
+
+    if (size > SB_MAX_STRING) {
+        size = SB_MAX_STRING;
+    }
+
+    result = tempString(size);
+    memcpy(result, (text ? text : ""), size);
+    result[size] = '\0';
+    return result;
+}
+
+
+void sbEnter(void) {
+    tempRing++;
+    if (tempRing >= tempRingCount) {
+        tempGrow();
+    }
+    tempRings[tempRing].next = 0;
+    tempRings[tempRing].nextRef = 0;
+}
+
+
+void sbTempRing(unsigned short count) {
+    tempRingSize(count);
+}
+
+
+SB_FLOAT sbLeaveFloat(SB_FLOAT result) {
+    if (tempRing) {
+        tempRing--;
+    }
+    return result;
+}
+
+
+SB_INTEGER sbLeaveInteger(SB_INTEGER result) {
+    if (tempRing) {
+        tempRing--;
+    }
+    return result;
+}
+
+
+SB_CHAR *sbLeaveString(SB_CHAR *result) {
+    if (tempRing) {
+        tempRing--;
+    }
+
+    /* The FuNction's ring isn't reused until the next call, so the result
+     * is still there to copy. */
+    return sbTemp(result);
+}
+
+
+SB_CHAR *sbConcat(SB_CHAR *left, SB_CHAR *right) {
+    size_t leftSize;
+    size_t rightSize;
+    SB_CHAR *result;
+
+    left = SB_UNSET(left);
+    right = SB_UNSET(right);
+    leftSize = strlen(left);
+    rightSize = strlen(right);
+
+    if (leftSize > SB_MAX_STRING) {
+        leftSize = SB_MAX_STRING;
+    }
+    if (leftSize + rightSize > SB_MAX_STRING) {
+        rightSize = SB_MAX_STRING - leftSize;
+    }
+
+    result = tempString(leftSize + rightSize);
+    memcpy(result, left, leftSize);
+    memcpy(result + leftSize, right, rightSize);
+    result[leftSize + rightSize] = '\0';
+    return result;
+}
+
+
+SB_CHAR *sbSlice(SB_CHAR *text, SB_FLOAT from, SB_FLOAT to) {
+    long size = strlen(SB_UNSET(text));
+    long first = sbInt(from);
+    long last;
+    SB_CHAR *result;
+
+    if (to == SB_SLICE_ONE) {
+        last = first;
+    } else if (to == SB_SLICE_END) {
+        last = size;
+    } else {
+        last = sbInt(to);
+    }
+
+    /* SuperBASIC would stop with 'out of range', we give what there is. */
+    if (first < 1) {
+        first = 1;
+    }
+    if (last > size) {
+        last = size;
+    }
+    if (last < first) {
+        return tempString(0);
+    }
+
+    result = tempString(last - first + 1);
+    memcpy(result, text + first - 1, last - first + 1);
+    result[last - first + 1] = '\0';
+    return result;
+}
+
+
+SB_CHAR *sbStr(SB_FLOAT value) {
+    SB_CHAR *result = tempString(20);
+    SB_CHAR *exponent;
+    SB_CHAR *from;
+    SB_CHAR *to;
+
+    sprintf(result, "%.7G", value);
+
+    /* SuperBASIC shows .5 not 0.5 and 1E10 not 1E+10. */
+    if (result[0] == '0' && result[1] == '.') {
+        memmove(result, result + 1, strlen(result));
+    } else if (result[0] == '-' && result[1] == '0' && result[2] == '.') {
+        memmove(result + 1, result + 2, strlen(result + 1));
+    }
+
+    exponent = strchr(result, 'E');
+    if (exponent) {
+        from = to = exponent + 1;
+        if (*from == '+') {
+            from++;
+        } else if (*from == '-') {
+            from++;
+            to++;
+        }
+        while (*from == '0' && from[1]) {
+            from++;
+        }
+        memmove(to, from, strlen(from) + 1);
+    }
+
+    return result;
+}
+
+
+SB_FLOAT sbVal(SB_CHAR *text) {
+    return strtod(SB_UNSET(text), NULL);
+}
+
+
+SB_INTEGER sbInt(SB_FLOAT value) {
+    SB_FLOAT rounded = floor(value + 0.5);
+
+    if (rounded < -32768 || rounded > 32767) {
+        fprintf(stderr, "sbRuntime: Overflow, %g is too big for an integer.\n", value);
+        exit(1);
+    }
+    return (SB_INTEGER)rounded;
+}
+
+
+SB_INTEGER sbMod(SB_FLOAT left, SB_FLOAT right) {
+    long a = sbInt(left);
+    long b = sbInt(right);
+    long result;
+
+    if (b == 0) {
+        fprintf(stderr, "sbRuntime: MOD by zero.\n");
+        exit(1);
+    }
+
+    result = a % b;
+    if (result && ((result < 0) != (b < 0))) {
+        result += b;
+    }
+    return (SB_INTEGER)result;
+}
+
+
+SB_INTEGER sbDiv(SB_FLOAT left, SB_FLOAT right) {
+    long a = sbInt(left);
+    long b = sbInt(right);
+    long result;
+
+    if (b == 0) {
+        fprintf(stderr, "sbRuntime: DIV by zero.\n");
+        exit(1);
+    }
+
+    result = a / b;
+    if ((a % b) && ((a < 0) != (b < 0))) {
+        result--;
+    }
+    return (SB_INTEGER)result;
+}
+
+
+SB_INTEGER sbInstr(SB_CHAR *find, SB_CHAR *in) {
+    size_t findSize;
+    size_t inSize;
+    size_t x;
+    size_t y;
+
+    find = SB_UNSET(find);
+    in = SB_UNSET(in);
+    findSize = strlen(find);
+    inSize = strlen(in);
+
+    for (x = 0; x + findSize <= inSize; x++) {
+        for (y = 0; y < findSize; y++) {
+            if (tolower((unsigned char)in[x + y]) != tolower((unsigned char)find[y])) {
+                break;
+            }
+        }
+        if (y == findSize) {
+            return (SB_INTEGER)(x + 1);
+        }
+    }
+
+    return 0;
+}
+
+
+int sbCompare(SB_CHAR *left, SB_CHAR *right, int ignoreCase) {
+    int a;
+    int b;
+
+    left = SB_UNSET(left);
+    right = SB_UNSET(right);
+    for (;; left++, right++) {
+        a = (unsigned char)*left;
+        b = (unsigned char)*right;
+        if (ignoreCase) {
+            a = tolower(a);
+            b = tolower(b);
+        }
+        if (a != b || !a) {
+            return a - b;
+        }
+    }
+}
+
+
+int sbApprox(SB_FLOAT left, SB_FLOAT right) {
+    SB_FLOAT size = fabs(left) > fabs(right) ? fabs(left) : fabs(right);
+
+    return fabs(left - right) <= size * 1e-7;
+}
+
+
+long sbForLimit(SB_FLOAT end, SB_FLOAT step) {
+    SB_FLOAT limit = (step < 0 ? ceil(end) : floor(end));
+
+    if (limit > SB_FOR_LIMIT) {
+        return SB_FOR_LIMIT;
+    }
+    if (limit < -SB_FOR_LIMIT) {
+        return -SB_FOR_LIMIT;
+    }
+    return (long)limit;
+}
+
+
+long sbWhole(SB_FLOAT value) {
+    if (value != floor(value) || fabs(value) > SB_FOR_LIMIT) {
+        return -SB_FOR_LIMIT - 1;
+    }
+    return (long)value;
+}
+
+
+int sbSelect(const SB_SELECT *table, int size, SB_FLOAT value) {
+    int low = 0;
+    int high = size - 1;
+    int middle;
+
+    /* The last range that starts at or before value. */
+    while (low <= high) {
+        middle = (low + high) / 2;
+        if (table[middle].from <= value) {
+            low = middle + 1;
+        } else {
+            high = middle - 1;
+        }
+    }
+
+    if (high >= 0 && value <= table[high].to) {
+        return table[high].clause;
+    }
+    return 0;
+}
+
+
+int sbGoTo(const unsigned short *lines, int count, SB_FLOAT line) {
+    int low = 0;
+    int high = count;
+    int middle;
+    SB_FLOAT number = floor(line + 0.5);
+
+    while (low < high) {
+        middle = (low + high) / 2;
+        if (lines[middle] < number) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+
+void sbGoSub(SB_GOSUB *stack, int back, int line) {
+    if (stack->depth == SB_GOSUB_DEPTH) {
+        fprintf(stderr, "sbRuntime: GO SUB nested too deeply, at line %d.\n", line);
+        exit(1);
+    }
+    stack->back[stack->depth++] = back;
+}
+
+
+int sbReturn(SB_GOSUB *stack) {
+    return (stack->depth ? stack->back[--stack->depth] : 0);
+}
+
+
+SB_FLOAT *sbRefFloat(SB_FLOAT value) {
+    unsigned short x;
+    TEMP_REFS *refs = tempRef(&x);
+
+    refs->floats[x] = value;
+    return refs->floats + x;
+}
+
+
+SB_INTEGER *sbRefInteger(SB_INTEGER value) {
+    unsigned short x;
+    TEMP_REFS *refs = tempRef(&x);
+
+    refs->integers[x] = value;
+    return refs->integers + x;
+}
+
+
+SB_CHAR **sbRefString(SB_CHAR *value) {
+    unsigned short x;
+    TEMP_REFS *refs = tempRef(&x);
+
+    sbAssign(refs->strings + x, value);
+    return refs->strings + x;
+}
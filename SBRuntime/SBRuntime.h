@@ -0,0 +1,134 @@
+#ifndef __SBRUNTIME_H__
+#define __SBRUNTIME_H__
+
+#include <math.h>
+#include "SBLocal.h"
+
+/* The helpers that converted expressions call, where C has no operator
+ * that does what SuperBASIC does. Strings returned by these functions are
+ * temporary, they live in a small ring of buffers which are reused, so a
+ * result must be copied, with sbAssign(), before SB_TEMP_STRINGS more
+ * temporary strings are made. Each FuNction call has a ring of its own,
+ * so the strings it makes can't reuse its caller's. The converter calls
+ * sbTempRing() first for a statement that needs more than this at once.
+ * A string variable that was never set is NULL, which they take as empty. */
+#define SB_TEMP_STRINGS 8
+
+/* SuperBASIC strings can't be longer than this. */
+#define SB_MAX_STRING 32766
+
+/* Slices. a$(3) is sbSlice(a$, 3, SB_SLICE_ONE) and a$(3 TO) is
+ * sbSlice(a$, 3, SB_SLICE_END). */
+#define SB_SLICE_END -1
+#define SB_SLICE_ONE -2
+
+/* Integer FOR loops count in a long, but never further than this, so that
+ * adding the STEP can't overflow. */
+#define SB_FOR_LIMIT 1073741823L
+
+/* One range of a SELect ON clause, from TO to, in a table sorted on from,
+ * for sbSelect(). Clauses count from 1. */
+typedef struct SB_SELECT {
+    SB_FLOAT from;
+    SB_FLOAT to;
+    int clause;
+} SB_SELECT;
+
+/* Arguments passed by reference, to a parameter that the PROCedure or
+ * FuNction may change, that aren't variables, like a PROC 1 + 2. Each is
+ * copied to a slot in the calling FuNction's ring, like temporary strings,
+ * and any change made to it is lost. */
+#define SB_TEMP_REFS 32
+
+/* GO SUB's return stack, of the numbers of the places to RETurn to. */
+#define SB_GOSUB_DEPTH 256
+
+typedef struct SB_GOSUB {
+    int depth;
+    int back[SB_GOSUB_DEPTH];
+} SB_GOSUB;
+
+
+/*====================================================================PUBLIC */
+
+/* Copy a string into a string variable, making room as needed. */
+void sbAssign(SB_CHAR **variable, SB_CHAR *value);
+
+/* A temporary copy of a string, for a FuNction's result, which may be
+ * freed before it's used. */
+SB_CHAR *sbTemp(SB_CHAR *text);
+
+/* Called before a FuNction is, to give it a ring of temporary strings of
+ * its own. */
+void sbEnter(void);
+
+/* Called before a statement that needs more than SB_TEMP_STRINGS
+ * temporary strings at once, to make the current ring at least count
+ * long. */
+void sbTempRing(unsigned short count);
+
+/* Called with a FuNction's result, to go back to its caller's ring. A
+ * string result is copied to the caller's ring, before it's reused. */
+SB_FLOAT sbLeaveFloat(SB_FLOAT result);
+SB_INTEGER sbLeaveInteger(SB_INTEGER result);
+SB_CHAR *sbLeaveString(SB_CHAR *result);
+
+/* a$ & b$. */
+SB_CHAR *sbConcat(SB_CHAR *left, SB_CHAR *right);
+
+/* a$(from TO to), characters count from 1. */
+SB_CHAR *sbSlice(SB_CHAR *text, SB_FLOAT from, SB_FLOAT to);
+
+/* A number, as PRINT would show it, for when a number is used as a string. */
+SB_CHAR *sbStr(SB_FLOAT value);
+
+/* A string, used as a number. Anything that isn't a number is zero. */
+SB_FLOAT sbVal(SB_CHAR *text);
+
+/* A float, rounded to an integer, as SuperBASIC does for a% = 2.5. One
+ * that's too big stops the program, as an overflow does in SuperBASIC. */
+SB_INTEGER sbInt(SB_FLOAT value);
+
+/* a MOD b and a DIV b, on integers, rounded towards minus infinity. */
+SB_INTEGER sbMod(SB_FLOAT left, SB_FLOAT right);
+SB_INTEGER sbDiv(SB_FLOAT left, SB_FLOAT right);
+
+/* find$ INSTR in$, the position of find$, ignoring case, or 0. */
+SB_INTEGER sbInstr(SB_CHAR *find, SB_CHAR *in);
+
+/* Compare two strings, <0, 0 or >0, like strcmp(). a$ == b$ ignores case,
+ * the other comparisons do not. */
+int sbCompare(SB_CHAR *left, SB_CHAR *right, int ignoreCase);
+
+/* a == b, for numbers. Almost equal, to 1 part in 10 million. */
+int sbApprox(SB_FLOAT left, SB_FLOAT right);
+
+/* The last whole number an integer FOR loop can reach, before end, counting
+ * up if step is positive and down if not. */
+long sbForLimit(SB_FLOAT end, SB_FLOAT step);
+
+/* A whole number, for a switch, or -SB_FOR_LIMIT - 1, which no case is, if
+ * value isn't one or is too big. */
+long sbWhole(SB_FLOAT value);
+
+/* The clause of a SELect ON with value in one of its ranges, found by a
+ * binary search of a table of size ranges that don't overlap, or 0. */
+int sbSelect(const SB_SELECT *table, int size, SB_FLOAT value);
+
+/* GO TO an expression. The index, in lines, of the first of count line
+ * numbers at or after line, or count if there isn't one. */
+int sbGoTo(const unsigned short *lines, int count, SB_FLOAT line);
+
+/* GO SUB, from line, pushing back, the place to RETurn to. The program
+ * stops if the stack is full. */
+void sbGoSub(SB_GOSUB *stack, int back, int line);
+
+/* RETurn. Pops the place to go back to, or 0 if there was no GO SUB. */
+int sbReturn(SB_GOSUB *stack);
+
+/* A pointer to a copy of value, for an argument passed by reference. */
+SB_FLOAT *sbRefFloat(SB_FLOAT value);
+SB_INTEGER *sbRefInteger(SB_INTEGER value);
+SB_CHAR **sbRefString(SB_CHAR *value);
+
+#endif /* __SBRUNTIME_H__ */
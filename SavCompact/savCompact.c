@@ -0,0 +1,376 @@
+/*=============================================================================
+ * SAV file compactor. Makes a SAV file smaller, so it loads faster and takes
+ * less memory, without changing what the program does.
+ *
+ * Three things are taken out:
+ *
+ * REMarks. The keyword and its text go, as does the colon before them, if
+ * there is one. A line that was only a REMark goes completely, unless a GO
+ * TO, GO SUB or RESTORE might use it. If any of those use an expression,
+ * rather than line numbers, we can't tell which lines they use, so no lines
+ * are removed at all. A REMark on a line with FOR, REPeat, IF, SELect, WHEN,
+ * THEN or ELSE keeps its keyword, with no text, as taking it away could turn
+ * an in-line loop or IF into the start of a block.
+ *
+ * Multispaces. These are only there for LIST, the interpreter skips them.
+ *
+ * Unused names. QDOS never takes anything out of the name table, so names
+ * that were once typed, then deleted, stay in the file for ever. Names that
+ * no token uses are dropped and the rest are renumbered.
+ *
+ * Line numbers are never changed. MISTake lines are left as they are.
+ *
+ * Usage: savCompact [-r] [-s] [-n] [-o output_sav] program_sav
+ *
+ * -r           Keep REMarks.
+ * -s           Keep multispaces.
+ * -n           Keep unused names.
+ * -o output    The compacted file. Default is the input with '_cmp' added
+ *              before the '_sav' or '.sav', or on the end.
+ *===========================================================================*/
+
+/*===========================================================================
+ * HEADERS
+ *===========================================================================*/
+#include "savCompact.h"
+
+/*===========================================================================
+ * GLOBALS
+ *===========================================================================*/
+ushort keepRemarks = 0;         /* -r */
+ushort keepSpaces = 0;          /* -s */
+ushort keepNames = 0;           /* -n */
+
+uchar referenced[65536 / 8];    /* One bit for every possible line number. */
+ushort computedReferences = 0;  /* GO TO an expression? Keep every line. */
+
+compactStats stats;
+
+/* An empty REMark text token, 0x8C.00.0000 */
+uchar emptyText[4] = {TYPE_TEXT, 0, 0, 0};
+
+
+/*=============================================================================
+ * MAIN() Start here. Reads the SAV file, compacts it, then writes it out.
+ *===========================================================================*/
+int main (int argc, char *argv[]) {
+    char *inFile = NULL;
+    char outFile[MAXPATH + 1] = "";
+    savFile sav;
+    savProgram prog;
+    savProgram out;
+    savBuffer buffer;
+    FILE *fp;
+    ulong saved;
+    int arg;
+
+    for (arg = 1; arg < argc; arg++) {
+        if (strcmp(argv[arg], "-o") == 0 && arg + 1 < argc) {
+            strncpy(outFile, argv[++arg], MAXPATH);
+            outFile[MAXPATH] = '\0';
+        } else if (strcmp(argv[arg], "-r") == 0) {
+            keepRemarks = 1;
+        } else if (strcmp(argv[arg], "-s") == 0) {
+            keepSpaces = 1;
+        } else if (strcmp(argv[arg], "-n") == 0) {
+            keepNames = 1;
+        } else if (argv[arg][0] == '-') {
+            fprintf(stderr, "%s: Unknown option '%s'.\n", argv[0], argv[arg]);
+            return -1;
+        } else {
+            inFile = argv[arg];
+        }
+    }
+
+    if (!inFile) {
+        fprintf(stderr, "Usage: %s [-r] [-s] [-n] [-o output_sav] program_sav\n", argv[0]);
+        return -1;
+    }
+
+    if (!outFile[0]) {
+        savOutputName(inFile, "_cmp", outFile);
+    }
+
+    savInitFile(&sav);
+    savInitProgram(&prog);
+    savInitProgram(&out);
+    savInitBuffer(&buffer);
+
+    if (savReadFile(inFile, &sav) != SAV_OK ||
+        savDecodeProgram(&sav, &prog) != SAV_OK) {
+        fprintf(stderr, "FATAL ERROR: main(): Cannot decode '%s'.\n", inFile);
+        return -1;
+    }
+
+    memset(&stats, 0, sizeof(stats));
+    findLineReferences(&prog);
+
+    if (compactLines(&prog, &out) != 0) {
+        fprintf(stderr, "FATAL ERROR: compactLines() failed.\n");
+        return -1;
+    }
+
+    if (!keepNames && compactNames(&out) != 0) {
+        fprintf(stderr, "FATAL ERROR: compactNames() failed.\n");
+        return -1;
+    }
+
+    savCountProgram(&out);
+    if (savEncodeProgram(&out, &buffer) != SAV_OK) {
+        fprintf(stderr, "FATAL ERROR: savEncodeProgram() failed.\n");
+        return -1;
+    }
+
+    fp = fopen(outFile, "wb");
+    if (!fp) {
+        fprintf(stderr, "FATAL ERROR: main(): Cannot open '%s' for writing.\n", outFile);
+        return -1;
+    }
+
+    if (savWriteBuffer(fp, &buffer) != SAV_OK) {
+        fprintf(stderr, "FATAL ERROR: savWriteBuffer() failed.\n");
+        fclose(fp);
+        return -1;
+    }
+
+    fclose(fp);
+
+    saved = (sav.size > buffer.size ? sav.size - buffer.size : 0);
+    fprintf(stderr, "%s: %lu bytes, was %lu, saved %lu (%.1f%%).\n",
+            outFile, buffer.size, sav.size, saved, 100.0 * saved / sav.size);
+    fprintf(stderr, "Removed %lu REMarks, %lu multispaces, %lu unused names and %lu lines. Emptied %lu REMarks.\n",
+            stats.remarks, stats.spaces, stats.names, stats.lines, stats.emptied);
+
+    savFreeBuffer(&buffer);
+    savFreeProgram(&out);
+    savFreeProgram(&prog);
+    savFreeFile(&sav);
+    return 0;
+}
+
+
+/*=============================================================================
+ * MARKREFERENCE() Called by savFindTargets() for each line number used by a
+ * GO TO, GO SUB or RESTORE.
+ *===========================================================================*/
+void markReference(savToken *token, ushort lineNumber, ulong line, void *data) {
+    (void)line;
+    (void)data;
+
+    if (!token) {
+        computedReferences = 1;
+        return;
+    }
+
+    referenced[lineNumber >> 3] |= 1 << (lineNumber & 7);
+}
+
+
+/*=============================================================================
+ * FINDLINEREFERENCES() Finds every line that a GO TO, GO SUB or RESTORE uses,
+ * so that they are not removed.
+ *===========================================================================*/
+void findLineReferences(savProgram *prog) {
+    memset(referenced, 0, sizeof(referenced));
+    computedReferences = 0;
+
+    savFindTargets(prog, markReference, NULL);
+}
+
+
+/*=============================================================================
+ * ISRISKY() Would taking a REMark off the end of these tokens change what the
+ * line does? It would if the line starts an in-line FOR, REPeat, IF, SELect
+ * or WHEN, or has a THEN or ELSE, as without the REMark it could become the
+ * start of a block.
+ *===========================================================================*/
+ushort isRisky(savToken *tokens, ulong count) {
+    ulong t = savSkipSpaces(tokens, 0, count);
+
+    if (t < count && tokens[t].type == TYPE_KEYWORD) {
+        switch (tokens[t].code - 1) {
+            case kwFor:
+            case kwRepeat:
+            case kwIf:
+            case kwSelect:
+            case kwWhen:
+                return 1;
+        }
+    }
+
+    for (; t < count; t++) {
+        if (tokens[t].type == TYPE_KEYWORD &&
+            (tokens[t].code == kwThen + 1 || tokens[t].code == kwElse + 1)) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+
+/*=============================================================================
+ * COMPACTLINES() Copies the program to out, a line at a time, leaving out
+ * the REMarks and multispaces. The name table is copied as it is.
+ *===========================================================================*/
+ushort compactLines(savProgram *prog, savProgram *out) {
+    ulong x;
+
+    out->flags[0] = prog->flags[0];
+    out->flags[1] = prog->flags[1];
+
+    for (x = 0; x < prog->nameCount; x++) {
+        if (savAddName(out, prog->names + x) != SAV_OK) {
+            return 1;
+        }
+    }
+
+    for (x = 0; x < prog->lineCount; x++) {
+        if (compactLine(prog, prog->lines + x, out) != 0) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+
+/*=============================================================================
+ * COMPACTLINE() Copies one line to out. A REMark is always the last statement
+ * on a line, so everything from it to the end of the line goes.
+ *===========================================================================*/
+ushort compactLine(savProgram *prog, savProgLine *line, savProgram *out) {
+    savProgLine *outLine;
+    savToken *token;
+    savToken *outTokens;
+    savToken empty;
+    ulong end = line->first + line->count;
+    ulong t;
+    ulong kept;
+
+    if (savAddLine(out, line->lineNumber) != SAV_OK) {
+        return 1;
+    }
+
+    outLine = out->lines + out->lineCount - 1;
+
+    for (t = line->first; t < end; t++) {
+        token = prog->tokens + t;
+
+        if (!keepSpaces && token->type == TYPE_MULTISPACE) {
+            stats.spaces++;
+            continue;
+        }
+
+        /* REMark is followed by its text, and nothing else. */
+        if (!keepRemarks && token->type == TYPE_KEYWORD && token->code == kwRemark + 1 &&
+            t + 2 == end && token[1].type == TYPE_TEXT) {
+            break;
+        }
+
+        if (savAddToken(out, token) != SAV_OK) {
+            return 1;
+        }
+    }
+
+    if (t == end) {
+        return 0;
+    }
+
+    /* Lose the colon, and any spaces, before the REMark. */
+    outTokens = out->tokens + outLine->first;
+    kept = outLine->count;
+    while (kept && outTokens[kept - 1].type == TYPE_MULTISPACE) {
+        kept--;
+    }
+
+    if (kept && outTokens[kept - 1].type == TYPE_SYMBOL && outTokens[kept - 1].code == SYMBOL_COLON) {
+        kept--;
+        while (kept && outTokens[kept - 1].type == TYPE_MULTISPACE) {
+            kept--;
+        }
+    }
+
+    /* Only a REMark? Lose the line, if nothing can GO TO it. */
+    if (!kept && !computedReferences &&
+        !(referenced[line->lineNumber >> 3] & (1 << (line->lineNumber & 7)))) {
+        out->tokenCount -= outLine->count;
+        out->lineCount--;
+        stats.remarks++;
+        stats.lines++;
+        return 0;
+    }
+
+    if (kept && !isRisky(outTokens, kept)) {
+        out->tokenCount -= outLine->count - kept;
+        outLine->count = kept;
+        stats.remarks++;
+        return 0;
+    }
+
+    /* Keep the REMark, but not its text. */
+    empty = prog->tokens[t + 1];
+    empty.value = 0;
+    empty.size = 4;
+    empty.data = emptyText;
+    empty.padding = 0;
+
+    if (savAddToken(out, prog->tokens + t) != SAV_OK ||
+        savAddToken(out, &empty) != SAV_OK) {
+        return 1;
+    }
+
+    if (prog->tokens[t + 1].value) {
+        stats.emptied++;
+    }
+
+    return 0;
+}
+
+
+/*=============================================================================
+ * COMPACTNAMES() Drops the names that no token uses, and renumbers the name
+ * tokens to match.
+ *===========================================================================*/
+ushort compactNames(savProgram *out) {
+    ulong *newEntry;
+    ulong x;
+    ulong used = 0;
+
+    if (!out->nameCount) {
+        return 0;
+    }
+
+    newEntry = calloc(out->nameCount, sizeof(ulong));
+    if (!newEntry) {
+        fprintf(stderr, "\n\nERROR: compactNames(): Cannot allocate memory for %lu names.\n", out->nameCount);
+        return 1;
+    }
+
+    /* Entry + 1 for each name that's used, 0 for the rest. */
+    for (x = 0; x < out->tokenCount; x++) {
+        if (out->tokens[x].type == TYPE_NAME) {
+            newEntry[out->tokens[x].value] = 1;
+        }
+    }
+
+    for (x = 0; x < out->nameCount; x++) {
+        if (newEntry[x]) {
+            out->names[used] = out->names[x];
+            newEntry[x] = ++used;
+        }
+    }
+
+    for (x = 0; x < out->tokenCount; x++) {
+        if (out->tokens[x].type == TYPE_NAME) {
+            out->tokens[x].value = newEntry[out->tokens[x].value] - 1;
+        }
+    }
+
+    stats.names = out->nameCount - used;
+    out->nameCount = used;
+
+    free(newEntry);
+    return 0;
+}
+
@@ -0,0 +1,39 @@
+#ifndef __SAVCOMPACT_H__
+#define __SAVCOMPACT_H__
+
+/*===========================================================================
+ * HEADERS
+ *===========================================================================*/
+#include "../SavFile/savFile.h"
+
+/*===========================================================================
+ * DEFINES
+ *===========================================================================*/
+#define MAXLINENUMBER 32767         /* SuperBASIC's biggest line number. */
+
+/*===========================================================================
+ * TYPEDEFS
+ *===========================================================================*/
+
+/* What was taken out, for the report. */
+typedef struct compactStats {
+    ulong remarks;                  /* REMarks removed. */
+    ulong emptied;                  /* REMarks kept, but with no text. */
+    ulong spaces;                   /* Multispace tokens removed. */
+    ulong names;                    /* Unused names dropped. */
+    ulong lines;                    /* Lines that were only a REMark. */
+} compactStats;
+
+/*===========================================================================
+ * FUNCTION PROTOTYPES
+ *===========================================================================*/
+void   markReference(savToken *token, ushort lineNumber, ulong line, void *data);
+void   findLineReferences(savProgram *prog);
+ushort isRisky(savToken *tokens, ulong count);
+ushort compactLines(savProgram *prog, savProgram *out);
+ushort compactLine(savProgram *prog, savProgLine *line, savProgram *out);
+ushort compactNames(savProgram *out);
+
+/*===========================================================================*/
+
+#endif /* __SAVCOMPACT_H__ */
@@ -0,0 +1,523 @@
+/*=============================================================================
+ * SAV file differ. Compares two versions of a program, token by token.
+ *
+ * Both files are decoded into token arrays, and their lines are matched up
+ * by line number, so lines only in the old file were removed and lines only
+ * in the new one were added. Lines in both are compared without their
+ * multispaces, floats by value and names by spelling, so reordered name
+ * tables and different indentation aren't differences. A changed line is
+ * shown once, with the tokens that changed in brackets:
+ *
+ * ~ 130: IF a THEN x = [1 => 2]
+ *
+ * Renamed names are found by looking at lines that have the same number of
+ * tokens in both files. If every time old name A is in a place where the new
+ * file has B, and the old program doesn't use B, nor the new one A, then A
+ * was renamed to B, and lines that differ only by that are not changed.
+ *
+ * Names are matched with a hash table, and each pair of lines is compared
+ * from each end, so it all takes time linear in the size of the files.
+ *
+ * Usage: savDiff [-q] old_sav new_sav
+ *
+ * -q           Quiet. Only print the summary.
+ *
+ * Exits with 0 if the programs are the same, 1 if they differ, like diff.
+ *===========================================================================*/
+
+/*===========================================================================
+ * HEADERS
+ *===========================================================================*/
+#include <ctype.h>
+
+#include "savDiff.h"
+
+/*===========================================================================
+ * GLOBALS
+ *===========================================================================*/
+diffSide oldSide;               /* What it was. */
+diffSide newSide;               /* What it is now. */
+long *renamed = NULL;           /* New entry for each old name, or NO_RENAME. */
+ulong *renamedLines = NULL;     /* Lines where each rename was seen. */
+ushort quiet = 0;               /* -q */
+
+diffStats stats;
+
+
+/*=============================================================================
+ * MAIN() Start here. Reads both files, then compares them.
+ *===========================================================================*/
+int main (int argc, char *argv[]) {
+    char *files[2] = {NULL, NULL};
+    ushort fileCount = 0;
+    int arg;
+
+    for (arg = 1; arg < argc; arg++) {
+        if (strcmp(argv[arg], "-q") == 0) {
+            quiet = 1;
+        } else if (argv[arg][0] == '-') {
+            fprintf(stderr, "%s: Unknown option '%s'.\n", argv[0], argv[arg]);
+            return -1;
+        } else if (fileCount < 2) {
+            files[fileCount++] = argv[arg];
+        }
+    }
+
+    if (fileCount != 2) {
+        fprintf(stderr, "Usage: %s [-q] old_sav new_sav\n", argv[0]);
+        return -1;
+    }
+
+    if (loadSide(&oldSide, files[0]) != 0 || loadSide(&newSide, files[1]) != 0) {
+        fprintf(stderr, "FATAL ERROR: loadSide() failed.\n");
+        return -1;
+    }
+
+    if (matchNames(&oldSide, &newSide) != 0 || matchNames(&newSide, &oldSide) != 0) {
+        fprintf(stderr, "FATAL ERROR: matchNames() failed.\n");
+        return -1;
+    }
+
+    countUses(&oldSide);
+    countUses(&newSide);
+
+    if (findRenames() != 0) {
+        fprintf(stderr, "FATAL ERROR: findRenames() failed.\n");
+        return -1;
+    }
+
+    memset(&stats, 0, sizeof(stats));
+    if (!quiet) {
+        printf("--- %s\n+++ %s\n", oldSide.fileName, newSide.fileName);
+    }
+
+    diffPrograms();
+
+    printf("%lu lines the same, %lu changed, %lu added, %lu removed, %lu names renamed.\n",
+           stats.same, stats.changed, stats.added, stats.removed, stats.renames);
+
+    return (stats.changed || stats.added || stats.removed || stats.renames ? 1 : 0);
+}
+
+
+/*=============================================================================
+ * LOADSIDE() Reads and decodes one of the files.
+ *===========================================================================*/
+ushort loadSide(diffSide *side, char *fileName) {
+    memset(side, 0, sizeof(diffSide));
+    side->fileName = fileName;
+    savInitFile(&side->sav);
+    savInitProgram(&side->prog);
+
+    if (savReadFile(fileName, &side->sav) != SAV_OK ||
+        savDecodeProgram(&side->sav, &side->prog) != SAV_OK) {
+        fprintf(stderr, "\n\nERROR: loadSide(): Cannot decode '%s'.\n", fileName);
+        return 1;
+    }
+
+    side->match = malloc((side->prog.nameCount + 1) * sizeof(long));
+    side->uses = calloc(side->prog.nameCount + 1, sizeof(ulong));
+    if (!side->match || !side->uses) {
+        fprintf(stderr, "\n\nERROR: loadSide(): Cannot allocate memory for %lu names.\n", side->prog.nameCount);
+        return 1;
+    }
+
+    return 0;
+}
+
+
+/*=============================================================================
+ * NAMEHASH() Hashes a name, ignoring case, as SuperBASIC does.
+ *===========================================================================*/
+ulong nameHash(savName *name) {
+    ulong hash = 2166136261UL;
+    ushort x;
+
+    for (x = 0; x < name->nameLength; x++) {
+        hash = ((hash ^ toupper(name->name[x])) * 16777619UL) & 0xFFFFFFFFUL;
+    }
+
+    return hash;
+}
+
+
+/*=============================================================================
+ * SAMENAME() Are two names spelt the same, ignoring case?
+ *===========================================================================*/
+ushort sameName(savName *a, savName *b) {
+    ushort x;
+
+    if (a->nameLength != b->nameLength) {
+        return 0;
+    }
+
+    for (x = 0; x < a->nameLength; x++) {
+        if (toupper(a->name[x]) != toupper(b->name[x])) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+
+/*=============================================================================
+ * MATCHNAMES() Finds, for every name in from, the name in to that's spelt
+ * the same, or NO_MATCH. The names in to go in a hash table first, so this
+ * takes time linear in the number of names.
+ *===========================================================================*/
+ushort matchNames(diffSide *from, diffSide *to) {
+    ulong *slots;
+    ulong size = 16;
+    ulong slot;
+    ulong x;
+
+    while (size < to->prog.nameCount * 2) {
+        size *= 2;
+    }
+
+    /* Entry + 1 in each slot, 0 is empty. */
+    slots = calloc(size, sizeof(ulong));
+    if (!slots) {
+        fprintf(stderr, "\n\nERROR: matchNames(): Cannot allocate memory for %lu names.\n", to->prog.nameCount);
+        return 1;
+    }
+
+    for (x = 0; x < to->prog.nameCount; x++) {
+        slot = nameHash(to->prog.names + x) & (size - 1);
+        while (slots[slot]) {
+            slot = (slot + 1) & (size - 1);
+        }
+        slots[slot] = x + 1;
+    }
+
+    for (x = 0; x < from->prog.nameCount; x++) {
+        from->match[x] = NO_MATCH;
+        slot = nameHash(from->prog.names + x) & (size - 1);
+        while (slots[slot]) {
+            if (sameName(from->prog.names + x, to->prog.names + slots[slot] - 1)) {
+                from->match[x] = slots[slot] - 1;
+                break;
+            }
+            slot = (slot + 1) & (size - 1);
+        }
+    }
+
+    free(slots);
+    return 0;
+}
+
+
+/*=============================================================================
+ * COUNTUSES() Counts the tokens that use each name.
+ *===========================================================================*/
+void countUses(diffSide *side) {
+    ulong x;
+
+    for (x = 0; x < side->prog.tokenCount; x++) {
+        if (side->prog.tokens[x].type == TYPE_NAME) {
+            side->uses[side->prog.tokens[x].value]++;
+        }
+    }
+}
+
+
+/*=============================================================================
+ * LOADLINE() Makes a list of the tokens on a line, leaving out multispaces.
+ *===========================================================================*/
+ushort loadLine(diffSide *side, ulong line) {
+    savProgLine *progLine = side->prog.lines + line;
+    savToken **temp;
+    ulong x;
+
+    if (progLine->count > side->lineSpace) {
+        temp = realloc(side->line, progLine->count * sizeof(savToken *));
+        if (!temp) {
+            fprintf(stderr, "\n\nERROR: loadLine(): Cannot allocate memory for %lu tokens.\n", progLine->count);
+            return 1;
+        }
+
+        side->line = temp;
+        side->lineSpace = progLine->count;
+    }
+
+    side->lineSize = 0;
+    for (x = progLine->first; x < progLine->first + progLine->count; x++) {
+        if (side->prog.tokens[x].type != TYPE_MULTISPACE) {
+            side->line[side->lineSize++] = side->prog.tokens + x;
+        }
+    }
+
+    return 0;
+}
+
+
+/*=============================================================================
+ * FINDRENAMES() Looks for names that have been renamed. Only lines with the
+ * same number of tokens in both files are looked at, and a name that lines
+ * up with two different names wasn't renamed.
+ *===========================================================================*/
+ushort findRenames(void) {
+    ulong o = 0;
+    ulong n = 0;
+    ulong x;
+    ushort a;
+    ushort b;
+    uchar *taken;
+
+    renamed = malloc((oldSide.prog.nameCount + 1) * sizeof(long));
+    renamedLines = calloc(oldSide.prog.nameCount + 1, sizeof(ulong));
+    taken = calloc(newSide.prog.nameCount + 1, 1);
+    if (!renamed || !renamedLines || !taken) {
+        fprintf(stderr, "\n\nERROR: findRenames(): Cannot allocate memory for %lu names.\n", oldSide.prog.nameCount);
+        return 1;
+    }
+
+    for (x = 0; x < oldSide.prog.nameCount; x++) {
+        renamed[x] = NO_RENAME;
+    }
+
+    while (o < oldSide.prog.lineCount && n < newSide.prog.lineCount) {
+        if (oldSide.prog.lines[o].lineNumber < newSide.prog.lines[n].lineNumber) {
+            o++;
+            continue;
+        }
+
+        if (oldSide.prog.lines[o].lineNumber > newSide.prog.lines[n].lineNumber) {
+            n++;
+            continue;
+        }
+
+        if (loadLine(&oldSide, o++) != 0 || loadLine(&newSide, n++) != 0) {
+            return 1;
+        }
+
+        if (oldSide.lineSize != newSide.lineSize) {
+            continue;
+        }
+
+        for (x = 0; x < oldSide.lineSize; x++) {
+            if (oldSide.line[x]->type != TYPE_NAME || newSide.line[x]->type != TYPE_NAME) {
+                continue;
+            }
+
+            a = oldSide.line[x]->value;
+            b = newSide.line[x]->value;
+            if (oldSide.match[a] == b || renamed[a] == CONFLICT) {
+                continue;
+            }
+
+            if (renamed[a] == NO_RENAME) {
+                renamed[a] = b;
+            } else if (renamed[a] != b) {
+                renamed[a] = CONFLICT;
+                continue;
+            }
+
+            renamedLines[a]++;
+        }
+    }
+
+    /* A rename can't leave the old name in use, or take a name that was. */
+    for (x = 0; x < oldSide.prog.nameCount; x++) {
+        if (renamed[x] < 0) {
+            renamed[x] = NO_RENAME;
+            continue;
+        }
+
+        b = renamed[x];
+        if ((oldSide.match[x] != NO_MATCH && newSide.uses[oldSide.match[x]]) ||
+            (newSide.match[b] != NO_MATCH && oldSide.uses[newSide.match[b]]) ||
+            taken[b]) {
+            renamed[x] = NO_RENAME;
+            continue;
+        }
+
+        taken[b] = 1;
+    }
+
+    free(taken);
+    return 0;
+}
+
+
+/*=============================================================================
+ * SAMETOKEN() Are two tokens, one from each file, the same? Floats are
+ * compared by value, names by spelling, or by a rename.
+ *===========================================================================*/
+ushort sameToken(savToken *a, savToken *b) {
+    if (a->type >= TYPE_FP_BIN_MIN && b->type >= TYPE_FP_BIN_MIN) {
+        return qlfpDecode(a->data) == qlfpDecode(b->data);
+    }
+
+    if (a->type != b->type) {
+        return 0;
+    }
+
+    switch (a->type) {
+        case TYPE_NAME:
+            return (oldSide.match[a->value] == b->value || renamed[a->value] == b->value);
+
+        case TYPE_STRING:
+        case TYPE_TEXT:
+            return (a->code == b->code && a->value == b->value &&
+                    memcmp(a->data + 4, b->data + 4, a->value) == 0);
+    }
+
+    return a->code == b->code;
+}
+
+
+/*=============================================================================
+ * DIFFPROGRAMS() Reports the renames, then walks both programs in line number
+ * order, reporting lines that were added, removed or changed.
+ *===========================================================================*/
+void diffPrograms(void) {
+    ulong o = 0;
+    ulong n = 0;
+    ulong x;
+
+    for (x = 0; x < oldSide.prog.nameCount; x++) {
+        if (renamed[x] == NO_RENAME) {
+            continue;
+        }
+
+        stats.renames++;
+        if (!quiet) {
+            printf("= RENAMED ");
+            printName(stdout, oldSide.prog.names + x);
+            printf(" => ");
+            printName(stdout, newSide.prog.names + renamed[x]);
+            printf(", on %lu lines\n", renamedLines[x]);
+        }
+    }
+
+    while (o < oldSide.prog.lineCount || n < newSide.prog.lineCount) {
+        if (n == newSide.prog.lineCount ||
+            (o < oldSide.prog.lineCount && oldSide.prog.lines[o].lineNumber < newSide.prog.lines[n].lineNumber)) {
+            stats.removed++;
+            if (!quiet && loadLine(&oldSide, o) == 0) {
+                printf("- %d: ", oldSide.prog.lines[o].lineNumber);
+                printTokens(stdout, &oldSide.prog, oldSide.line, 0, oldSide.lineSize);
+                printf("\n");
+            }
+            o++;
+            continue;
+        }
+
+        if (o == oldSide.prog.lineCount ||
+            newSide.prog.lines[n].lineNumber < oldSide.prog.lines[o].lineNumber) {
+            stats.added++;
+            if (!quiet && loadLine(&newSide, n) == 0) {
+                printf("+ %d: ", newSide.prog.lines[n].lineNumber);
+                printTokens(stdout, &newSide.prog, newSide.line, 0, newSide.lineSize);
+                printf("\n");
+            }
+            n++;
+            continue;
+        }
+
+        diffLine(o++, n++);
+    }
+}
+
+
+/*=============================================================================
+ * DIFFLINE() Compares a line that's in both files. The tokens that are the
+ * same at the start and the end are skipped, what's left in the middle is
+ * what changed.
+ *===========================================================================*/
+void diffLine(ulong oldLine, ulong newLine) {
+    ulong prefix = 0;
+    ulong suffix = 0;
+    ulong shortest;
+
+    if (loadLine(&oldSide, oldLine) != 0 || loadLine(&newSide, newLine) != 0) {
+        return;
+    }
+
+    shortest = (oldSide.lineSize < newSide.lineSize ? oldSide.lineSize : newSide.lineSize);
+    while (prefix < shortest && sameToken(oldSide.line[prefix], newSide.line[prefix])) {
+        prefix++;
+    }
+
+    if (prefix == oldSide.lineSize && prefix == newSide.lineSize) {
+        stats.same++;
+        return;
+    }
+
+    while (suffix < shortest - prefix &&
+           sameToken(oldSide.line[oldSide.lineSize - 1 - suffix], newSide.line[newSide.lineSize - 1 - suffix])) {
+        suffix++;
+    }
+
+    stats.changed++;
+    if (quiet) {
+        return;
+    }
+
+    printf("~ %d: ", newSide.prog.lines[newLine].lineNumber);
+    printTokens(stdout, &newSide.prog, newSide.line, 0, prefix);
+    printf("%s[", (prefix ? " " : ""));
+    printTokens(stdout, &oldSide.prog, oldSide.line, prefix, oldSide.lineSize - suffix);
+    printf(" => ");
+    printTokens(stdout, &newSide.prog, newSide.line, prefix, newSide.lineSize - suffix);
+    printf("]");
+    if (suffix) {
+        printf(" ");
+    }
+    printTokens(stdout, &newSide.prog, newSide.line, newSide.lineSize - suffix, newSide.lineSize);
+    printf("\n");
+}
+
+
+/*=============================================================================
+ * PRINTTOKENS() Prints tokens first up to, but not including, last with a
+ * space between each one.
+ *===========================================================================*/
+void printTokens(FILE *fp, savProgram *prog, savToken **tokens, ulong first, ulong last) {
+    ulong x;
+
+    for (x = first; x < last; x++) {
+        if (x > first) {
+            fputc(' ', fp);
+        }
+        printToken(fp, prog, tokens[x]);
+    }
+}
+
+
+/*=============================================================================
+ * PRINTNAME() Prints a name from the name table.
+ *===========================================================================*/
+void printName(FILE *fp, savName *name) {
+    fprintf(fp, "%.*s", name->nameLength, name->name);
+}
+
+
+/*=============================================================================
+ * PRINTTOKEN() Prints one token as SuperBASIC. The end of line and
+ * multispaces are never passed in.
+ *===========================================================================*/
+void printToken(FILE *fp, savProgram *prog, savToken *token) {
+    switch (token->type) {
+        case TYPE_KEYWORD:   fprintf(fp, "%s", savKeywords[token->code]); break;
+        case TYPE_SYMBOL:    fprintf(fp, "%s", savSymbols[token->code]); break;
+        case TYPE_OPERATOR:  fprintf(fp, "%s", savOperators[token->code]); break;
+        case TYPE_MONADIC:   fprintf(fp, "%s", savMonadics[token->code]); break;
+        case TYPE_SEPARATOR: fprintf(fp, "%s", savSeparators[token->code]); break;
+        case TYPE_NAME:      printName(fp, prog->names + token->value); break;
+
+        case TYPE_STRING:
+            fprintf(fp, "%c%.*s%c", token->code, token->value, token->data + 4, token->code);
+            break;
+
+        case TYPE_TEXT:
+            fprintf(fp, "%.*s", token->value, token->data + 4);
+            break;
+
+        default:
+            fprintf(fp, "%.10g", qlfpDecode(token->data));
+            break;
+    }
+}
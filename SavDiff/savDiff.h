@@ -0,0 +1,60 @@
+#ifndef __SAVDIFF_H__
+#define __SAVDIFF_H__
+
+/*===========================================================================
+ * HEADERS
+ *===========================================================================*/
+#include "../SavFile/savFile.h"
+
+/*===========================================================================
+ * DEFINES
+ *===========================================================================*/
+#define NO_MATCH    -1              /* No name with the same spelling. */
+#define NO_RENAME   -1              /* No rename seen for this name. */
+#define CONFLICT    -2              /* Renamed to more than one name. */
+
+/*===========================================================================
+ * TYPEDEFS
+ *===========================================================================*/
+
+/* One of the two programs being compared. */
+typedef struct diffSide {
+    char       *fileName;
+    savFile    sav;
+    savProgram prog;
+    long       *match;              /* Same name in the other program. */
+    ulong      *uses;               /* How many tokens use each name. */
+    savToken   **line;              /* The current line, without spaces. */
+    ulong      lineSize;            /* Tokens in it. */
+    ulong      lineSpace;           /* And room for. */
+} diffSide;
+
+/* What changed, for the summary. */
+typedef struct diffStats {
+    ulong same;
+    ulong changed;
+    ulong added;
+    ulong removed;
+    ulong renames;
+} diffStats;
+
+/*===========================================================================
+ * FUNCTION PROTOTYPES
+ *===========================================================================*/
+ushort loadSide(diffSide *side, char *fileName);
+ushort matchNames(diffSide *from, diffSide *to);
+ushort sameName(savName *a, savName *b);
+ulong  nameHash(savName *name);
+void   countUses(diffSide *side);
+ushort loadLine(diffSide *side, ulong line);
+ushort findRenames(void);
+ushort sameToken(savToken *a, savToken *b);
+void   diffPrograms(void);
+void   diffLine(ulong oldLine, ulong newLine);
+void   printTokens(FILE *fp, savProgram *prog, savToken **tokens, ulong first, ulong last);
+void   printToken(FILE *fp, savProgram *prog, savToken *token);
+void   printName(FILE *fp, savName *name);
+
+/*===========================================================================*/
+
+#endif /* __SAVDIFF_H__ */
@@ -0,0 +1,1188 @@
+/*=============================================================================
+ * In memory SAV file decoder, shared by the various SAV file tools.
+ *
+ * The C68Port converter and the Lister read a SAV file a byte or a word at a
+ * time with stdio. That's fine for one file, but hopeless for thousands, so
+ * this version reads the whole file into a buffer, in one go, and decodes it
+ * from there. Every read is checked against the end of the buffer, and every
+ * table index is checked against the size of the table, so a corrupt file
+ * can only ever produce an error, never a hang or a stray read.
+ *
+ * Each token takes at least two bytes of the buffer, so decoding a file
+ * takes time linear in the file size, whatever the contents.
+ *===========================================================================*/
+
+/*===========================================================================
+ * HEADERS
+ *===========================================================================*/
+#include <math.h>
+
+#include "savFile.h"
+
+/*===========================================================================
+ * GLOBALS
+ *===========================================================================*/
+static ulong savRandomState = 1;    /* xorshift32 state, never zero. */
+
+/* These are the same tables that C68Port and the Lister use. Entry zero is
+ * unused as the SAV file counts from 1. */
+char *savKeywords[] = {
+    "",
+    "END", "FOR", "IF", "REPeat", "SELect", "WHEN", "DEFine",
+    "PROCedure", "FuNction", "GO", "TO", "SUB", "", "ERRor", "",
+    "", "RESTORE", "NEXT", "EXIT", "ELSE", "ON", "RETurn",
+    "REMAINDER", "DATA", "DIM", "LOCal", "LET", "THEN", "STEP",
+    "REMark", "MISTake"
+};
+
+char *savSymbols[] = {
+    "", "=", ":", "#", ",", "(", ")", "{", "}", " ", "\n"
+};
+
+char *savOperators[] = {
+    "",
+    "+", "-", "*", "/", ">=", ">", "==", "=", "<>", "<=", "<",
+    "||", "&&", "^^", "^", "&", "OR", "AND", "XOR", "MOD",
+    "DIV", "INSTR"
+};
+
+char *savMonadics[] = {
+    "", "+", "-", "~~", "NOT"
+};
+
+char *savSeparators[] = {
+    "", ",", ";", "\\", "!", "TO"
+};
+
+
+/*=============================================================================
+ * SAVINITFILE() Sets up an empty savFile structure, ready for use by
+ * savReadFile().
+ *===========================================================================*/
+void savInitFile(savFile *sav) {
+    memset(sav, 0, sizeof(savFile));
+}
+
+
+/*=============================================================================
+ * SAVFREEFILE() Releases the buffer and name table. The structure can be
+ * used again afterwards.
+ *===========================================================================*/
+void savFreeFile(savFile *sav) {
+    if (sav->buffer) {
+        free(sav->buffer);
+    }
+
+    if (sav->names) {
+        free(sav->names);
+    }
+
+    savInitFile(sav);
+}
+
+
+/*=============================================================================
+ * SAVREADFILE() Reads the whole of a SAV file into memory, then decodes the
+ * header and name table. The buffer is only reallocated if this file is
+ * bigger than the biggest one read so far.
+ *===========================================================================*/
+ushort savReadFile(char *fileName, savFile *sav) {
+    FILE *fp;
+    long fileSize;
+    uchar *temp;
+
+    sav->fileName = fileName;
+    sav->size = 0;
+
+    fp = fopen(fileName, "rb");
+    if (!fp) {
+        fprintf(stderr, "\n\nERROR: savReadFile(): Cannot open SAV file '%s'.\n", fileName);
+        return SAV_ERROR;
+    }
+
+    fseek(fp, 0, SEEK_END);
+    fileSize = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+
+    if (fileSize < SAV_HEADER_SIZE) {
+        fprintf(stderr, "\n\nERROR: savReadFile(): '%s' is too small to be a SAV file.\n", fileName);
+        fclose(fp);
+        return SAV_ERROR;
+    }
+
+    /* Do we need a bigger buffer? */
+    if ((ulong)fileSize > sav->bufferSize) {
+        temp = realloc(sav->buffer, fileSize);
+        if (!temp) {
+            fprintf(stderr, "\n\nERROR: savReadFile(): Cannot allocate %ld bytes for '%s'.\n", fileSize, fileName);
+            fclose(fp);
+            return SAV_ERROR;
+        }
+
+        sav->buffer = temp;
+        sav->bufferSize = fileSize;
+    }
+
+    if (fread(sav->buffer, 1, fileSize, fp) != (size_t)fileSize) {
+        fprintf(stderr, "\n\nERROR: savReadFile(): Cannot read '%s'.\n", fileName);
+        fclose(fp);
+        return SAV_ERROR;
+    }
+
+    fclose(fp);
+    sav->size = fileSize;
+
+    return savLoadBuffer(sav);
+}
+
+
+/*=============================================================================
+ * SAVLOADBUFFER() Decodes the header and name table of a SAV file that is
+ * already in the buffer. Useful when the file didn't come from disc.
+ *===========================================================================*/
+ushort savLoadBuffer(savFile *sav) {
+    if (savDecodeHeader(sav) != SAV_OK) {
+        return SAV_ERROR;
+    }
+
+    return savDecodeNameTable(sav);
+}
+
+
+/*=============================================================================
+ * SAVDECODEHEADER() Decodes the header of the SAV file and makes sure it's
+ * valid. Valid values are:
+ *
+ * 'Q', '1', 0, 0
+ * 'Q', '1', 2, 192
+ * 'Q', '1', 3, 128
+ * 'Q', '1', 0, 128
+ *===========================================================================*/
+ushort savDecodeHeader(savFile *sav) {
+    uchar *head = sav->buffer;
+    ushort valid = 0;
+
+    if (sav->size < SAV_HEADER_SIZE) {
+        fprintf(stderr, "\n\nERROR: savDecodeHeader(): Cannot read SAV file header.\n");
+        return SAV_ERROR;
+    }
+
+    if (head[0] == 'Q' && head[1] == '1') {
+        if (head[2] == 0 && head[3] == 0)
+            valid = 1;
+
+        else if (head[2] == 0 && head[3] == 128)
+            valid = 1;
+
+        else if (head[2] == 2 && head[3] == 192)
+            valid = 1;
+
+        else if (head[2] == 3 && head[3] == 128)
+            valid = 1;
+    }
+
+    if (!valid) {
+        fprintf(stderr, "\n\nERROR: savDecodeHeader(): Invalid SAV file header. [\"%c%c\",%d,%d]\n", head[0], head[1], head[2], head[3]);
+        return SAV_ERROR;
+    }
+
+    sav->flags[0] = head[2];
+    sav->flags[1] = head[3];
+    sav->nameTableEntries = savGetWord(head + 4);
+    sav->nameTableLength = savGetWord(head + 6);
+    sav->programLines = savGetWord(head + 8);
+
+    return SAV_OK;
+}
+
+
+/*=============================================================================
+ * SAVDECODENAMETABLE() Builds the name table from the SAV file's name table.
+ * Nothing is copied, the names point into the buffer. Each entry is:
+ *
+ * Word: Name type.
+ * Word: Line number, for PROCs and FNs.
+ * Word: Name length.
+ * Bytes: The name, padded to an even length.
+ *===========================================================================*/
+ushort savDecodeNameTable(savFile *sav) {
+    ushort x;
+    ulong pos = SAV_HEADER_SIZE;
+    savName *temp;
+
+    /* Do we need a bigger name table? */
+    if (sav->nameTableEntries > sav->namesSize) {
+        temp = realloc(sav->names, sav->nameTableEntries * sizeof(savName));
+        if (!temp) {
+            fprintf(stderr, "\n\nERROR: savDecodeNameTable(): Cannot allocate memory for name table. (%d entries).\n", sav->nameTableEntries);
+            return SAV_ERROR;
+        }
+
+        sav->names = temp;
+        sav->namesSize = sav->nameTableEntries;
+    }
+
+    for (x = 0; x < sav->nameTableEntries; x++) {
+        if (pos + SAV_NAME_HEADER_SIZE > sav->size) {
+            fprintf(stderr, "\n\nERROR: savDecodeNameTable(): Name table entry %d runs off the end of the file.\n", x);
+            return SAV_ERROR;
+        }
+
+        sav->names[x].offset = pos;
+        sav->names[x].nameType = savGetWord(sav->buffer + pos);
+        sav->names[x].lineNumber = (short)savGetWord(sav->buffer + pos + 2);
+        sav->names[x].nameLength = savGetWord(sav->buffer + pos + 4);
+        sav->names[x].name = sav->buffer + pos + SAV_NAME_HEADER_SIZE;
+
+        /* Odd length names are padded. */
+        pos += SAV_NAME_HEADER_SIZE + sav->names[x].nameLength + (sav->names[x].nameLength & 1);
+        if (pos > sav->size) {
+            fprintf(stderr, "\n\nERROR: savDecodeNameTable(): Name table entry %d runs off the end of the file.\n", x);
+            return SAV_ERROR;
+        }
+
+        /* Keep the pad byte, it isn't always zero. */
+        sav->names[x].padding = (sav->names[x].nameLength & 1 ? sav->buffer[pos - 1] : 0);
+    }
+
+    sav->programOffset = pos;
+    return SAV_OK;
+}
+
+
+/*=============================================================================
+ * SAVNEXTLINE() Reads the start of the program line at *pos, which is:
+ *
+ * Word: Line length change from previous line.
+ * Word: 0x8D00 (TYPE_LINENUMBER) Indicates a line number to follow.
+ * Word: The line number.
+ *
+ * On return, *pos is the address of the first token. Returns SAV_END when
+ * there are no more lines.
+ *===========================================================================*/
+ushort savNextLine(savFile *sav, ulong *pos, savLine *line) {
+    uchar *p;
+    ushort flag;
+
+    if (*pos >= sav->size) {
+        return SAV_END;
+    }
+
+    if (*pos + SAV_LINE_HEADER_SIZE > sav->size) {
+        fprintf(stderr, "\n\nERROR: savNextLine(): Truncated program line at offset %ld ($%08lx).\n", *pos, *pos);
+        return SAV_ERROR;
+    }
+
+    p = sav->buffer + *pos;
+    if ((flag = savGetWord(p + 2)) != TYPE_LINENUMBER) {
+        fprintf(stderr, "\n\nERROR: savNextLine(): Program out of step at offset %ld ($%08lx).\n", *pos, *pos);
+        fprintf(stderr, "Expected 0x8D00, found 0x%X.\n", flag);
+        return SAV_ERROR;
+    }
+
+    line->offset = *pos;
+    line->sizeChange = (short)savGetWord(p);
+    line->lineNumber = savGetWord(p + 4);
+    line->first = *pos + SAV_LINE_HEADER_SIZE;
+
+    *pos = line->first;
+    return SAV_OK;
+}
+
+
+/*=============================================================================
+ * SAVNEXTTOKEN() Decodes the token at *pos and moves *pos past it. Nothing is
+ * trusted, every length and index is checked before use.
+ *===========================================================================*/
+ushort savNextToken(savFile *sav, ulong *pos, savToken *token) {
+    uchar *p;
+    ulong left;
+    uchar limit = 0;
+
+    if (*pos + 2 > sav->size) {
+        fprintf(stderr, "\n\nERROR: savNextToken(): Unexpected end of file at offset %ld ($%08lx).\n", *pos, *pos);
+        return SAV_ERROR;
+    }
+
+    p = sav->buffer + *pos;
+    left = sav->size - *pos;
+
+    token->offset = *pos;
+    token->type = p[0];
+    token->code = p[1];
+    token->value = 0;
+    token->size = 2;
+    token->data = p;
+    token->padding = 0;
+
+    switch (token->type) {
+        case TYPE_MULTISPACE: break;
+        case TYPE_KEYWORD:    limit = SAV_KEYWORDS; break;
+        case TYPE_SYMBOL:     limit = SAV_SYMBOLS; break;
+        case TYPE_OPERATOR:   limit = SAV_OPERATORS; break;
+        case TYPE_MONADIC:    limit = SAV_MONADICS; break;
+        case TYPE_SEPARATOR:  limit = SAV_SEPARATORS; break;
+
+        case TYPE_NAME:
+            /* 0x8800.0xnnnn = name[0xnnnn] */
+            token->size = 4;
+            if (left < 4) {
+                break;
+            }
+
+            token->value = savGetWord(p + 2);
+            if (token->value >= sav->nameTableEntries) {
+                fprintf(stderr, "\n\nERROR: savNextToken(): At offset %ld ($%08lx), name %d is not in the name table.\n", *pos, *pos, token->value);
+                return SAV_ERROR;
+            }
+            break;
+
+        case TYPE_STRING:
+        case TYPE_TEXT:
+            /* 0x8B.delim.size.bytes.[padding]
+             * 0x8C.00.size.bytes.[padding] */
+            token->size = 4;
+            if (left < 4) {
+                break;
+            }
+
+            token->value = savGetWord(p + 2);
+            token->size += token->value + (token->value & 1);
+            break;
+
+        /* Floats come in three formats, each with 16 leading bytes! */
+        case TYPE_FP_BIN_MIN ... TYPE_FP_BIN_MAX:
+        case TYPE_FP_HEX_MIN ... TYPE_FP_HEX_MAX:
+        case TYPE_FP_DEC_MIN ... TYPE_FP_DEC_MAX:
+            token->size = SAV_FLOAT_SIZE;
+            break;
+
+        default:
+            fprintf(stderr, "\n\nERROR: savNextToken(): At offset %ld ($%08lx), read byte %d. Out of sync.\n", *pos, *pos, token->type);
+            return SAV_ERROR;
+    }
+
+    /* Table lookups must be in range. */
+    if (limit && (token->code == 0 || token->code > limit)) {
+        fprintf(stderr, "\n\nERROR: savNextToken(): At offset %ld ($%08lx), index %d is out of range for type $%2X.\n", *pos, *pos, token->code, token->type);
+        return SAV_ERROR;
+    }
+
+    if (token->size > left) {
+        fprintf(stderr, "\n\nERROR: savNextToken(): Token at offset %ld ($%08lx) runs off the end of the file.\n", *pos, *pos);
+        return SAV_ERROR;
+    }
+
+    /* Strings and text keep their pad byte. */
+    if ((token->type == TYPE_STRING || token->type == TYPE_TEXT) && (token->value & 1)) {
+        token->padding = p[token->size - 1];
+    }
+
+    *pos += token->size;
+    return SAV_OK;
+}
+
+
+/*=============================================================================
+ * SAVGETWORD() Returns the big endian word at the given address. This works
+ * the same whatever the endian-ness of the host.
+ *===========================================================================*/
+ushort savGetWord(uchar *bytes) {
+    return (ushort)((bytes[0] << 8) | bytes[1]);
+}
+
+
+/*=============================================================================
+ * QLFPDECODE() Converts the 6 bytes of a QL floating point value, straight
+ * from the buffer, to a double. The top nibble of the first byte is the D, E
+ * or F type marker and is ignored. The rest is a 12 bit exponent, offset by
+ * 0x800, and a 32 bit two's complement mantissa with the binary point after
+ * the sign bit. This doesn't care about the size of a long, or endian-ness.
+ *===========================================================================*/
+double qlfpDecode(uchar *bytes) {
+    int exponent = ((bytes[0] & 0x0F) << 8) | bytes[1];
+    ulong mantissa = ((ulong)bytes[2] << 24) | ((ulong)bytes[3] << 16) |
+                     ((ulong)bytes[4] << 8) | (ulong)bytes[5];
+    double value;
+
+    /* Simple case first, is it zero? */
+    if (exponent == 0 && mantissa == 0) {
+        return 0.0;
+    }
+
+    /* Negative? */
+    if (mantissa & 0x80000000UL) {
+        value = -(double)((~mantissa + 1) & 0xFFFFFFFFUL);
+    } else {
+        value = (double)mantissa;
+    }
+
+    return ldexp(value, exponent - 0x800 - 31);
+}
+
+
+/*=============================================================================
+ * QLFPENCODE() The reverse of qlfpDecode(). Converts a double to the 6 bytes
+ * of a QL floating point value, with the D, E or F type marker for a binary,
+ * hexadecimal or decimal (QLFP_BINARY etc) value.
+ *===========================================================================*/
+void qlfpEncode(double value, uchar fpType, uchar *bytes) {
+    uchar marker = TYPE_FP_BIN_MIN + (fpType << 4);
+    int exponent;
+    double fraction;
+    ulong mantissa;
+
+    memset(bytes, 0, SAV_FLOAT_SIZE);
+    bytes[0] = marker;
+
+    if (value == 0.0) {
+        return;
+    }
+
+    /* Fraction is 0.5 <= fraction < 1.0 */
+    fraction = frexp(fabs(value), &exponent);
+    mantissa = (ulong)floor(ldexp(fraction, 31) + 0.5);
+
+    /* Rounding may have overflowed. */
+    if (mantissa >= 0x80000000UL) {
+        mantissa = 0x40000000UL;
+        exponent++;
+    }
+
+    if (value < 0) {
+        if (mantissa == 0x40000000UL) {
+            /* -0.5 normalises to -1.0 with a smaller exponent. */
+            mantissa = 0x80000000UL;
+            exponent--;
+        } else {
+            mantissa = (~mantissa + 1) & 0xFFFFFFFFUL;
+        }
+    }
+
+    exponent += 0x800;
+
+    /* Too small is zero, too big is as big as we can get. */
+    if (exponent < 0) {
+        return;
+    }
+
+    if (exponent > 0xFFF) {
+        exponent = 0xFFF;
+        mantissa = (value < 0 ? 0x80000000UL : 0x7FFFFFFFUL);
+    }
+
+    bytes[0] = marker | ((exponent >> 8) & 0x0F);
+    bytes[1] = exponent & 0xFF;
+    bytes[2] = (mantissa >> 24) & 0xFF;
+    bytes[3] = (mantissa >> 16) & 0xFF;
+    bytes[4] = (mantissa >> 8) & 0xFF;
+    bytes[5] = mantissa & 0xFF;
+}
+
+
+/*=============================================================================
+ * SAVINITBUFFER() Sets up an empty output buffer.
+ *===========================================================================*/
+void savInitBuffer(savBuffer *out) {
+    memset(out, 0, sizeof(savBuffer));
+}
+
+
+/*=============================================================================
+ * SAVFREEBUFFER() Releases an output buffer. It can be used again afterwards.
+ *===========================================================================*/
+void savFreeBuffer(savBuffer *out) {
+    if (out->buffer) {
+        free(out->buffer);
+    }
+
+    savInitBuffer(out);
+}
+
+
+/*=============================================================================
+ * SAVRESERVE() Makes sure there is room for another 'bytes' bytes in the
+ * output buffer. The buffer doubles in size, so building a file is linear in
+ * its size. Returns 0 if there is room, 1 if not.
+ *===========================================================================*/
+ushort savReserve(savBuffer *out, ulong bytes) {
+    ulong space;
+    uchar *temp;
+
+    if (out->failed) {
+        return 1;
+    }
+
+    if (out->size + bytes <= out->space) {
+        return 0;
+    }
+
+    space = (out->space ? out->space : 4096);
+    while (space < out->size + bytes) {
+        space *= 2;
+    }
+
+    temp = realloc(out->buffer, space);
+    if (!temp) {
+        fprintf(stderr, "\n\nERROR: savReserve(): Cannot allocate %ld bytes for output.\n", space);
+        out->failed = 1;
+        return 1;
+    }
+
+    out->buffer = temp;
+    out->space = space;
+    return 0;
+}
+
+
+/*=============================================================================
+ * SAVPUTBYTE() Adds a single byte to the output buffer.
+ *===========================================================================*/
+void savPutByte(savBuffer *out, uchar byte) {
+    if (savReserve(out, 1) == 0) {
+        out->buffer[out->size++] = byte;
+    }
+}
+
+
+/*=============================================================================
+ * SAVPUTWORD() Adds a big endian word to the output buffer.
+ *===========================================================================*/
+void savPutWord(savBuffer *out, ushort word) {
+    if (savReserve(out, 2) == 0) {
+        out->buffer[out->size++] = (word >> 8) & 0xFF;
+        out->buffer[out->size++] = word & 0xFF;
+    }
+}
+
+
+/*=============================================================================
+ * SAVPUTBYTES() Adds any number of bytes to the output buffer.
+ *===========================================================================*/
+void savPutBytes(savBuffer *out, uchar *bytes, ulong size) {
+    if (size && savReserve(out, size) == 0) {
+        memcpy(out->buffer + out->size, bytes, size);
+        out->size += size;
+    }
+}
+
+
+/*=============================================================================
+ * SAVPUTHEADER() Adds the 10 byte SAV file header. The flags are header bytes
+ * 2 and 3, NULL means 0, 0.
+ *===========================================================================*/
+void savPutHeader(savBuffer *out, uchar *flags, ushort entries, ushort length, ushort lines) {
+    savPutByte(out, 'Q');
+    savPutByte(out, '1');
+    savPutByte(out, (flags ? flags[0] : 0));
+    savPutByte(out, (flags ? flags[1] : 0));
+    savPutWord(out, entries);
+    savPutWord(out, length);
+    savPutWord(out, lines);
+}
+
+
+/*=============================================================================
+ * SAVPUTNAMEENTRY() Adds one name table entry. Odd length names are padded.
+ *===========================================================================*/
+void savPutNameEntry(savBuffer *out, ushort nameType, short lineNumber, uchar *name, ushort nameLength) {
+    savPutWord(out, nameType);
+    savPutWord(out, (ushort)lineNumber);
+    savPutWord(out, nameLength);
+    savPutBytes(out, name, nameLength);
+
+    if (nameLength & 1) {
+        savPutByte(out, 0);
+    }
+}
+
+
+/*=============================================================================
+ * SAVBEGINLINE() Starts a new program line. The size change word isn't known
+ * until the line is finished, so savEndLine() fills it in.
+ *===========================================================================*/
+void savBeginLine(savBuffer *out, ushort lineNumber) {
+    out->lineStart = out->size;
+    savPutWord(out, 0);
+    savPutWord(out, TYPE_LINENUMBER);
+    savPutWord(out, lineNumber);
+}
+
+
+/*=============================================================================
+ * SAVENDLINE() Finishes the current program line with the 0x840A end of line
+ * symbol, then fills in the change in size from the previous line. The line
+ * size runs from the 0x8D00 to the 0x840A, inclusive.
+ *===========================================================================*/
+void savEndLine(savBuffer *out) {
+    ushort lineSize;
+    ushort sizeChange;
+
+    savPutToken(out, TYPE_SYMBOL, SYMBOL_EOL);
+    if (out->failed) {
+        return;
+    }
+
+    lineSize = out->size - out->lineStart - 2;
+    sizeChange = lineSize - out->lastLineSize;
+    out->buffer[out->lineStart] = (sizeChange >> 8) & 0xFF;
+    out->buffer[out->lineStart + 1] = sizeChange & 0xFF;
+
+    out->lastLineSize = lineSize;
+    out->lines++;
+}
+
+
+/*=============================================================================
+ * SAVPUTTOKEN() Adds a two byte token, a keyword, symbol, operator, monadic,
+ * separator or multispace.
+ *===========================================================================*/
+void savPutToken(savBuffer *out, uchar type, uchar code) {
+    if (savReserve(out, 2) == 0) {
+        out->buffer[out->size++] = type;
+        out->buffer[out->size++] = code;
+    }
+}
+
+
+/*=============================================================================
+ * SAVPUTNAME() Adds a 0x8800.0xnnnn name token.
+ *===========================================================================*/
+void savPutName(savBuffer *out, ushort entry) {
+    savPutToken(out, TYPE_NAME, 0);
+    savPutWord(out, entry);
+}
+
+
+/*=============================================================================
+ * SAVPUTSTRING() Adds a TYPE_STRING or TYPE_TEXT token, padded if the size is
+ * odd. Text has a zero delimiter.
+ *===========================================================================*/
+void savPutString(savBuffer *out, uchar type, uchar delim, uchar *text, ushort size) {
+    savPutToken(out, type, (type == TYPE_TEXT ? 0 : delim));
+    savPutWord(out, size);
+    savPutBytes(out, text, size);
+
+    if (size & 1) {
+        savPutByte(out, 0);
+    }
+}
+
+
+/*=============================================================================
+ * SAVPUTFLOAT() Adds a binary, hexadecimal or decimal floating point value.
+ *===========================================================================*/
+void savPutFloat(savBuffer *out, double value, uchar fpType) {
+    uchar bytes[SAV_FLOAT_SIZE];
+
+    qlfpEncode(value, fpType, bytes);
+    savPutBytes(out, bytes, SAV_FLOAT_SIZE);
+}
+
+
+/*=============================================================================
+ * SAVWRITEBUFFER() Writes the output buffer to a file. Returns SAV_ERROR if
+ * the buffer ran out of memory at any point, or the write fails.
+ *===========================================================================*/
+ushort savWriteBuffer(FILE *fp, savBuffer *out) {
+    if (out->failed) {
+        fprintf(stderr, "\n\nERROR: savWriteBuffer(): Output is incomplete, out of memory.\n");
+        return SAV_ERROR;
+    }
+
+    if (fwrite(out->buffer, 1, out->size, fp) != out->size) {
+        fprintf(stderr, "\n\nERROR: savWriteBuffer(): Cannot write output.\n");
+        return SAV_ERROR;
+    }
+
+    return SAV_OK;
+}
+
+
+/*=============================================================================
+ * SAVINITPROGRAM() Sets up an empty program.
+ *===========================================================================*/
+void savInitProgram(savProgram *prog) {
+    memset(prog, 0, sizeof(savProgram));
+}
+
+
+/*=============================================================================
+ * SAVFREEPROGRAM() Frees the program's arrays. The savFile it came from, if
+ * any, is not touched.
+ *===========================================================================*/
+void savFreeProgram(savProgram *prog) {
+    free(prog->names);
+    free(prog->lines);
+    free(prog->tokens);
+    savInitProgram(prog);
+}
+
+
+/*=============================================================================
+ * SAVGROW() Makes sure that an array has room for one more item, doubling it
+ * if not.
+ *===========================================================================*/
+static ushort savGrow(void **array, ulong *space, ulong used, size_t itemSize, char *what) {
+    ulong newSpace;
+    void *temp;
+
+    if (used < *space) {
+        return SAV_OK;
+    }
+
+    newSpace = (*space ? *space * 2 : 256);
+    temp = realloc(*array, newSpace * itemSize);
+    if (!temp) {
+        fprintf(stderr, "\n\nERROR: savGrow(): Cannot allocate memory for %ld %s.\n", newSpace, what);
+        return SAV_ERROR;
+    }
+
+    *array = temp;
+    *space = newSpace;
+    return SAV_OK;
+}
+
+
+/*=============================================================================
+ * SAVADDNAME() Adds a copy of the name to the end of the name table.
+ *===========================================================================*/
+ushort savAddName(savProgram *prog, savName *name) {
+    if (savGrow((void **)&prog->names, &prog->namesSize, prog->nameCount, sizeof(savName), "names") != SAV_OK) {
+        return SAV_ERROR;
+    }
+
+    prog->names[prog->nameCount++] = *name;
+    return SAV_OK;
+}
+
+
+/*=============================================================================
+ * SAVADDLINE() Adds a new, empty, line to the end of the program. Tokens
+ * added with savAddToken() go on this line.
+ *===========================================================================*/
+ushort savAddLine(savProgram *prog, ushort lineNumber) {
+    savProgLine *line;
+
+    if (savGrow((void **)&prog->lines, &prog->linesSize, prog->lineCount, sizeof(savProgLine), "lines") != SAV_OK) {
+        return SAV_ERROR;
+    }
+
+    line = prog->lines + prog->lineCount++;
+    line->offset = 0;
+    line->lineNumber = lineNumber;
+    line->first = prog->tokenCount;
+    line->count = 0;
+    return SAV_OK;
+}
+
+
+/*=============================================================================
+ * SAVADDTOKEN() Adds a copy of the token to the last line of the program.
+ *===========================================================================*/
+ushort savAddToken(savProgram *prog, savToken *token) {
+    if (!prog->lineCount) {
+        fprintf(stderr, "\n\nERROR: savAddToken(): There is no line to add the token to.\n");
+        return SAV_ERROR;
+    }
+
+    if (savGrow((void **)&prog->tokens, &prog->tokensSize, prog->tokenCount, sizeof(savToken), "tokens") != SAV_OK) {
+        return SAV_ERROR;
+    }
+
+    prog->tokens[prog->tokenCount++] = *token;
+    prog->lines[prog->lineCount - 1].count++;
+    return SAV_OK;
+}
+
+
+/*=============================================================================
+ * SAVDECODEPROGRAM() Decodes the whole of a SAV file, read by savReadFile(),
+ * into a program. The end of line tokens are dropped, everything else is
+ * kept exactly as it was, so that encoding the program again gives back the
+ * same file.
+ *===========================================================================*/
+ushort savDecodeProgram(savFile *sav, savProgram *prog) {
+    savLine line;
+    savToken token;
+    ulong pos;
+    ushort result;
+    ushort x;
+
+    prog->flags[0] = sav->flags[0];
+    prog->flags[1] = sav->flags[1];
+    prog->nameTableLength = sav->nameTableLength;
+    prog->programLines = sav->programLines;
+    prog->nameCount = 0;
+    prog->lineCount = 0;
+    prog->tokenCount = 0;
+
+    for (x = 0; x < sav->nameTableEntries; x++) {
+        if (savAddName(prog, sav->names + x) != SAV_OK) {
+            return SAV_ERROR;
+        }
+    }
+
+    pos = sav->programOffset;
+    while ((result = savNextLine(sav, &pos, &line)) == SAV_OK) {
+        if (savAddLine(prog, line.lineNumber) != SAV_OK) {
+            return SAV_ERROR;
+        }
+
+        prog->lines[prog->lineCount - 1].offset = line.offset;
+        for (;;) {
+            if (savNextToken(sav, &pos, &token) != SAV_OK) {
+                return SAV_ERROR;
+            }
+
+            if (token.type == TYPE_SYMBOL && token.code == SYMBOL_EOL) {
+                break;
+            }
+
+            if (savAddToken(prog, &token) != SAV_OK) {
+                return SAV_ERROR;
+            }
+        }
+    }
+
+    return (result == SAV_END ? SAV_OK : SAV_ERROR);
+}
+
+
+/*=============================================================================
+ * SAVCOUNTPROGRAM() Sets the header's name table length and line count from
+ * the program, after it has been edited. Both saturate at 65535.
+ *===========================================================================*/
+void savCountProgram(savProgram *prog) {
+    ulong length = 0;
+    ulong x;
+
+    for (x = 0; x < prog->nameCount; x++) {
+        length += prog->names[x].nameLength + 1;
+    }
+
+    prog->nameTableLength = (length > 0xFFFF ? 0xFFFF : length);
+    prog->programLines = (prog->lineCount > 0xFFFF ? 0xFFFF : prog->lineCount);
+}
+
+
+/*=============================================================================
+ * SAVENCODETOKEN() Adds a token from a decoded program. The type, code and
+ * value are used as they are, only string bytes and floats come from data.
+ *===========================================================================*/
+void savEncodeToken(savBuffer *out, savToken *token) {
+    switch (token->type) {
+        case TYPE_NAME:
+            savPutToken(out, token->type, token->code);
+            savPutWord(out, token->value);
+            break;
+
+        case TYPE_STRING:
+        case TYPE_TEXT:
+            savPutToken(out, token->type, token->code);
+            savPutWord(out, token->value);
+            savPutBytes(out, token->data + 4, token->value);
+            if (token->value & 1) {
+                savPutByte(out, token->padding);
+            }
+            break;
+
+        case TYPE_FP_BIN_MIN ... TYPE_FP_BIN_MAX:
+        case TYPE_FP_HEX_MIN ... TYPE_FP_HEX_MAX:
+        case TYPE_FP_DEC_MIN ... TYPE_FP_DEC_MAX:
+            savPutByte(out, token->type);
+            savPutBytes(out, token->data + 1, SAV_FLOAT_SIZE - 1);
+            break;
+
+        default:
+            savPutToken(out, token->type, token->code);
+            break;
+    }
+}
+
+
+/*=============================================================================
+ * SAVENCODEPROGRAM() Adds a whole SAV file for the program to the buffer, in
+ * one pass. The space needed is worked out first and reserved in one go.
+ * Line size changes are worked out as the lines are written, and the end of
+ * line tokens and padding are put back. Name tokens are checked against the
+ * name table, so an edit can't make a file that won't load.
+ *===========================================================================*/
+ushort savEncodeProgram(savProgram *prog, savBuffer *out) {
+    ulong bytes = SAV_HEADER_SIZE;
+    ulong x;
+    ulong t;
+    savName *name;
+    savProgLine *line;
+    savToken *token;
+
+    if (prog->nameCount > 0xFFFF) {
+        fprintf(stderr, "\n\nERROR: savEncodeProgram(): Too many names, %ld.\n", prog->nameCount);
+        return SAV_ERROR;
+    }
+
+    /* How much room will it take? */
+    for (x = 0; x < prog->nameCount; x++) {
+        bytes += SAV_NAME_HEADER_SIZE + prog->names[x].nameLength + (prog->names[x].nameLength & 1);
+    }
+
+    for (x = 0; x < prog->lineCount; x++) {
+        bytes += SAV_LINE_HEADER_SIZE + 2;
+        line = prog->lines + x;
+        for (t = line->first; t < line->first + line->count; t++) {
+            token = prog->tokens + t;
+            switch (token->type) {
+                case TYPE_NAME:
+                    if (token->value >= prog->nameCount) {
+                        fprintf(stderr, "\n\nERROR: savEncodeProgram(): Line %d uses name %d, which is not in the name table.\n", line->lineNumber, token->value);
+                        return SAV_ERROR;
+                    }
+                    bytes += 4;
+                    break;
+
+                case TYPE_STRING:
+                case TYPE_TEXT:
+                    bytes += 4 + token->value + (token->value & 1);
+                    break;
+
+                default:
+                    bytes += (token->type >= TYPE_FP_BIN_MIN ? SAV_FLOAT_SIZE : 2);
+                    break;
+            }
+        }
+    }
+
+    if (savReserve(out, bytes) != 0) {
+        return SAV_ERROR;
+    }
+
+    savPutHeader(out, prog->flags, prog->nameCount, prog->nameTableLength, prog->programLines);
+
+    for (x = 0; x < prog->nameCount; x++) {
+        name = prog->names + x;
+        savPutWord(out, name->nameType);
+        savPutWord(out, (ushort)name->lineNumber);
+        savPutWord(out, name->nameLength);
+        savPutBytes(out, name->name, name->nameLength);
+        if (name->nameLength & 1) {
+            savPutByte(out, name->padding);
+        }
+    }
+
+    out->lastLineSize = 0;
+    out->lines = 0;
+    for (x = 0; x < prog->lineCount; x++) {
+        line = prog->lines + x;
+        savBeginLine(out, line->lineNumber);
+        for (t = line->first; t < line->first + line->count; t++) {
+            savEncodeToken(out, prog->tokens + t);
+        }
+        savEndLine(out);
+    }
+
+    return (out->failed ? SAV_ERROR : SAV_OK);
+}
+
+
+/*=============================================================================
+ * SAVWRITEPROGRAM() Encodes the program and writes it to a file.
+ *===========================================================================*/
+ushort savWriteProgram(char *fileName, savProgram *prog) {
+    savBuffer out;
+    FILE *fp;
+    ushort result;
+
+    savInitBuffer(&out);
+    if (savEncodeProgram(prog, &out) != SAV_OK) {
+        savFreeBuffer(&out);
+        return SAV_ERROR;
+    }
+
+    fp = fopen(fileName, "wb");
+    if (!fp) {
+        fprintf(stderr, "\n\nERROR: savWriteProgram(): Cannot open file '%s' for writing.\n", fileName);
+        savFreeBuffer(&out);
+        return SAV_ERROR;
+    }
+
+    result = savWriteBuffer(fp, &out);
+    if (fclose(fp) != 0) {
+        result = SAV_ERROR;
+    }
+
+    savFreeBuffer(&out);
+    return result;
+}
+
+
+/*=============================================================================
+ * SAVSKIPSPACES() Returns the index of the first token from t onwards that
+ * isn't a multispace, or end if there isn't one.
+ *===========================================================================*/
+ulong savSkipSpaces(savToken *tokens, ulong t, ulong end) {
+    while (t < end && tokens[t].type == TYPE_MULTISPACE) {
+        t++;
+    }
+
+    return t;
+}
+
+
+/*=============================================================================
+ * SAVENDOFLIST() Does the token end a list of line numbers? A colon, or a
+ * keyword like ELSE or REMark, does.
+ *===========================================================================*/
+static ushort savEndOfList(savToken *token) {
+    return (token->type == TYPE_KEYWORD ||
+            (token->type == TYPE_SYMBOL && token->code == SYMBOL_COLON));
+}
+
+
+/*=============================================================================
+ * SAVSCANTARGETS() Passes each line number in the list starting at token t to
+ * func. Anything other than a list of whole numbers is an expression, and
+ * func is told so, once. RESTORE may have nothing at all after it.
+ *===========================================================================*/
+static void savScanTargets(savToken *tokens, ulong t, ulong end, ushort allowEmpty,
+                           ulong line, SAVTARGETFUNC func, void *data) {
+    double lineNumber;
+    ulong number;
+
+    t = savSkipSpaces(tokens, t, end);
+    if (t == end || savEndOfList(tokens + t)) {
+        if (!allowEmpty) {
+            func(NULL, 0, line, data);
+        }
+        return;
+    }
+
+    for (;;) {
+        number = t;
+        if (tokens[number].type < TYPE_FP_BIN_MIN) {
+            func(NULL, 0, line, data);
+            return;
+        }
+
+        lineNumber = qlfpDecode(tokens[number].data);
+        if (lineNumber < 0 || lineNumber > 65535 || lineNumber != (ushort)lineNumber) {
+            func(NULL, 0, line, data);
+            return;
+        }
+
+        /* A number followed by anything but a comma is an expression. */
+        t = savSkipSpaces(tokens, t + 1, end);
+        if (t < end && !savEndOfList(tokens + t) &&
+            (tokens[t].type != TYPE_SEPARATOR || tokens[t].code != SEPARATOR_COMMA)) {
+            func(NULL, 0, line, data);
+            return;
+        }
+
+        func(tokens + number, (ushort)lineNumber, line, data);
+        if (t == end || savEndOfList(tokens + t)) {
+            return;
+        }
+
+        t = savSkipSpaces(tokens, t + 1, end);
+        if (t == end) {
+            func(NULL, 0, line, data);
+            return;
+        }
+    }
+}
+
+
+/*=============================================================================
+ * SAVFINDTARGETS() Finds every line number that a GO TO, GO SUB, ON ... GO
+ * TO, ON ... GO SUB or RESTORE uses, and passes it to func. TO after GO is
+ * the keyword, not the separator. Keyword codes are one more than the kw
+ * enum.
+ *===========================================================================*/
+void savFindTargets(savProgram *prog, SAVTARGETFUNC func, void *data) {
+    savToken *tokens = prog->tokens;
+    ulong x;
+    ulong t;
+    ulong next;
+    ulong end;
+
+    for (x = 0; x < prog->lineCount; x++) {
+        end = prog->lines[x].first + prog->lines[x].count;
+        for (t = prog->lines[x].first; t < end; t++) {
+            if (tokens[t].type != TYPE_KEYWORD) {
+                continue;
+            }
+
+            if (tokens[t].code == kwRestore + 1) {
+                savScanTargets(tokens, t + 1, end, 1, x, func, data);
+            } else if (tokens[t].code == kwGo + 1) {
+                next = savSkipSpaces(tokens, t + 1, end);
+                if (next < end && tokens[next].type == TYPE_KEYWORD &&
+                    (tokens[next].code == kwTt + 1 || tokens[next].code == kwSub + 1)) {
+                    savScanTargets(tokens, next + 1, end, 0, x, func, data);
+                } else {
+                    func(NULL, 0, x, data);
+                }
+            }
+        }
+    }
+}
+
+
+/*=============================================================================
+ * SAVOUTPUTNAME() Works out an output file name from the input, by adding the
+ * suffix before its '_sav' or '.sav', or on the end if it has neither. The
+ * output must have room for MAXPATH characters.
+ *===========================================================================*/
+void savOutputName(char *savFile, char *suffix, char *outFile) {
+    ushort size = strlen(savFile);
+    ushort suffixSize = strlen(suffix);
+    ushort hasExtension;
+
+    if (size > MAXPATH - suffixSize) {
+        size = MAXPATH - suffixSize;
+    }
+
+    memcpy(outFile, savFile, size);
+    outFile[size] = '\0';
+
+    hasExtension = (size > 4 && (outFile[size - 4] == '_' || outFile[size - 4] == '.') &&
+                    (outFile[size - 3] == 's' || outFile[size - 3] == 'S') &&
+                    (outFile[size - 2] == 'a' || outFile[size - 2] == 'A') &&
+                    (outFile[size - 1] == 'v' || outFile[size - 1] == 'V'));
+
+    if (hasExtension) {
+        memmove(&outFile[size - 4 + suffixSize], &outFile[size - 4], 5);
+        memcpy(&outFile[size - 4], suffix, suffixSize);
+    } else {
+        strcat(outFile, suffix);
+    }
+}
+
+
+/*=============================================================================
+ * SAVSEEDRANDOM() Starts savRandom() again from the seed. The random numbers
+ * are our own, not rand(), so the tools that make test files, savGen and
+ * savFuzz, make the same ones, byte for byte, on any system.
+ *===========================================================================*/
+void savSeedRandom(ulong seed) {
+    savRandomState = (seed & 0xFFFFFFFFUL ? seed & 0xFFFFFFFFUL : 1);    /* xorshift never leaves zero. */
+}
+
+
+/*=============================================================================
+ * SAVRANDOM() Returns the next 32 bit random number. This is Marsaglia's
+ * xorshift32, masked so it works the same with 32 or 64 bit longs.
+ *===========================================================================*/
+ulong savRandom(void) {
+    savRandomState ^= (savRandomState << 13) & 0xFFFFFFFFUL;
+    savRandomState ^= savRandomState >> 17;
+    savRandomState ^= (savRandomState << 5) & 0xFFFFFFFFUL;
+    return savRandomState;
+}
+
+
+/*=============================================================================
+ * SAVRANDOMBELOW() Returns a random number from 0 to limit - 1.
+ *===========================================================================*/
+ulong savRandomBelow(ulong limit) {
+    return (limit ? savRandom() % limit : 0);
+}
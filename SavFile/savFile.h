@@ -0,0 +1,255 @@
+#ifndef __SAVFILE_H__
+#define __SAVFILE_H__
+
+/*===========================================================================
+ * HEADERS
+ *===========================================================================*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../C68Port/keywords.h"
+
+/*===========================================================================
+ * DEFINES
+ *===========================================================================*/
+#define SAV_OK      0               /* All went well. */
+#define SAV_ERROR   1               /* Something, somewhere, went wrong. */
+#define SAV_END     2               /* No more lines in the program. */
+
+#define SAV_HEADER_SIZE 10          /* 'Q1' flags, entries, length, lines. */
+#define SAV_NAME_HEADER_SIZE 6      /* Type, line number, length words. */
+#define SAV_LINE_HEADER_SIZE 6      /* Size change, 0x8D00, line number. */
+#define SAV_FLOAT_SIZE 6            /* Bytes in a QL floating point value. */
+
+/* How many of each token sub-type are there? These are the sizes of
+ * the lookup tables below, not counting the unused zero entries. */
+#define SAV_KEYWORDS    31
+#define SAV_SYMBOLS     10
+#define SAV_OPERATORS   22
+#define SAV_MONADICS    4
+#define SAV_SEPARATORS  5
+
+#define SYMBOL_EQUALS   1           /* 0x8401 = */
+#define SYMBOL_COLON    2           /* 0x8402 : End of statement */
+#define SYMBOL_HASH     3           /* 0x8403 # */
+#define SYMBOL_COMMA    4           /* 0x8404 , */
+#define SYMBOL_LPAREN   5           /* 0x8405 ( */
+#define SYMBOL_RPAREN   6           /* 0x8406 ) */
+#define SYMBOL_EOL      10          /* 0x840A End of line */
+
+#define OPERATOR_PLUS   1           /* 0x8501 + */
+#define OPERATOR_MINUS  2           /* 0x8502 - */
+#define OPERATOR_TIMES  3           /* 0x8503 * */
+#define OPERATOR_DIVIDE 4           /* 0x8504 / */
+#define OPERATOR_GE     5           /* 0x8505 >= */
+#define OPERATOR_GT     6           /* 0x8506 > */
+#define OPERATOR_APPROX 7           /* 0x8507 == */
+#define OPERATOR_EQUALS 8           /* 0x8508 = */
+#define OPERATOR_NE     9           /* 0x8509 <> */
+#define OPERATOR_LE     10          /* 0x850A <= */
+#define OPERATOR_LT     11          /* 0x850B < */
+#define OPERATOR_BITOR  12          /* 0x850C || */
+#define OPERATOR_BITAND 13          /* 0x850D && */
+#define OPERATOR_BITXOR 14          /* 0x850E ^^ */
+#define OPERATOR_POWER  15          /* 0x850F ^ */
+#define OPERATOR_CONCAT 16          /* 0x8510 & */
+#define OPERATOR_OR     17          /* 0x8511 OR */
+#define OPERATOR_AND    18          /* 0x8512 AND */
+#define OPERATOR_XOR    19          /* 0x8513 XOR */
+#define OPERATOR_MOD    20          /* 0x8514 MOD */
+#define OPERATOR_DIV    21          /* 0x8515 DIV */
+#define OPERATOR_INSTR  22          /* 0x8516 INSTR */
+
+#define MONADIC_PLUS    1           /* 0x8601 + */
+#define MONADIC_MINUS   2           /* 0x8602 - */
+#define MONADIC_BITNOT  3           /* 0x8603 ~~ */
+#define MONADIC_NOT     4           /* 0x8604 NOT */
+
+#define SEPARATOR_COMMA 1           /* 0x8E01 , */
+#define SEPARATOR_SEMI  2           /* 0x8E02 ; */
+#define SEPARATOR_BACK  3           /* 0x8E03 \ */
+#define SEPARATOR_PLING 4           /* 0x8E04 ! */
+#define SEPARATOR_TO    5           /* 0x8E05 TO */
+
+/* The high byte of a name table entry's type is what the name is, the low
+ * byte is the variable type - 1 = string, 2 = float, 3 = integer. */
+#define NAME_UNSET      0x00        /* Not yet used as anything. */
+#define NAME_VARIABLE   0x02        /* Simple variable. */
+#define NAME_ARRAY      0x03        /* DIMensioned array. */
+#define NAME_SB_PROC    0x14        /* DEFine PROCedure. */
+#define NAME_SB_FN      0x15        /* DEFine FuNction. */
+#define NAME_REPEAT     0x06        /* REPeat loop name. */
+#define NAME_FOR        0x07        /* FOR loop variable. */
+#define NAME_MC_PROC    0x08        /* Machine code procedure. */
+#define NAME_MC_FN      0x09        /* Machine code function. */
+
+#define VAR_STRING      1
+#define VAR_FLOAT       2
+#define VAR_INTEGER     3
+
+/*===========================================================================
+ * TYPEDEFS
+ *===========================================================================*/
+
+/* One entry from the name table. The name itself is not copied, it points
+ * into the file buffer and is NOT zero terminated. */
+typedef struct savName {
+    ulong  offset;                  /* Address in file of this entry. */
+    ushort nameType;                /* Name type. */
+    short  lineNumber;              /* Line number of definition. */
+    ushort nameLength;              /* Length of actual name. */
+    uchar  *name;                   /* Bytes of name, in the buffer. */
+    uchar  padding;                 /* Pad byte after an odd length name. */
+} savName;
+
+/* A whole SAV file, read into memory in one go. The buffer and name table
+ * are kept between calls to savReadFile() so that a batch of files can be
+ * processed without allocating memory for every one. */
+typedef struct savFile {
+    char   *fileName;               /* Where it came from. */
+    uchar  *buffer;                 /* The whole of the SAV file. */
+    ulong  size;                    /* How much of the buffer is file. */
+    ulong  bufferSize;              /* How much buffer we have. */
+    uchar  flags[2];                /* Header bytes 2 and 3. */
+    ushort nameTableEntries;        /* From the header. */
+    ushort nameTableLength;         /* From the header. */
+    ushort programLines;            /* From the header. */
+    savName *names;                 /* The decoded name table. */
+    ushort namesSize;               /* How many names we have room for. */
+    ulong  programOffset;           /* Where the first program line is. */
+} savFile;
+
+/* One program line. The tokens run from first up to, and including, the
+ * 0x840A end of line symbol. */
+typedef struct savLine {
+    ulong  offset;                  /* Address of the size change word. */
+    short  sizeChange;              /* Line size change from previous. */
+    ushort lineNumber;              /* Guess! */
+    ulong  first;                   /* Address of the first token. */
+} savLine;
+
+/* One token from a program line. */
+typedef struct savToken {
+    ulong  offset;                  /* Address in file of this token. */
+    uchar  type;                    /* Type byte, 0xD0-0xFF for floats. */
+    uchar  code;                    /* Keyword, symbol etc index or count. */
+    ushort value;                   /* Name table entry or string size. */
+    ushort size;                    /* Total bytes, including padding. */
+    uchar  *data;                   /* The token, type byte first. */
+    uchar  padding;                 /* Pad byte after an odd length string. */
+} savToken;
+
+/* One line of a decoded program. Its tokens are count entries of the
+ * program's token array, starting at first, and do NOT include the 0x840A
+ * end of line, savEncodeProgram() adds that. */
+typedef struct savProgLine {
+    ulong  offset;                  /* Address in file, 0 for a new line. */
+    ushort lineNumber;              /* Guess! */
+    ulong  first;                   /* Index of the first token. */
+    ulong  count;                   /* How many tokens. */
+} savProgLine;
+
+/* A whole program, decoded into arrays that can be edited and then written
+ * back out with savEncodeProgram(). Names and tokens still point into the
+ * savFile's buffer, so that must be kept until the program is encoded. New
+ * tokens need data laid out as it would be in a file, type byte first. The
+ * header counts are written as they are, savCountProgram() sets them from
+ * the arrays after an edit. */
+typedef struct savProgram {
+    uchar  flags[2];                /* Header bytes 2 and 3. */
+    ushort nameTableLength;         /* For the header. */
+    ushort programLines;            /* For the header. */
+    savName *names;                 /* The name table. */
+    ulong  nameCount;
+    ulong  namesSize;               /* How many names we have room for. */
+    savProgLine *lines;             /* The program lines, in order. */
+    ulong  lineCount;
+    ulong  linesSize;
+    savToken *tokens;               /* Every line's tokens. */
+    ulong  tokenCount;
+    ulong  tokensSize;
+} savProgram;
+
+/* An output buffer, for building SAV files in memory. It grows as needed.
+ * If it can't, failed is set and everything else is ignored, so callers only
+ * need to check once, at the end. */
+typedef struct savBuffer {
+    uchar  *buffer;                 /* What we have so far. */
+    ulong  size;                    /* How much of it is used. */
+    ulong  space;                   /* How much there is. */
+    ulong  lineStart;               /* Where the current line started. */
+    ushort lastLineSize;            /* Size of the previous line. */
+    ushort lines;                   /* How many lines so far. */
+    ushort failed;                  /* Out of memory? */
+} savBuffer;
+
+/* Called by savFindTargets() for every line number after GO TO, GO SUB, ON
+ * ... GO TO, ON ... GO SUB and RESTORE. The token is the floating point line
+ * number, or NULL for an expression, which can't be known until the program
+ * runs. Line is the index of the line it's on. */
+typedef void (*SAVTARGETFUNC)(savToken *token, ushort lineNumber, ulong line, void *data);
+
+/*===========================================================================
+ * GLOBALS
+ *===========================================================================*/
+extern char *savKeywords[];
+extern char *savSymbols[];
+extern char *savOperators[];
+extern char *savMonadics[];
+extern char *savSeparators[];
+
+/*===========================================================================
+ * FUNCTION PROTOTYPES
+ *===========================================================================*/
+void   savInitFile(savFile *sav);
+void   savFreeFile(savFile *sav);
+ushort savReadFile(char *fileName, savFile *sav);
+ushort savLoadBuffer(savFile *sav);
+ushort savDecodeHeader(savFile *sav);
+ushort savDecodeNameTable(savFile *sav);
+ushort savNextLine(savFile *sav, ulong *pos, savLine *line);
+ushort savNextToken(savFile *sav, ulong *pos, savToken *token);
+
+void   savInitBuffer(savBuffer *out);
+void   savFreeBuffer(savBuffer *out);
+ushort savReserve(savBuffer *out, ulong bytes);
+void   savPutByte(savBuffer *out, uchar byte);
+void   savPutWord(savBuffer *out, ushort word);
+void   savPutBytes(savBuffer *out, uchar *bytes, ulong size);
+void   savPutHeader(savBuffer *out, uchar *flags, ushort entries, ushort length, ushort lines);
+void   savPutNameEntry(savBuffer *out, ushort nameType, short lineNumber, uchar *name, ushort nameLength);
+void   savBeginLine(savBuffer *out, ushort lineNumber);
+void   savEndLine(savBuffer *out);
+void   savPutToken(savBuffer *out, uchar type, uchar code);
+void   savPutName(savBuffer *out, ushort entry);
+void   savPutString(savBuffer *out, uchar type, uchar delim, uchar *text, ushort size);
+void   savPutFloat(savBuffer *out, double value, uchar fpType);
+ushort savWriteBuffer(FILE *fp, savBuffer *out);
+
+void   savInitProgram(savProgram *prog);
+void   savFreeProgram(savProgram *prog);
+ushort savDecodeProgram(savFile *sav, savProgram *prog);
+ushort savAddName(savProgram *prog, savName *name);
+ushort savAddLine(savProgram *prog, ushort lineNumber);
+ushort savAddToken(savProgram *prog, savToken *token);
+void   savCountProgram(savProgram *prog);
+void   savEncodeToken(savBuffer *out, savToken *token);
+ushort savEncodeProgram(savProgram *prog, savBuffer *out);
+ushort savWriteProgram(char *fileName, savProgram *prog);
+
+ulong  savSkipSpaces(savToken *tokens, ulong t, ulong end);
+void   savFindTargets(savProgram *prog, SAVTARGETFUNC func, void *data);
+void   savOutputName(char *savFile, char *suffix, char *outFile);
+
+void   savSeedRandom(ulong seed);
+ulong  savRandom(void);
+ulong  savRandomBelow(ulong limit);
+
+ushort savGetWord(uchar *bytes);
+double qlfpDecode(uchar *bytes);
+void   qlfpEncode(double value, uchar fpType, uchar *bytes);
+
+/*===========================================================================*/
+
+#endif /* __SAVFILE_H__ */
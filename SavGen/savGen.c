@@ -0,0 +1,703 @@
+/*=============================================================================
+ * Synthetic SAV file generator.
+ *
+ * Writes a valid, tokenised, SAV file of any size from 10 lines upwards, for
+ * benchmarking and testing the decoders without needing an emulator and
+ * QSAVE. The program has a main section, then DEFine PROCedure and DEFine
+ * FuNction blocks, with FOR, REPeat and IF blocks nested inside. The mix of
+ * REMarks, indentation, strings and binary, hex and decimal floats can be
+ * changed on the command line.
+ *
+ * The random numbers come from savRandom(), so the same seed gives the same
+ * file, byte for byte, on any system.
+ *
+ * SuperBASIC line numbers stop at 32767. Programs longer than that are given
+ * line numbers that wrap around and start again at 1. The decoders don't care
+ * but SuperBASIC would, so these files are for benchmarking only.
+ *
+ * Usage: savGen [options] -o output_sav
+ *
+ * -n lines     Program lines. Default 1000.
+ * -s seed      Random number seed. Default 1.
+ * -v count     How many variables. Default 40.
+ * -p count     How many PROCedures and FuNctions. Default lines / 50.
+ * -r percent   REMark lines. Default 10.
+ * -i percent   Indented (multispace) lines. Default 50.
+ * -q percent   Statements that PRINT strings. Default 20.
+ * -b percent   Floats written in binary, %1010. Default 5.
+ * -x percent   Floats written in hex, $12AB. Default 5.
+ * -c count     Most statements on one line. Default 3.
+ *===========================================================================*/
+
+/*===========================================================================
+ * HEADERS
+ *===========================================================================*/
+#include "savGen.h"
+
+/*===========================================================================
+ * GLOBALS
+ *===========================================================================*/
+genOptions options = {1000, 1, 40, 0xFFFF, 10, 50, 20, 5, 5, 3};
+
+savBuffer program;              /* The program lines. */
+genName *names = NULL;          /* The name table. */
+ushort nameCount = 0;           /* How many names so far. */
+ushort nameSpace = 0;           /* And how many we have room for. */
+
+ulong lineCount = 0;            /* Lines written so far. */
+ushort lineStep = 10;           /* Line number increment. */
+
+/* Where each kind of name starts in the name table, and how many. */
+ushort firstMcProc, mcProcs;
+ushort firstMcFn, mcFns;
+ushort firstFloat, floats;
+ushort firstInteger, integers;
+ushort firstString, strings;
+ushort firstProc, procs;
+ushort firstFn, fns;
+ushort firstLoop, loops;
+
+/* Machine code procedures and functions that every QL has. */
+static char *mcProcNames[] = {"PRINT", "CLS", "INK", "PAPER", "AT", "CLOSE", "OPEN"};
+static char *mcFnNames[] = {"INT", "ABS", "RND", "SQRT"};
+#define MCLENGTH 4                  /* mcFnNames index for LEN below. */
+
+/* Words for names, strings and REMarks. */
+static char *words[] = {
+    "total", "count", "index", "value", "sum", "name", "line", "size",
+    "flag", "max", "min", "temp", "file", "channel", "result", "offset",
+    "buffer", "screen", "colour", "width", "height", "score", "level", "item"
+};
+#define WORDS (sizeof(words) / sizeof(words[0]))
+
+
+/*=============================================================================
+ * MAIN() Start here. Sorts out the options, generates the program and name
+ * table, then writes the SAV file.
+ *===========================================================================*/
+int main (int argc, char *argv[]) {
+    char *outFile = NULL;
+    savBuffer head;
+    ushort x;
+    ulong nameTableLength = 0;
+    FILE *fp;
+    int arg;
+    ulong value;
+
+    for (arg = 1; arg < argc; arg++) {
+        if (argv[arg][0] != '-' || argv[arg][1] == '\0' || argv[arg][2] != '\0' || arg + 1 >= argc) {
+            fprintf(stderr, "%s: Unknown option '%s'.\n", argv[0], argv[arg]);
+            return -1;
+        }
+
+        if (argv[arg][1] == 'o') {
+            outFile = argv[++arg];
+            continue;
+        }
+
+        value = strtoul(argv[++arg], NULL, 10);
+        switch (argv[arg - 1][1]) {
+            case 'n': options.lines = value; break;
+            case 's': options.seed = value; break;
+            case 'v': options.variables = value; break;
+            case 'p': options.procedures = value; break;
+            case 'r': options.remarks = value; break;
+            case 'i': options.indents = value; break;
+            case 'q': options.strings = value; break;
+            case 'b': options.binary = value; break;
+            case 'x': options.hexadecimal = value; break;
+            case 'c': options.statements = value; break;
+            default:
+                fprintf(stderr, "%s: Unknown option '%s'.\n", argv[0], argv[arg - 1]);
+                return -1;
+        }
+    }
+
+    if (!outFile || options.lines < 10) {
+        fprintf(stderr, "Usage: %s [-n lines] [-s seed] [-v variables] [-p procedures] [-r %%remarks]\n", argv[0]);
+        fprintf(stderr, "       [-i %%indents] [-q %%strings] [-b %%binary] [-x %%hex] [-c statements] -o output\n");
+        fprintf(stderr, "There must be at least 10 lines.\n");
+        return -1;
+    }
+
+    if (options.variables < 3) {
+        options.variables = 3;
+    }
+
+    if (options.statements < 1) {
+        options.statements = 1;
+    }
+
+    /* Default to one PROC or FN for every 50 lines. The name table can only
+     * have 65535 entries, all told. */
+    if (options.procedures == 0xFFFF) {
+        options.procedures = options.lines / 50;
+    }
+
+    if (options.procedures > 60000) {
+        options.procedures = 60000;
+    }
+
+    if (options.variables > 65535 - 60000 - 100) {
+        options.variables = 65535 - 60000 - 100;
+    }
+
+    if (options.lines > MAXLINENUMBER) {
+        fprintf(stderr, "WARNING: More than %d lines, line numbers will wrap around.\n", MAXLINENUMBER);
+        lineStep = 1;
+    } else if (options.lines * 10 > MAXLINENUMBER) {
+        lineStep = MAXLINENUMBER / options.lines;
+    }
+
+    savSeedRandom(options.seed);
+
+    savInitBuffer(&program);
+    buildNameTable();
+    generateProgram();
+
+    /* Now we know everything, the header and name table. The name table
+     * length is the space SuperBASIC needs for the names, each one has a
+     * length byte then the characters. */
+    savInitBuffer(&head);
+    for (x = 0; x < nameCount; x++) {
+        nameTableLength += names[x].nameLength + 1;
+    }
+
+    /* Huge programs can overflow the header's words. */
+    savPutHeader(&head, NULL, nameCount,
+                 (nameTableLength > 0xFFFF ? 0xFFFF : nameTableLength),
+                 (lineCount > 0xFFFF ? 0xFFFF : lineCount));
+    for (x = 0; x < nameCount; x++) {
+        savPutNameEntry(&head, names[x].nameType, names[x].lineNumber, names[x].name, names[x].nameLength);
+    }
+
+    fp = fopen(outFile, "wb");
+    if (!fp) {
+        fprintf(stderr, "FATAL ERROR: main(): Cannot create '%s'.\n", outFile);
+        return -1;
+    }
+
+    if (savWriteBuffer(fp, &head) != SAV_OK || savWriteBuffer(fp, &program) != SAV_OK) {
+        fprintf(stderr, "FATAL ERROR: main(): Cannot write '%s'.\n", outFile);
+        fclose(fp);
+        return -1;
+    }
+
+    fclose(fp);
+
+    fprintf(stderr, "%s: %lu lines, %d names, %lu bytes.\n", outFile, lineCount, nameCount, head.size + program.size);
+
+    savFreeBuffer(&head);
+    savFreeBuffer(&program);
+    free(names);
+
+    return 0;
+}
+
+
+/*=============================================================================
+ * PERCENT() Returns 1, chance times out of 100.
+ *===========================================================================*/
+ushort percent(ushort chance) {
+    return (savRandomBelow(100) < chance);
+}
+
+
+/*=============================================================================
+ * BUILDNAMETABLE() Creates all the names the program will use. Each kind of
+ * name is kept together so that pickName() can choose one easily.
+ *===========================================================================*/
+void buildNameTable(void) {
+    ushort x;
+
+    firstMcProc = nameCount;
+    for (x = 0; x < sizeof(mcProcNames) / sizeof(mcProcNames[0]); x++) {
+        addName(NAME_MC_PROC << 8, mcProcNames[x], 0xFFFF, "");
+    }
+    mcProcs = nameCount - firstMcProc;
+
+    /* LEN is kept separate as it takes a string. */
+    firstMcFn = nameCount;
+    for (x = 0; x < sizeof(mcFnNames) / sizeof(mcFnNames[0]); x++) {
+        addName(NAME_MC_FN << 8, mcFnNames[x], 0xFFFF, "");
+    }
+    mcFns = nameCount - firstMcFn;
+    addName(NAME_MC_FN << 8, "LEN", 0xFFFF, "");
+
+    /* Half the variables are floats, a quarter each integers and strings. */
+    firstFloat = nameCount;
+    for (x = 0; x < options.variables - options.variables / 2; x++) {
+        addName((NAME_VARIABLE << 8) | VAR_FLOAT, words[savRandomBelow(WORDS)], x, "");
+    }
+    floats = nameCount - firstFloat;
+
+    firstInteger = nameCount;
+    for (x = 0; x < options.variables / 4; x++) {
+        addName((NAME_VARIABLE << 8) | VAR_INTEGER, words[savRandomBelow(WORDS)], x, "%");
+    }
+    integers = nameCount - firstInteger;
+
+    firstString = nameCount;
+    for (x = 0; x < options.variables / 2 - options.variables / 4; x++) {
+        addName((NAME_VARIABLE << 8) | VAR_STRING, words[savRandomBelow(WORDS)], x, "$");
+    }
+    strings = nameCount - firstString;
+
+    /* Two PROCs for every FN. */
+    firstProc = nameCount;
+    for (x = 0; x < options.procedures - options.procedures / 3; x++) {
+        addName((NAME_SB_PROC << 8) | VAR_FLOAT, "do", x, "");
+    }
+    procs = nameCount - firstProc;
+
+    firstFn = nameCount;
+    for (x = 0; x < options.procedures / 3; x++) {
+        addName((NAME_SB_FN << 8) | VAR_FLOAT, "calc", x, "");
+    }
+    fns = nameCount - firstFn;
+
+    firstLoop = nameCount;
+    for (x = 0; x < MAXNESTING; x++) {
+        addName(NAME_REPEAT << 8, "loop", x, "");
+    }
+    loops = nameCount - firstLoop;
+}
+
+
+/*=============================================================================
+ * ADDNAME() Adds a name to the name table. The name is the prefix, then an
+ * underscore and the number, unless the number is 0xFFFF, then the suffix.
+ * Returns the entry number.
+ *===========================================================================*/
+ushort addName(ushort nameType, char *prefix, ushort number, char *suffix) {
+    genName *temp;
+    char buffer[MAXGENNAME + 16];
+
+    if (nameCount == nameSpace) {
+        nameSpace = (nameSpace ? nameSpace * 2 : 64);
+        temp = realloc(names, nameSpace * sizeof(genName));
+        if (!temp) {
+            fprintf(stderr, "FATAL ERROR: addName(): Out of memory for name table.\n");
+            exit(-1);
+        }
+
+        names = temp;
+    }
+
+    if (number == 0xFFFF) {
+        sprintf(buffer, "%s%s", prefix, suffix);
+    } else {
+        sprintf(buffer, "%s_%u%s", prefix, number, suffix);
+    }
+
+    names[nameCount].nameType = nameType;
+    names[nameCount].lineNumber = 0;
+    names[nameCount].nameLength = strlen(buffer);
+    memcpy(names[nameCount].name, buffer, names[nameCount].nameLength);
+
+    return nameCount++;
+}
+
+
+/*=============================================================================
+ * PICKNAME() Returns a random entry from one kind of name.
+ *===========================================================================*/
+ushort pickName(ushort first, ushort count) {
+    return first + savRandomBelow(count);
+}
+
+
+/*=============================================================================
+ * GENERATEPROGRAM() Writes the main program, which takes a quarter of the
+ * lines, or all of them if there are no PROCs or FNs, then the definitions
+ * share the rest.
+ *===========================================================================*/
+void generateProgram(void) {
+    ulong mainLines;
+    ulong defineLines;
+    ushort definitions = procs + fns;
+    ushort x;
+
+    mainLines = (definitions ? options.lines / 4 : options.lines);
+
+    /* Each definition needs at least 3 lines. */
+    while (definitions && (options.lines - mainLines) / definitions < 3) {
+        definitions--;
+    }
+
+    if (!definitions) {
+        mainLines = options.lines;
+    }
+
+    generateBody(mainLines, 0, 0);
+
+    for (x = 0; x < definitions; x++) {
+        /* The last one takes whatever is left. */
+        if (x == definitions - 1) {
+            defineLines = options.lines - lineCount;
+        } else {
+            defineLines = (options.lines - mainLines) / definitions;
+        }
+
+        generateDefinition(defineLines, (x < procs ? firstProc + x : firstFn + x - procs));
+    }
+}
+
+
+/*=============================================================================
+ * GENERATEDEFINITION() Writes a DEFine PROCedure or DEFine FuNction block of
+ * exactly 'lines' lines, and records the line number in the name table.
+ *===========================================================================*/
+void generateDefinition(ulong lines, ushort entry) {
+    ushort function = ((names[entry].nameType >> 8) == NAME_SB_FN);
+
+    names[entry].lineNumber = beginLine(0);
+    savPutToken(&program, TYPE_KEYWORD, kwDefine + 1);
+    savPutToken(&program, TYPE_KEYWORD, (function ? kwFunction : kwProcedure) + 1);
+    savPutName(&program, entry);
+
+    /* FNs take a parameter. */
+    if (function) {
+        savPutToken(&program, TYPE_SYMBOL, SYMBOL_LPAREN);
+        savPutName(&program, pickName(firstFloat, floats));
+        savPutToken(&program, TYPE_SYMBOL, SYMBOL_RPAREN);
+    }
+    endLine();
+
+    /* A LOCal or two. */
+    beginLine(1);
+    savPutToken(&program, TYPE_KEYWORD, kwLocal + 1);
+    savPutName(&program, pickName(firstFloat, floats));
+    if (percent(50)) {
+        savPutToken(&program, TYPE_SYMBOL, SYMBOL_COMMA);
+        savPutName(&program, pickName(firstInteger, integers));
+    }
+    endLine();
+
+    generateBody(lines - 3, 1, function);
+
+    beginLine(0);
+    savPutToken(&program, TYPE_KEYWORD, kwEnd + 1);
+    savPutToken(&program, TYPE_KEYWORD, kwDefine + 1);
+    savPutName(&program, entry);
+    endLine();
+}
+
+
+/*=============================================================================
+ * GENERATEBODY() Writes exactly 'lines' lines, with nested blocks if there is
+ * room. A FuNction's body always ends with RETurn.
+ *===========================================================================*/
+void generateBody(ulong lines, ushort depth, ushort function) {
+    ulong inner;
+    ushort variable = 0;            /* Only FOR and REPeat have one. */
+    ushort kind;
+
+    if (function && lines) {
+        lines--;
+    }
+
+    while (lines) {
+        /* Room for a block? */
+        if (lines >= 3 && depth < MAXNESTING && percent(20)) {
+            inner = 1 + savRandomBelow(lines - 2 < 10 ? lines - 2 : 10);
+            kind = savRandomBelow(3);
+
+            beginLine(depth);
+            switch (kind) {
+                case 0:
+                    /* FOR variable = start TO end [STEP step] */
+                    variable = pickName(firstFloat, floats);
+                    savPutToken(&program, TYPE_KEYWORD, kwFor + 1);
+                    savPutName(&program, variable);
+                    savPutToken(&program, TYPE_SYMBOL, SYMBOL_EQUALS);
+                    generateFloat();
+                    savPutToken(&program, TYPE_SEPARATOR, 5);
+                    generateExpression(1);
+                    if (percent(25)) {
+                        savPutToken(&program, TYPE_KEYWORD, kwStep + 1);
+                        generateFloat();
+                    }
+                    break;
+
+                case 1:
+                    /* REPeat loop_n */
+                    variable = firstLoop + depth;
+                    savPutToken(&program, TYPE_KEYWORD, kwRepeat + 1);
+                    savPutName(&program, variable);
+                    break;
+
+                default:
+                    /* IF expression */
+                    savPutToken(&program, TYPE_KEYWORD, kwIf + 1);
+                    generateExpression(1);
+                    savPutToken(&program, TYPE_OPERATOR, 6);
+                    generateExpression(1);
+                    break;
+            }
+            endLine();
+
+            generateBody(inner, depth + 1, 0);
+
+            /* REPeat needs a way out. */
+            beginLine(depth);
+            if (kind == 1) {
+                savPutToken(&program, TYPE_KEYWORD, kwIf + 1);
+                generateExpression(1);
+                savPutToken(&program, TYPE_OPERATOR, 11);
+                generateFloat();
+                savPutToken(&program, TYPE_KEYWORD, kwThen + 1);
+                savPutToken(&program, TYPE_KEYWORD, kwExit + 1);
+                savPutName(&program, variable);
+                savPutToken(&program, TYPE_SYMBOL, SYMBOL_COLON);
+            }
+
+            savPutToken(&program, TYPE_KEYWORD, kwEnd + 1);
+            savPutToken(&program, TYPE_KEYWORD, (kind == 0 ? kwFor : kind == 1 ? kwRepeat : kwIf) + 1);
+            if (kind != 2) {
+                savPutName(&program, variable);
+            }
+            endLine();
+
+            lines -= inner + 2;
+            continue;
+        }
+
+        generateSimpleLine(depth);
+        lines--;
+    }
+
+    if (function) {
+        beginLine(depth);
+        savPutToken(&program, TYPE_KEYWORD, kwReturn + 1);
+        generateExpression(2);
+        endLine();
+    }
+}
+
+
+/*=============================================================================
+ * GENERATESIMPLELINE() Writes a REMark line, or a line of one or more
+ * statements separated by colons.
+ *===========================================================================*/
+void generateSimpleLine(ushort depth) {
+    ushort statements;
+
+    beginLine(depth);
+
+    if (percent(options.remarks)) {
+        savPutToken(&program, TYPE_KEYWORD, kwRemark + 1);
+        generateText(TYPE_TEXT, 0, 1 + savRandomBelow(8));
+        endLine();
+        return;
+    }
+
+    statements = 1 + savRandomBelow(options.statements);
+    while (statements--) {
+        generateStatement();
+        if (statements) {
+            savPutToken(&program, TYPE_SYMBOL, SYMBOL_COLON);
+        }
+    }
+
+    endLine();
+}
+
+
+/*=============================================================================
+ * GENERATESTATEMENT() Writes one statement - a PRINT, an assignment, a PROC
+ * call or a single line IF.
+ *===========================================================================*/
+void generateStatement(void) {
+    ushort kind = savRandomBelow(10);
+
+    if (percent(options.strings)) {
+        /* PRINT "text";variable */
+        savPutName(&program, firstMcProc);
+        generateText(TYPE_STRING, (percent(50) ? '"' : '\''), 1 + savRandomBelow(5));
+        savPutToken(&program, TYPE_SEPARATOR, 2);
+        savPutName(&program, pickName(firstFloat, floats));
+        return;
+    }
+
+    if (kind < 5) {
+        /* [LET] variable = expression */
+        if (kind == 0) {
+            savPutToken(&program, TYPE_KEYWORD, kwLet + 1);
+        }
+
+        if (strings && percent(20)) {
+            savPutName(&program, pickName(firstString, strings));
+            savPutToken(&program, TYPE_SYMBOL, SYMBOL_EQUALS);
+            generateStringExpression();
+        } else {
+            savPutName(&program, (integers && percent(30) ? pickName(firstInteger, integers) : pickName(firstFloat, floats)));
+            savPutToken(&program, TYPE_SYMBOL, SYMBOL_EQUALS);
+            generateExpression(1 + savRandomBelow(3));
+        }
+        return;
+    }
+
+    if (kind < 7 && procs) {
+        /* PROC call */
+        savPutName(&program, pickName(firstProc, procs));
+        return;
+    }
+
+    if (kind < 8) {
+        /* INK expression, or any other MC PROC */
+        savPutName(&program, pickName(firstMcProc + 1, mcProcs - 1));
+        generateExpression(1);
+        return;
+    }
+
+    /* IF expression THEN variable = expression */
+    savPutToken(&program, TYPE_KEYWORD, kwIf + 1);
+    generateExpression(1);
+    savPutToken(&program, TYPE_OPERATOR, 5 + savRandomBelow(7));
+    generateExpression(1);
+    savPutToken(&program, TYPE_KEYWORD, kwThen + 1);
+    savPutName(&program, pickName(firstFloat, floats));
+    savPutToken(&program, TYPE_SYMBOL, SYMBOL_EQUALS);
+    generateExpression(1);
+}
+
+
+/*=============================================================================
+ * GENERATEEXPRESSION() Writes a numeric expression of 'terms' terms. A term
+ * is a float, a variable or a FN call, maybe with a monadic minus.
+ *===========================================================================*/
+void generateExpression(ushort terms) {
+    ushort kind;
+
+    while (terms--) {
+        if (percent(5)) {
+            savPutToken(&program, TYPE_MONADIC, 2);
+        }
+
+        kind = savRandomBelow(10);
+        if (kind < 4) {
+            generateFloat();
+        } else if (kind < 7) {
+            savPutName(&program, pickName(firstFloat, floats));
+        } else if (kind < 8 && integers) {
+            savPutName(&program, pickName(firstInteger, integers));
+        } else if (kind < 9 && fns) {
+            savPutName(&program, pickName(firstFn, fns));
+            savPutToken(&program, TYPE_SYMBOL, SYMBOL_LPAREN);
+            savPutName(&program, pickName(firstFloat, floats));
+            savPutToken(&program, TYPE_SYMBOL, SYMBOL_RPAREN);
+        } else if (strings && percent(50)) {
+            savPutName(&program, firstMcFn + MCLENGTH);
+            savPutToken(&program, TYPE_SYMBOL, SYMBOL_LPAREN);
+            savPutName(&program, pickName(firstString, strings));
+            savPutToken(&program, TYPE_SYMBOL, SYMBOL_RPAREN);
+        } else {
+            savPutName(&program, pickName(firstMcFn, mcFns));
+            savPutToken(&program, TYPE_SYMBOL, SYMBOL_LPAREN);
+            generateFloat();
+            savPutToken(&program, TYPE_SYMBOL, SYMBOL_RPAREN);
+        }
+
+        /* + - * / or MOD */
+        if (terms) {
+            kind = savRandomBelow(5);
+            savPutToken(&program, TYPE_OPERATOR, (kind < 4 ? kind + 1 : 20));
+        }
+    }
+}
+
+
+/*=============================================================================
+ * GENERATESTRINGEXPRESSION() Writes a string, or a string variable, maybe
+ * joined to another one with &.
+ *===========================================================================*/
+void generateStringExpression(void) {
+    if (percent(50)) {
+        generateText(TYPE_STRING, '"', 1 + savRandomBelow(3));
+    } else {
+        savPutName(&program, pickName(firstString, strings));
+    }
+
+    if (percent(30)) {
+        savPutToken(&program, TYPE_OPERATOR, 16);
+        generateText(TYPE_STRING, '\'', 1);
+    }
+}
+
+
+/*=============================================================================
+ * GENERATEFLOAT() Writes a binary, hexadecimal or decimal float. Binary and
+ * hex are whole numbers, decimals sometimes have a fraction.
+ *===========================================================================*/
+void generateFloat(void) {
+    ulong chance = savRandomBelow(100);
+
+    if (chance < options.binary) {
+        savPutFloat(&program, (double)savRandomBelow(256), QLFP_BINARY);
+    } else if (chance < (ulong)options.binary + options.hexadecimal) {
+        savPutFloat(&program, (double)savRandomBelow(65536), QLFP_HEXADECIMAL);
+    } else if (percent(20)) {
+        savPutFloat(&program, (double)savRandomBelow(100000) / 100.0, QLFP_DECIMAL);
+    } else {
+        savPutFloat(&program, (double)savRandomBelow(1000), QLFP_DECIMAL);
+    }
+}
+
+
+/*=============================================================================
+ * GENERATETEXT() Writes a string or REMark text of a few random words.
+ *===========================================================================*/
+void generateText(uchar type, uchar delim, ushort wordCount) {
+    char buffer[256];
+    ushort size = 0;
+    char *word;
+
+    while (wordCount--) {
+        word = words[savRandomBelow(WORDS)];
+        if (size + strlen(word) + 1 >= sizeof(buffer)) {
+            break;
+        }
+
+        if (size) {
+            buffer[size++] = ' ';
+        }
+
+        strcpy(buffer + size, word);
+        size += strlen(word);
+    }
+
+    savPutString(&program, type, delim, (uchar *)buffer, size);
+}
+
+
+/*=============================================================================
+ * BEGINLINE() Starts a new program line, and indents it if required. Returns
+ * the line number.
+ *===========================================================================*/
+ushort beginLine(ushort depth) {
+    ushort lineNumber;
+
+    if (lineStep == 1) {
+        lineNumber = (lineCount % MAXLINENUMBER) + 1;
+    } else {
+        lineNumber = (lineCount + 1) * lineStep;
+    }
+
+    savBeginLine(&program, lineNumber);
+
+    if (percent(options.indents)) {
+        savPutToken(&program, TYPE_MULTISPACE, 2 + depth * 2);
+    }
+
+    return lineNumber;
+}
+
+
+/*=============================================================================
+ * ENDLINE() Finishes the current line.
+ *===========================================================================*/
+void endLine(void) {
+    savEndLine(&program);
+    lineCount++;
+}
@@ -0,0 +1,67 @@
+#ifndef __SAVGEN_H__
+#define __SAVGEN_H__
+
+/*===========================================================================
+ * HEADERS
+ *===========================================================================*/
+#include "../SavFile/savFile.h"
+
+/*===========================================================================
+ * DEFINES
+ *===========================================================================*/
+#define MAXLINENUMBER 32767         /* SuperBASIC's biggest line number. */
+#define MAXNESTING 8                /* How deep blocks can be nested. */
+#define MAXGENNAME 24               /* Longest generated name. */
+
+/*===========================================================================
+ * TYPEDEFS
+ *===========================================================================*/
+
+/* Everything that can be changed on the command line. Percentages are 0
+ * to 100. */
+typedef struct genOptions {
+    ulong  lines;                   /* -n How many program lines. */
+    ulong  seed;                    /* -s Random number seed. */
+    ushort variables;               /* -v How many variables. */
+    ushort procedures;              /* -p How many PROCs and FNs. */
+    ushort remarks;                 /* -r Percentage of REMark lines. */
+    ushort indents;                 /* -i Percentage of indented lines. */
+    ushort strings;                 /* -q Percentage of PRINT statements. */
+    ushort binary;                  /* -b Percentage of binary floats. */
+    ushort hexadecimal;             /* -x Percentage of hex floats. */
+    ushort statements;              /* -c Most statements on one line. */
+} genOptions;
+
+/* One generated name table entry. */
+typedef struct genName {
+    ushort nameType;
+    short  lineNumber;
+    ushort nameLength;
+    uchar  name[MAXGENNAME];
+} genName;
+
+/*===========================================================================
+ * FUNCTION PROTOTYPES
+ *===========================================================================*/
+ushort percent(ushort chance);
+
+void   buildNameTable(void);
+ushort addName(ushort nameType, char *prefix, ushort number, char *suffix);
+ushort pickName(ushort first, ushort count);
+
+void   generateProgram(void);
+void   generateBody(ulong lines, ushort depth, ushort function);
+void   generateDefinition(ulong lines, ushort entry);
+void   generateSimpleLine(ushort depth);
+void   generateStatement(void);
+void   generateExpression(ushort terms);
+void   generateStringExpression(void);
+void   generateFloat(void);
+void   generateText(uchar type, uchar delim, ushort words);
+
+ushort beginLine(ushort depth);
+void   endLine(void);
+
+/*===========================================================================*/
+
+#endif /* __SAVGEN_H__ */
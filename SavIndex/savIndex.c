@@ -0,0 +1,953 @@
+/*=============================================================================
+ * SAV corpus indexer. Finds every program, and line, that uses a name or a
+ * keyword, without reading the SAV files again.
+ *
+ * Building the index decodes each SAV file and posts every name and keyword
+ * token against the file and line it's on. Names are upper cased, as
+ * SuperBASIC doesn't care, so PRINT, Print and print are the same term.
+ * Extension keywords, from toolkits, are machine code PROC or FN names, so
+ * they are found the same way.
+ *
+ * The index is one file, in four parts, all big endian:
+ *
+ * Header:   'SIDX', version, file count, term count, and the offsets of the
+ *           other three parts, all longs.
+ * Files:    Name offset, modification time and size, for each SAV file.
+ * Terms:    Text offset, first posting and posting count for each term, in
+ *           order of text, so a query is a binary search.
+ * Postings: File number (long) and line number (word). Each term's postings
+ *           are together, in order of file and line.
+ * Strings:  The file names and term texts, zero terminated.
+ *
+ * Queries map the index into memory, and read nothing else.
+ *
+ * Updating an index only reads the SAV files that are new, or whose time or
+ * size has changed. The postings for the rest are copied from the old index.
+ * Files that have gone are dropped. The new index is written alongside the
+ * old one, then renamed over it, so a query never sees half an index.
+ *
+ * Usage: savIndex [-i index] file_or_directory ...
+ *        savIndex [-i index] [-f] -q term ...
+ *
+ * -i index     The index file. Default is INDEX_DEFAULT.
+ * -q           Query the index. Every line that uses each term is listed,
+ *              as file:line.
+ * -f           Just list the files, once each.
+ *
+ * Without -q, the files, and every file in the directories, are added to the
+ * index, or updated, and the files already in it are checked.
+ *===========================================================================*/
+
+/*===========================================================================
+ * HEADERS
+ *===========================================================================*/
+#include <ctype.h>
+#include <time.h>
+#include <sys/stat.h>
+
+#ifndef QDOS
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+#include "savIndex.h"
+
+/*===========================================================================
+ * GLOBALS
+ *===========================================================================*/
+idxFile *files = NULL;          /* The SAV files in the new index. */
+ulong fileCount = 0;
+ulong fileSpace = 0;
+
+idxTerm *terms = NULL;          /* Names and keywords. */
+ulong termCount = 0;
+ulong termSpace = 0;
+ulong *termSlots = NULL;        /* Hash of terms, entry + 1, 0 is empty. */
+ulong termSlotCount = 0;        /* Always a power of 2. */
+
+idxPosting *postings = NULL;    /* Every use of every term. */
+ulong postingCount = 0;
+ulong postingSpace = 0;
+
+
+/*=============================================================================
+ * MAIN() Start here. Builds, or updates, the index, or queries it.
+ *===========================================================================*/
+int main (int argc, char *argv[]) {
+    char *indexName = INDEX_DEFAULT;
+    ushort query = 0;
+    ushort filesOnly = 0;
+    int arg;
+
+    for (arg = 1; arg < argc; arg++) {
+        if (strcmp(argv[arg], "-i") == 0 && arg + 1 < argc) {
+            indexName = argv[++arg];
+        } else if (strcmp(argv[arg], "-q") == 0) {
+            query = 1;
+        } else if (strcmp(argv[arg], "-f") == 0) {
+            filesOnly = 1;
+        } else if (argv[arg][0] == '-') {
+            fprintf(stderr, "%s: Unknown option '%s'.\n", argv[0], argv[arg]);
+            return -1;
+        } else {
+            break;
+        }
+    }
+
+    if (arg == argc && query) {
+        fprintf(stderr, "Usage: %s [-i index] file_or_directory ...\n", argv[0]);
+        fprintf(stderr, "       %s [-i index] [-f] -q term ...\n", argv[0]);
+        return -1;
+    }
+
+    if (query) {
+        return (queryIndex(indexName, filesOnly, argc, argv, arg) == 0 ? 0 : -1);
+    }
+
+    if (buildIndex(indexName, argc, argv, arg) != 0) {
+        fprintf(stderr, "FATAL ERROR: buildIndex() failed.\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+
+/*=============================================================================
+ * IDXGETLONG() Returns the big endian long at the given address.
+ *===========================================================================*/
+ulong idxGetLong(uchar *bytes) {
+    return ((ulong)bytes[0] << 24) | ((ulong)bytes[1] << 16) |
+           ((ulong)bytes[2] << 8) | (ulong)bytes[3];
+}
+
+
+/*=============================================================================
+ * IDXPUTLONG() Writes a big endian long.
+ *===========================================================================*/
+void idxPutLong(FILE *fp, ulong value) {
+    fputc((value >> 24) & 0xFF, fp);
+    fputc((value >> 16) & 0xFF, fp);
+    fputc((value >> 8) & 0xFF, fp);
+    fputc(value & 0xFF, fp);
+}
+
+
+/*=============================================================================
+ * IDXPUTWORD() Writes a big endian word.
+ *===========================================================================*/
+void idxPutWord(FILE *fp, ushort value) {
+    fputc((value >> 8) & 0xFF, fp);
+    fputc(value & 0xFF, fp);
+}
+
+
+/*=============================================================================
+ * MAPINDEX() Maps an index file into memory and checks that it all fits
+ * together. QDOS has no mmap(), so it's read in there. Returns 1 if the file
+ * can't be opened, or isn't an index.
+ *===========================================================================*/
+ushort mapIndex(char *indexName, idxMap *map) {
+    uchar *base;
+    ulong termEnd;
+    ulong postingEnd;
+    FILE *fp;
+    long size;
+
+    memset(map, 0, sizeof(idxMap));
+
+    fp = fopen(indexName, "rb");
+    if (!fp) {
+        return 1;
+    }
+
+    fseek(fp, 0, SEEK_END);
+    size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+
+    if (size < INDEX_HEADER_SIZE) {
+        fprintf(stderr, "\n\nERROR: mapIndex(): '%s' is too small to be an index.\n", indexName);
+        fclose(fp);
+        return 1;
+    }
+
+#ifndef QDOS
+    base = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fileno(fp), 0);
+    if (base == MAP_FAILED) {
+        fprintf(stderr, "\n\nERROR: mapIndex(): Cannot map '%s' into memory.\n", indexName);
+        fclose(fp);
+        return 1;
+    }
+#else
+    base = malloc(size);
+    if (!base || fread(base, 1, size, fp) != (size_t)size) {
+        fprintf(stderr, "\n\nERROR: mapIndex(): Cannot read '%s'.\n", indexName);
+        free(base);
+        fclose(fp);
+        return 1;
+    }
+#endif
+
+    fclose(fp);
+    map->base = base;
+    map->size = size;
+
+    if (memcmp(base, INDEX_MAGIC, 4) != 0 || idxGetLong(base + 4) != INDEX_VERSION) {
+        fprintf(stderr, "\n\nERROR: mapIndex(): '%s' is not a version %d index.\n", indexName, INDEX_VERSION);
+        unmapIndex(map);
+        return 1;
+    }
+
+    map->fileCount = idxGetLong(base + 8);
+    map->termCount = idxGetLong(base + 12);
+    map->fileTable = idxGetLong(base + 16);
+    map->termTable = idxGetLong(base + 20);
+    map->postings = idxGetLong(base + 24);
+    map->strings = idxGetLong(base + 28);
+
+    /* Everything must be where the header says, and in the file. */
+    termEnd = map->termTable + map->termCount * INDEX_TERM_SIZE;
+    postingEnd = map->strings;
+    if (map->fileTable + map->fileCount * INDEX_FILE_SIZE > map->termTable ||
+        termEnd > map->postings || map->postings > postingEnd ||
+        map->strings > map->size || map->size == map->strings ||
+        base[map->size - 1] != '\0') {
+        fprintf(stderr, "\n\nERROR: mapIndex(): '%s' is damaged.\n", indexName);
+        unmapIndex(map);
+        return 1;
+    }
+
+    return 0;
+}
+
+
+/*=============================================================================
+ * UNMAPINDEX() Lets go of a mapped index.
+ *===========================================================================*/
+void unmapIndex(idxMap *map) {
+    if (map->base) {
+#ifndef QDOS
+        munmap(map->base, map->size);
+#else
+        free(map->base);
+#endif
+    }
+
+    memset(map, 0, sizeof(idxMap));
+}
+
+
+/*=============================================================================
+ * MAPSTRING() Returns a string from the index, or "" if the offset is bad.
+ * The last byte of the index is always a zero, so the string ends.
+ *===========================================================================*/
+char *mapString(idxMap *map, ulong offset) {
+    if (map->strings + offset >= map->size) {
+        return "";
+    }
+
+    return (char *)map->base + map->strings + offset;
+}
+
+
+/*=============================================================================
+ * ADDFILE() Adds a SAV file to the list for the new index. OldFile is its
+ * entry in the old index, or -1 if it's new.
+ *===========================================================================*/
+ushort addFile(char *name, long oldFile) {
+    idxFile *temp;
+
+    if (fileCount == fileSpace) {
+        fileSpace = (fileSpace ? fileSpace * 2 : 256);
+        temp = realloc(files, fileSpace * sizeof(idxFile));
+        if (!temp) {
+            fprintf(stderr, "\n\nERROR: addFile(): Cannot allocate memory for %lu files.\n", fileSpace);
+            return 1;
+        }
+        files = temp;
+    }
+
+    files[fileCount].name = strdup(name);
+    if (!files[fileCount].name) {
+        fprintf(stderr, "\n\nERROR: addFile(): Cannot allocate memory for '%s'.\n", name);
+        return 1;
+    }
+
+    files[fileCount].oldFile = oldFile;
+    files[fileCount].unchanged = 0;
+    fileCount++;
+    return 0;
+}
+
+
+/*=============================================================================
+ * ADDFILES() Adds a file, or every file in a directory.
+ *===========================================================================*/
+ushort addFiles(char *name) {
+#ifndef QDOS
+    DIR *dir;
+    struct dirent *entry;
+    struct stat info;
+    char fileName[MAXPATH + 1];
+
+    if (stat(name, &info) != 0) {
+        fprintf(stderr, "\n\nERROR: addFiles(): Cannot find '%s'.\n", name);
+        return 1;
+    }
+
+    if (!S_ISDIR(info.st_mode)) {
+        return addFile(name, -1);
+    }
+
+    dir = opendir(name);
+    if (!dir) {
+        fprintf(stderr, "\n\nERROR: addFiles(): Cannot read directory '%s'.\n", name);
+        return 1;
+    }
+
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] == '.') {
+            continue;
+        }
+
+        snprintf(fileName, sizeof(fileName), "%s/%s", name, entry->d_name);
+        if (addFile(fileName, -1) != 0) {
+            closedir(dir);
+            return 1;
+        }
+    }
+
+    closedir(dir);
+    return 0;
+#else
+    return addFile(name, -1);
+#endif
+}
+
+
+/*=============================================================================
+ * COMPAREFILES() For qsort(), by name, with files from the old index first,
+ * so they are the ones kept when a name is there twice.
+ *===========================================================================*/
+int compareFiles(const void *a, const void *b) {
+    const idxFile *fa = a;
+    const idxFile *fb = b;
+    int result = strcmp(fa->name, fb->name);
+
+    if (result) {
+        return result;
+    }
+
+    return (fa->oldFile < fb->oldFile) - (fa->oldFile > fb->oldFile);
+}
+
+
+/*=============================================================================
+ * PREPAREFILES() Sorts the files, drops repeats and ones that have gone, and
+ * notes which are unchanged since the old index.
+ *===========================================================================*/
+ushort prepareFiles(void) {
+    struct stat info;
+    ulong x;
+    ulong kept = 0;
+
+    if (fileCount) {
+        qsort(files, fileCount, sizeof(idxFile), compareFiles);
+    }
+
+    for (x = 0; x < fileCount; x++) {
+        if ((kept && strcmp(files[kept - 1].name, files[x].name) == 0) ||
+            stat(files[x].name, &info) != 0 || S_ISDIR(info.st_mode)) {
+            free(files[x].name);
+            continue;
+        }
+
+        if (files[x].oldFile >= 0 &&
+            files[x].mtime == (ulong)info.st_mtime && files[x].size == (ulong)info.st_size) {
+            files[x].unchanged = 1;
+        }
+
+        files[x].mtime = info.st_mtime;
+        files[x].size = info.st_size;
+        files[kept++] = files[x];
+    }
+
+    fileCount = kept;
+    return 0;
+}
+
+
+/*=============================================================================
+ * TERMHASH() FNV-1a hash of a term.
+ *===========================================================================*/
+ulong termHash(char *text) {
+    ulong hash = 2166136261UL;
+
+    while (*text) {
+        hash = ((hash ^ (uchar)*text++) * 16777619UL) & 0xFFFFFFFFUL;
+    }
+
+    return hash;
+}
+
+
+/*=============================================================================
+ * FINDTERM() Returns a term's entry, adding it if it's new and add is set.
+ * Returns -1 if it isn't there, or there's no memory. The hash is kept under
+ * half full.
+ *===========================================================================*/
+long findTerm(char *text, ushort add) {
+    ulong slot;
+    ulong x;
+    ulong *temp;
+    idxTerm *tempTerms;
+
+    if (termSlotCount) {
+        slot = termHash(text) & (termSlotCount - 1);
+        while (termSlots[slot]) {
+            if (strcmp(terms[termSlots[slot] - 1].text, text) == 0) {
+                return termSlots[slot] - 1;
+            }
+            slot = (slot + 1) & (termSlotCount - 1);
+        }
+    }
+
+    if (!add) {
+        return -1;
+    }
+
+    /* Grow the hash, and put everything back. */
+    if ((termCount + 1) * 2 > termSlotCount) {
+        termSlotCount = (termSlotCount ? termSlotCount * 2 : 1024);
+        temp = calloc(termSlotCount, sizeof(ulong));
+        if (!temp) {
+            fprintf(stderr, "\n\nERROR: findTerm(): Cannot allocate memory for %lu terms.\n", termSlotCount);
+            return -1;
+        }
+
+        free(termSlots);
+        termSlots = temp;
+        for (x = 0; x < termCount; x++) {
+            slot = termHash(terms[x].text) & (termSlotCount - 1);
+            while (termSlots[slot]) {
+                slot = (slot + 1) & (termSlotCount - 1);
+            }
+            termSlots[slot] = x + 1;
+        }
+    }
+
+    if (termCount == termSpace) {
+        termSpace = (termSpace ? termSpace * 2 : 512);
+        tempTerms = realloc(terms, termSpace * sizeof(idxTerm));
+        if (!tempTerms) {
+            fprintf(stderr, "\n\nERROR: findTerm(): Cannot allocate memory for %lu terms.\n", termSpace);
+            return -1;
+        }
+        terms = tempTerms;
+    }
+
+    terms[termCount].text = strdup(text);
+    if (!terms[termCount].text) {
+        fprintf(stderr, "\n\nERROR: findTerm(): Cannot allocate memory for '%s'.\n", text);
+        return -1;
+    }
+
+    terms[termCount].count = 0;
+    terms[termCount].lastFile = NO_FILE;
+    terms[termCount].lastLine = 0;
+
+    slot = termHash(text) & (termSlotCount - 1);
+    while (termSlots[slot]) {
+        slot = (slot + 1) & (termSlotCount - 1);
+    }
+    termSlots[slot] = termCount + 1;
+
+    return termCount++;
+}
+
+
+/*=============================================================================
+ * ADDPOSTING() Records a use of a term. A term used twice on a line is only
+ * posted once.
+ *===========================================================================*/
+ushort addPosting(ulong term, ulong file, ushort line) {
+    idxPosting *temp;
+
+    if (terms[term].lastFile == file && terms[term].lastLine == line) {
+        return 0;
+    }
+
+    if (postingCount == postingSpace) {
+        postingSpace = (postingSpace ? postingSpace * 2 : 65536);
+        temp = realloc(postings, postingSpace * sizeof(idxPosting));
+        if (!temp) {
+            fprintf(stderr, "\n\nERROR: addPosting(): Cannot allocate memory for %lu postings.\n", postingSpace);
+            return 1;
+        }
+        postings = temp;
+    }
+
+    postings[postingCount].term = term;
+    postings[postingCount].file = file;
+    postings[postingCount].line = line;
+    postingCount++;
+
+    terms[term].lastFile = file;
+    terms[term].lastLine = line;
+    terms[term].count++;
+    return 0;
+}
+
+
+/*=============================================================================
+ * TERMFROMBYTES() Makes an upper case, zero terminated, term from a name or
+ * keyword. Overlong names are cut short. Returns the length.
+ *===========================================================================*/
+ushort termFromBytes(uchar *bytes, ushort size, char *text) {
+    ushort x;
+
+    if (size > MAXNAMESIZE * 8) {
+        size = MAXNAMESIZE * 8;
+    }
+
+    for (x = 0; x < size; x++) {
+        text[x] = toupper(bytes[x]);
+    }
+
+    text[size] = '\0';
+    return size;
+}
+
+
+/*=============================================================================
+ * INDEXSAVFILE() Reads a SAV file and posts all its names and keywords. Each
+ * name's term is looked up the first time it's used, not every time, and
+ * names that are never used aren't terms. A file that won't
+ * decode is left in the index, with no postings, so it isn't read again
+ * until it changes.
+ *===========================================================================*/
+ushort indexSavFile(ulong file, savFile *sav, savProgram *prog) {
+    static long *nameTerms = NULL;
+    static ulong nameTermSpace = 0;
+    long *temp;
+    long term;
+    char text[MAXNAMESIZE * 8 + 1];
+    savProgLine *line;
+    savToken *token;
+    ulong x;
+    ulong t;
+
+    if (savReadFile(files[file].name, sav) != SAV_OK ||
+        savDecodeProgram(sav, prog) != SAV_OK) {
+        fprintf(stderr, "WARNING: '%s' will not decode, it has no postings.\n", files[file].name);
+        return 0;
+    }
+
+    if (prog->nameCount > nameTermSpace) {
+        temp = realloc(nameTerms, prog->nameCount * sizeof(long));
+        if (!temp) {
+            fprintf(stderr, "\n\nERROR: indexSavFile(): Cannot allocate memory for %lu names.\n", prog->nameCount);
+            return 1;
+        }
+        nameTerms = temp;
+        nameTermSpace = prog->nameCount;
+    }
+
+    for (x = 0; x < prog->nameCount; x++) {
+        nameTerms[x] = -1;
+    }
+
+    for (x = 0; x < prog->lineCount; x++) {
+        line = prog->lines + x;
+        for (t = line->first; t < line->first + line->count; t++) {
+            token = prog->tokens + t;
+            if (token->type == TYPE_NAME) {
+                if (nameTerms[token->value] < 0) {
+                    termFromBytes(prog->names[token->value].name, prog->names[token->value].nameLength, text);
+                    if ((nameTerms[token->value] = findTerm(text, 1)) < 0) {
+                        return 1;
+                    }
+                }
+                term = nameTerms[token->value];
+            } else if (token->type == TYPE_KEYWORD && savKeywords[token->code][0]) {
+                termFromBytes((uchar *)savKeywords[token->code], strlen(savKeywords[token->code]), text);
+                if ((term = findTerm(text, 1)) < 0) {
+                    return 1;
+                }
+            } else {
+                continue;
+            }
+
+            if (addPosting(term, file, line->lineNumber) != 0) {
+                return 1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+
+/*=============================================================================
+ * COPYPOSTINGS() Copies the postings for the unchanged files from the old
+ * index, instead of reading the files again.
+ *===========================================================================*/
+ushort copyPostings(idxMap *map) {
+    ulong *newFile;
+    ulong x;
+    ulong p;
+    ulong first;
+    ulong count;
+    ulong file;
+    long term;
+    uchar *entry;
+    uchar *posting;
+
+    newFile = malloc((map->fileCount + 1) * sizeof(ulong));
+    if (!newFile) {
+        fprintf(stderr, "\n\nERROR: copyPostings(): Cannot allocate memory for %lu files.\n", map->fileCount);
+        return 1;
+    }
+
+    for (x = 0; x < map->fileCount; x++) {
+        newFile[x] = NO_FILE;
+    }
+
+    for (x = 0; x < fileCount; x++) {
+        if (files[x].unchanged) {
+            newFile[files[x].oldFile] = x;
+        }
+    }
+
+    for (x = 0; x < map->termCount; x++) {
+        entry = map->base + map->termTable + x * INDEX_TERM_SIZE;
+        first = idxGetLong(entry + 4);
+        count = idxGetLong(entry + 8);
+        term = -1;
+
+        if (map->postings + (first + count) * INDEX_POSTING_SIZE > map->strings) {
+            continue;
+        }
+
+        for (p = first; p < first + count; p++) {
+            posting = map->base + map->postings + p * INDEX_POSTING_SIZE;
+            file = idxGetLong(posting);
+            if (file >= map->fileCount || newFile[file] == NO_FILE) {
+                continue;
+            }
+
+            if (term < 0 && (term = findTerm(mapString(map, idxGetLong(entry)), 1)) < 0) {
+                free(newFile);
+                return 1;
+            }
+
+            if (addPosting(term, newFile[file], savGetWord(posting + 4)) != 0) {
+                free(newFile);
+                return 1;
+            }
+        }
+    }
+
+    free(newFile);
+    return 0;
+}
+
+
+/*=============================================================================
+ * COMPARETERMS() For qsort(), sorts term numbers by their text.
+ *===========================================================================*/
+int compareTerms(const void *a, const void *b) {
+    return strcmp(terms[*(const ulong *)a].text, terms[*(const ulong *)b].text);
+}
+
+
+/*=============================================================================
+ * COMPAREPOSTINGS() For qsort(), by term, then file, then line.
+ *===========================================================================*/
+int comparePostings(const void *a, const void *b) {
+    const idxPosting *pa = a;
+    const idxPosting *pb = b;
+
+    if (pa->term != pb->term) {
+        return (pa->term < pb->term ? -1 : 1);
+    }
+
+    if (pa->file != pb->file) {
+        return (pa->file < pb->file ? -1 : 1);
+    }
+
+    return (pa->line > pb->line) - (pa->line < pb->line);
+}
+
+
+/*=============================================================================
+ * WRITEINDEX() Sorts the terms and postings and writes the index, to a new
+ * file that is then renamed over the old one.
+ *===========================================================================*/
+ushort writeIndex(char *indexName) {
+    char tempName[MAXPATH + 1];
+    ulong *order;
+    ulong x;
+    ulong offset = 0;
+    ulong first = 0;
+    ulong fileTable = INDEX_HEADER_SIZE;
+    ulong termTable = fileTable + fileCount * INDEX_FILE_SIZE;
+    ulong postingTable = termTable + termCount * INDEX_TERM_SIZE;
+    FILE *fp;
+
+    order = malloc((termCount + 1) * sizeof(ulong));
+    if (!order) {
+        fprintf(stderr, "\n\nERROR: writeIndex(): Cannot allocate memory for %lu terms.\n", termCount);
+        return 1;
+    }
+
+    for (x = 0; x < termCount; x++) {
+        order[x] = x;
+    }
+
+    if (termCount) {
+        qsort(order, termCount, sizeof(ulong), compareTerms);
+    }
+
+    for (x = 0; x < termCount; x++) {
+        terms[order[x]].newTerm = x;
+    }
+
+    for (x = 0; x < postingCount; x++) {
+        postings[x].term = terms[postings[x].term].newTerm;
+    }
+
+    if (postingCount) {
+        qsort(postings, postingCount, sizeof(idxPosting), comparePostings);
+    }
+
+    snprintf(tempName, sizeof(tempName), "%s_new", indexName);
+    fp = fopen(tempName, "wb");
+    if (!fp) {
+        fprintf(stderr, "\n\nERROR: writeIndex(): Cannot open '%s' for writing.\n", tempName);
+        free(order);
+        return 1;
+    }
+
+    fwrite(INDEX_MAGIC, 1, 4, fp);
+    idxPutLong(fp, INDEX_VERSION);
+    idxPutLong(fp, fileCount);
+    idxPutLong(fp, termCount);
+    idxPutLong(fp, fileTable);
+    idxPutLong(fp, termTable);
+    idxPutLong(fp, postingTable);
+    idxPutLong(fp, postingTable + postingCount * INDEX_POSTING_SIZE);
+
+    /* Strings are file names, then terms, in the same order as the tables. */
+    for (x = 0; x < fileCount; x++) {
+        idxPutLong(fp, offset);
+        idxPutLong(fp, files[x].mtime);
+        idxPutLong(fp, files[x].size);
+        offset += strlen(files[x].name) + 1;
+    }
+
+    for (x = 0; x < termCount; x++) {
+        idxPutLong(fp, offset);
+        idxPutLong(fp, first);
+        idxPutLong(fp, terms[order[x]].count);
+        offset += strlen(terms[order[x]].text) + 1;
+        first += terms[order[x]].count;
+    }
+
+    for (x = 0; x < postingCount; x++) {
+        idxPutLong(fp, postings[x].file);
+        idxPutWord(fp, postings[x].line);
+    }
+
+    for (x = 0; x < fileCount; x++) {
+        fwrite(files[x].name, 1, strlen(files[x].name) + 1, fp);
+    }
+
+    for (x = 0; x < termCount; x++) {
+        fwrite(terms[order[x]].text, 1, strlen(terms[order[x]].text) + 1, fp);
+    }
+
+    /* Queries rely on the last byte being zero. */
+    fputc('\0', fp);
+    free(order);
+
+    if (ferror(fp) | fclose(fp)) {
+        fprintf(stderr, "\n\nERROR: writeIndex(): Cannot write '%s'.\n", tempName);
+        remove(tempName);
+        return 1;
+    }
+
+    if (rename(tempName, indexName) != 0) {
+        fprintf(stderr, "\n\nERROR: writeIndex(): Cannot rename '%s' to '%s'.\n", tempName, indexName);
+        return 1;
+    }
+
+    return 0;
+}
+
+
+/*=============================================================================
+ * BUILDINDEX() Builds a new index, or updates the old one, from the files in
+ * the old index and the ones on the command line.
+ *===========================================================================*/
+ushort buildIndex(char *indexName, int argc, char *argv[], int first) {
+    idxMap map;
+    savFile sav;
+    savProgram prog;
+    ulong x;
+    ulong readCount = 0;
+    ulong oldCount;
+    ulong keptCount = 0;
+    uchar *entry;
+    clock_t start = clock();
+
+    /* No old index is fine, it's a new one. */
+    if (mapIndex(indexName, &map) == 0) {
+        for (x = 0; x < map.fileCount; x++) {
+            entry = map.base + map.fileTable + x * INDEX_FILE_SIZE;
+            if (addFile(mapString(&map, idxGetLong(entry)), x) != 0) {
+                return 1;
+            }
+            files[fileCount - 1].mtime = idxGetLong(entry + 4);
+            files[fileCount - 1].size = idxGetLong(entry + 8);
+        }
+    }
+
+    oldCount = map.fileCount;
+
+    for (; first < argc; first++) {
+        if (addFiles(argv[first]) != 0) {
+            return 1;
+        }
+    }
+
+    if (prepareFiles() != 0 || (map.base && copyPostings(&map) != 0)) {
+        return 1;
+    }
+
+    unmapIndex(&map);
+
+    savInitFile(&sav);
+    savInitProgram(&prog);
+    for (x = 0; x < fileCount; x++) {
+        if (files[x].oldFile >= 0) {
+            keptCount++;
+        }
+
+        if (files[x].unchanged) {
+            continue;
+        }
+
+        if (indexSavFile(x, &sav, &prog) != 0) {
+            return 1;
+        }
+        readCount++;
+    }
+
+    savFreeProgram(&prog);
+    savFreeFile(&sav);
+
+    if (writeIndex(indexName) != 0) {
+        return 1;
+    }
+
+    fprintf(stderr, "%s: %lu files, %lu read, %lu unchanged, %lu dropped, %lu terms, %lu postings, %.2f seconds.\n",
+            indexName, fileCount, readCount, fileCount - readCount, oldCount - keptCount,
+            termCount, postingCount, (double)(clock() - start) / CLOCKS_PER_SEC);
+
+    return 0;
+}
+
+
+/*=============================================================================
+ * LOOKUPTERM() Binary searches the mapped term table. Returns the term's
+ * entry, or -1.
+ *===========================================================================*/
+long lookupTerm(idxMap *map, char *text) {
+    ulong low = 0;
+    ulong high = map->termCount;
+    ulong middle;
+    int result;
+
+    while (low < high) {
+        middle = low + (high - low) / 2;
+        result = strcmp(mapString(map, idxGetLong(map->base + map->termTable + middle * INDEX_TERM_SIZE)), text);
+        if (result == 0) {
+            return middle;
+        }
+
+        if (result < 0) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+
+    return -1;
+}
+
+
+/*=============================================================================
+ * QUERYINDEX() Lists every file and line that uses each term, or just the
+ * files.
+ *===========================================================================*/
+ushort queryIndex(char *indexName, ushort filesOnly, int argc, char *argv[], int first) {
+    idxMap map;
+    char text[MAXNAMESIZE * 8 + 1];
+    uchar *entry;
+    uchar *posting;
+    ulong count;
+    ulong start;
+    ulong file;
+    ulong lastFile;
+    ulong p;
+    ulong found = 0;
+    long term;
+    clock_t began = clock();
+
+    if (mapIndex(indexName, &map) != 0) {
+        fprintf(stderr, "\n\nERROR: queryIndex(): Cannot open index '%s'.\n", indexName);
+        return 1;
+    }
+
+    for (; first < argc; first++) {
+        termFromBytes((uchar *)argv[first], strlen(argv[first]), text);
+        if ((term = lookupTerm(&map, text)) < 0) {
+            continue;
+        }
+
+        entry = map.base + map.termTable + term * INDEX_TERM_SIZE;
+        start = idxGetLong(entry + 4);
+        count = idxGetLong(entry + 8);
+        if (map.postings + (start + count) * INDEX_POSTING_SIZE > map.strings) {
+            fprintf(stderr, "\n\nERROR: queryIndex(): '%s' is damaged.\n", indexName);
+            unmapIndex(&map);
+            return 1;
+        }
+
+        lastFile = NO_FILE;
+        for (p = start; p < start + count; p++) {
+            posting = map.base + map.postings + p * INDEX_POSTING_SIZE;
+            file = idxGetLong(posting);
+            if (file >= map.fileCount || (filesOnly && file == lastFile)) {
+                continue;
+            }
+
+            entry = map.base + map.fileTable + file * INDEX_FILE_SIZE;
+            if (filesOnly) {
+                printf("%s\n", mapString(&map, idxGetLong(entry)));
+            } else {
+                printf("%s:%d: %s\n", mapString(&map, idxGetLong(entry)), savGetWord(posting + 4), text);
+            }
+
+            lastFile = file;
+            found++;
+        }
+    }
+
+    fprintf(stderr, "%lu found, %.3f ms.\n", found, 1000.0 * (clock() - began) / CLOCKS_PER_SEC);
+    unmapIndex(&map);
+    return 0;
+}
@@ -0,0 +1,97 @@
+#ifndef __SAVINDEX_H__
+#define __SAVINDEX_H__
+
+/*===========================================================================
+ * HEADERS
+ *===========================================================================*/
+#include "../SavFile/savFile.h"
+
+/*===========================================================================
+ * DEFINES
+ *===========================================================================*/
+#define INDEX_MAGIC "SIDX"          /* First 4 bytes of an index file. */
+#define INDEX_VERSION 1             /* Change this if the layout changes. */
+#define INDEX_DEFAULT "sav_index"   /* Index file, if -i isn't given. */
+
+/* The index file is all big endian longs, and words, like a SAV file. */
+#define INDEX_HEADER_SIZE 32        /* Magic, version, counts and offsets. */
+#define INDEX_FILE_SIZE 12          /* Name offset, mtime, size. */
+#define INDEX_TERM_SIZE 12          /* Text offset, first posting, count. */
+#define INDEX_POSTING_SIZE 6        /* File long, line word. */
+
+#define NO_FILE 0xFFFFFFFFUL        /* Posting for a file that's gone. */
+
+/*===========================================================================
+ * TYPEDEFS
+ *===========================================================================*/
+
+/* One SAV file in the index being built. */
+typedef struct idxFile {
+    char  *name;
+    ulong mtime;
+    ulong size;
+    long  oldFile;                  /* Entry in the old index, or -1. */
+    ushort unchanged;               /* Postings can come from the old index. */
+} idxFile;
+
+/* One name or keyword in the index being built. */
+typedef struct idxTerm {
+    char  *text;                    /* Upper case. */
+    ulong count;                    /* Postings. */
+    ulong newTerm;                  /* Where it ends up, in sorted order. */
+    ulong lastFile;                 /* So a line is only posted once. */
+    ushort lastLine;
+} idxTerm;
+
+/* One use of a term, on a line of a file. */
+typedef struct idxPosting {
+    ulong term;
+    ulong file;
+    ushort line;
+} idxPosting;
+
+/* An index file, mapped into memory. */
+typedef struct idxMap {
+    uchar *base;
+    ulong size;
+    ulong fileCount;
+    ulong termCount;
+    ulong fileTable;
+    ulong termTable;
+    ulong postings;
+    ulong strings;
+} idxMap;
+
+/*===========================================================================
+ * FUNCTION PROTOTYPES
+ *===========================================================================*/
+ulong  idxGetLong(uchar *bytes);
+void   idxPutLong(FILE *fp, ulong value);
+void   idxPutWord(FILE *fp, ushort value);
+
+ushort mapIndex(char *indexName, idxMap *map);
+void   unmapIndex(idxMap *map);
+char  *mapString(idxMap *map, ulong offset);
+
+ushort addFile(char *name, long oldFile);
+ushort addFiles(char *name);
+int    compareFiles(const void *a, const void *b);
+ushort prepareFiles(void);
+
+ulong  termHash(char *text);
+long   findTerm(char *text, ushort add);
+ushort addPosting(ulong term, ulong file, ushort line);
+ushort termFromBytes(uchar *bytes, ushort size, char *text);
+ushort indexSavFile(ulong file, savFile *sav, savProgram *prog);
+ushort copyPostings(idxMap *map);
+int    compareTerms(const void *a, const void *b);
+int    comparePostings(const void *a, const void *b);
+ushort writeIndex(char *indexName);
+
+ushort buildIndex(char *indexName, int argc, char *argv[], int first);
+long   lookupTerm(idxMap *map, char *text);
+ushort queryIndex(char *indexName, ushort filesOnly, int argc, char *argv[], int first);
+
+/*===========================================================================*/
+
+#endif /* __SAVINDEX_H__ */
@@ -0,0 +1,281 @@
+/*=============================================================================
+ * SAV file renumberer. RENUM, without loading the program into a QL.
+ *
+ * The lines from first to last are given new numbers, start, start + step
+ * and so on, and every line number after GO TO, GO SUB, ON ... GO TO, ON ...
+ * GO SUB and RESTORE is changed to match, as are the line numbers of PROC
+ * and FN definitions in the name table. Lines outside the range keep their
+ * numbers, and the new numbers must fit between them.
+ *
+ * The old and new numbers are held in a flat array, one entry per line, in
+ * line order, so looking up a target is a binary search. The program is
+ * changed in one pass, each float that is a target is re-encoded where it
+ * is, in the same format.
+ *
+ * A target that isn't a line is changed to the new number of the line after
+ * it, as that's where SuperBASIC would have gone. A target that is an
+ * expression, GO TO 100 + x * 10 for example, can't be changed, so those
+ * lines are listed, for checking by hand.
+ *
+ * Usage: savRenum [-f first] [-l last] [-s start] [-i step] [-o output_sav]
+ *                 program_sav
+ *
+ * -f first     First line to renumber. Default is the first line.
+ * -l last      Last line to renumber. Default is the last line.
+ * -s start     New number for the first line. Default 100.
+ * -i step      Gap between new numbers. Default 10.
+ * -o output    The renumbered file. Default is the input with '_ren' added
+ *              before the '_sav' or '.sav', or on the end.
+ *===========================================================================*/
+
+/*===========================================================================
+ * HEADERS
+ *===========================================================================*/
+#include <time.h>
+
+#include "savRenum.h"
+
+/*===========================================================================
+ * GLOBALS
+ *===========================================================================*/
+lineMap *map = NULL;            /* Old and new numbers, one per line. */
+ulong mapSize = 0;              /* How many lines. */
+
+renumStats stats;
+
+
+/*=============================================================================
+ * MAIN() Start here. Reads the SAV file, renumbers it, then writes it out.
+ *===========================================================================*/
+int main (int argc, char *argv[]) {
+    char *inFile = NULL;
+    char outFile[MAXPATH + 1] = "";
+    ushort first = 0;
+    ushort last = 65535;
+    ulong start = 100;
+    ulong step = 10;
+    savFile sav;
+    savProgram prog;
+    clock_t began;
+    double took;
+    int arg;
+
+    for (arg = 1; arg < argc; arg++) {
+        if (strcmp(argv[arg], "-o") == 0 && arg + 1 < argc) {
+            strncpy(outFile, argv[++arg], MAXPATH);
+            outFile[MAXPATH] = '\0';
+        } else if (strcmp(argv[arg], "-f") == 0 && arg + 1 < argc) {
+            first = atoi(argv[++arg]);
+        } else if (strcmp(argv[arg], "-l") == 0 && arg + 1 < argc) {
+            last = atoi(argv[++arg]);
+        } else if (strcmp(argv[arg], "-s") == 0 && arg + 1 < argc) {
+            start = atol(argv[++arg]);
+        } else if (strcmp(argv[arg], "-i") == 0 && arg + 1 < argc) {
+            step = atol(argv[++arg]);
+        } else if (argv[arg][0] == '-') {
+            fprintf(stderr, "%s: Unknown option '%s'.\n", argv[0], argv[arg]);
+            return -1;
+        } else {
+            inFile = argv[arg];
+        }
+    }
+
+    if (!inFile) {
+        fprintf(stderr, "Usage: %s [-f first] [-l last] [-s start] [-i step] [-o output_sav] program_sav\n", argv[0]);
+        return -1;
+    }
+
+    if (start < 1 || start > MAXLINENUMBER || step < 1 || step > MAXLINENUMBER || first > last) {
+        fprintf(stderr, "FATAL ERROR: main(): Start and step must be 1 to %d, and first can't be after last.\n", MAXLINENUMBER);
+        return -1;
+    }
+
+    if (!outFile[0]) {
+        savOutputName(inFile, "_ren", outFile);
+    }
+
+    savInitFile(&sav);
+    savInitProgram(&prog);
+
+    if (savReadFile(inFile, &sav) != SAV_OK ||
+        savDecodeProgram(&sav, &prog) != SAV_OK) {
+        fprintf(stderr, "FATAL ERROR: main(): Cannot decode '%s'.\n", inFile);
+        return -1;
+    }
+
+    began = clock();
+    memset(&stats, 0, sizeof(stats));
+
+    if (buildLineMap(&prog, first, last, start, step) != 0) {
+        fprintf(stderr, "FATAL ERROR: buildLineMap() failed.\n");
+        return -1;
+    }
+
+    renumberProgram(&prog);
+    took = (double)(clock() - began) / CLOCKS_PER_SEC;
+
+    if (savWriteProgram(outFile, &prog) != SAV_OK) {
+        fprintf(stderr, "FATAL ERROR: savWriteProgram() failed.\n");
+        return -1;
+    }
+
+    fprintf(stderr, "%s: %lu lines renumbered, %lu targets and %lu definitions changed",
+            outFile, stats.lines, stats.targets, stats.names);
+    if (took > 0) {
+        fprintf(stderr, ", %.0f lines/s", prog.lineCount / took);
+    }
+    fprintf(stderr, ".\n");
+
+    if (stats.missing) {
+        fprintf(stderr, "WARNING: %lu targets were not lines, they now go to the line after.\n", stats.missing);
+    }
+
+    if (stats.computed) {
+        fprintf(stderr, "WARNING: %lu targets are expressions and were not changed.\n", stats.computed);
+    }
+
+    free(map);
+    savFreeProgram(&prog);
+    savFreeFile(&sav);
+    return 0;
+}
+
+
+/*=============================================================================
+ * BUILDLINEMAP() Works out every line's new number. The lines must already be
+ * in order, and the renumbered ones must stay between the lines either side
+ * of them. Returns 1 if they won't.
+ *===========================================================================*/
+ushort buildLineMap(savProgram *prog, ushort first, ushort last, ulong start, ulong step) {
+    ulong x;
+    ulong next = start;
+
+    mapSize = prog->lineCount;
+    map = malloc((mapSize ? mapSize : 1) * sizeof(lineMap));
+    if (!map) {
+        fprintf(stderr, "\n\nERROR: buildLineMap(): Cannot allocate memory for %lu lines.\n", mapSize);
+        return 1;
+    }
+
+    for (x = 0; x < mapSize; x++) {
+        map[x].oldLine = prog->lines[x].lineNumber;
+        map[x].newLine = map[x].oldLine;
+
+        if (x && map[x].oldLine <= map[x - 1].oldLine) {
+            fprintf(stderr, "\n\nERROR: buildLineMap(): Line %d is out of order, after line %d.\n", map[x].oldLine, map[x - 1].oldLine);
+            return 1;
+        }
+
+        if (map[x].oldLine >= first && map[x].oldLine <= last) {
+            if (next > MAXLINENUMBER) {
+                fprintf(stderr, "\n\nERROR: buildLineMap(): Line %d would be renumbered past %d.\n", map[x].oldLine, MAXLINENUMBER);
+                return 1;
+            }
+
+            map[x].newLine = next;
+            next += step;
+        }
+
+        if (x && map[x].newLine <= map[x - 1].newLine) {
+            fprintf(stderr, "\n\nERROR: buildLineMap(): Line %d would be renumbered to %d, which is not after line %d.\n",
+                    map[x].oldLine, map[x].newLine, map[x - 1].newLine);
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+
+/*=============================================================================
+ * FINDLINE() Returns the index, in the map, of the first line numbered
+ * lineNumber or more. Returns mapSize if there isn't one.
+ *===========================================================================*/
+ulong findLine(ushort lineNumber) {
+    ulong low = 0;
+    ulong high = mapSize;
+    ulong middle;
+
+    while (low < high) {
+        middle = low + (high - low) / 2;
+        if (map[middle].oldLine < lineNumber) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+
+    return low;
+}
+
+
+/*=============================================================================
+ * RENUMBERTARGET() Called by savFindTargets() for each line number after a
+ * GO TO, GO SUB or RESTORE. The float is re-encoded in place, in its original
+ * format, but only if the number has changed.
+ *===========================================================================*/
+void renumberTarget(savToken *token, ushort lineNumber, ulong line, void *data) {
+    ulong x;
+    ushort newLine;
+
+    (void)data;
+
+    if (!token) {
+        if (stats.computed++ < MAXWARNINGS) {
+            fprintf(stderr, "WARNING: Line %d (was %d) has a GO TO, GO SUB or RESTORE that can't be renumbered.\n",
+                    map[line].newLine, map[line].oldLine);
+        }
+        return;
+    }
+
+    x = findLine(lineNumber);
+    if (x == mapSize) {
+        /* Off the end, keep it there. */
+        newLine = (mapSize && map[mapSize - 1].newLine >= lineNumber ? map[mapSize - 1].newLine + 1 : lineNumber);
+    } else {
+        newLine = map[x].newLine;
+    }
+
+    if (x == mapSize || map[x].oldLine != lineNumber) {
+        stats.missing++;
+    }
+
+    if (newLine != lineNumber) {
+        qlfpEncode(newLine, (token->type - TYPE_FP_BIN_MIN) >> 4, token->data);
+        token->type = token->data[0];
+        stats.targets++;
+    }
+}
+
+
+/*=============================================================================
+ * RENUMBERPROGRAM() Changes the targets, the line numbers and then the name
+ * table. The targets need the old line numbers to say where they are.
+ *===========================================================================*/
+void renumberProgram(savProgram *prog) {
+    ulong x;
+    ulong y;
+
+    savFindTargets(prog, renumberTarget, NULL);
+
+    for (x = 0; x < prog->lineCount; x++) {
+        if (prog->lines[x].lineNumber != map[x].newLine) {
+            prog->lines[x].lineNumber = map[x].newLine;
+            stats.lines++;
+        }
+    }
+
+    /* PROCs and FNs know the line they were DEFined on. */
+    for (x = 0; x < prog->nameCount; x++) {
+        if (prog->names[x].lineNumber <= 0) {
+            continue;
+        }
+
+        y = findLine(prog->names[x].lineNumber);
+        if (y < mapSize && map[y].oldLine == prog->names[x].lineNumber &&
+            map[y].newLine != map[y].oldLine) {
+            prog->names[x].lineNumber = map[y].newLine;
+            stats.names++;
+        }
+    }
+}
@@ -0,0 +1,45 @@
+#ifndef __SAVRENUM_H__
+#define __SAVRENUM_H__
+
+/*===========================================================================
+ * HEADERS
+ *===========================================================================*/
+#include "../SavFile/savFile.h"
+
+/*===========================================================================
+ * DEFINES
+ *===========================================================================*/
+#define MAXLINENUMBER 32767         /* SuperBASIC's biggest line number. */
+#define MAXWARNINGS 10              /* Lines listed for each kind of warning. */
+
+/*===========================================================================
+ * TYPEDEFS
+ *===========================================================================*/
+
+/* One line's old and new numbers. The map has one of these for every line,
+ * in order, so it's sorted by both. */
+typedef struct lineMap {
+    ushort oldLine;
+    ushort newLine;
+} lineMap;
+
+/* What was done, for the report. */
+typedef struct renumStats {
+    ulong lines;                    /* Lines given a new number. */
+    ulong targets;                  /* GO TO etc line numbers changed. */
+    ulong missing;                  /* Targets that aren't a line. */
+    ulong computed;                 /* Targets we can't change. */
+    ulong names;                    /* PROC and FN definitions moved. */
+} renumStats;
+
+/*===========================================================================
+ * FUNCTION PROTOTYPES
+ *===========================================================================*/
+ushort buildLineMap(savProgram *prog, ushort first, ushort last, ulong start, ulong step);
+ulong  findLine(ushort lineNumber);
+void   renumberTarget(savToken *token, ushort lineNumber, ulong line, void *data);
+void   renumberProgram(savProgram *prog);
+
+/*===========================================================================*/
+
+#endif /* __SAVRENUM_H__ */
@@ -0,0 +1,580 @@
+/*=============================================================================
+ * SAV file corpus statistics.
+ *
+ * Scans any number of SAV files and counts what's in them - token types,
+ * keywords, operators and the rest, name table types, line sizes and the
+ * number of PROCedures and FuNctions. The idea is to find out what a real
+ * collection of programs uses, before deciding what to make faster.
+ *
+ * Each thread reads whole files into its own buffer and counts into its own
+ * totals, so there is no locking apart from handing out the next file name.
+ * The totals are merged when all the threads are done and written as CSV or
+ * JSON.
+ *
+ * Usage: savStat [-t threads] [-j] [-o output] [-l listfile] [file ...]
+ *
+ * -t threads   How many threads to use. Default 1.
+ * -j           Write JSON instead of CSV.
+ * -o output    Write to this file instead of stdout.
+ * -l listfile  Read the SAV file names from this file, one per line. Use
+ *              '-' to read them from stdin.
+ *===========================================================================*/
+
+/*===========================================================================
+ * HEADERS
+ *===========================================================================*/
+#include <stddef.h>
+
+#ifndef QDOS
+#include <pthread.h>
+#endif
+
+#include "savStat.h"
+
+/*===========================================================================
+ * GLOBALS
+ *===========================================================================*/
+char **fileNames = NULL;        /* All the files to be scanned. */
+ulong fileCount = 0;            /* How many there are. */
+ulong fileSpace = 0;            /* How many we have room for. */
+ulong nextFile = 0;             /* The next one to be scanned. */
+
+#ifndef QDOS
+pthread_mutex_t nextFileLock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+static char *typeNames[STAT_TYPES] = {
+    "MULTISPACE", "KEYWORD", "SYMBOL", "OPERATOR", "MONADIC", "NAME",
+    "STRING", "TEXT", "SEPARATOR", "FP_BINARY", "FP_HEXADECIMAL", "FP_DECIMAL"
+};
+
+
+/*=============================================================================
+ * ADDFILENAME() Adds a file name to the list of files to be scanned.
+ *===========================================================================*/
+static ushort addFileName(char *fileName) {
+    char **temp;
+
+    if (fileCount == fileSpace) {
+        fileSpace = (fileSpace ? fileSpace * 2 : 1024);
+        temp = realloc(fileNames, fileSpace * sizeof(char *));
+        if (!temp) {
+            fprintf(stderr, "\n\nERROR: addFileName(): Out of memory for file names.\n");
+            return 1;
+        }
+
+        fileNames = temp;
+    }
+
+    fileNames[fileCount++] = fileName;
+    return 0;
+}
+
+
+/*=============================================================================
+ * GETNEXTFILE() Returns the next file to be scanned, or NULL if there are no
+ * more. This is the only place the threads have to take turns.
+ *===========================================================================*/
+static char *getNextFile(void) {
+    char *fileName = NULL;
+
+#ifndef QDOS
+    pthread_mutex_lock(&nextFileLock);
+#endif
+
+    if (nextFile < fileCount) {
+        fileName = fileNames[nextFile++];
+    }
+
+#ifndef QDOS
+    pthread_mutex_unlock(&nextFileLock);
+#endif
+
+    return fileName;
+}
+
+
+/*=============================================================================
+ * SCANFILES() The body of each thread. Scans files until there are none left,
+ * counting into its own savStats.
+ *===========================================================================*/
+static void *scanFiles(void *data) {
+    savStats *stats = (savStats *)data;
+    savCounts *counts;
+    savFile sav;
+    char *fileName;
+
+    counts = malloc(sizeof(savCounts));
+    if (!counts) {
+        fprintf(stderr, "\n\nERROR: scanFiles(): Out of memory.\n");
+        return NULL;
+    }
+
+    savInitFile(&sav);
+
+    while ((fileName = getNextFile()) != NULL) {
+        stats->files++;
+
+        if (savReadFile(fileName, &sav) != SAV_OK ||
+            statFile(&sav, stats, counts) != SAV_OK) {
+            fprintf(stderr, "WARNING: '%s' ignored.\n", fileName);
+            stats->failed++;
+            continue;
+        }
+
+        stats->bytes += sav.size;
+    }
+
+    savFreeFile(&sav);
+    free(counts);
+
+    return NULL;
+}
+
+
+/*=============================================================================
+ * MAIN() Start here. Sorts out the options and file names, starts the
+ * threads, then merges their totals and writes them out.
+ *===========================================================================*/
+int main (int argc, char *argv[]) {
+    ushort threads = 1;
+    ushort format = FORMAT_CSV;
+    char *outFile = NULL;
+    FILE *out = stdout;
+    savStats *stats;
+    ushort x;
+    int arg;
+
+#ifndef QDOS
+    pthread_t threadIds[MAXTHREADS];
+#endif
+
+    for (arg = 1; arg < argc; arg++) {
+        if (strcmp(argv[arg], "-t") == 0 && arg + 1 < argc) {
+            threads = atoi(argv[++arg]);
+            if (threads < 1 || threads > MAXTHREADS) {
+                fprintf(stderr, "%s: threads must be 1 to %d.\n", argv[0], MAXTHREADS);
+                return -1;
+            }
+        } else if (strcmp(argv[arg], "-j") == 0) {
+            format = FORMAT_JSON;
+        } else if (strcmp(argv[arg], "-o") == 0 && arg + 1 < argc) {
+            outFile = argv[++arg];
+        } else if (strcmp(argv[arg], "-l") == 0 && arg + 1 < argc) {
+            if (readFileList(argv[++arg]) != 0) {
+                return -1;
+            }
+        } else if (argv[arg][0] == '-') {
+            fprintf(stderr, "%s: Unknown option '%s'.\n", argv[0], argv[arg]);
+            return -1;
+        } else if (addFileName(argv[arg]) != 0) {
+            return -1;
+        }
+    }
+
+    if (!fileCount) {
+        fprintf(stderr, "Usage: %s [-t threads] [-j] [-o output] [-l listfile] [file ...]\n", argv[0]);
+        return -1;
+    }
+
+#ifdef QDOS
+    threads = 1;
+#endif
+
+    /* One set of totals per thread, slot zero gets the merged ones. */
+    stats = calloc(threads, sizeof(savStats));
+    if (!stats) {
+        fprintf(stderr, "FATAL ERROR: main(): Cannot allocate memory for statistics.\n");
+        return -1;
+    }
+
+    for (x = 0; x < threads; x++) {
+        stats[x].counts.minLineSize = (ulong)-1;
+    }
+
+#ifndef QDOS
+    for (x = 1; x < threads; x++) {
+        if (pthread_create(&threadIds[x], NULL, scanFiles, &stats[x]) != 0) {
+            fprintf(stderr, "FATAL ERROR: main(): Cannot start thread %d.\n", x);
+            return -1;
+        }
+    }
+#endif
+
+    /* The main thread does its share too. */
+    scanFiles(&stats[0]);
+
+#ifndef QDOS
+    for (x = 1; x < threads; x++) {
+        pthread_join(threadIds[x], NULL);
+        mergeStats(&stats[0], &stats[x]);
+    }
+#endif
+
+    if (outFile) {
+        out = fopen(outFile, "w");
+        if (!out) {
+            fprintf(stderr, "FATAL ERROR: main(): Cannot create '%s'.\n", outFile);
+            return -1;
+        }
+    }
+
+    if (format == FORMAT_JSON) {
+        writeJSON(out, &stats[0]);
+    } else {
+        writeCSV(out, &stats[0]);
+    }
+
+    if (outFile) {
+        fclose(out);
+    }
+
+    x = (stats[0].failed ? 1 : 0);
+    free(stats);
+    free(fileNames);
+
+    return x;
+}
+
+
+/*=============================================================================
+ * STATFILE() Counts everything in one SAV file that is already in memory.
+ * The program lines are counted separately and only added to the totals if
+ * the whole program decodes.
+ *===========================================================================*/
+ushort statFile(savFile *sav, savStats *stats, savCounts *counts) {
+    ushort x;
+    ushort result;
+    ushort nameType;
+    ulong pos;
+    ulong lineSize;
+    savLine line;
+    savToken token;
+
+    clearCounts(counts);
+    pos = sav->programOffset;
+
+    while ((result = savNextLine(sav, &pos, &line)) == SAV_OK) {
+        counts->lines++;
+
+        /* The rest of the line - the tokens. */
+        do {
+            if (savNextToken(sav, &pos, &token) != SAV_OK) {
+                return SAV_ERROR;
+            }
+
+            counts->tokens++;
+
+            switch (token.type) {
+                case TYPE_MULTISPACE: counts->types[STAT_MULTISPACE]++; break;
+                case TYPE_SYMBOL:     counts->types[STAT_SYMBOL]++;
+                                      counts->symbols[token.code]++; break;
+                case TYPE_OPERATOR:   counts->types[STAT_OPERATOR]++;
+                                      counts->operators[token.code]++; break;
+                case TYPE_MONADIC:    counts->types[STAT_MONADIC]++;
+                                      counts->monadics[token.code]++; break;
+                case TYPE_NAME:       counts->types[STAT_NAME]++; break;
+                case TYPE_STRING:     counts->types[STAT_STRING]++; break;
+                case TYPE_TEXT:       counts->types[STAT_TEXT]++; break;
+                case TYPE_SEPARATOR:  counts->types[STAT_SEPARATOR]++;
+                                      counts->separators[token.code]++; break;
+
+                case TYPE_KEYWORD:
+                    counts->types[STAT_KEYWORD]++;
+                    counts->keywords[token.code]++;
+                    if (token.code == kwProcedure + 1) {
+                        counts->defines[0]++;
+                    } else if (token.code == kwFunction + 1) {
+                        counts->defines[1]++;
+                    }
+                    break;
+
+                case TYPE_FP_BIN_MIN ... TYPE_FP_BIN_MAX: counts->types[STAT_FP_BIN]++; break;
+                case TYPE_FP_HEX_MIN ... TYPE_FP_HEX_MAX: counts->types[STAT_FP_HEX]++; break;
+                case TYPE_FP_DEC_MIN ... TYPE_FP_DEC_MAX: counts->types[STAT_FP_DEC]++; break;
+            }
+        } while (token.type != TYPE_SYMBOL || token.code != SYMBOL_EOL);
+
+        /* Line size is from the 0x8D00 to the 0x840A, inclusive. */
+        lineSize = pos - line.offset - 2;
+        counts->lineSizes[lineSize < MAXLINESIZE ? lineSize : MAXLINESIZE]++;
+        counts->totalLineSize += lineSize;
+        if (lineSize < counts->minLineSize) {
+            counts->minLineSize = lineSize;
+        }
+
+        if (lineSize > counts->maxLineSize) {
+            counts->maxLineSize = lineSize;
+        }
+    }
+
+    if (result != SAV_END) {
+        return SAV_ERROR;
+    }
+
+    /* It all decoded, so the name table counts too. */
+    for (x = 0; x < sav->nameTableEntries; x++) {
+        nameType = sav->names[x].nameType;
+        stats->nameTypes[nameType]++;
+
+        if (nameType == 0x1402) {
+            stats->procs++;
+        } else if (nameType >= 0x1501 && nameType <= 0x1503) {
+            stats->fns[nameType - 0x1501]++;
+        }
+    }
+
+    stats->names += sav->nameTableEntries;
+    mergeCounts(&stats->counts, counts);
+
+    return SAV_OK;
+}
+
+
+/*=============================================================================
+ * CLEARCOUNTS() Empties a savCounts ready for the next file.
+ *===========================================================================*/
+void clearCounts(savCounts *counts) {
+    memset(counts, 0, sizeof(savCounts));
+    counts->minLineSize = (ulong)-1;
+}
+
+
+/*=============================================================================
+ * MERGECOUNTS() Adds one set of program line counts to another.
+ *===========================================================================*/
+void mergeCounts(savCounts *to, savCounts *from) {
+    ulong *t = (ulong *)to;
+    ulong *f = (ulong *)from;
+    ulong x;
+
+    /* Everything up to minLineSize is a simple total. */
+    for (x = 0; x < offsetof(savCounts, minLineSize) / sizeof(ulong); x++) {
+        t[x] += f[x];
+    }
+
+    if (from->minLineSize < to->minLineSize) {
+        to->minLineSize = from->minLineSize;
+    }
+
+    if (from->maxLineSize > to->maxLineSize) {
+        to->maxLineSize = from->maxLineSize;
+    }
+
+    to->totalLineSize += from->totalLineSize;
+}
+
+
+/*=============================================================================
+ * MERGESTATS() Adds one thread's totals to another's.
+ *===========================================================================*/
+void mergeStats(savStats *to, savStats *from) {
+    ulong x;
+
+    to->files += from->files;
+    to->failed += from->failed;
+    to->bytes += from->bytes;
+    to->names += from->names;
+    to->procs += from->procs;
+
+    for (x = 0; x < 3; x++) {
+        to->fns[x] += from->fns[x];
+    }
+
+    for (x = 0; x < 65536; x++) {
+        to->nameTypes[x] += from->nameTypes[x];
+    }
+
+    mergeCounts(&to->counts, &from->counts);
+}
+
+
+/*=============================================================================
+ * WRITECSV() Writes the totals as "section,index,name,count" lines.
+ *===========================================================================*/
+void writeCSV(FILE *out, savStats *stats) {
+    savCounts *c = &stats->counts;
+    ulong x;
+
+    fprintf(out, "section,index,name,count\n");
+    fprintf(out, "summary,0,files,%lu\n", stats->files);
+    fprintf(out, "summary,1,failed,%lu\n", stats->failed);
+    fprintf(out, "summary,2,bytes,%lu\n", stats->bytes);
+    fprintf(out, "summary,3,lines,%lu\n", c->lines);
+    fprintf(out, "summary,4,tokens,%lu\n", c->tokens);
+    fprintf(out, "summary,5,names,%lu\n", stats->names);
+    fprintf(out, "summary,6,minLineSize,%lu\n", (c->lines ? c->minLineSize : 0));
+    fprintf(out, "summary,7,maxLineSize,%lu\n", c->maxLineSize);
+    fprintf(out, "summary,8,totalLineSize,%lu\n", c->totalLineSize);
+
+    fprintf(out, "procfn,0,PROCedure,%lu\n", stats->procs);
+    fprintf(out, "procfn,1,FuNction$,%lu\n", stats->fns[0]);
+    fprintf(out, "procfn,2,FuNction,%lu\n", stats->fns[1]);
+    fprintf(out, "procfn,3,FuNction%%,%lu\n", stats->fns[2]);
+    fprintf(out, "procfn,4,DEFine PROCedure,%lu\n", c->defines[0]);
+    fprintf(out, "procfn,5,DEFine FuNction,%lu\n", c->defines[1]);
+
+    for (x = 0; x < STAT_TYPES; x++) {
+        fprintf(out, "type,%lu,%s,%lu\n", x, typeNames[x], c->types[x]);
+    }
+
+    for (x = 1; x <= SAV_KEYWORDS; x++) {
+        fprintf(out, "keyword,%lu,%s,%lu\n", x, savKeywords[x], c->keywords[x]);
+    }
+
+    /* The end of line symbol is written as EOL, not as a newline! */
+    for (x = 1; x <= SAV_SYMBOLS; x++) {
+        fprintf(out, "symbol,%lu,\"%s\",%lu\n", x, (x == SYMBOL_EOL ? "EOL" : savSymbols[x]), c->symbols[x]);
+    }
+
+    for (x = 1; x <= SAV_OPERATORS; x++) {
+        fprintf(out, "operator,%lu,%s,%lu\n", x, savOperators[x], c->operators[x]);
+    }
+
+    for (x = 1; x <= SAV_MONADICS; x++) {
+        fprintf(out, "monadic,%lu,%s,%lu\n", x, savMonadics[x], c->monadics[x]);
+    }
+
+    for (x = 1; x <= SAV_SEPARATORS; x++) {
+        fprintf(out, "separator,%lu,\"%s\",%lu\n", x, savSeparators[x], c->separators[x]);
+    }
+
+    for (x = 0; x < 65536; x++) {
+        if (stats->nameTypes[x]) {
+            fprintf(out, "nametype,%lu,$%4.4lX,%lu\n", x, x, stats->nameTypes[x]);
+        }
+    }
+
+    for (x = 0; x <= MAXLINESIZE; x++) {
+        if (c->lineSizes[x]) {
+            fprintf(out, "linesize,%lu,%s,%lu\n", x, (x == MAXLINESIZE ? "longer" : ""), c->lineSizes[x]);
+        }
+    }
+}
+
+
+/*=============================================================================
+ * WRITEJSONTABLE() Writes one of the token tables as a JSON array. The names
+ * in the tables need escaping for the backslash and end of line only.
+ *===========================================================================*/
+static void writeJSONTable(FILE *out, char *title, char **names, ulong *counts, ulong size) {
+    ulong x;
+    char *name;
+
+    fprintf(out, "  \"%s\": [", title);
+    for (x = 1; x <= size; x++) {
+        name = names[x];
+        if (strcmp(name, "\\") == 0) {
+            name = "\\\\";
+        } else if (strcmp(name, "\n") == 0) {
+            name = "\\n";
+        }
+
+        fprintf(out, "%s\n    {\"index\": %lu, \"name\": \"%s\", \"count\": %lu}", (x > 1 ? "," : ""), x, name, counts[x]);
+    }
+
+    fprintf(out, "\n  ],\n");
+}
+
+
+/*=============================================================================
+ * WRITEJSON() Writes the totals as a single JSON object.
+ *===========================================================================*/
+void writeJSON(FILE *out, savStats *stats) {
+    savCounts *c = &stats->counts;
+    ulong x;
+    ushort first;
+
+    fprintf(out, "{\n");
+    fprintf(out, "  \"files\": %lu,\n", stats->files);
+    fprintf(out, "  \"failed\": %lu,\n", stats->failed);
+    fprintf(out, "  \"bytes\": %lu,\n", stats->bytes);
+    fprintf(out, "  \"lines\": %lu,\n", c->lines);
+    fprintf(out, "  \"tokens\": %lu,\n", c->tokens);
+    fprintf(out, "  \"names\": %lu,\n", stats->names);
+    fprintf(out, "  \"procedures\": %lu,\n", stats->procs);
+    fprintf(out, "  \"functions\": {\"string\": %lu, \"float\": %lu, \"integer\": %lu},\n", stats->fns[0], stats->fns[1], stats->fns[2]);
+    fprintf(out, "  \"defines\": {\"procedure\": %lu, \"function\": %lu},\n", c->defines[0], c->defines[1]);
+
+    fprintf(out, "  \"tokenTypes\": {");
+    for (x = 0; x < STAT_TYPES; x++) {
+        fprintf(out, "%s\n    \"%s\": %lu", (x ? "," : ""), typeNames[x], c->types[x]);
+    }
+    fprintf(out, "\n  },\n");
+
+    writeJSONTable(out, "keywords", savKeywords, c->keywords, SAV_KEYWORDS);
+    writeJSONTable(out, "symbols", savSymbols, c->symbols, SAV_SYMBOLS);
+    writeJSONTable(out, "operators", savOperators, c->operators, SAV_OPERATORS);
+    writeJSONTable(out, "monadics", savMonadics, c->monadics, SAV_MONADICS);
+    writeJSONTable(out, "separators", savSeparators, c->separators, SAV_SEPARATORS);
+
+    fprintf(out, "  \"nameTypes\": {");
+    for (x = 0, first = 1; x < 65536; x++) {
+        if (stats->nameTypes[x]) {
+            fprintf(out, "%s\n    \"$%4.4lX\": %lu", (first ? "" : ","), x, stats->nameTypes[x]);
+            first = 0;
+        }
+    }
+    fprintf(out, "\n  },\n");
+
+    fprintf(out, "  \"lineSizes\": {\n");
+    fprintf(out, "    \"min\": %lu,\n", (c->lines ? c->minLineSize : 0));
+    fprintf(out, "    \"max\": %lu,\n", c->maxLineSize);
+    fprintf(out, "    \"total\": %lu,\n", c->totalLineSize);
+    fprintf(out, "    \"histogram\": {");
+    for (x = 0, first = 1; x <= MAXLINESIZE; x++) {
+        if (c->lineSizes[x]) {
+            fprintf(out, "%s\n      \"%lu%s\": %lu", (first ? "" : ","), x, (x == MAXLINESIZE ? "+" : ""), c->lineSizes[x]);
+            first = 0;
+        }
+    }
+    fprintf(out, "\n    }\n  }\n}\n");
+}
+
+
+/*=============================================================================
+ * READFILELIST() Reads SAV file names, one per line, from a file or from
+ * stdin if the file name is '-'.
+ *===========================================================================*/
+ushort readFileList(char *listFile) {
+    FILE *fp = stdin;
+    char buffer[MAXPATH + 1];
+    char *fileName;
+    size_t size;
+
+    if (strcmp(listFile, "-") != 0) {
+        fp = fopen(listFile, "r");
+        if (!fp) {
+            fprintf(stderr, "\n\nERROR: readFileList(): Cannot open file list '%s'.\n", listFile);
+            return 1;
+        }
+    }
+
+    while (fgets(buffer, sizeof(buffer), fp)) {
+        size = strlen(buffer);
+        while (size && (buffer[size - 1] == '\n' || buffer[size - 1] == '\r')) {
+            buffer[--size] = '\0';
+        }
+
+        if (!size) {
+            continue;
+        }
+
+        fileName = malloc(size + 1);
+        if (!fileName) {
+            fprintf(stderr, "\n\nERROR: readFileList(): Out of memory for file names.\n");
+            return 1;
+        }
+
+        strcpy(fileName, buffer);
+        if (addFileName(fileName) != 0) {
+            return 1;
+        }
+    }
+
+    if (fp != stdin) {
+        fclose(fp);
+    }
+
+    return 0;
+}
@@ -0,0 +1,81 @@
+#ifndef __SAVSTAT_H__
+#define __SAVSTAT_H__
+
+/*===========================================================================
+ * HEADERS
+ *===========================================================================*/
+#include "../SavFile/savFile.h"
+
+/*===========================================================================
+ * DEFINES
+ *===========================================================================*/
+#define MAXTHREADS 64               /* More than enough for any disc. */
+#define MAXLINESIZE 512             /* Longer lines share the last bucket. */
+
+/* Token type buckets, floats are split by kind. */
+#define STAT_MULTISPACE 0
+#define STAT_KEYWORD    1
+#define STAT_SYMBOL     2
+#define STAT_OPERATOR   3
+#define STAT_MONADIC    4
+#define STAT_NAME       5
+#define STAT_STRING     6
+#define STAT_TEXT       7
+#define STAT_SEPARATOR  8
+#define STAT_FP_BIN     9
+#define STAT_FP_HEX     10
+#define STAT_FP_DEC     11
+#define STAT_TYPES      12
+
+#define FORMAT_CSV  0
+#define FORMAT_JSON 1
+
+/*===========================================================================
+ * TYPEDEFS
+ *===========================================================================*/
+
+/* Counts for the program lines of one file. These are only added to the
+ * totals if the whole file decodes. */
+typedef struct savCounts {
+    ulong lines;
+    ulong tokens;
+    ulong defines[2];                       /* DEFine PROCedure, FuNction */
+    ulong types[STAT_TYPES];
+    ulong keywords[SAV_KEYWORDS + 1];
+    ulong symbols[SAV_SYMBOLS + 1];
+    ulong operators[SAV_OPERATORS + 1];
+    ulong monadics[SAV_MONADICS + 1];
+    ulong separators[SAV_SEPARATORS + 1];
+    ulong lineSizes[MAXLINESIZE + 1];
+    ulong minLineSize;
+    ulong maxLineSize;
+    ulong totalLineSize;
+} savCounts;
+
+/* Totals for everything one thread has seen, and after merging, for the
+ * whole corpus. */
+typedef struct savStats {
+    ulong files;
+    ulong failed;
+    ulong bytes;
+    ulong names;
+    ulong procs;                            /* Name type 0x1402 */
+    ulong fns[3];                           /* 0x1501 - 0x1503 */
+    ulong nameTypes[65536];
+    savCounts counts;
+} savStats;
+
+/*===========================================================================
+ * FUNCTION PROTOTYPES
+ *===========================================================================*/
+ushort statFile(savFile *sav, savStats *stats, savCounts *counts);
+void   clearCounts(savCounts *counts);
+void   mergeCounts(savCounts *to, savCounts *from);
+void   mergeStats(savStats *to, savStats *from);
+void   writeCSV(FILE *out, savStats *stats);
+void   writeJSON(FILE *out, savStats *stats);
+ushort readFileList(char *listFile);
+
+/*===========================================================================*/
+
+#endif /* __SAVSTAT_H__ */
@@ -0,0 +1,1014 @@
+/*=============================================================================
+ * SuperBASIC text to SAV file tokeniser. The Lister, backwards.
+ *
+ * Reads a SuperBASIC program as text, C68Port.bas for example, and writes
+ * the SAV file that QSAVE would, without needing a QL or an emulator. The
+ * whole text is read into memory and tokenised in one pass, building the name
+ * table as names turn up. The type of each name - PROC, FN, array, variable
+ * or machine code PROC or FN - depends on how it's used, so that is worked
+ * out when the whole program has been seen.
+ *
+ * Keywords, and the operators, monadics and separators that are words, like
+ * MOD, NOT and TO, are found with a perfect hash built from the tables in
+ * savFile.c, so each word in the program costs one slot and one compare.
+ * Everything else is decided by its first character.
+ *
+ * Spaces are kept as they were typed, as multispace tokens, except for the
+ * one after the line number and the one after a keyword, which the Lister
+ * puts back. Lines must be in order of line number, blank lines are ignored.
+ *
+ * Usage: savTokenise [-o output_sav] program_bas
+ *
+ * -o output    The SAV file. Default is the input with 'bas' changed to
+ *              'sav', or '_sav' added to the end.
+ *===========================================================================*/
+
+/*===========================================================================
+ * HEADERS
+ *===========================================================================*/
+#include <ctype.h>
+#include <time.h>
+
+#include "savTokenise.h"
+
+/*===========================================================================
+ * GLOBALS
+ *===========================================================================*/
+tokWord words[WORDHASHSIZE];    /* Keyword hash, empty slots have length 0. */
+uchar upper[256];               /* Upper case of every character. */
+
+savBuffer program;              /* The program lines. */
+tokName *names = NULL;          /* The name table. */
+ulong nameCount = 0;            /* How many names so far. */
+ulong nameSpace = 0;            /* And how many we have room for. */
+ulong *nameHash = NULL;         /* Entry + 1 for each name, 0 is empty. */
+ulong nameHashSize = 0;         /* Always a power of 2. */
+
+ushort lastLineNumber = 0;      /* Lines must go up. */
+ulong lineCount = 0;            /* Lines written so far. */
+
+
+/*=============================================================================
+ * MAIN() Start here. Reads the text, tokenises it, then writes the SAV file.
+ *===========================================================================*/
+int main (int argc, char *argv[]) {
+    char *inFile = NULL;
+    char outFile[MAXPATH + 1] = "";
+    uchar *text;
+    long size;
+    clock_t start;
+    double took;
+    FILE *fp;
+    int arg;
+
+    for (arg = 1; arg < argc; arg++) {
+        if (strcmp(argv[arg], "-o") == 0 && arg + 1 < argc) {
+            strncpy(outFile, argv[++arg], MAXPATH);
+            outFile[MAXPATH] = '\0';
+        } else if (argv[arg][0] == '-') {
+            fprintf(stderr, "%s: Unknown option '%s'.\n", argv[0], argv[arg]);
+            return -1;
+        } else {
+            inFile = argv[arg];
+        }
+    }
+
+    if (!inFile) {
+        fprintf(stderr, "Usage: %s [-o output_sav] program_bas\n", argv[0]);
+        return -1;
+    }
+
+    if (buildWordTable() != 0) {
+        fprintf(stderr, "FATAL ERROR: buildWordTable() failed.\n");
+        return -1;
+    }
+
+    /* Read the whole program. */
+    fp = fopen(inFile, "rb");
+    if (!fp) {
+        fprintf(stderr, "FATAL ERROR: main(): Cannot open '%s'.\n", inFile);
+        return -1;
+    }
+
+    fseek(fp, 0, SEEK_END);
+    size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+
+    text = malloc(size + 1);
+    if (!text) {
+        fprintf(stderr, "FATAL ERROR: main(): Cannot allocate %ld bytes for '%s'.\n", size + 1, inFile);
+        fclose(fp);
+        return -1;
+    }
+
+    if (fread(text, 1, size, fp) != (size_t)size) {
+        fprintf(stderr, "FATAL ERROR: main(): Cannot read '%s'.\n", inFile);
+        fclose(fp);
+        return -1;
+    }
+
+    fclose(fp);
+    text[size] = '\0';
+
+    start = clock();
+    savInitBuffer(&program);
+    if (tokeniseText(text, size) != 0) {
+        fprintf(stderr, "FATAL ERROR: tokeniseText() failed.\n");
+        return -1;
+    }
+
+    nameTypes();
+    took = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    if (!outFile[0]) {
+        savExtension(inFile, outFile);
+    }
+
+    if (writeSav(outFile) != 0) {
+        fprintf(stderr, "FATAL ERROR: writeSav() failed.\n");
+        return -1;
+    }
+
+    fprintf(stderr, "%s: %lu lines, %lu names, %lu bytes", outFile, lineCount, nameCount, program.size);
+    if (took > 0) {
+        fprintf(stderr, ", %.2f MB/s", size / took / 1e6);
+    }
+    fprintf(stderr, ".\n");
+
+    savFreeBuffer(&program);
+    free(names);
+    free(nameHash);
+    free(text);
+
+    return 0;
+}
+
+
+/*=============================================================================
+ * BUILDWORDTABLE() Builds the keyword hash from the keyword, operator,
+ * monadic and separator tables. Only words go in, symbols are dealt with by
+ * tokeniseSymbol(). TO is both a keyword and a separator, the keyword goes
+ * in and tokeniseWord() decides which one it is. Returns 1 if two words hash
+ * to the same slot, which means wordHash() needs new numbers.
+ *===========================================================================*/
+ushort buildWordTable(void) {
+    ushort x;
+    ushort result = 0;
+
+    for (x = 0; x < 256; x++) {
+        upper[x] = toupper(x);
+    }
+
+    memset(words, 0, sizeof(words));
+
+    for (x = 1; x <= SAV_KEYWORDS; x++) {
+        if (savKeywords[x][0]) {
+            result |= addWord(savKeywords[x], TYPE_KEYWORD, x);
+        }
+    }
+
+    for (x = 1; x <= SAV_OPERATORS; x++) {
+        if (isalpha((uchar)savOperators[x][0])) {
+            result |= addWord(savOperators[x], TYPE_OPERATOR, x);
+        }
+    }
+
+    for (x = 1; x <= SAV_MONADICS; x++) {
+        if (isalpha((uchar)savMonadics[x][0])) {
+            result |= addWord(savMonadics[x], TYPE_MONADIC, x);
+        }
+    }
+
+    for (x = 1; x <= SAV_SEPARATORS; x++) {
+        if (isalpha((uchar)savSeparators[x][0])) {
+            result |= addWord(savSeparators[x], TYPE_SEPARATOR, x);
+        }
+    }
+
+    return result;
+}
+
+
+/*=============================================================================
+ * ADDWORD() Adds one word to the keyword hash, in upper case. A word that is
+ * already there is left alone. Returns 1 if the slot is taken by a different
+ * word.
+ *===========================================================================*/
+ushort addWord(char *word, uchar type, uchar code) {
+    ushort length = strlen(word);
+    ushort x;
+    tokWord *entry;
+
+    if (length > MAXWORDSIZE) {
+        fprintf(stderr, "\n\nERROR: addWord(): '%s' is longer than %d characters.\n", word, MAXWORDSIZE);
+        return 1;
+    }
+
+    entry = &words[wordHash((uchar *)word, length)];
+    if (entry->length) {
+        if (findWord((uchar *)word, length) == entry) {
+            return 0;
+        }
+
+        fprintf(stderr, "\n\nERROR: addWord(): '%s' and '%s' have the same hash.\n", word, entry->word);
+        return 1;
+    }
+
+    for (x = 0; x < length; x++) {
+        entry->word[x] = upper[(uchar)word[x]];
+    }
+
+    entry->word[length] = '\0';
+    entry->length = length;
+    entry->type = type;
+    entry->code = code;
+
+    return 0;
+}
+
+
+/*=============================================================================
+ * WORDHASH() The keyword hash. The numbers were found by trying them all until
+ * every word had a slot to itself. Words of less than two characters never
+ * get here.
+ *===========================================================================*/
+ushort wordHash(uchar *word, ushort length) {
+    return (upper[word[0]] * 9 + upper[word[1]] * 38 +
+            upper[word[length - 1]] * 37 + length) & (WORDHASHSIZE - 1);
+}
+
+
+/*=============================================================================
+ * FINDWORD() Returns the keyword hash entry for a word, any case, or NULL if
+ * it isn't a keyword.
+ *===========================================================================*/
+tokWord *findWord(uchar *word, ushort length) {
+    tokWord *entry;
+    ushort x;
+
+    if (length < 2 || length > MAXWORDSIZE) {
+        return NULL;
+    }
+
+    entry = &words[wordHash(word, length)];
+    if (entry->length != length) {
+        return NULL;
+    }
+
+    for (x = 0; x < length; x++) {
+        if (upper[word[x]] != (uchar)entry->word[x]) {
+            return NULL;
+        }
+    }
+
+    return entry;
+}
+
+
+/*=============================================================================
+ * NAMEHASHVALUE() FNV-1a, ignoring case, as SuperBASIC does.
+ *===========================================================================*/
+static ulong nameHashValue(uchar *name, ushort length) {
+    ulong hash = 2166136261UL;
+    ushort x;
+
+    for (x = 0; x < length; x++) {
+        hash = ((hash ^ upper[name[x]]) * 16777619UL) & 0xFFFFFFFFUL;
+    }
+
+    return hash;
+}
+
+
+/*=============================================================================
+ * FINDNAME() Returns the name table entry for a name, adding it if it's new.
+ * Names are the same whatever their case, the first one seen is the one that
+ * is kept. Returns -1 if the name table is full, or out of memory.
+ *===========================================================================*/
+long findName(uchar *name, ushort length) {
+    ulong slot;
+    ulong mask;
+    ulong x;
+    ulong *newHash;
+    tokName *temp;
+    tokName *entry;
+    ushort y;
+
+    /* Keep the hash no more than half full. */
+    if (nameCount * 2 >= nameHashSize) {
+        x = (nameHashSize ? nameHashSize * 2 : 1024);
+        newHash = calloc(x, sizeof(ulong));
+        if (!newHash) {
+            fprintf(stderr, "\n\nERROR: findName(): Out of memory for the name hash.\n");
+            return -1;
+        }
+
+        nameHashSize = x;
+        mask = nameHashSize - 1;
+        for (x = 0; x < nameCount; x++) {
+            slot = nameHashValue(names[x].name, names[x].nameLength) & mask;
+            while (newHash[slot]) {
+                slot = (slot + 1) & mask;
+            }
+            newHash[slot] = x + 1;
+        }
+
+        free(nameHash);
+        nameHash = newHash;
+    }
+
+    mask = nameHashSize - 1;
+    slot = nameHashValue(name, length) & mask;
+    while (nameHash[slot]) {
+        entry = &names[nameHash[slot] - 1];
+        if (entry->nameLength == length) {
+            for (y = 0; y < length; y++) {
+                if (upper[entry->name[y]] != upper[name[y]]) {
+                    break;
+                }
+            }
+
+            if (y == length) {
+                return nameHash[slot] - 1;
+            }
+        }
+
+        slot = (slot + 1) & mask;
+    }
+
+    /* A new one. */
+    if (nameCount == MAXNAMES) {
+        fprintf(stderr, "\n\nERROR: findName(): More than %d names.\n", MAXNAMES);
+        return -1;
+    }
+
+    if (nameCount == nameSpace) {
+        nameSpace = (nameSpace ? nameSpace * 2 : 256);
+        temp = realloc(names, nameSpace * sizeof(tokName));
+        if (!temp) {
+            fprintf(stderr, "\n\nERROR: findName(): Out of memory for the name table.\n");
+            return -1;
+        }
+
+        names = temp;
+    }
+
+    entry = &names[nameCount];
+    entry->name = name;
+    entry->nameLength = length;
+    entry->nameType = 0;
+    entry->lineNumber = 0;
+    entry->used = 0;
+
+    switch (name[length - 1]) {
+        case '$': entry->varType = VAR_STRING; break;
+        case '%': entry->varType = VAR_INTEGER; break;
+        default:  entry->varType = VAR_FLOAT; break;
+    }
+
+    nameHash[slot] = nameCount + 1;
+    return nameCount++;
+}
+
+
+/*=============================================================================
+ * TOKENISETEXT() Tokenises the whole program, a line at a time. Lines can
+ * end with a linefeed, as on the QL, or a carriage return and linefeed.
+ *===========================================================================*/
+ushort tokeniseText(uchar *text, ulong size) {
+    uchar *end = text + size;
+    uchar *lineEnd;
+    uchar *last;
+    ulong textLine = 0;
+
+    while (text < end) {
+        lineEnd = memchr(text, '\n', end - text);
+        if (!lineEnd) {
+            lineEnd = end;
+        }
+
+        last = lineEnd;
+        if (last > text && last[-1] == '\r') {
+            last--;
+        }
+
+        if (tokeniseLine(text, last, ++textLine) != 0) {
+            return 1;
+        }
+
+        text = lineEnd + 1;
+    }
+
+    return 0;
+}
+
+
+/*=============================================================================
+ * TOKENISELINE() Tokenises one line of text. Blank lines are ignored, all the
+ * others must start with a line number higher than the last one.
+ *===========================================================================*/
+ushort tokeniseLine(uchar *text, uchar *end, ulong textLine) {
+    tokState state;
+    ulong lineNumber = 0;
+    ushort spaces;
+
+    while (text < end && (*text == ' ' || *text == '\t')) {
+        text++;
+    }
+
+    /* Trailing spaces aren't kept. */
+    while (end > text && (end[-1] == ' ' || end[-1] == '\t')) {
+        end--;
+    }
+
+    if (text == end) {
+        return 0;
+    }
+
+    if (!isdigit(*text)) {
+        fprintf(stderr, "\n\nERROR: tokeniseLine(): Line %lu doesn't start with a line number.\n", textLine);
+        return 1;
+    }
+
+    while (text < end && isdigit(*text)) {
+        lineNumber = lineNumber * 10 + (*text++ - '0');
+        if (lineNumber > MAXLINENUMBER) {
+            break;
+        }
+    }
+
+    if (lineNumber == 0 || lineNumber > MAXLINENUMBER) {
+        fprintf(stderr, "\n\nERROR: tokeniseLine(): Line %lu, line numbers must be 1 to %d.\n", textLine, MAXLINENUMBER);
+        return 1;
+    }
+
+    if (lineNumber <= lastLineNumber) {
+        fprintf(stderr, "\n\nERROR: tokeniseLine(): Line %lu, line %lu comes after line %d.\n", textLine, lineNumber, lastLineNumber);
+        return 1;
+    }
+
+    /* The space after the line number isn't kept either. */
+    if (text < end && *text == ' ') {
+        text++;
+    }
+
+    memset(&state, 0, sizeof(tokState));
+    state.lineNumber = lineNumber;
+    state.textLine = textLine;
+    newStatement(&state);
+
+    savBeginLine(&program, lineNumber);
+
+    while (text < end) {
+        switch (*text) {
+            case ' ':
+            case '\t':
+                spaces = 0;
+                while (text < end && (*text == ' ' || *text == '\t')) {
+                    spaces++;
+                    text++;
+                }
+
+                /* The Lister puts a space after every keyword. */
+                if (state.lastType == TYPE_KEYWORD) {
+                    spaces--;
+                }
+
+                while (spaces) {
+                    savPutToken(&program, TYPE_MULTISPACE, (spaces > MAXMULTISPACE ? MAXMULTISPACE : spaces));
+                    spaces -= (spaces > MAXMULTISPACE ? MAXMULTISPACE : spaces);
+                }
+                break;
+
+            case 'A' ... 'Z':
+            case 'a' ... 'z':
+            case '_':
+                text = tokeniseWord(text, end, &state);
+                break;
+
+            case '0' ... '9':
+            case '.':
+            case '%':
+            case '$':
+                text = tokeniseNumber(text, end, &state);
+                break;
+
+            default:
+                text = tokeniseSymbol(text, end, &state);
+                break;
+        }
+
+        if (!text) {
+            return 1;
+        }
+    }
+
+    endStatement(&state);
+    savEndLine(&program);
+
+    if (program.failed) {
+        fprintf(stderr, "\n\nERROR: tokeniseLine(): Out of memory at line %lu.\n", textLine);
+        return 1;
+    }
+
+    lastLineNumber = lineNumber;
+    lineCount++;
+    return 0;
+}
+
+
+/*=============================================================================
+ * TOKENISEWORD() Tokenises a keyword, a word operator or a name. REMark and
+ * MISTake take the rest of the line as text. Returns where it stopped, or
+ * NULL if there was an error.
+ *===========================================================================*/
+uchar *tokeniseWord(uchar *text, uchar *end, tokState *state) {
+    uchar *start = text;
+    uchar *next;
+    tokWord *word = NULL;
+    long entry;
+    uchar code;
+
+    while (text < end && (isalnum(*text) || *text == '_')) {
+        text++;
+    }
+
+    if (text < end && (*text == '$' || *text == '%')) {
+        text++;
+    } else {
+        word = findWord(start, text - start);
+    }
+
+    if (word && word->type == TYPE_KEYWORD) {
+        code = word->code;
+
+        /* TO is a keyword after GO, a separator everywhere else. */
+        if (code == kwTt + 1 &&
+            (state->lastType != TYPE_KEYWORD || state->lastCode != kwGo + 1)) {
+            putToken(state, TYPE_SEPARATOR, 5);
+            return text;
+        }
+
+        /* So DEFine can be seen by PROCedure and FuNction. */
+        if ((code == kwProcedure + 1 || code == kwFunction + 1) &&
+            state->lastType == TYPE_KEYWORD && state->lastCode == kwDefine + 1) {
+            state->nameUse = (code == kwProcedure + 1 ? USED_DEFPROC : USED_DEFFN);
+        }
+
+        putToken(state, TYPE_KEYWORD, code);
+
+        switch (code - 1) {
+            case kwRemark:
+            case kwMistake:
+                /* The rest of the line is text, less the keyword's space. */
+                if (text < end && *text == ' ') {
+                    text++;
+                }
+
+                savPutString(&program, TYPE_TEXT, 0, text, end - text);
+                return end;
+
+            case kwThen:
+            case kwElse:
+                endStatement(state);
+                newStatement(state);
+                break;
+
+            case kwLet:
+            case kwOn:
+                state->assignState = ASSIGN_START;
+                break;
+
+            case kwFor:
+                state->assignState = ASSIGN_START;
+                state->nameUse = USED_FOR;
+                break;
+
+            case kwRepeat:
+                state->nameUse = USED_REPEAT;
+                break;
+
+            case kwDim:
+            case kwLocal:
+                state->dimContext = 1;
+                break;
+        }
+
+        return text;
+    }
+
+    if (word) {
+        putToken(state, word->type, word->code);
+        return text;
+    }
+
+    /* A name then. */
+    entry = findName(start, text - start);
+    if (entry < 0) {
+        fprintf(stderr, "\n\nERROR: tokeniseWord(): Line %lu, cannot add '%.*s' to the name table.\n", state->textLine, (int)(text - start), start);
+        return NULL;
+    }
+
+    /* Is it followed by a bracket? */
+    next = text;
+    while (next < end && *next == ' ') {
+        next++;
+    }
+
+    /* A DEFine's parameters, and LOCals that aren't arrays, are variables,
+     * whatever brackets come after them elsewhere. */
+    if (state->nameUse) {
+        names[entry].used |= state->nameUse;
+        if (state->nameUse & (USED_DEFPROC | USED_DEFFN)) {
+            names[entry].lineNumber = state->lineNumber;
+            state->defContext = 1;
+        }
+        state->nameUse = 0;
+    } else if (state->defContext) {
+        names[entry].used |= USED_VARIABLE;
+    } else if (state->statementStart) {
+        state->candidate = entry;
+    } else if (next < end && *next == '(') {
+        names[entry].used |= (state->dimContext ? USED_DIM : USED_PAREN);
+    } else if (state->dimContext) {
+        names[entry].used |= USED_VARIABLE;
+    }
+
+    /* The name that = would assign to, after LET, or at the start. */
+    if (state->assignState == ASSIGN_START && state->depth == 0) {
+        state->target = entry;
+    }
+
+    savPutName(&program, entry);
+    noteToken(state, TYPE_NAME, 0);
+
+    /* A PROC's parameters can start with a monadic, PRINT -x. */
+    if (state->candidate == entry) {
+        state->expectOperand = 1;
+    }
+
+    return text;
+}
+
+
+/*=============================================================================
+ * TOKENISENUMBER() Tokenises a decimal, %binary or $hexadecimal number as a
+ * QL float. Returns where it stopped, or NULL if there was an error.
+ *===========================================================================*/
+uchar *tokeniseNumber(uchar *text, uchar *end, tokState *state) {
+    char buffer[MAXNUMBERSIZE + 1];
+    uchar *start = text;
+    double value = 0;
+    uchar fpType;
+
+    if (*text == '%') {
+        fpType = QLFP_BINARY;
+        for (text++; text < end && (*text == '0' || *text == '1'); text++) {
+            value = value * 2 + (*text - '0');
+        }
+    } else if (*text == '$') {
+        fpType = QLFP_HEXADECIMAL;
+        for (text++; text < end && isxdigit(*text); text++) {
+            value = value * 16 + (isdigit(*text) ? *text - '0' : upper[*text] - 'A' + 10);
+        }
+    } else {
+        fpType = QLFP_DECIMAL;
+        while (text < end && isdigit(*text)) {
+            text++;
+        }
+
+        if (text < end && *text == '.') {
+            for (text++; text < end && isdigit(*text); text++)
+                ;
+        }
+
+        /* An exponent, but only if there are digits. */
+        if (text + 1 < end && upper[*text] == 'E' &&
+            (isdigit(text[1]) ||
+             (text + 2 < end && (text[1] == '+' || text[1] == '-') && isdigit(text[2])))) {
+            for (text += 2; text < end && isdigit(*text); text++)
+                ;
+        }
+
+        if (text - start > MAXNUMBERSIZE) {
+            fprintf(stderr, "\n\nERROR: tokeniseNumber(): Line %lu, number is too long.\n", state->textLine);
+            return NULL;
+        }
+
+        memcpy(buffer, start, text - start);
+        buffer[text - start] = '\0';
+        value = strtod(buffer, NULL);
+    }
+
+    /* A lone %, $ or full stop. */
+    if (text - start == 1 && !isdigit(*start)) {
+        fprintf(stderr, "\n\nERROR: tokeniseNumber(): Line %lu, '%c' is not a number.\n", state->textLine, *start);
+        return NULL;
+    }
+
+    savPutFloat(&program, value, fpType);
+    noteToken(state, TYPE_FP_DEC_MIN, 0);
+    return text;
+}
+
+
+/*=============================================================================
+ * TOKENISESYMBOL() Tokenises a string, symbol, operator, monadic or
+ * separator. = is a symbol when it assigns, and an operator when it
+ * compares. + and - are monadic if there's nothing on their left. A comma is
+ * a symbol in brackets, otherwise it's a separator. Returns where it stopped,
+ * or NULL if there was an error.
+ *===========================================================================*/
+uchar *tokeniseSymbol(uchar *text, uchar *end, tokState *state) {
+    uchar *close;
+    uchar next = (text + 1 < end ? text[1] : 0);
+
+    switch (*text) {
+        case '"':
+        case '\'':
+            close = memchr(text + 1, *text, end - text - 1);
+            if (!close) {
+                fprintf(stderr, "\n\nERROR: tokeniseSymbol(): Line %lu, string has no closing %c.\n", state->textLine, *text);
+                return NULL;
+            }
+
+            savPutString(&program, TYPE_STRING, *text, text + 1, close - text - 1);
+            noteToken(state, TYPE_STRING, 0);
+            return close + 1;
+
+        case '=':
+            if (next == '=') {
+                putToken(state, TYPE_OPERATOR, 7);
+                return text + 2;
+            }
+
+            if (state->assignState == ASSIGN_TARGET && state->depth == 0) {
+                if (state->target >= 0) {
+                    names[state->target].used |= USED_VARIABLE;
+                }
+                state->candidate = -1;
+                putToken(state, TYPE_SYMBOL, SYMBOL_EQUALS);
+            } else {
+                putToken(state, TYPE_OPERATOR, 8);
+            }
+            break;
+
+        case '+':
+        case '-':
+            putToken(state, (state->expectOperand ? TYPE_MONADIC : TYPE_OPERATOR), (*text == '+' ? 1 : 2));
+            break;
+
+        case '~':
+            if (next != '~') {
+                fprintf(stderr, "\n\nERROR: tokeniseSymbol(): Line %lu, '~' on its own is not an operator.\n", state->textLine);
+                return NULL;
+            }
+            putToken(state, TYPE_MONADIC, 3);
+            return text + 2;
+
+        case '*': putToken(state, TYPE_OPERATOR, 3); break;
+        case '/': putToken(state, TYPE_OPERATOR, 4); break;
+
+        case '>':
+            if (next == '=') {
+                putToken(state, TYPE_OPERATOR, 5);
+                return text + 2;
+            }
+            putToken(state, TYPE_OPERATOR, 6);
+            break;
+
+        case '<':
+            if (next == '>' || next == '=') {
+                putToken(state, TYPE_OPERATOR, (next == '>' ? 9 : 10));
+                return text + 2;
+            }
+            putToken(state, TYPE_OPERATOR, 11);
+            break;
+
+        case '|':
+            if (next != '|') {
+                fprintf(stderr, "\n\nERROR: tokeniseSymbol(): Line %lu, '|' on its own is not an operator.\n", state->textLine);
+                return NULL;
+            }
+            putToken(state, TYPE_OPERATOR, 12);
+            return text + 2;
+
+        case '&':
+            if (next == '&') {
+                putToken(state, TYPE_OPERATOR, 13);
+                return text + 2;
+            }
+            putToken(state, TYPE_OPERATOR, 16);
+            break;
+
+        case '^':
+            if (next == '^') {
+                putToken(state, TYPE_OPERATOR, 14);
+                return text + 2;
+            }
+            putToken(state, TYPE_OPERATOR, 15);
+            break;
+
+        case ':':
+            endStatement(state);
+            putToken(state, TYPE_SYMBOL, SYMBOL_COLON);
+            newStatement(state);
+            break;
+
+        case ',':
+            if (state->depth) {
+                putToken(state, TYPE_SYMBOL, SYMBOL_COMMA);
+            } else {
+                putToken(state, TYPE_SEPARATOR, 1);
+            }
+            break;
+
+        case '#': putToken(state, TYPE_SYMBOL, SYMBOL_HASH); break;
+        case '(': putToken(state, TYPE_SYMBOL, SYMBOL_LPAREN); break;
+        case ')': putToken(state, TYPE_SYMBOL, SYMBOL_RPAREN); break;
+        case '{': putToken(state, TYPE_SYMBOL, 7); break;
+        case '}': putToken(state, TYPE_SYMBOL, 8); break;
+        case ';': putToken(state, TYPE_SEPARATOR, 2); break;
+        case '\\': putToken(state, TYPE_SEPARATOR, 3); break;
+        case '!': putToken(state, TYPE_SEPARATOR, 4); break;
+
+        default:
+            fprintf(stderr, "\n\nERROR: tokeniseSymbol(): Line %lu, unexpected character '%c'.\n", state->textLine, *text);
+            return NULL;
+    }
+
+    return text + 1;
+}
+
+
+/*=============================================================================
+ * PUTTOKEN() Adds a two byte token to the program, and remembers it.
+ *===========================================================================*/
+void putToken(tokState *state, uchar type, uchar code) {
+    savPutToken(&program, type, code);
+    noteToken(state, type, code);
+}
+
+
+/*=============================================================================
+ * NOTETOKEN() Remembers the token just added, for the ones that follow.
+ *===========================================================================*/
+void noteToken(tokState *state, uchar type, uchar code) {
+    ushort bracket = (type == TYPE_SYMBOL && (code == SYMBOL_LPAREN || code == SYMBOL_RPAREN));
+
+    state->lastType = type;
+    state->lastCode = code;
+    state->statementStart = 0;
+
+    /* Is there something on the left of the next + or -? */
+    state->expectOperand = !(type == TYPE_NAME || type == TYPE_STRING ||
+                             type >= TYPE_FP_BIN_MIN ||
+                             (type == TYPE_SYMBOL && code == SYMBOL_RPAREN));
+
+    if (bracket) {
+        if (code == SYMBOL_LPAREN) {
+            state->depth++;
+        } else if (state->depth) {
+            state->depth--;
+        }
+    } else if (state->depth == 0) {
+        /* Only name = or name(...) = assign. */
+        if (type == TYPE_NAME && state->assignState == ASSIGN_START) {
+            state->assignState = ASSIGN_TARGET;
+        } else {
+            state->assignState = ASSIGN_NONE;
+        }
+    }
+}
+
+
+/*=============================================================================
+ * NEWSTATEMENT() Gets ready for the start of a statement, at the start of a
+ * line, after a colon, THEN or ELSE.
+ *===========================================================================*/
+void newStatement(tokState *state) {
+    state->statementStart = 1;
+    state->expectOperand = 1;
+    state->assignState = ASSIGN_START;
+    state->depth = 0;
+    state->candidate = -1;
+    state->nameUse = 0;
+    state->dimContext = 0;
+    state->defContext = 0;
+    state->target = -1;
+}
+
+
+/*=============================================================================
+ * ENDSTATEMENT() A name that started the statement, and wasn't assigned to,
+ * was a PROC call.
+ *===========================================================================*/
+void endStatement(tokState *state) {
+    if (state->candidate >= 0) {
+        names[state->candidate].used |= USED_CALL;
+        state->candidate = -1;
+    }
+}
+
+
+/*=============================================================================
+ * NAMETYPES() Works out the type of every name, from how it was used. A
+ * DEFine beats everything, then DIM, then loops, then being assigned to, a
+ * LOCal or a parameter, so a$(2) is a slice of a variable. Names that were
+ * called, but not DEFined here, must be machine code PROCs or FNs, like
+ * PRINT or CHR$.
+ *===========================================================================*/
+void nameTypes(void) {
+    ulong x;
+    tokName *entry;
+
+    for (x = 0; x < nameCount; x++) {
+        entry = &names[x];
+
+        if (entry->used & USED_DEFPROC) {
+            entry->nameType = (NAME_SB_PROC << 8) | VAR_FLOAT;
+        } else if (entry->used & USED_DEFFN) {
+            entry->nameType = (NAME_SB_FN << 8) | entry->varType;
+        } else if (entry->used & USED_DIM) {
+            entry->nameType = (NAME_ARRAY << 8) | entry->varType;
+        } else if (entry->used & USED_REPEAT) {
+            entry->nameType = NAME_REPEAT << 8;
+        } else if (entry->used & USED_FOR) {
+            entry->nameType = (NAME_FOR << 8) | entry->varType;
+        } else if (entry->used & USED_VARIABLE) {
+            entry->nameType = (NAME_VARIABLE << 8) | entry->varType;
+        } else if (entry->used & USED_CALL) {
+            entry->nameType = NAME_MC_PROC << 8;
+        } else if (entry->used & USED_PAREN) {
+            entry->nameType = NAME_MC_FN << 8;
+        } else {
+            entry->nameType = (NAME_VARIABLE << 8) | entry->varType;
+        }
+    }
+}
+
+
+/*=============================================================================
+ * WRITESAV() Writes the header, the name table and the program. The name
+ * table length is the space SuperBASIC needs for the names, each one has a
+ * length byte then the characters.
+ *===========================================================================*/
+ushort writeSav(char *fileName) {
+    savBuffer head;
+    ulong nameTableLength = 0;
+    ulong x;
+    FILE *fp;
+    ushort result = 0;
+
+    savInitBuffer(&head);
+    for (x = 0; x < nameCount; x++) {
+        nameTableLength += names[x].nameLength + 1;
+    }
+
+    savPutHeader(&head, NULL, nameCount,
+                 (nameTableLength > 0xFFFF ? 0xFFFF : nameTableLength),
+                 (lineCount > 0xFFFF ? 0xFFFF : lineCount));
+    for (x = 0; x < nameCount; x++) {
+        savPutNameEntry(&head, names[x].nameType, names[x].lineNumber, names[x].name, names[x].nameLength);
+    }
+
+    fp = fopen(fileName, "wb");
+    if (!fp) {
+        fprintf(stderr, "\n\nERROR: writeSav(): Cannot create '%s'.\n", fileName);
+        savFreeBuffer(&head);
+        return 1;
+    }
+
+    if (savWriteBuffer(fp, &head) != SAV_OK || savWriteBuffer(fp, &program) != SAV_OK) {
+        result = 1;
+    }
+
+    fclose(fp);
+    savFreeBuffer(&head);
+    return result;
+}
+
+
+/*=============================================================================
+ * SAVEXTENSION() Makes the SAV file name from the text file name. 'bas' at
+ * the end becomes 'sav', anything else gets '_sav' added.
+ *===========================================================================*/
+void savExtension(char *textFile, char *savFile) {
+    ushort size = strlen(textFile);
+
+    if (size > MAXPATH - 4) {
+        size = MAXPATH - 4;
+    }
+
+    memcpy(savFile, textFile, size);
+    savFile[size] = '\0';
+
+    if (size > 4 && (savFile[size - 4] == '_' || savFile[size - 4] == '.') &&
+        upper[(uchar)savFile[size - 3]] == 'B' &&
+        upper[(uchar)savFile[size - 2]] == 'A' &&
+        upper[(uchar)savFile[size - 1]] == 'S') {
+        strcpy(&savFile[size - 3], "sav");
+    } else {
+        strcat(savFile, "_sav");
+    }
+}
@@ -0,0 +1,101 @@
+#ifndef __SAVTOKENISE_H__
+#define __SAVTOKENISE_H__
+
+/*===========================================================================
+ * HEADERS
+ *===========================================================================*/
+#include "../SavFile/savFile.h"
+
+/*===========================================================================
+ * DEFINES
+ *===========================================================================*/
+#define MAXLINENUMBER 32767         /* SuperBASIC's biggest line number. */
+#define WORDHASHSIZE 64             /* Slots in the keyword hash, power of 2. */
+#define MAXWORDSIZE 9               /* PROCEDURE, FUNCTION and REMAINDER. */
+#define MAXNUMBERSIZE 64            /* Longest number we will read. */
+#define MAXNAMES 65535              /* The name table is indexed by a word. */
+#define MAXMULTISPACE 255           /* Spaces in one multispace token. */
+
+/* What we learn about a name as it's used. These decide its type in the
+ * name table, when the whole program has been seen. */
+#define USED_DEFPROC    0x01        /* DEFine PROCedure name */
+#define USED_DEFFN      0x02        /* DEFine FuNction name */
+#define USED_DIM        0x04        /* DIM name( or LOCal name( */
+#define USED_REPEAT     0x08        /* REPeat name */
+#define USED_FOR        0x10        /* FOR name = */
+#define USED_CALL       0x20        /* A statement on its own, a PROC call. */
+#define USED_PAREN      0x40        /* name( in an expression, a FN call. */
+#define USED_VARIABLE   0x80        /* Assigned to, a LOCal or a parameter. */
+
+/* Where we are in a statement, for telling = from ==, and a PROC call from
+ * an assignment. */
+#define ASSIGN_START    0           /* Nothing yet, a name may be assigned. */
+#define ASSIGN_TARGET   1           /* Seen the name, = would assign to it. */
+#define ASSIGN_NONE     2           /* Any = from now on is a comparison. */
+
+/*===========================================================================
+ * TYPEDEFS
+ *===========================================================================*/
+
+/* One entry in the keyword hash. The word is upper case. */
+typedef struct tokWord {
+    char   word[MAXWORDSIZE + 1];
+    uchar  length;
+    uchar  type;                    /* TYPE_KEYWORD, TYPE_OPERATOR etc. */
+    uchar  code;
+} tokWord;
+
+/* One name. The name points into the text, which is kept until the SAV
+ * file has been written. */
+typedef struct tokName {
+    uchar *name;
+    ushort nameLength;
+    ushort nameType;                /* Worked out by nameTypes(). */
+    short  lineNumber;              /* Where it was DEFined. */
+    uchar  varType;                 /* VAR_STRING, VAR_FLOAT or VAR_INTEGER. */
+    uchar  used;                    /* USED_* flags. */
+} tokName;
+
+/* Everything we need to know about the line being tokenised. */
+typedef struct tokState {
+    ushort lineNumber;
+    ulong  textLine;                /* Line in the text file, for errors. */
+    ushort statementStart;          /* Next token starts a statement. */
+    ushort expectOperand;           /* So + and - are monadic. */
+    ushort assignState;             /* ASSIGN_* */
+    ushort depth;                   /* Inside how many brackets? */
+    long   candidate;               /* Name that may be a PROC call, or -1. */
+    uchar  lastType;                /* The previous token. */
+    uchar  lastCode;
+    uchar  nameUse;                 /* USED_* for the next name, if any. */
+    ushort dimContext;              /* In a DIM or LOCal statement. */
+    ushort defContext;              /* After a DEFine's name, so parameters. */
+    long   target;                  /* Name that may be assigned to, or -1. */
+} tokState;
+
+/*===========================================================================
+ * FUNCTION PROTOTYPES
+ *===========================================================================*/
+ushort buildWordTable(void);
+ushort addWord(char *word, uchar type, uchar code);
+ushort wordHash(uchar *word, ushort length);
+tokWord *findWord(uchar *word, ushort length);
+long   findName(uchar *name, ushort length);
+
+ushort tokeniseText(uchar *text, ulong size);
+ushort tokeniseLine(uchar *text, uchar *end, ulong textLine);
+uchar *tokeniseWord(uchar *text, uchar *end, tokState *state);
+uchar *tokeniseNumber(uchar *text, uchar *end, tokState *state);
+uchar *tokeniseSymbol(uchar *text, uchar *end, tokState *state);
+void   putToken(tokState *state, uchar type, uchar code);
+void   noteToken(tokState *state, uchar type, uchar code);
+void   newStatement(tokState *state);
+void   endStatement(tokState *state);
+
+void   nameTypes(void);
+ushort writeSav(char *fileName);
+void   savExtension(char *textFile, char *savFile);
+
+/*===========================================================================*/
+
+#endif /* __SAVTOKENISE_H__ */
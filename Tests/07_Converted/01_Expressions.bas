@@ -0,0 +1,31 @@
+100 a$ = "Hello"
+110 PRINT a$
+120 a$ = a$ & " World"
+130 PRINT a$
+140 PRINT a$(7 TO 9)
+150 PRINT a$(7)
+160 PRINT a$(7 TO)
+170 PRINT a$(TO 5)
+180 a$ = a$(7 TO)
+190 PRINT a$
+200 PRINT "OR" INSTR a$
+210 PRINT "x" INSTR a$
+220 b$ = "abc" : c$ = "ABC"
+230 PRINT b$ < "abd"
+240 PRINT c$ == b$
+250 PRINT c$ = b$
+260 PRINT "1.5" + 1
+270 PRINT b$ & 0.5
+280 x = 1E10 : PRINT b$ & x
+290 x = -1 : PRINT b$ & x / 3
+300 x = 2.5 : i% = x : PRINT i%
+310 x = -2.5 : i% = x : PRINT i%
+320 x = -7 : PRINT x MOD 2
+330 x = 7 : PRINT x MOD -2
+340 x = -7 : PRINT x DIV 2
+350 x = 7 : PRINT x DIV 2
+360 x = 1 : PRINT x == 1.00000001
+370 PRINT x == 1.001
+380 i% = 9 : PRINT "9" / i%
+390 PRINT 10 - 2 * 3 ^ 2
+400 PRINT NOT 0, 1 AND 0, 1 OR 0
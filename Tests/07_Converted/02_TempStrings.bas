@@ -0,0 +1,18 @@
+100 a$ = "a" : b$ = "b"
+110 PRINT a$&b$&a$&b$&a$&b$&a$&b$&a$&b$&a$&b$&a$&b$&a$&b$&a$&b$&a$&b$&a$&b$&a$&b$
+120 PRINT (a$&b$) & many$(10)
+130 PRINT back$("SuperBASIC")
+140 PRINT a$ & back$(a$ & b$ & "cd") & b$
+150 c$ = "SuperBASIC"
+160 PRINT c$(10)&c$(9)&c$(8)&c$(7)&c$(6)&c$(5)&c$(4)&c$(3)&c$(2)&c$(1)&c$(10 TO)&c$(TO 1)
+170 STOP
+1000 DEFine FuNction many$(n)
+1010   LOCal r$, i
+1020   r$ = ""
+1030   FOR i = 1 TO n : r$ = r$ & i
+1040   RETurn r$
+1050 END DEFine
+2000 DEFine FuNction back$(s$)
+2010   IF LEN(s$) < 2 THEN RETurn s$
+2020   RETurn back$(s$(2 TO)) & s$(1)
+2030 END DEFine
@@ -0,0 +1,23 @@
+100 FOR i = 1 TO 3
+110   PRINT "i =" ! i
+120   NEXT i
+130   PRINT "done"
+140 END FOR i
+150 FOR j = 1, 5 TO 6
+160   PRINT "j =" ! j
+170   NEXT j
+180   PRINT "after"
+190 END FOR j
+200 n = 0 : e = 7.5
+210 FOR k = 1 TO e : n = n + 1
+220 PRINT "1 TO 7.5:" ! n ! k
+230 n = 0 : e = 2.5
+240 FOR k = 9 TO e STEP -1 : n = n + 1
+250 PRINT "9 TO 2.5 STEP -1:" ! n ! k
+255 e = 1E20
+260 FOR k = 1 TO e
+270   IF k = 3 THEN EXIT k
+280 END FOR k
+290 PRINT "1 TO 1E20, EXIT at" ! k
+300 FOR x = 0 TO 1 STEP 0.25 : PRINT x
+310 FOR i% = 3 TO 1 STEP -1 : PRINT "i% =" ! i%
@@ -0,0 +1,22 @@
+100 FOR x = 0, 3, 3.5, 4.5, 6, 7, 20, 21
+110   SELect ON x
+120     = 1 TO 5 : PRINT x ! "is 1 TO 5"
+130     = 7 : PRINT x ! "is 7"
+140     = 10 TO 20 : PRINT x ! "is 10 TO 20"
+150     = REMAINDER : PRINT x ! "is none of them"
+160   END SELect
+170 END FOR x
+200 FOR n% = 1 TO 4
+210   SELect ON n%
+220     = 1 : PRINT "one"
+230     = 2, 3 : PRINT "two or three"
+240     = REMAINDER : PRINT "more"
+250   END SELect
+260 END FOR n%
+300 FOR x = 2, 2.5, 3
+310   SELect ON x
+320     = 2 : PRINT x ! "is 2"
+330     = 3 : PRINT x ! "is 3"
+340     = REMAINDER : PRINT x ! "is neither"
+350   END SELect
+360 END FOR x
@@ -0,0 +1,48 @@
+100 a = 1 : n% = 2 : s$ = "ab"
+110 double a : PRINT "a =" ! a
+120 double 1 + 2
+130 bump n% : PRINT "n% =" ! n%
+140 bump 2
+150 twice s$ : PRINT "s$ =" ! s$
+160 twice "cd"
+170 twice unset$ : PRINT "unset$ = '" & unset$ & "'"
+180 PRINT "half(7) =" ! half(7)
+190 PRINT "whole%(7.6) =" ! whole%(7.6)
+200 PRINT "upper$('abc') =" ! upper$("abc")
+210 PRINT "sum(10) =" ! sum(a, 10)
+220 PRINT "add(1, deep(40, 0)) =" ! add(1, deep(40, 0)) ! add(deep(40, 0), 1)
+230 STOP
+1000 DEFine PROCedure double(x)
+1010   x = x * 2
+1020   PRINT "double:" ! x
+1030 END DEFine
+1100 DEFine PROCedure bump(i%)
+1110   i% = i% + 1
+1120   PRINT "bump:" ! i%
+1130 END DEFine
+1200 DEFine PROCedure twice(t$)
+1210   t$ = t$ & t$
+1220   PRINT "twice: '" & t$ & "'"
+1230 END DEFine
+1300 DEFine FuNction half(v)
+1310   RETurn v / 2
+1320 END DEFine
+1400 DEFine FuNction whole%(v)
+1410   RETurn v
+1420 END DEFine
+1500 DEFine FuNction upper$(u$)
+1510   RETurn u$ & "ABC"
+1520 END DEFine
+1600 DEFine FuNction sum(total, k)
+1610   IF k = 0 THEN RETurn total
+1620   RETurn sum(total + k, k - 1)
+1630 END DEFine
+1700 DEFine FuNction add(p, q)
+1710   p = p + q : q = 0
+1720   RETurn p
+1730 END DEFine
+1800 DEFine FuNction deep(d, r)
+1810   r = r + 1
+1820   IF d = 0 THEN RETurn r
+1830   RETurn deep(d - 1, r * 0 + d)
+1840 END DEFine
@@ -0,0 +1,34 @@
+100 fred = 1.5 : barney% = 10 : wilma$ = "global"
+110 show "Outside any scope:"
+120 test_1
+130 show "Outside any scope:"
+140 PRINT "count(3) =" ! count(3)
+150 PRINT "keep(2) =" ! keep(2) ! "fred =" ! fred
+160 STOP
+1000 DEFine PROCedure show(where$)
+1010   PRINT where$ ! "fred =" ! fred ! "barney% =" ! barney% ! "wilma$ =" ! wilma$
+1020 END DEFine
+1100 DEFine PROCedure test_1
+1110   LOCal fred, wilma$
+1120   fred = 2.5 : wilma$ = "local"
+1130   show "In test_1:"
+1140   test_2
+1150   show "Back in test_1:"
+1160 END DEFine
+1200 DEFine PROCedure test_2
+1210   LOCal barney%
+1220   barney% = 20
+1230   show "In test_2:"
+1240   fred = fred + 1
+1250 END DEFine
+1300 DEFine FuNction count(n)
+1310   LOCal i, total
+1320   total = 0
+1330   FOR i = 1 TO n : total = total + i
+1340   RETurn total
+1350 END DEFine
+1400 DEFine FuNction keep(n)
+1410   LOCal fred, list(10)
+1420   fred = n * 10
+1430   RETurn fred + 1
+1440 END DEFine
@@ -0,0 +1,13 @@
+100 IF INKEY$(#1) = "x" THEN PRINT "INKEY$(#1) = 'x': yes" : ELSE PRINT "INKEY$(#1) = 'x': no"
+110 IF INKEY$(#2) = "x" THEN PRINT "INKEY$(#2) = 'x': yes" : ELSE PRINT "INKEY$(#2) = 'x': no"
+120 PRINT "unset% + 1 =" ! unset% + 1
+130 PRINT "unset + 0.5 =" ! unset + 0.5
+140 PRINT "'[' & unset$ & ']' =" ! "[" & unset$ & "]"
+150 i% = 30000 : j% = i% + 2767 : PRINT "30000 + 2767 =" ! j%
+160 i% = 7 : j% = i% / 2 : PRINT "7 / 2 =" ! j%
+170 k = i% * 10000 : PRINT "7 * 10000 =" ! k
+180 s$ = 12 : PRINT "s$ = 12:" ! s$ & "!"
+190 n = "3.25" : PRINT "n = '3.25':" ! n * 2
+200 PRINT "LEN('abc') + 1 =" ! LEN("abc") + 1
+210 j% = i% * 10000
+220 PRINT "Not reached, j% =" ! j%
@@ -0,0 +1,58 @@
+#ifndef __MCPROCS_H__
+#define __MCPROCS_H__
+
+/* Stand ins for the machine code PROCedures and FuNctions that the test
+ * programs use, which C68Port leaves as calls, by name, for the QL's own
+ * versions. They are just enough to print the results.
+ *
+ * C68Port doesn't pass on PRINT's separators, so PRINT puts a space between
+ * the items, and ends the line. Floats are printed the way SuperBASIC would,
+ * with sbStr(). PRINT can take up to 8 items.
+ *
+ * runTests.sh includes this before the converted program, with gcc's
+ * -include.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "SBRuntime.h"
+
+static void mcPrintString(SB_CHAR *text) {
+    printf("%s", (text ? text : ""));
+}
+
+static void mcPrintFloat(SB_FLOAT value) {
+    printf("%s", sbStr(value));
+}
+
+static void mcPrintWhole(long value) {
+    printf("%ld", value);
+}
+
+#define MC_ITEM(x) _Generic((x), SB_CHAR *: mcPrintString, float: mcPrintFloat, \
+                            SB_FLOAT: mcPrintFloat, default: mcPrintWhole)(x)
+
+#define MC_1(a) MC_ITEM(a)
+#define MC_2(a, ...) MC_ITEM(a), printf(" "), MC_1(__VA_ARGS__)
+#define MC_3(a, ...) MC_ITEM(a), printf(" "), MC_2(__VA_ARGS__)
+#define MC_4(a, ...) MC_ITEM(a), printf(" "), MC_3(__VA_ARGS__)
+#define MC_5(a, ...) MC_ITEM(a), printf(" "), MC_4(__VA_ARGS__)
+#define MC_6(a, ...) MC_ITEM(a), printf(" "), MC_5(__VA_ARGS__)
+#define MC_7(a, ...) MC_ITEM(a), printf(" "), MC_6(__VA_ARGS__)
+#define MC_8(a, ...) MC_ITEM(a), printf(" "), MC_7(__VA_ARGS__)
+#define MC_PICK(_1, _2, _3, _4, _5, _6, _7, _8, N, ...) N
+
+#define PRINT(...) (MC_PICK(__VA_ARGS__, MC_8, MC_7, MC_6, MC_5, MC_4, MC_3, MC_2, MC_1)(__VA_ARGS__), \
+                    printf("\n"))
+
+#define STOP() exit(0)
+
+#define LEN(text) ((SB_INTEGER)strlen((text) ? (text) : ""))
+
+/* The next key pressed, which is always 'x' in #1, and 'y' anywhere else. */
+static SB_CHAR *INKEY_s(int channel) {
+    return (channel == 1 ? "x" : "y");
+}
+
+#endif
@@ -0,0 +1,72 @@
+#!/bin/bash
+#
+# Convert every SuperBASIC program named *.bas in the current directory, and
+# check that it prints what it should. Each one is tokenised by SavTokenise,
+# converted by C68Port, compiled with SBRuntime, SBLocal and the stand ins
+# in mcProcs.h, then run, and what it prints is compared with the file of
+# the same name ending .out. There are no extensions required to run just
+# some of them, so:
+#
+#     ./runTests.sh 01_Expressions
+#
+# The tools, and everything each test makes, go in work/. Exits 1 if any
+# test fails.
+#
+CC="${CC:-gcc}"
+ROOT=../..
+WORK=work
+
+mkdir -p "${WORK}"
+
+${CC} -o "${WORK}/SavTokenise" ${ROOT}/SavTokenise/savTokenise.c ${ROOT}/SavFile/savFile.c -lm || exit 1
+${CC} -o "${WORK}/C68Port" ${ROOT}/C68Port/c68port.c ${ROOT}/C68Port/symbols.c ${ROOT}/C68Port/ast.c \
+    ${ROOT}/C68Port/blocks.c ${ROOT}/C68Port/expr.c ${ROOT}/C68Port/gen.c ${ROOT}/Arena/arena.c \
+    ${ROOT}/SavFile/savFile.c ${ROOT}/Xref/xref.c -lm || exit 1
+
+tests="$*"
+if [ -z "${tests}" ]; then
+    tests=`ls *.bas | sed 's/\.bas$//'`
+fi
+
+passed=0
+failed=0
+for t in ${tests}
+do
+    rm -f "${WORK}/${t}" "${WORK}/${t}"_*
+    cp "${t}.bas" "${WORK}/${t}_txt"
+
+    if ! (cd "${WORK}" && ./SavTokenise -o "${t}_sav" "${t}_txt" && ./C68Port "${t}_sav") >"${WORK}/${t}_log" 2>&1; then
+        echo "FAIL: ${t} didn't convert, see ${WORK}/${t}_log."
+        failed=$((failed + 1))
+        continue
+    fi
+
+    if ! ${CC} -o "${WORK}/${t}" -I ${ROOT}/SBLocal -I ${ROOT}/SBRuntime -include mcProcs.h -I . \
+            -x c "${WORK}/${t}_c" -x none ${ROOT}/SBRuntime/SBRuntime.c ${ROOT}/SBLocal/SBLocal.c -lm \
+            >>"${WORK}/${t}_log" 2>&1; then
+        echo "FAIL: ${t} didn't compile, see ${WORK}/${t}_log."
+        failed=$((failed + 1))
+        continue
+    fi
+
+    # A program may stop with an error, as SuperBASIC would, but not crash.
+    "./${WORK}/${t}" >"${WORK}/${t}_run" 2>&1
+    if [ $? -gt 128 ]; then
+        echo "FAIL: ${t} crashed, see ${WORK}/${t}_run."
+        failed=$((failed + 1))
+        continue
+    fi
+
+    if ! diff "${t}.out" "${WORK}/${t}_run" >"${WORK}/${t}_diff"; then
+        echo "FAIL: ${t} printed the wrong results, see ${WORK}/${t}_diff."
+        failed=$((failed + 1))
+        continue
+    fi
+
+    echo "PASS: ${t}"
+    passed=$((passed + 1))
+done
+
+echo
+echo "${passed} passed, ${failed} failed."
+[ ${failed} -eq 0 ]
@@ -0,0 +1,221 @@
+/*=============================================================================
+ * Cross reference (XREF) for the Lister and the converter.
+ *
+ * While a program is being decoded, every name token is passed to xrefUse(),
+ * along with the line it's on, and added to that name's list of lines. When
+ * the whole program has been decoded, xrefWrite() reports, for every entry
+ * in the name table, what it is, the line it was DEFined on, for PROCs and
+ * FNs, and every line that uses it. The file is only read once.
+ *
+ * Each name's lines are a small array of words, which doubles in size when
+ * it's full, so a name used on thousands of lines costs a dozen or so calls
+ * to realloc(), not thousands.
+ *===========================================================================*/
+
+/*===========================================================================
+ * HEADERS
+ *===========================================================================*/
+#include "xref.h"
+
+/*===========================================================================
+ * GLOBALS
+ *===========================================================================*/
+ushort xrefMode = XREF_NONE;        /* XREF_NONE, XREF_TEXT or XREF_JSON. */
+
+xrefEntry *xrefTable = NULL;        /* One per name table entry. */
+ushort xrefSize = 0;
+
+
+/*=============================================================================
+ * XREFINIT() Sets up an empty list of lines for each name table entry.
+ *===========================================================================*/
+ushort xrefInit(ushort entries) {
+    xrefFree();
+
+    xrefTable = calloc((entries ? entries : 1), sizeof(xrefEntry));
+    if (!xrefTable) {
+        fprintf(stderr, "\n\nERROR: xrefInit(): Cannot allocate memory for cross reference. (%d entries).\n", entries);
+        return 1;
+    }
+
+    xrefSize = entries;
+    return 0;
+}
+
+
+/*=============================================================================
+ * XREFUSE() Records that a name is used on a line. A name used more than once
+ * on a line is only recorded once.
+ *===========================================================================*/
+ushort xrefUse(ushort entry, ushort lineNumber) {
+    xrefEntry *xref;
+    ushort *temp;
+    ulong space;
+
+    if (entry >= xrefSize) {
+        return 1;
+    }
+
+    xref = &xrefTable[entry];
+    if (xref->count && xref->lines[xref->count - 1] == lineNumber) {
+        return 0;
+    }
+
+    if (xref->count == xref->space) {
+        space = (xref->space ? xref->space * 2 : 4);
+        temp = realloc(xref->lines, space * sizeof(ushort));
+        if (!temp) {
+            fprintf(stderr, "\n\nERROR: xrefUse(): Cannot allocate memory for cross reference. (%ld lines).\n", space);
+            return 1;
+        }
+
+        xref->lines = temp;
+        xref->space = space;
+    }
+
+    xref->lines[xref->count++] = lineNumber;
+    return 0;
+}
+
+
+/*=============================================================================
+ * XREFTYPENAME() What a name is, from the high byte of its type.
+ *===========================================================================*/
+char *xrefTypeName(ushort nameType) {
+    switch (nameType >> 8) {
+        case 0x00: return "unset";
+        case 0x02: return "variable";
+        case 0x03: return "array";
+        case 0x06: return "REPeat";
+        case 0x07: return "FOR";
+        case 0x08: return "MC PROC";
+        case 0x09: return "MC FN";
+        case 0x14: return "PROC";
+        case 0x15: return "FN";
+    }
+
+    return "unknown";
+}
+
+
+/*=============================================================================
+ * XREFTYPESUFFIX() The variable type, from the low byte of a name's type, as
+ * SuperBASIC would show it.
+ *===========================================================================*/
+char *xrefTypeSuffix(ushort nameType) {
+    switch (nameType & 0xFF) {
+        case 1: return "$";
+        case 3: return "%";
+    }
+
+    return "";
+}
+
+
+/*=============================================================================
+ * XREFJSONSTRING() Writes bytes as a quoted JSON string.
+ *===========================================================================*/
+void xrefJsonString(FILE *fp, uchar *text, ushort size) {
+    ushort x;
+
+    fputc('"', fp);
+    for (x = 0; x < size; x++) {
+        if (text[x] == '"' || text[x] == '\\') {
+            fprintf(fp, "\\%c", text[x]);
+        } else if (text[x] < 32 || text[x] > 126) {
+            fprintf(fp, "\\u%04x", text[x]);
+        } else {
+            fputc(text[x], fp);
+        }
+    }
+
+    fputc('"', fp);
+}
+
+
+/*=============================================================================
+ * XREFWRITE() Writes the report, as text or JSON. Names that aren't used at
+ * all are included, they are probably left over from deleted lines.
+ *===========================================================================*/
+void xrefWrite(FILE *fp, char *fileName, nameTableEntry *names, ushort entries, ushort format) {
+    ushort x;
+    ulong line;
+    xrefEntry *xref;
+    char typeText[16];
+
+    if (format == XREF_JSON) {
+        fprintf(fp, "{\n  \"file\": ");
+        xrefJsonString(fp, (uchar *)fileName, strlen(fileName));
+        fprintf(fp, ",\n  \"names\": [");
+    } else {
+        fprintf(fp, "CROSS REFERENCE: %s\n\n", fileName);
+        fprintf(fp, "%5s %-32s %-12s %7s  %s\n", "Entry", "Name", "Type", "Defined", "Lines");
+    }
+
+    for (x = 0; x < entries; x++) {
+        xref = (x < xrefSize ? &xrefTable[x] : NULL);
+
+        if (format == XREF_JSON) {
+            fprintf(fp, "%s\n    {\"entry\": %d, \"name\": ", (x ? "," : ""), x);
+            xrefJsonString(fp, names[x].name, names[x].nameLength);
+            fprintf(fp, ", \"type\": \"%s%s\", \"nameType\": %d, \"defined\": %d, \"lines\": [",
+                    xrefTypeName(names[x].nameType), xrefTypeSuffix(names[x].nameType),
+                    names[x].nameType, names[x].lineNumber);
+
+            for (line = 0; xref && line < xref->count; line++) {
+                fprintf(fp, "%s%d", (line ? ", " : ""), xref->lines[line]);
+            }
+
+            fprintf(fp, "]}");
+            continue;
+        }
+
+        sprintf(typeText, "%s%s", xrefTypeName(names[x].nameType), xrefTypeSuffix(names[x].nameType));
+        fprintf(fp, "%5d %-32.*s %-12s ", x, names[x].nameLength, names[x].name, typeText);
+
+        if (names[x].lineNumber > 0) {
+            fprintf(fp, "%7d", names[x].lineNumber);
+        } else {
+            fprintf(fp, "%7s", "");
+        }
+
+        if (!xref || !xref->count) {
+            fprintf(fp, " Not used\n");
+            continue;
+        }
+
+        for (line = 0; line < xref->count; line++) {
+            if (line && line % XREF_PER_ROW == 0) {
+                fprintf(fp, "\n%*s", 59, "");
+            }
+            fprintf(fp, " %5d", xref->lines[line]);
+        }
+
+        fputc('\n', fp);
+    }
+
+    if (format == XREF_JSON) {
+        fprintf(fp, "\n  ]\n}\n");
+    }
+
+    fflush(fp);
+}
+
+
+/*=============================================================================
+ * XREFFREE() Frees the cross reference.
+ *===========================================================================*/
+void xrefFree(void) {
+    ushort x;
+
+    if (xrefTable) {
+        for (x = 0; x < xrefSize; x++) {
+            free(xrefTable[x].lines);
+        }
+
+        free(xrefTable);
+    }
+
+    xrefTable = NULL;
+    xrefSize = 0;
+}
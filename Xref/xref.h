@@ -0,0 +1,53 @@
+#ifndef __XREF_H__
+#define __XREF_H__
+
+/*===========================================================================
+ * HEADERS
+ *===========================================================================*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* The Lister's header has the same guard, and the same types. */
+#include "../C68Port/c68port.h"
+
+/*===========================================================================
+ * DEFINES
+ *===========================================================================*/
+#define XREF_NONE   0               /* No cross reference wanted. */
+#define XREF_TEXT   1               /* Plain text report. */
+#define XREF_JSON   2               /* JSON report. */
+
+#define XREF_PER_ROW 10             /* Line numbers per row in a text report. */
+
+/*===========================================================================
+ * TYPEDEFS
+ *===========================================================================*/
+
+/* Where one name is used. The lines are in the order they were seen, with
+ * no repeats for a name used more than once on the same line. */
+typedef struct xrefEntry {
+    ushort *lines;
+    ulong  count;
+    ulong  space;
+} xrefEntry;
+
+/*===========================================================================
+ * FUNCTION PROTOTYPES
+ *===========================================================================*/
+ushort xrefInit(ushort entries);
+ushort xrefUse(ushort entry, ushort lineNumber);
+void   xrefWrite(FILE *fp, char *fileName, nameTableEntry *names, ushort entries, ushort format);
+void   xrefFree(void);
+char  *xrefTypeName(ushort nameType);
+char  *xrefTypeSuffix(ushort nameType);
+void   xrefJsonString(FILE *fp, uchar *text, ushort size);
+
+/*===========================================================================
+ * GLOBALS
+ *===========================================================================*/
+extern ushort xrefMode;
+
+/*===========================================================================*/
+
+#endif /* __XREF_H__ */